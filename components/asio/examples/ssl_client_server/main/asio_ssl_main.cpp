@@ -6,6 +6,7 @@
 //
 
 #include <string>
+#include <cstring>
 #include "protocol_examples_common.h"
 #include "esp_event.h"
 #include "nvs_flash.h"
@@ -73,7 +74,11 @@ private:
         socket_.async_handshake(asio::ssl::stream_base::client,
         [this](const std::error_code & error) {
             if (!error) {
+#if CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK
+                start_benchmark();
+#else
                 send_request();
+#endif // CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK
             } else {
                 std::cout << "Handshake failed: " << error.message() << "\n";
             }
@@ -110,6 +115,50 @@ private:
         });
     }
 
+#if CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK
+    static constexpr std::size_t benchmark_size = CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK_SIZE * 1024;
+
+    void start_benchmark()
+    {
+        std::memset(request_, 'A', max_length);
+        start_ = std::chrono::steady_clock::now();
+        benchmark_step();
+    }
+
+    // writes one chunk to the echo server and waits for it to come back
+    void benchmark_step()
+    {
+        if (transferred_ >= benchmark_size) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_).count();
+            // data travels to the server and back, so count both directions
+            std::cout << "Benchmark: " << transferred_ << " bytes echoed in " << ms << " ms ("
+                      << (ms > 0 ? 2 * transferred_ / ms : 0) << " kB/s)\n";
+            return;
+        }
+        asio::async_write(socket_,
+                          asio::buffer(request_, max_length),
+        [this](const std::error_code & error, std::size_t length) {
+            if (error) {
+                std::cout << "Write failed: " << error.message() << "\n";
+                return;
+            }
+            asio::async_read(socket_,
+                             asio::buffer(reply_, length),
+            [this](const std::error_code & error, std::size_t length) {
+                if (error) {
+                    std::cout << "Read failed: " << error.message() << "\n";
+                    return;
+                }
+                transferred_ += length;
+                benchmark_step();
+            });
+        });
+    }
+
+    std::chrono::steady_clock::time_point start_;
+    std::size_t transferred_ = 0;
+#endif // CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK
+
     asio::ssl::stream<tcp::socket> socket_;
     char request_[max_length] = "GET / HTTP/1.1\r\n\r\n";
     char reply_[max_length];
@@ -145,9 +194,11 @@ private:
         socket_.async_read_some(asio::buffer(data_),
         [this, self](const std::error_code & ec, std::size_t length) {
             if (!ec) {
+#if !CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK
                 std::cout << "Server received: ";
                 std::cout.write(data_, length);
                 std::cout << std::endl;
+#endif // !CONFIG_EXAMPLE_THROUGHPUT_BENCHMARK
                 do_write(length);
             }
         });
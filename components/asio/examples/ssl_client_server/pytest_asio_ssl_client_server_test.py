@@ -1,7 +1,11 @@
-# SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2022-2026 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Unlicense OR CC0-1.0
 from __future__ import unicode_literals
 
 
 def test_examples_asio_ssl(dut):
+    if dut.app.sdkconfig.get('EXAMPLE_THROUGHPUT_BENCHMARK') is True:
+        res = dut.expect(r'Benchmark: (\d+) bytes echoed in (\d+) ms \((\d+) kB/s\)')
+        print('TLS echo throughput: {} kB/s'.format(res.group(3).decode()))
+        return
     dut.expect('Reply: GET / HTTP/1.1')
@@ -1,5 +1,5 @@
 //
-// SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+// SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
 //
 // SPDX-License-Identifier: BSL-1.0
 //
@@ -13,11 +13,20 @@ namespace asio {
 namespace ssl {
 namespace mbedtls {
 
+/**
+ * @brief One half of a BIO pair
+ *
+ * Each bio owns a ring buffer which is filled by its own write() and drained by the peer's read(),
+ * so the data never needs to be shifted back to the beginning of the buffer.
+ */
 class bio {
-    static constexpr int BIO_SIZE = CONFIG_ASIO_SSL_BIO_SIZE;
+    static constexpr size_t BIO_SIZE = CONFIG_ASIO_SSL_BIO_SIZE;
     static constexpr int BIO_FLAGS_READ = 1;
     static constexpr int BIO_FLAGS_WRITE = 2;
 
+    using const_span = std::pair<const uint8_t *, size_t>;
+    using mutable_span = std::pair<uint8_t *, size_t>;
+
 public:
     int write(const void *buf, int len)
     {
@@ -25,19 +34,28 @@ public:
             // not an error, just empty operation (as in openssl/bio)
             return 0;
         }
-        int remaining = size_ - offset_;
-        if (remaining <= 0) {
+        if (count_ == BIO_SIZE) {
             flags_ |= BIO_FLAGS_WRITE;
             return -1;
         }
-        int len_to_write = len > remaining ? remaining : len;
-        std::memcpy(&data_[offset_], buf, len_to_write);
-        offset_ += len_to_write;
-        dlen_ = offset_;
-        if (len_to_write == len) {
+        auto src = static_cast<const uint8_t *>(buf);
+        size_t to_write = static_cast<size_t>(len);
+        size_t written = 0;
+        // at most two chunks: up to the end of the buffer and then from its beginning
+        while (written < to_write) {
+            auto span = write_span();
+            if (span.second == 0) {
+                break;
+            }
+            size_t chunk = std::min(span.second, to_write - written);
+            std::memcpy(span.first, src + written, chunk);
+            commit(chunk);
+            written += chunk;
+        }
+        if (written == to_write) {
             flags_ &= ~BIO_FLAGS_WRITE;
         }
-        return len_to_write;
+        return static_cast<int>(written);
     }
 
     int read(void *buf, int len)
@@ -46,35 +64,37 @@ public:
             // not an error, just empty operation (as in openssl/bio)
             return 0;
         }
-        int remaining = peer_->dlen_ - peer_->roffset_;
-        if (remaining <= 0) {
+        if (peer_->count_ == 0) {
             flags_ |= BIO_FLAGS_READ;
             return -1;
         }
-        int len_to_read = remaining > len ? len : remaining;
-        std::memcpy(buf, &peer_->data_[peer_->roffset_], len_to_read);
-        peer_->roffset_ += len_to_read;
-        if (len_to_read == len) {
-            flags_ &= ~BIO_FLAGS_READ;
+        auto dst = static_cast<uint8_t *>(buf);
+        size_t to_read = static_cast<size_t>(len);
+        size_t read = 0;
+        while (read < to_read) {
+            auto span = peer_->read_span();
+            if (span.second == 0) {
+                break;
+            }
+            size_t chunk = std::min(span.second, to_read - read);
+            std::memcpy(dst + read, span.first, chunk);
+            peer_->consume(chunk);
+            read += chunk;
         }
-        if (peer_->offset_) {
-            // shift data back to the beginning of the buffer
-            std::memmove(&peer_->data_[0], &peer_->data_[peer_->roffset_], peer_->offset_ - peer_->roffset_);
-            peer_->offset_ -= peer_->roffset_;
-            peer_->roffset_ = 0;
-            peer_->dlen_ = peer_->offset_;
+        if (read == to_read) {
+            flags_ &= ~BIO_FLAGS_READ;
         }
-        return len_to_read;
+        return static_cast<int>(read);
     }
 
     size_t wpending() const
     {
-        return dlen_ - roffset_;
+        return count_;
     }
 
     size_t ctrl_pending()
     {
-        return peer_->dlen_ - peer_->roffset_;
+        return peer_->count_;
     }
 
     bool should_write() const
@@ -112,12 +132,51 @@ public:
     }
 
 private:
+    /**
+     * @brief Contiguous block of data written to this bio and not yet read by the peer
+     * (might be shorter than wpending() if the data wraps around the end of the buffer)
+     */
+    const_span read_span() const
+    {
+        return { &data_[head_], std::min(count_, BIO_SIZE - head_) };
+    }
+
+    /**
+     * @brief Marks the first `len` bytes of read_span() as read
+     */
+    void consume(size_t len)
+    {
+        len = std::min(len, count_);
+        head_ = (head_ + len) % BIO_SIZE;
+        count_ -= len;
+        if (count_ == 0) {
+            // rewind to keep the next write_span() as long as possible
+            head_ = 0;
+        }
+    }
+
+    /**
+     * @brief Contiguous block of free space in this bio, to be filled in place and committed
+     */
+    mutable_span write_span()
+    {
+        size_t tail = (head_ + count_) % BIO_SIZE;
+        size_t free = BIO_SIZE - count_;
+        return { &data_[tail], std::min(free, BIO_SIZE - tail) };
+    }
+
+    /**
+     * @brief Marks the first `len` bytes of write_span() as written
+     */
+    void commit(size_t len)
+    {
+        count_ += std::min(len, BIO_SIZE - count_);
+    }
+
     std::array<uint8_t, BIO_SIZE> data_ {};
-    size_t size_ {BIO_SIZE};
     std::shared_ptr<bio> peer_ {nullptr};
-    int dlen_ {0};
-    size_t offset_ {0};
-    size_t roffset_ {0};
+    size_t head_ {0};
+    size_t count_ {0};
     size_t flags_ {0};
 };
 
@@ -116,6 +116,7 @@ static esp_err_t receive(esp_eth_handle_t h, uint8_t *buffer, uint32_t len, void
         free(buffer);
         return ret;
     }
+    free(buffer);
     return ESP_FAIL;
 }
 
@@ -140,9 +141,10 @@ __attribute__((weak)) void eppp_transport_ethernet_deinit(esp_eth_handle_t *hand
 #endif
 }
 
-esp_err_t eppp_transport_tx(void *h, void *buffer, size_t len)
+static esp_err_t transmit_iov(void *h, const struct eppp_iov *iov, size_t iovcnt)
 {
     static uint8_t out_buffer[ETH_HEADER_LEN];
+    size_t len = eppp_iov_len(iov, iovcnt);
     if (!s_is_connected) {
         return ESP_FAIL;
     }
@@ -155,7 +157,25 @@ esp_err_t eppp_transport_tx(void *h, void *buffer, size_t len)
     if (len > ETH_MAX_PAYLOAD_LEN) {
         return ESP_FAIL;
     }
-    return esp_eth_transmit_vargs(s_eth_handles[0], 2, out_buffer, ETH_HEADER_LEN, buffer, len);
+    // the driver gathers the header and the segments into its DMA buffers
+    switch (iovcnt) {
+    case 1:
+        return esp_eth_transmit_vargs(s_eth_handles[0], 2, out_buffer, ETH_HEADER_LEN, iov[0].base, iov[0].len);
+    case 2:
+        return esp_eth_transmit_vargs(s_eth_handles[0], 3, out_buffer, ETH_HEADER_LEN, iov[0].base, iov[0].len,
+                                      iov[1].base, iov[1].len);
+    case 3:
+        return esp_eth_transmit_vargs(s_eth_handles[0], 4, out_buffer, ETH_HEADER_LEN, iov[0].base, iov[0].len,
+                                      iov[1].base, iov[1].len, iov[2].base, iov[2].len);
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+esp_err_t eppp_transport_tx(void *h, void *buffer, size_t len)
+{
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_iov(h, &iov, 1);
 }
 
 static esp_err_t start_driver(esp_netif_t *esp_netif)
@@ -198,6 +218,7 @@ eppp_transport_handle_t eppp_eth_init(struct eppp_config_ethernet_s *config)
     ESP_RETURN_ON_FALSE(h, NULL, TAG, "Failed to allocate eppp_handle");
     ESP_GOTO_ON_ERROR(eppp_transport_ethernet_init(config, &s_eth_handles), err, TAG, "Failed to init Ethernet transport");
     h->base.post_attach = post_attach;
+    h->transmit_iov = transmit_iov;
     return h;
 err:
     return NULL;
@@ -0,0 +1,303 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <stdint.h>
+#include "eppp_hc.h"
+
+// IPv4 header offsets
+#define IP_VHL      0
+#define IP_LEN      2
+#define IP_ID       4
+#define IP_OFF      6   // followed by TTL and protocol
+#define IP_PROTO    9
+#define IP_SUM      10
+#define IP_SRC      12  // followed by destination and options
+#define IP_PROTO_TCP 6
+
+// TCP header offsets and flags
+#define TCP_SEQ     4
+#define TCP_ACK     8
+#define TCP_OFF     12
+#define TCP_FLAGS   13
+#define TCP_WIN     14
+#define TCP_SUM     16
+#define TCP_URP     18  // followed by options
+#define TCP_FIN     0x01
+#define TCP_SYN     0x02
+#define TCP_RST     0x04
+#define TCP_PSH     0x08
+#define TCP_ACKF    0x10
+#define TCP_URG     0x20
+
+// Changes encoded in the first byte of the compressed header
+#define HC_SEQ      0x01
+#define HC_ACK      0x02
+#define HC_WIN      0x04
+#define HC_ID       0x08    // IP ID delta other than 1
+#define HC_PUSH     0x10
+#define HC_CHANGES  (HC_SEQ | HC_ACK | HC_WIN | HC_ID | HC_PUSH)
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v >> 16);
+    put16(p + 2, v);
+}
+
+/**
+ * @brief Returns the length of the TCP/IP headers of a compressible segment, 0 otherwise
+ *
+ * Only unfragmented IPv4 segments of established connections qualify (ACK set, no SYN, FIN, RST or URG)
+ */
+static size_t tcp_headers_len(const uint8_t *p, size_t len, size_t packet_len)
+{
+    if (len < 40 || (p[IP_VHL] >> 4) != 4 || p[IP_PROTO] != IP_PROTO_TCP) {
+        return 0;
+    }
+    size_t ip_len = (p[IP_VHL] & 0x0F) * 4;
+    if (ip_len < 20 || ip_len + 20 > len || get16(p + IP_LEN) != packet_len || (get16(p + IP_OFF) & 0x3FFF)) {
+        return 0;
+    }
+    const uint8_t *tcp = p + ip_len;
+    size_t hlen = ip_len + (tcp[TCP_OFF] >> 4) * 4;
+    if ((tcp[TCP_OFF] >> 4) < 5 || hlen > len || hlen > EPPP_HC_MAX_HEADER) {
+        return 0;
+    }
+    if ((tcp[TCP_FLAGS] & (TCP_SYN | TCP_FIN | TCP_RST | TCP_URG)) || !(tcp[TCP_FLAGS] & TCP_ACKF)) {
+        return 0;
+    }
+    return hlen;
+}
+
+static bool same_flow(const uint8_t *old, const uint8_t *p, size_t ip_len)
+{
+    size_t old_ip_len = (old[IP_VHL] & 0x0F) * 4;
+    return memcmp(old + IP_SRC, p + IP_SRC, 8) == 0 && memcmp(old + old_ip_len, p + ip_len, 4) == 0;
+}
+
+// Everything but the lengths, IDs, checksums, sequence numbers, window and PSH flag stays the same within a flow
+static bool same_constants(const struct eppp_hc_slot *slot, const uint8_t *p, size_t ip_len, size_t hlen)
+{
+    const uint8_t *old = slot->header;
+    const uint8_t *old_tcp = old + ip_len;
+    const uint8_t *tcp = p + ip_len;
+    return slot->len == hlen && old[IP_VHL] == p[IP_VHL] && old[1] == p[1] &&
+           memcmp(old + IP_OFF, p + IP_OFF, 4) == 0 && memcmp(old + IP_SRC, p + IP_SRC, ip_len - IP_SRC) == 0 &&
+           old_tcp[TCP_OFF] == tcp[TCP_OFF] && (old_tcp[TCP_FLAGS] & ~TCP_PSH) == (tcp[TCP_FLAGS] & ~TCP_PSH) &&
+           memcmp(old_tcp + TCP_URP, tcp + TCP_URP, hlen - ip_len - TCP_URP) == 0;
+}
+
+// Deltas 1..255 take one byte, others a zero followed by two bytes
+static uint8_t *encode(uint8_t *d, uint16_t delta)
+{
+    if (delta >= 1 && delta <= 255) {
+        *d++ = delta;
+    } else {
+        *d++ = 0;
+        put16(d, delta);
+        d += 2;
+    }
+    return d;
+}
+
+static bool decode(const uint8_t **data, const uint8_t *end, uint16_t *delta)
+{
+    const uint8_t *d = *data;
+    if (d >= end) {
+        return false;
+    }
+    if (*d != 0) {
+        *delta = *d;
+        *data = d + 1;
+        return true;
+    }
+    if (end - d < 3) {
+        return false;
+    }
+    *delta = get16(d + 1);
+    *data = d + 3;
+    return true;
+}
+
+static uint16_t ip_checksum(const uint8_t *p, size_t len)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += get16(p + i);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum;
+}
+
+void eppp_hc_tx_reset(struct eppp_hc_tx *tx, uint8_t slots)
+{
+    memset(tx, 0, sizeof(*tx));
+    tx->slots = slots < EPPP_HC_SLOTS ? slots : EPPP_HC_SLOTS;
+}
+
+eppp_hc_type_t eppp_hc_compress(struct eppp_hc_tx *tx, const uint8_t *p, size_t len, size_t packet_len, struct eppp_hc_header *out)
+{
+    size_t hlen = tcp_headers_len(p, len, packet_len);
+    if (tx->slots == 0 || hlen == 0) {
+        return EPPP_HC_PLAIN;
+    }
+    size_t ip_len = (p[IP_VHL] & 0x0F) * 4;
+
+    // find the flow, or replace the least recently used one
+    struct eppp_hc_slot *slot = NULL;
+    struct eppp_hc_slot *oldest = &tx->slot[0];
+    for (int i = 0; i < tx->slots; ++i) {
+        struct eppp_hc_slot *s = &tx->slot[i];
+        if (s->len && same_flow(s->header, p, ip_len)) {
+            slot = s;
+            break;
+        }
+        if (s->used < oldest->used) {   // unused slots come first
+            oldest = s;
+        }
+    }
+    eppp_hc_type_t type = EPPP_HC_UNCOMPRESSED;
+    if (slot == NULL) {
+        slot = oldest;
+    } else if (same_constants(slot, p, ip_len, hlen)) {
+        const uint8_t *old = slot->header;
+        const uint8_t *old_tcp = old + ip_len;
+        const uint8_t *tcp = p + ip_len;
+        uint32_t seq = get32(tcp + TCP_SEQ) - get32(old_tcp + TCP_SEQ);
+        uint32_t ack = get32(tcp + TCP_ACK) - get32(old_tcp + TCP_ACK);
+        uint16_t win = get16(tcp + TCP_WIN) - get16(old_tcp + TCP_WIN);
+        uint16_t id = get16(p + IP_ID) - get16(old + IP_ID);
+        size_t payload = packet_len - hlen;
+        size_t old_payload = get16(old + IP_LEN) - hlen;
+        // Send in full what the peer might have missed: retransmissions (also of lost compressed segments,
+        // so that the peer recovers its context), duplicate ACKs and window probes
+        bool resend = (seq == 0 && payload > 0 && old_payload > 0) ||
+                      (seq == 0 && ack == 0 && win == 0 && payload == 0);
+        if (seq <= 0xFFFF && ack <= 0xFFFF && !resend) {
+            uint8_t *d = out->data;
+            uint8_t changes = 0;
+            d++;
+            memcpy(d, tcp + TCP_SUM, 2);    // the end to end check stays
+            d += 2;
+            if (seq) {
+                changes |= HC_SEQ;
+                d = encode(d, seq);
+            }
+            if (ack) {
+                changes |= HC_ACK;
+                d = encode(d, ack);
+            }
+            if (win) {
+                changes |= HC_WIN;
+                d = encode(d, win);
+            }
+            if (id != 1) {
+                changes |= HC_ID;
+                d = encode(d, id);
+            }
+            if (tcp[TCP_FLAGS] & TCP_PSH) {
+                changes |= HC_PUSH;
+            }
+            out->data[0] = changes;
+            out->len = d - out->data;
+            out->skip = hlen;
+            type = EPPP_HC_COMPRESSED;
+        }
+    }
+    memcpy(slot->header, p, hlen);
+    slot->len = hlen;
+    slot->used = ++tx->clock;
+    out->slot = slot - tx->slot;
+    return type;
+}
+
+bool eppp_hc_uncompressed(struct eppp_hc_rx *rx, uint8_t slot, const uint8_t *packet, size_t len)
+{
+    size_t hlen = tcp_headers_len(packet, len, len);
+    if (slot >= EPPP_HC_SLOTS || hlen == 0) {
+        return false;
+    }
+    memcpy(rx->slot[slot].header, packet, hlen);
+    rx->slot[slot].len = hlen;
+    return true;
+}
+
+size_t eppp_hc_decompress(struct eppp_hc_rx *rx, uint8_t slot, const uint8_t *data, size_t len, uint8_t *packet, size_t packet_size)
+{
+    if (slot >= EPPP_HC_SLOTS || rx->slot[slot].len == 0) {
+        return 0;
+    }
+    struct eppp_hc_slot *s = &rx->slot[slot];
+    uint8_t *ip = s->header;
+    size_t ip_len = (ip[IP_VHL] & 0x0F) * 4;
+    uint8_t *tcp = ip + ip_len;
+    const uint8_t *end = data + len;
+    uint16_t delta;
+    if (len < 3 || (data[0] & ~HC_CHANGES)) {
+        goto invalid;
+    }
+    uint8_t changes = *data++;
+    memcpy(tcp + TCP_SUM, data, 2);
+    data += 2;
+    if (changes & HC_SEQ) {
+        if (!decode(&data, end, &delta)) {
+            goto invalid;
+        }
+        put32(tcp + TCP_SEQ, get32(tcp + TCP_SEQ) + delta);
+    }
+    if (changes & HC_ACK) {
+        if (!decode(&data, end, &delta)) {
+            goto invalid;
+        }
+        put32(tcp + TCP_ACK, get32(tcp + TCP_ACK) + delta);
+    }
+    if (changes & HC_WIN) {
+        if (!decode(&data, end, &delta)) {
+            goto invalid;
+        }
+        put16(tcp + TCP_WIN, get16(tcp + TCP_WIN) + delta);
+    }
+    delta = 1;
+    if ((changes & HC_ID) && !decode(&data, end, &delta)) {
+        goto invalid;
+    }
+    put16(ip + IP_ID, get16(ip + IP_ID) + delta);
+    tcp[TCP_FLAGS] = (changes & HC_PUSH) ? (tcp[TCP_FLAGS] | TCP_PSH) : (tcp[TCP_FLAGS] & ~TCP_PSH);
+
+    size_t payload = end - data;
+    size_t packet_len = s->len + payload;
+    if (packet_len > packet_size) {
+        goto invalid;
+    }
+    put16(ip + IP_LEN, packet_len);
+    put16(ip + IP_SUM, 0);
+    put16(ip + IP_SUM, ip_checksum(ip, ip_len));
+    memcpy(packet, ip, s->len);
+    memcpy(packet + s->len, data, payload);
+    return packet_len;
+
+invalid:
+    // the context is out of sync, wait for the peer to send the flow in full
+    s->len = 0;
+    return 0;
+}
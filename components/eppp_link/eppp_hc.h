@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+// TCP/IPv4 header compression (RFC 1144 style) of the TUN packets on stream transports
+#define EPPP_HC_SLOTS CONFIG_EPPP_LINK_HEADER_COMPRESSION_SLOTS
+#define EPPP_HC_MAX_HEADER (120)        // IPv4 and TCP headers, both with the longest options
+#define EPPP_HC_MAX_COMPRESSED (16)     // changes, TCP checksum and four deltas
+
+typedef enum {
+    EPPP_HC_PLAIN,          // not a compressible TCP segment, send as is
+    EPPP_HC_UNCOMPRESSED,   // send as is, the peer stores the headers of the flow
+    EPPP_HC_COMPRESSED,     // send the compressed header followed by the payload
+} eppp_hc_type_t;
+
+// Headers of one flow, as last sent (or received)
+struct eppp_hc_slot {
+    uint8_t header[EPPP_HC_MAX_HEADER];
+    uint8_t len;        // 0 = no flow
+    uint32_t used;
+};
+
+// Compressor state (Tx)
+struct eppp_hc_tx {
+    struct eppp_hc_slot slot[EPPP_HC_SLOTS];
+    uint8_t slots;      // slots the peer decompresses, 0 = don't compress
+    uint32_t clock;
+};
+
+// Decompressor state (Rx)
+struct eppp_hc_rx {
+    struct eppp_hc_slot slot[EPPP_HC_SLOTS];
+};
+
+struct eppp_hc_header {
+    uint8_t slot;
+    uint8_t len;        // length of the compressed header
+    uint8_t skip;       // length of the TCP/IP headers it replaces
+    uint8_t data[EPPP_HC_MAX_COMPRESSED];
+};
+
+/**
+ * @brief Forgets all flows and sets the number of slots the peer decompresses
+ */
+void eppp_hc_tx_reset(struct eppp_hc_tx *tx, uint8_t slots);
+
+/**
+ * @brief Compresses the TCP/IP headers of an outgoing packet
+ *
+ * @param header First bytes of the packet (up to EPPP_HC_MAX_HEADER)
+ * @param header_len Number of these bytes
+ * @param packet_len Length of the whole packet
+ * @param out Slot of the flow and the compressed header
+ */
+eppp_hc_type_t eppp_hc_compress(struct eppp_hc_tx *tx, const uint8_t *header, size_t header_len, size_t packet_len, struct eppp_hc_header *out);
+
+/**
+ * @brief Stores the headers of a packet received in full
+ * @return false if it's not a compressible TCP segment
+ */
+bool eppp_hc_uncompressed(struct eppp_hc_rx *rx, uint8_t slot, const uint8_t *packet, size_t len);
+
+/**
+ * @brief Rebuilds the packet from the compressed header and the payload
+ * @return Length of the packet, 0 if the flow is unknown or the data are corrupted
+ *         (the flow is then dropped until the peer sends it in full again)
+ */
+size_t eppp_hc_decompress(struct eppp_hc_rx *rx, uint8_t slot, const uint8_t *data, size_t len, uint8_t *packet, size_t packet_size);
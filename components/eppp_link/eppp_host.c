@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "eppp_link.h"
+#include "eppp_transport.h"
+#include "eppp_transport_host.h"
+#include "eppp_stream.h"
+
+#define TAG "eppp_host"
+
+// How long eppp_perform() waits for data, so it could check the stop request
+#define POLL_TIMEOUT_MS 100
+
+struct eppp_host {
+    struct eppp_handle parent;
+    int fd;
+    SemaphoreHandle_t tx_lock;  // keeps the frames of concurrent writers (netif and channels) apart
+#ifdef CONFIG_EPPP_LINK_USES_PPP
+    uint8_t rx_buffer[EPPP_STREAM_MAX_FRAME];
+#else
+    uint8_t tx_frame[EPPP_STREAM_MAX_FRAME];
+    struct eppp_stream stream;
+#endif
+};
+
+static esp_err_t write_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t len = writev(fd, iov, iovcnt);
+        if (len < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            ESP_LOGE(TAG, "Failed to write to fd %d: errno %d", fd, errno);
+            return ESP_FAIL;
+        }
+        // skip the written buffers and the written part of the next one
+        while (iovcnt > 0 && (size_t)len >= iov->iov_len) {
+            len -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + len;
+            iov->iov_len -= len;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t transmit_generic(struct eppp_host *handle, int channel, const struct eppp_iov *iov, size_t iovcnt)
+{
+    esp_err_t ret;
+#ifdef CONFIG_EPPP_LINK_USES_PPP
+    ESP_RETURN_ON_FALSE(iovcnt <= EPPP_MAX_IOV, ESP_ERR_NOT_SUPPORTED, TAG, "Too many segments");
+#endif
+    xSemaphoreTake(handle->tx_lock, portMAX_DELAY);
+#ifndef CONFIG_EPPP_LINK_USES_PPP
+    size_t len = eppp_stream_frame(&handle->stream, handle->tx_frame, channel, iov, iovcnt);
+    if (len == 0) {
+        xSemaphoreGive(handle->tx_lock);
+        ESP_LOGE(TAG, "Packet too long (%d bytes)", (int)eppp_iov_len(iov, iovcnt));
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ESP_LOG_BUFFER_HEXDUMP("ppp_host_send", handle->tx_frame, len, ESP_LOG_VERBOSE);
+    struct iovec frame = { .iov_base = handle->tx_frame, .iov_len = len };
+    ret = write_all(handle->fd, &frame, 1);
+#else
+    struct iovec vec[EPPP_MAX_IOV];
+    for (size_t i = 0; i < iovcnt; ++i) {
+        vec[i].iov_base = (void *)iov[i].base;
+        vec[i].iov_len = iov[i].len;
+    }
+    ret = write_all(handle->fd, vec, iovcnt);
+#endif
+    xSemaphoreGive(handle->tx_lock);
+    return ret;
+}
+
+static esp_err_t transmit(void *h, void *buffer, size_t len)
+{
+    struct eppp_handle *handle = h;
+    struct eppp_host *host_handle = __containerof(handle, struct eppp_host, parent);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_generic(host_handle, 0, &iov, 1);
+}
+
+static esp_err_t transmit_iov(void *h, const struct eppp_iov *iov, size_t iovcnt)
+{
+    struct eppp_handle *handle = h;
+    struct eppp_host *host_handle = __containerof(handle, struct eppp_host, parent);
+    return transmit_generic(host_handle, 0, iov, iovcnt);
+}
+
+#ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
+static esp_err_t transmit_channel(esp_netif_t *netif, int channel, void *buffer, size_t len)
+{
+    struct eppp_handle *handle = esp_netif_get_io_driver(netif);
+    struct eppp_host *host_handle = __containerof(handle, struct eppp_host, parent);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_generic(host_handle, channel, &iov, 1);
+}
+#endif
+
+esp_err_t eppp_perform(esp_netif_t *netif)
+{
+    struct eppp_handle *handle = esp_netif_get_io_driver(netif);
+    struct eppp_host *h = __containerof(handle, struct eppp_host, parent);
+    if (h->parent.stop) {
+        return ESP_ERR_TIMEOUT;
+    }
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+    uint8_t control[EPPP_STREAM_CONTROL_FRAME];
+    size_t control_len = eppp_stream_control(&h->stream, control);
+    if (control_len > 0) {
+        struct iovec frame = { .iov_base = control, .iov_len = control_len };
+        xSemaphoreTake(h->tx_lock, portMAX_DELAY);
+        write_all(h->fd, &frame, 1);
+        xSemaphoreGive(h->tx_lock);
+    }
+#endif
+
+    struct pollfd pfd = { .fd = h->fd, .events = POLLIN };
+    if (poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0) {
+        // timeout, or interrupted
+        return ESP_OK;
+    }
+#ifdef CONFIG_EPPP_LINK_USES_PPP
+    uint8_t *buffer = h->rx_buffer;
+    size_t space = sizeof(h->rx_buffer);
+#else
+    // Read directly into the stream buffer
+    size_t space;
+    uint8_t *buffer = eppp_stream_rx_space(&h->stream, &space);
+#endif
+    ssize_t len = read(h->fd, buffer, space);
+    if (len <= 0) {
+        if (len < 0 && (errno == EINTR || errno == EAGAIN)) {
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Peer closed fd %d", h->fd);
+        vTaskDelay(pdMS_TO_TICKS(POLL_TIMEOUT_MS));
+        return ESP_FAIL;
+    }
+    ESP_LOG_BUFFER_HEXDUMP("ppp_host_recv", buffer, len, ESP_LOG_VERBOSE);
+#ifdef CONFIG_EPPP_LINK_USES_PPP
+    esp_netif_receive(netif, buffer, len, NULL);
+#else
+    eppp_stream_rx_process(&h->stream, len, eppp_stream_deliver, netif);
+#endif
+    return ESP_OK;
+}
+
+static esp_err_t post_attach(esp_netif_t *esp_netif, void *args)
+{
+    eppp_transport_handle_t h = (eppp_transport_handle_t)args;
+    ESP_RETURN_ON_FALSE(h, ESP_ERR_INVALID_ARG, TAG, "Transport handle cannot be null");
+    h->base.netif = esp_netif;
+
+    esp_netif_driver_ifconfig_t driver_ifconfig = {
+        .handle =  h,
+        .transmit = transmit,
+    };
+
+    ESP_RETURN_ON_ERROR(esp_netif_set_driver_config(esp_netif, &driver_ifconfig), TAG, "Failed to set driver config");
+    ESP_LOGI(TAG, "EPPP host transport attached to EPPP netif %s", esp_netif_get_desc(esp_netif));
+    return ESP_OK;
+}
+
+eppp_transport_handle_t eppp_host_init(struct eppp_config_host_s *config)
+{
+    __attribute__((unused)) esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config, NULL, TAG, "Config cannot be null");
+    ESP_RETURN_ON_FALSE(config->fd >= 0, NULL, TAG, "Invalid file descriptor");
+    struct eppp_host *h = calloc(1, sizeof(struct eppp_host));
+    ESP_RETURN_ON_FALSE(h, NULL, TAG, "Failed to allocate eppp_handle");
+#ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
+    h->parent.channel_tx = transmit_channel;
+#endif
+    h->parent.base.post_attach = post_attach;
+    h->parent.transmit_iov = transmit_iov;
+    h->fd = config->fd;
+    ESP_GOTO_ON_FALSE(h->tx_lock = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM, err, TAG, "Failed to create the Tx lock");
+    return &h->parent;
+err:
+    free(h);
+    return NULL;
+}
+
+void eppp_host_deinit(eppp_transport_handle_t handle)
+{
+    struct eppp_host *h = __containerof(handle, struct eppp_host, parent);
+    // the file descriptor belongs to the caller
+    vSemaphoreDelete(h->tx_lock);
+    free(h);
+}
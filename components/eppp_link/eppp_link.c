@@ -16,6 +16,7 @@
 #include "eppp_transport_spi.h"
 #include "eppp_transport_uart.h"
 #include "eppp_transport_sdio.h"
+#include "eppp_transport_host.h"
 #include "eppp_transport.h"
 
 
@@ -277,6 +278,12 @@ esp_netif_t *eppp_open(eppp_type_t role, eppp_config_t *config, int connect_time
         return NULL;
     }
 #endif
+#if CONFIG_EPPP_LINK_DEVICE_HOST
+    if (config->transport != EPPP_TRANSPORT_HOST) {
+        ESP_LOGE(TAG, "Invalid transport: Linux host device must be enabled in Kconfig");
+        return NULL;
+    }
+#endif
 
     if (config->task.run_task == false) {
         ESP_LOGE(TAG, "task.run_task == false is invalid in this API. Please use eppp_init()");
@@ -377,3 +384,68 @@ void* eppp_get_context(esp_netif_t *netif)
     return h->context;
 }
 #endif
+
+size_t eppp_iov_len(const struct eppp_iov *iov, size_t iovcnt)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+        len += iov[i].len;
+    }
+    return len;
+}
+
+size_t eppp_iov_copy(uint8_t *dst, const struct eppp_iov *iov, size_t iovcnt, size_t offset, size_t len)
+{
+    size_t copied = 0;
+    for (size_t i = 0; i < iovcnt && copied < len; ++i) {
+        if (offset >= iov[i].len) {
+            offset -= iov[i].len;
+            continue;
+        }
+        size_t chunk = iov[i].len - offset;
+        if (chunk > len - copied) {
+            chunk = len - copied;
+        }
+        memcpy(dst + copied, (const uint8_t *)iov[i].base + offset, chunk);
+        copied += chunk;
+        offset = 0;
+    }
+    return copied;
+}
+
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+size_t eppp_record_write(uint8_t *buffer, int channel, const struct eppp_iov *iov, size_t iovcnt, size_t offset, size_t len)
+{
+    struct eppp_record *record = (void *)buffer;
+    record->channel = channel;
+    record->reserved = 0;
+    record->size = len;
+    eppp_iov_copy(buffer + sizeof(struct eppp_record), iov, iovcnt, offset, len);
+    return EPPP_RECORD_LEN(len);
+}
+
+esp_err_t eppp_record_receive(esp_netif_t *netif, uint8_t *buffer, size_t len)
+{
+    while (len >= sizeof(struct eppp_record)) {
+        struct eppp_record *record = (void *)buffer;
+        size_t record_len = EPPP_RECORD_LEN(record->size);
+        if (record->channel >= NR_OF_CHANNELS || record_len > len) {
+            ESP_LOGE(TAG, "Invalid record: channel %d, size %d", record->channel, record->size);
+            return ESP_FAIL;
+        }
+        if (record->channel == 0) {
+            esp_netif_receive(netif, buffer + sizeof(struct eppp_record), record->size, NULL);
+        } else {
+#ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
+            struct eppp_handle *h = esp_netif_get_io_driver(netif);
+            if (h->channel_rx) {
+                h->channel_rx(netif, record->channel, buffer + sizeof(struct eppp_record), record->size);
+            }
+#endif
+        }
+        buffer += record_len;
+        len -= record_len;
+    }
+    return ESP_OK;
+}
+#endif // CONFIG_EPPP_LINK_PACKET_AGGREGATION
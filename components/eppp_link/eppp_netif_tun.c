@@ -16,6 +16,8 @@
 #include "ping/ping_sock.h"
 #include "esp_check.h"
 #include "esp_idf_version.h"
+#include "eppp_link.h"
+#include "eppp_transport.h"
 
 #if defined(CONFIG_ESP_NETIF_RECEIVE_REPORT_ERRORS)
 typedef esp_err_t esp_netif_recv_ret_t;
@@ -47,12 +49,50 @@ err:
     return ESP_NETIF_OPTIONAL_RETURN_CODE(ret);
 }
 
+/**
+ * @brief Transmits a pbuf chain, as a vector if the transport supports it, otherwise copied to one buffer
+ */
+static esp_err_t tun_transmit_chain(esp_netif_t *esp_netif, struct pbuf *p)
+{
+    struct eppp_handle *h = esp_netif_get_io_driver(esp_netif);
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+    if (h->transmit_iov) {
+        struct eppp_iov iov[EPPP_MAX_IOV];
+        size_t iovcnt = 0;
+        struct pbuf *q;
+        for (q = p; q != NULL && iovcnt < EPPP_MAX_IOV; q = q->next) {
+            if (q->len > 0) {
+                iov[iovcnt].base = q->payload;
+                iov[iovcnt].len = q->len;
+                ++iovcnt;
+            }
+        }
+        if (q == NULL) {
+            ret = h->transmit_iov(h, iov, iovcnt);
+        }
+    }
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        struct pbuf *q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        if (q == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        ret = esp_netif_transmit(esp_netif, q->payload, q->len);
+        pbuf_free(q);
+    }
+    return ret;
+}
+
 static err_t tun_output(struct netif *netif, struct pbuf *p)
 {
     LWIP_ASSERT("netif != NULL", (netif != NULL));
     LWIP_ASSERT("netif->state != NULL", (netif->state != NULL));
     LWIP_ASSERT("p != NULL", (p != NULL));
-    esp_err_t ret = esp_netif_transmit(netif->state, p->payload, p->len);
+    esp_err_t ret;
+    if (p->next == NULL) {
+        ret = esp_netif_transmit(netif->state, p->payload, p->len);
+    } else {
+        ret = tun_transmit_chain(netif->state, p);
+    }
     switch (ret) {
     case ESP_OK:
         return ERR_OK;
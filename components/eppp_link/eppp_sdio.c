@@ -23,9 +23,11 @@ struct eppp_sdio {
 };
 
 esp_err_t eppp_sdio_host_tx(void *h, void *buffer, size_t len);
+esp_err_t eppp_sdio_host_tx_iov(void *h, const struct eppp_iov *iov, size_t iovcnt);
 esp_err_t eppp_sdio_host_rx(esp_netif_t *netif);
 esp_err_t eppp_sdio_slave_rx(esp_netif_t *netif);
 esp_err_t eppp_sdio_slave_tx(void *h, void *buffer, size_t len);
+esp_err_t eppp_sdio_slave_tx_iov(void *h, const struct eppp_iov *iov, size_t iovcnt);
 esp_err_t eppp_sdio_host_init(struct eppp_config_sdio_s *config);
 esp_err_t eppp_sdio_slave_init(struct eppp_config_sdio_s *config);
 void eppp_sdio_slave_deinit(void);
@@ -45,6 +47,78 @@ esp_err_t eppp_perform(esp_netif_t *netif)
     }
 }
 
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+esp_err_t eppp_sdio_batch_init(struct eppp_sdio_batch *batch, SemaphoreHandle_t bus_lock, uint8_t *buffer0, uint8_t *buffer1)
+{
+    ESP_RETURN_ON_FALSE(batch->lock = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM, TAG, "Failed to create batch lock");
+    batch->bus_lock = bus_lock;
+    batch->buffer[0] = buffer0;
+    batch->buffer[1] = buffer1;
+    batch->len[0] = batch->len[1] = 0;
+    batch->fill = 0;
+    return ESP_OK;
+}
+
+void eppp_sdio_batch_deinit(struct eppp_sdio_batch *batch)
+{
+    if (batch->lock) {
+        vSemaphoreDelete(batch->lock);
+        batch->lock = NULL;
+    }
+}
+
+static bool batch_add(struct eppp_sdio_batch *batch, int channel, const struct eppp_iov *iov, size_t iovcnt, size_t len)
+{
+    bool added = false;
+    xSemaphoreTake(batch->lock, portMAX_DELAY);
+    int i = batch->fill;
+    if (sizeof(struct header) + batch->len[i] + EPPP_RECORD_LEN(len) <= SDIO_PACKET_SIZE) {
+        batch->len[i] += eppp_record_write(batch->buffer[i] + sizeof(struct header) + batch->len[i], channel, iov, iovcnt, 0, len);
+        added = true;
+    }
+    xSemaphoreGive(batch->lock);
+    return added;
+}
+
+esp_err_t eppp_sdio_batch_transmit(struct eppp_sdio_batch *batch, int channel, const struct eppp_iov *iov, size_t iovcnt,
+                                   esp_err_t (*send)(uint8_t *buffer, size_t len))
+{
+    size_t len = eppp_iov_len(iov, iovcnt);
+    ESP_RETURN_ON_FALSE(len <= MAX_SDIO_PAYLOAD, ESP_ERR_INVALID_SIZE, TAG, "Packet too long (%d bytes)", (int)len);
+    esp_err_t ret = ESP_OK;
+    bool added = batch_add(batch, channel, iov, iovcnt, len);
+    xSemaphoreTake(batch->bus_lock, portMAX_DELAY);
+    while (true) {
+        // swap the buffers, the other one was sent already by the previous holder of the bus_lock
+        xSemaphoreTake(batch->lock, portMAX_DELAY);
+        int i = batch->fill;
+        size_t records = batch->len[i];
+        if (records > 0) {
+            batch->fill = !i;
+            batch->len[i] = 0;
+        }
+        xSemaphoreGive(batch->lock);
+        if (records > 0) {
+            struct header *head = (void *)batch->buffer[i];
+            head->magic = PPP_SOF;
+            head->channel = 0;
+            head->size = records;
+            esp_err_t err = send(batch->buffer[i], SDIO_ALIGN(sizeof(struct header) + records));
+            if (err != ESP_OK) {
+                ret = err;
+            }
+        }
+        // an empty batch means that our packet was sent by another task
+        if (added) {
+            break;
+        }
+        added = batch_add(batch, channel, iov, iovcnt, len);
+    }
+    xSemaphoreGive(batch->bus_lock);
+    return ret;
+}
+#endif // CONFIG_EPPP_LINK_PACKET_AGGREGATION
+
 static esp_err_t post_attach(esp_netif_t *esp_netif, void *args)
 {
     eppp_transport_handle_t h = (eppp_transport_handle_t)args;
@@ -73,6 +147,7 @@ eppp_transport_handle_t eppp_sdio_init(struct eppp_config_sdio_s *config)
 #endif
     h->parent.base.post_attach = post_attach;
     h->is_host = config->is_host;
+    h->parent.transmit_iov = h->is_host ? eppp_sdio_host_tx_iov : eppp_sdio_slave_tx_iov;
     esp_err_t (*init_fn)(struct eppp_config_sdio_s * eppp_config) = h->is_host ? eppp_sdio_host_init : eppp_sdio_slave_init;
     ESP_GOTO_ON_ERROR(init_fn(config), err, TAG, "Failed to init SDIO");
     return &h->parent;
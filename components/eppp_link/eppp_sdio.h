@@ -8,7 +8,14 @@
 #define MAX_SDIO_PAYLOAD 1500
 #define SDIO_ALIGN(size) (((size) + 3U) & ~(3U))
 #define SDIO_PAYLOAD SDIO_ALIGN(MAX_SDIO_PAYLOAD)
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+// packets are sent as records (see eppp_record_write()), one SDIO packet fits one receive buffer of the slave
+#define SDIO_PACKET_SIZE SDIO_ALIGN(sizeof(struct header) + EPPP_RECORD_LEN(MAX_SDIO_PAYLOAD))
+#define SDIO_RECV_BUFFER_SIZE SDIO_PACKET_SIZE
+#else
 #define SDIO_PACKET_SIZE SDIO_ALIGN(MAX_SDIO_PAYLOAD + 4)
+#define SDIO_RECV_BUFFER_SIZE SDIO_PAYLOAD
+#endif
 #define PPP_SOF 0x7E
 
 
@@ -27,3 +34,31 @@ struct header {
 } __attribute__((packed));
 
 esp_err_t eppp_sdio_transmit_channel(esp_netif_t *netif, int channel, void *buffer, size_t len);
+
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+struct eppp_iov;
+
+// Packets to be sent together in one SDIO packet, collected while the previous one is being sent
+struct eppp_sdio_batch {
+    SemaphoreHandle_t lock;     // protects the buffers and their lengths
+    SemaphoreHandle_t bus_lock; // held while sending
+    uint8_t *buffer[2];         // SDIO_PACKET_SIZE each, the header is followed by records
+    size_t len[2];              // length of the records in the buffer
+    int fill;                   // index of the buffer being filled
+};
+
+esp_err_t eppp_sdio_batch_init(struct eppp_sdio_batch *batch, SemaphoreHandle_t bus_lock, uint8_t *buffer0, uint8_t *buffer1);
+
+void eppp_sdio_batch_deinit(struct eppp_sdio_batch *batch);
+
+/**
+ * @brief Adds the packet to the batch and sends the batch, unless another task is sending it already
+ *
+ * @param send Sends one SDIO packet, called with the bus_lock held
+ */
+esp_err_t eppp_sdio_batch_transmit(struct eppp_sdio_batch *batch, int channel, const struct eppp_iov *iov, size_t iovcnt,
+                                   esp_err_t (*send)(uint8_t *buffer, size_t len));
+#endif
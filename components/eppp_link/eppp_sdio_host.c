@@ -33,42 +33,64 @@ static sdmmc_card_t *s_card = NULL;
 
 static DRAM_DMA_ALIGNED_ATTR uint8_t send_buffer[SDIO_PACKET_SIZE];
 static DMA_ATTR uint8_t rcv_buffer[SDIO_PACKET_SIZE];
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+static DRAM_DMA_ALIGNED_ATTR uint8_t batch_buffer[SDIO_PACKET_SIZE];
+static struct eppp_sdio_batch s_batch;
+#endif
+
+// Called with s_essl_mutex held
+static esp_err_t send_packet(uint8_t *buffer, size_t send_len)
+{
+    esp_err_t ret = essl_send_packet(s_essl, buffer, send_len, PACKET_TIMEOUT_MS);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Slave not ready to receive packet %x", ret);
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        ret = ESP_ERR_NO_MEM; // to inform the upper layers
+    }
+    ESP_LOG_BUFFER_HEXDUMP(TAG, buffer, send_len, ESP_LOG_VERBOSE);
+    return ret;
+}
 
-static esp_err_t eppp_sdio_host_tx_generic(int channel, void *buffer, size_t len)
+static esp_err_t eppp_sdio_host_tx_generic(int channel, const struct eppp_iov *iov, size_t iovcnt)
 {
     if (s_essl == NULL || s_essl_mutex == NULL) {
         // silently skip the Tx if the SDIO not fully initialized
         return ESP_OK;
     }
-
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    return eppp_sdio_batch_transmit(&s_batch, channel, iov, iovcnt, send_packet);
+#else
+    size_t len = eppp_iov_len(iov, iovcnt);
 
     struct header *head = (void *)send_buffer;
     head->magic = PPP_SOF;
     head->channel = channel;
     head->size = len;
-    memcpy(send_buffer + sizeof(struct header), buffer, len);
+    eppp_iov_copy(send_buffer + sizeof(struct header), iov, iovcnt, 0, len);
     size_t send_len = SDIO_ALIGN(len + sizeof(struct header));
     xSemaphoreTake(s_essl_mutex, portMAX_DELAY);
-    esp_err_t ret = essl_send_packet(s_essl, send_buffer, send_len, PACKET_TIMEOUT_MS);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Slave not ready to receive packet %x", ret);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        ret = ESP_ERR_NO_MEM; // to inform the upper layers
-    }
-    ESP_LOG_BUFFER_HEXDUMP(TAG, send_buffer, send_len, ESP_LOG_VERBOSE);
+    esp_err_t ret = send_packet(send_buffer, send_len);
     xSemaphoreGive(s_essl_mutex);
     return ret;
+#endif
 }
 
 esp_err_t eppp_sdio_host_tx(void *h, void *buffer, size_t len)
 {
-    return eppp_sdio_host_tx_generic(0, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return eppp_sdio_host_tx_generic(0, &iov, 1);
+}
+
+esp_err_t eppp_sdio_host_tx_iov(void *h, const struct eppp_iov *iov, size_t iovcnt)
+{
+    return eppp_sdio_host_tx_generic(0, iov, iovcnt);
 }
 
 #ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
 esp_err_t eppp_sdio_transmit_channel(esp_netif_t *netif, int channel, void *buffer, size_t len)
 {
-    return eppp_sdio_host_tx_generic(channel, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return eppp_sdio_host_tx_generic(channel, &iov, 1);
 }
 #endif
 
@@ -117,12 +139,15 @@ esp_err_t eppp_sdio_host_init(struct eppp_config_sdio_s *eppp_config)
 
     essl_sdio_config_t ser_config = {
         .card = s_card,
-        .recv_buffer_size = SDIO_PAYLOAD,
+        .recv_buffer_size = SDIO_RECV_BUFFER_SIZE,
     };
     ESP_GOTO_ON_FALSE(essl_sdio_init_dev(&s_essl, &ser_config) == ESP_OK && s_essl, ESP_FAIL, err, TAG, "essl_sdio_init_dev failed");
     ESP_GOTO_ON_ERROR(essl_init(s_essl, TIMEOUT_MAX), err, TAG, "essl-init failed");
     ESP_GOTO_ON_ERROR(request_slave_reset(), err, TAG, "failed to reset the slave");
     ESP_GOTO_ON_FALSE((s_essl_mutex = xSemaphoreCreateMutex()), ESP_ERR_NO_MEM, err, TAG, "failed to create semaphore");
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    ESP_GOTO_ON_ERROR(eppp_sdio_batch_init(&s_batch, s_essl_mutex, send_buffer, batch_buffer), err, TAG, "failed to init batch");
+#endif
     return ret;
 
 err:
@@ -178,6 +203,14 @@ esp_err_t eppp_sdio_host_rx(esp_netif_t *netif)
                     ESP_LOGE(TAG, "invalid channel %x", head->channel);
                     break;
                 }
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+                if (sizeof(struct header) + head->size > size_read) {
+                    ESP_LOGE(TAG, "invalid size %x", head->size);
+                    break;
+                }
+                ESP_LOG_BUFFER_HEXDUMP(TAG, rcv_buffer, size_read, ESP_LOG_VERBOSE);
+                eppp_record_receive(netif, rcv_buffer + sizeof(struct header), head->size);
+#else
                 if (head->size > SDIO_PAYLOAD || head->size > size_read) {
                     ESP_LOGE(TAG, "invalid size %x", head->size);
                     break;
@@ -193,6 +226,7 @@ esp_err_t eppp_sdio_host_rx(esp_netif_t *netif)
                     }
 #endif
                 }
+#endif
                 break;
             } else {
                 ESP_LOGE(TAG, "rx packet error: %08X", ret);
@@ -209,6 +243,9 @@ esp_err_t eppp_sdio_host_rx(esp_netif_t *netif)
 
 void eppp_sdio_host_deinit(void)
 {
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    eppp_sdio_batch_deinit(&s_batch);
+#endif
     essl_sdio_deinit_dev(s_essl);
     sdmmc_host_deinit();
     free(s_card);
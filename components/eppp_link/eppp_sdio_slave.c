@@ -17,23 +17,44 @@
 #include "esp_check.h"
 #if CONFIG_EPPP_LINK_DEVICE_SDIO_SLAVE
 #define BUFFER_NUM 4
-#define BUFFER_SIZE SDIO_PAYLOAD
+#define BUFFER_SIZE SDIO_RECV_BUFFER_SIZE
 static const char *TAG = "eppp_sdio_slave";
 static DMA_ATTR uint8_t sdio_slave_rx_buffer[BUFFER_NUM][BUFFER_SIZE];
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+static DMA_ATTR uint8_t sdio_slave_tx_buffer[2][SDIO_PACKET_SIZE];
+static struct eppp_sdio_batch s_batch;
+
+static esp_err_t send_packet(uint8_t *buffer, size_t send_len)
+{
+    ESP_LOG_BUFFER_HEXDUMP(TAG, buffer, send_len, ESP_LOG_VERBOSE);
+    esp_err_t ret = sdio_slave_transmit(buffer, send_len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "sdio slave transmit error, ret : 0x%x", ret);
+        // to inform the upper layers
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+#else
 static DMA_ATTR uint8_t sdio_slave_tx_buffer[SDIO_PAYLOAD];
+#endif
 static int s_slave_request = 0;
 
-static esp_err_t eppp_sdio_host_tx_generic(int channel, void *buffer, size_t len)
+static esp_err_t eppp_sdio_host_tx_generic(int channel, const struct eppp_iov *iov, size_t iovcnt)
 {
     if (s_slave_request != REQ_INIT) {
         // silently skip the Tx if the SDIO not fully initialized
         return ESP_OK;
     }
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    return eppp_sdio_batch_transmit(&s_batch, channel, iov, iovcnt, send_packet);
+#else
+    size_t len = eppp_iov_len(iov, iovcnt);
     struct header *head = (void *)sdio_slave_tx_buffer;
     head->magic = PPP_SOF;
     head->channel = channel;
     head->size = len;
-    memcpy(sdio_slave_tx_buffer + sizeof(struct header), buffer, len);
+    eppp_iov_copy(sdio_slave_tx_buffer + sizeof(struct header), iov, iovcnt, 0, len);
     size_t send_len = SDIO_ALIGN(len + sizeof(struct header));
     ESP_LOG_BUFFER_HEXDUMP(TAG, sdio_slave_tx_buffer, send_len, ESP_LOG_VERBOSE);
     esp_err_t ret = sdio_slave_transmit(sdio_slave_tx_buffer, send_len);
@@ -43,17 +64,25 @@ static esp_err_t eppp_sdio_host_tx_generic(int channel, void *buffer, size_t len
         return ESP_ERR_NO_MEM;
     }
     return ESP_OK;
+#endif
 }
 
 esp_err_t eppp_sdio_slave_tx(void *h, void *buffer, size_t len)
 {
-    return eppp_sdio_host_tx_generic(0, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return eppp_sdio_host_tx_generic(0, &iov, 1);
+}
+
+esp_err_t eppp_sdio_slave_tx_iov(void *h, const struct eppp_iov *iov, size_t iovcnt)
+{
+    return eppp_sdio_host_tx_generic(0, iov, iovcnt);
 }
 
 #ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
 esp_err_t eppp_sdio_transmit_channel(esp_netif_t *netif, int channel, void *buffer, size_t len)
 {
-    return eppp_sdio_host_tx_generic(channel, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return eppp_sdio_host_tx_generic(channel, &iov, 1);
 }
 #endif
 
@@ -104,6 +133,13 @@ again:
             ESP_LOGE(TAG, "invalid channel %x", head->channel);
             return ESP_FAIL;
         }
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+        if (sizeof(struct header) + head->size > length) {
+            ESP_LOGE(TAG, "invalid size %x", head->size);
+            return ESP_FAIL;
+        }
+        eppp_record_receive(netif, ptr + sizeof(struct header), head->size);
+#else
         if (head->size > SDIO_PAYLOAD || head->size > length) {
             ESP_LOGE(TAG, "invalid size %x", head->size);
             return ESP_FAIL;
@@ -118,6 +154,7 @@ again:
             }
 #endif
         }
+#endif
         if (sdio_slave_recv_load_buf(handle) != ESP_OK) {
             ESP_LOGE(TAG, "Failed to recycle packet buffer");
             return ESP_FAIL;
@@ -153,6 +190,14 @@ esp_err_t eppp_sdio_slave_init(struct eppp_config_sdio_s *eppp_config)
         .recv_buffer_size   = BUFFER_SIZE,
         .event_cb           = event_cb,
     };
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    SemaphoreHandle_t bus_lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(bus_lock, ESP_ERR_NO_MEM, TAG, "Failed to create bus lock");
+    if (eppp_sdio_batch_init(&s_batch, bus_lock, sdio_slave_tx_buffer[0], sdio_slave_tx_buffer[1]) != ESP_OK) {
+        vSemaphoreDelete(bus_lock);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
     esp_err_t ret = sdio_slave_initialize(&config);
     if (ret != ESP_OK) {
         return ret;
@@ -185,6 +230,10 @@ void eppp_sdio_slave_deinit(void)
 {
     sdio_slave_stop();
     sdio_slave_deinit();
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    vSemaphoreDelete(s_batch.bus_lock);
+    eppp_sdio_batch_deinit(&s_batch);
+#endif
 }
 
 #else // SOC_SDIO_SLAVE NOT-SUPPORTED
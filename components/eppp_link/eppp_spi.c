@@ -20,6 +20,7 @@
 #include "driver/gpio.h"
 #include "esp_timer.h"
 #include "esp_rom_crc.h"
+#include "esp_heap_caps.h"
 
 #define TAG "eppp_spi"
 
@@ -28,12 +29,19 @@
 #define PPP_SOF 0x7E
 #define SPI_HEADER_MAGIC PPP_SOF
 #define SPI_ALIGN(size) (((size) + 3U) & ~(3U))
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+// packets are sent as records (see eppp_record_write()), one record of MAX_PAYLOAD fits a transaction
+#define TRANSFER_SIZE SPI_ALIGN(sizeof(struct header) + EPPP_RECORD_LEN(MAX_PAYLOAD))
+#else
 #define TRANSFER_SIZE SPI_ALIGN((MAX_PAYLOAD + 6))
+#endif
+#define MAX_TRANSACTION_PAYLOAD (TRANSFER_SIZE - sizeof(struct header))
 #define NEXT_TRANSACTION_SIZE(a,b) (((a)>(b))?(a):(b)) /* next transaction: whichever is bigger */
+#define POOL_SIZE CONFIG_EPPP_LINK_PACKET_QUEUE_SIZE
 
 struct packet {
-    size_t len;
-    uint8_t *data;
+    size_t len;     // length of the payload, or of the record if aggregating packets
+    uint8_t *data;  // pool slot of TRANSFER_SIZE bytes, the payload follows the space reserved for the header
     int channel;
 };
 
@@ -57,6 +65,12 @@ struct eppp_spi {
     struct eppp_handle parent;
     bool is_master;
     QueueHandle_t out_queue;
+    QueueHandle_t free_queue;   // free slots of the packet pool
+    SemaphoreHandle_t tx_lock;  // serializes the producers of the out_queue
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    size_t queued_len;          // length of the records queued or outbound, announced as the next transaction size
+#endif
+    uint8_t *pool;              // POOL_SIZE DMA capable transfer buffers
     QueueHandle_t ready_semaphore;
     spi_device_handle_t spi_device;
     spi_host_device_t spi_host;
@@ -69,30 +83,46 @@ struct eppp_spi {
     esp_timer_handle_t timer;
 };
 
-static esp_err_t transmit_generic(struct eppp_spi *handle, int channel, void *buffer, size_t len)
+static esp_err_t transmit_generic(struct eppp_spi *handle, int channel, const struct eppp_iov *iov, size_t iovcnt)
 {
-
     struct packet buf = { .channel = channel };
-    uint8_t *current_buffer = buffer;
+    size_t len = eppp_iov_len(iov, iovcnt);
+    size_t offset = 0;
     size_t remaining = len;
-    do {    // TODO(IDF-9194): Refactor this loop to allocate only once and perform
-        //       fragmentation after receiving from the queue (applicable only if MTU > MAX_PAYLOAD)
+    size_t nr_of_slots = (len + MAX_PAYLOAD - 1) / MAX_PAYLOAD;
+    if (len == 0) {
+        return ESP_OK;
+    }
+    xSemaphoreTake(handle->tx_lock, portMAX_DELAY);
+    // Only eppp_perform() returns the slots, so if they're available now, the whole packet gets queued
+    if (uxQueueMessagesWaiting(handle->free_queue) < nr_of_slots) {
+        xSemaphoreGive(handle->tx_lock);
+        // pool exhausted: inform the upper layers to retry later
+        ESP_LOGD(TAG, "No free slot to queue packet");
+        return ESP_ERR_NO_MEM;
+    }
+    do {
         size_t batch = remaining > MAX_PAYLOAD ? MAX_PAYLOAD : remaining;
-        buf.data = malloc(batch);
-        if (buf.data == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate packet");
-            return ESP_ERR_NO_MEM;
-        }
-        buf.len = batch;
+        xQueueReceive(handle->free_queue, &buf.data, 0);
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+        buf.len = eppp_record_write(buf.data + sizeof(struct header), channel, iov, iovcnt, offset, batch);
+#else
+        buf.len = eppp_iov_copy(buf.data + sizeof(struct header), iov, iovcnt, offset, batch);
+#endif
         remaining -= batch;
-        memcpy(buf.data, current_buffer, batch);
-        current_buffer += batch;
-        BaseType_t ret = xQueueSend(handle->out_queue, &buf, 0);
-        if (ret != pdTRUE) {
-            ESP_LOGE(TAG, "Failed to queue packet to slave!");
+        offset += batch;
+        if (xQueueSend(handle->out_queue, &buf, 0) != pdTRUE) {
+            // cannot happen, the queue has room for all the slots and for the signal from the GPIO ISR
+            xQueueSend(handle->free_queue, &buf.data, 0);
+            xSemaphoreGive(handle->tx_lock);
+            ESP_LOGE(TAG, "Packet queue overflow");
             return ESP_ERR_NO_MEM;
         }
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+        handle->queued_len += buf.len;
+#endif
     } while (remaining > 0);
+    xSemaphoreGive(handle->tx_lock);
 
     if (!handle->is_master && handle->blocked == SLAVE_BLOCKED) {
         uint32_t now = esp_timer_get_time();
@@ -109,7 +139,15 @@ static esp_err_t transmit(void *h, void *buffer, size_t len)
 {
     struct eppp_handle *handle = h;
     struct eppp_spi *spi_handle = __containerof(handle, struct eppp_spi, parent);;
-    return transmit_generic(spi_handle, 0, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_generic(spi_handle, 0, &iov, 1);
+}
+
+static esp_err_t transmit_iov(void *h, const struct eppp_iov *iov, size_t iovcnt)
+{
+    struct eppp_handle *handle = h;
+    struct eppp_spi *spi_handle = __containerof(handle, struct eppp_spi, parent);
+    return transmit_generic(spi_handle, 0, iov, iovcnt);
 }
 
 #ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
@@ -117,7 +155,8 @@ static esp_err_t transmit_channel(esp_netif_t *netif, int channel, void *buffer,
 {
     struct eppp_handle *handle = esp_netif_get_io_driver(netif);
     struct eppp_spi *spi_handle = __containerof(handle, struct eppp_spi, parent);;
-    return transmit_generic(spi_handle, channel, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_generic(spi_handle, channel, &iov, 1);
 }
 #endif
 
@@ -314,8 +353,36 @@ static esp_err_t perform_transaction_slave(struct eppp_spi *h, size_t len, const
     return spi_slave_transmit(h->spi_host, &t, portMAX_DELAY);
 }
 
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+/**
+ * @brief Appends the queued packets, which fit into the transaction, after the outbound record
+ * @return Length of all records in the transaction
+ */
+static size_t aggregate(struct eppp_spi *h, uint8_t *records)
+{
+    size_t len = h->outbound.len;
+    struct packet next;
+    xSemaphoreTake(h->tx_lock, portMAX_DELAY);
+    while (xQueuePeek(h->out_queue, &next, 0) == pdTRUE) {
+        if (next.len != -1) {   // signals from the GPIO ISR are just dropped
+            if (len + next.len > h->transaction_size) {
+                break;
+            }
+            memcpy(records + len, next.data + sizeof(struct header), next.len);
+            xQueueSend(h->free_queue, &next.data, 0);
+            len += next.len;
+        }
+        xQueueReceive(h->out_queue, &next, 0);
+    }
+    h->queued_len -= len;
+    xSemaphoreGive(h->tx_lock);
+    return len;
+}
+#endif
+
 esp_err_t eppp_perform(esp_netif_t *netif)
 {
+    // used only for transactions without outbound packet, packets are sent from their pool slots
     static WORD_ALIGNED_ATTR uint8_t out_buf[TRANSFER_SIZE] = {};
     static WORD_ALIGNED_ATTR uint8_t in_buf[TRANSFER_SIZE] = {};
 
@@ -350,18 +417,27 @@ esp_err_t eppp_perform(esp_netif_t *netif)
             h->blocked = NONE;
         }
     }
+    uint8_t *tx_buf = out_buf;
+    uint8_t *sent_slot = NULL;
     struct header *head = (void *)out_buf;
     if (h->outbound.len <= h->transaction_size && allow_test_tx == false) {
         // sending outbound
+        if (h->outbound.data) {
+            // the header is written in place, in front of the payload
+            sent_slot = tx_buf = h->outbound.data;
+            head = (void *)tx_buf;
+            ESP_LOG_BUFFER_HEXDUMP(TAG, tx_buf + sizeof(struct header), h->outbound.len, ESP_LOG_VERBOSE);
+        }
         head->size = h->outbound.len;
         head->channel = h->outbound.channel;
-        if (h->outbound.len > 0) {
-            memcpy(out_buf + sizeof(struct header), h->outbound.data, h->outbound.len);
-            free(h->outbound.data);
-            ESP_LOG_BUFFER_HEXDUMP(TAG, out_buf + sizeof(struct header), head->size, ESP_LOG_VERBOSE);
-            h->outbound.data = NULL;
-            h->outbound.len = 0;
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+        if (sent_slot) {
+            head->size = aggregate(h, tx_buf + sizeof(struct header));
         }
+        head->channel = 0;
+#endif
+        h->outbound.data = NULL;
+        h->outbound.len = 0;
         do {
             tx_queue_stat = xQueueReceive(h->out_queue, &h->outbound, 0);
         } while (tx_queue_stat == pdTRUE && h->outbound.len == -1);
@@ -373,10 +449,18 @@ esp_err_t eppp_perform(esp_netif_t *netif)
         head->size = 0;
         head->channel = 0;
     }
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+    // announce all the queued records, so that they could be sent in the next transaction
+    next_tx_size = head->next_size = h->queued_len < MAX_TRANSACTION_PAYLOAD ? h->queued_len : MAX_TRANSACTION_PAYLOAD;
+#else
     next_tx_size = head->next_size = h->outbound.len;
+#endif
     head->magic = SPI_HEADER_MAGIC;
-    head->check = esp_rom_crc16_le(0, out_buf, sizeof(struct header) - sizeof(uint16_t));
-    esp_err_t ret = perform_transaction(h, sizeof(struct header) + h->transaction_size, out_buf, in_buf);
+    head->check = esp_rom_crc16_le(0, tx_buf, sizeof(struct header) - sizeof(uint16_t));
+    esp_err_t ret = perform_transaction(h, sizeof(struct header) + h->transaction_size, tx_buf, in_buf);
+    if (sent_slot) {
+        xQueueSend(h->free_queue, &sent_slot, 0);
+    }
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "spi_device_transmit failed");
         h->transaction_size = 0; // need to start with HEADER only transaction
@@ -394,6 +478,12 @@ esp_err_t eppp_perform(esp_netif_t *netif)
     }
     if (head->size > 0) {
         ESP_LOG_BUFFER_HEXDUMP(TAG, in_buf + sizeof(struct header), head->size, ESP_LOG_VERBOSE);
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+        if (head->size > MAX_TRANSACTION_PAYLOAD || eppp_record_receive(netif, in_buf + sizeof(struct header), head->size) != ESP_OK) {
+            h->transaction_size = 0; // need to start with HEADER only transaction
+            return ESP_FAIL;
+        }
+#else
         if (head->channel == 0) {
             esp_netif_receive(netif, in_buf + sizeof(struct header), head->size, NULL);
         } else {
@@ -403,6 +493,7 @@ esp_err_t eppp_perform(esp_netif_t *netif)
             }
 #endif
         }
+#endif
     }
     h->transaction_size = NEXT_TRANSACTION_SIZE(next_tx_size, head->next_size);
     return ESP_OK;
@@ -445,8 +536,19 @@ eppp_transport_handle_t eppp_spi_init(struct eppp_config_spi_s *config)
 #endif
     h->is_master = config->is_master;
     h->parent.base.post_attach = post_attach;
-    h->out_queue = xQueueCreate(CONFIG_EPPP_LINK_PACKET_QUEUE_SIZE, sizeof(struct packet));
+    h->parent.transmit_iov = transmit_iov;
+    // one more entry for the signal from the GPIO ISR
+    h->out_queue = xQueueCreate(POOL_SIZE + 1, sizeof(struct packet));
     ESP_GOTO_ON_FALSE(h->out_queue, ESP_FAIL, err, TAG, "Failed to create the packet queue");
+    h->free_queue = xQueueCreate(POOL_SIZE, sizeof(uint8_t *));
+    ESP_GOTO_ON_FALSE(h->free_queue, ESP_FAIL, err, TAG, "Failed to create the packet pool queue");
+    ESP_GOTO_ON_FALSE(h->tx_lock = xSemaphoreCreateMutex(), ESP_FAIL, err, TAG, "Failed to create the Tx lock");
+    h->pool = heap_caps_malloc(POOL_SIZE * TRANSFER_SIZE, MALLOC_CAP_DMA);
+    ESP_GOTO_ON_FALSE(h->pool, ESP_FAIL, err, TAG, "Failed to allocate the packet pool");
+    for (int i = 0; i < POOL_SIZE; ++i) {
+        uint8_t *slot = h->pool + i * TRANSFER_SIZE;
+        xQueueSend(h->free_queue, &slot, 0);
+    }
     if (h->is_master) {
         ESP_GOTO_ON_FALSE(h->ready_semaphore = xSemaphoreCreateBinary(), ESP_FAIL, err, TAG, "Failed to create the semaphore");
     }
@@ -467,6 +569,13 @@ err:
     if (h->out_queue) {
         vQueueDelete(h->out_queue);
     }
+    if (h->free_queue) {
+        vQueueDelete(h->free_queue);
+    }
+    if (h->tx_lock) {
+        vSemaphoreDelete(h->tx_lock);
+    }
+    heap_caps_free(h->pool);
     if (h->ready_semaphore) {
         vSemaphoreDelete(h->ready_semaphore);
     }
@@ -481,13 +590,10 @@ void eppp_spi_deinit(eppp_transport_handle_t handle)
     } else {
         deinit_slave(h);
     }
-    struct packet buf = { };
-    while (xQueueReceive(h->out_queue, &buf, 0) == pdTRUE) {
-        if (buf.len > 0) {
-            free(buf.data);
-        }
-    }
     vQueueDelete(h->out_queue);
+    vQueueDelete(h->free_queue);
+    vSemaphoreDelete(h->tx_lock);
+    heap_caps_free(h->pool);
     if (h->is_master) {
         vSemaphoreDelete(h->ready_semaphore);
     }
@@ -0,0 +1,264 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "eppp_link.h"
+#include "eppp_transport.h"
+#include "eppp_stream.h"
+
+#define TAG "eppp_stream"
+
+static size_t frame_header(uint8_t *frame, uint8_t magic, uint8_t channel, size_t len)
+{
+    struct eppp_stream_header *head = (void *)frame;
+    head->magic = magic;
+    head->channel = channel;
+    head->size = len;
+    head->check = (0xFF & len) ^ (len >> 8);
+    return sizeof(struct eppp_stream_header);
+}
+
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+// Version of the header compression, and the flag of advertisements answering the peer's one
+#define HC_VERSION 1
+#define HC_REPLY 0x01
+
+static size_t compress_frame(struct eppp_stream *stream, uint8_t *frame, const struct eppp_iov *iov, size_t iovcnt, size_t len)
+{
+    if (stream->hc_reset) {
+        stream->hc_reset = false;
+        eppp_hc_tx_reset(&stream->hc_tx, stream->peer_slots);
+    }
+    if (stream->hc_tx.slots == 0) {
+        return 0;
+    }
+    uint8_t header[EPPP_HC_MAX_HEADER];
+    size_t header_len = len < sizeof(header) ? len : sizeof(header);
+    eppp_iov_copy(header, iov, iovcnt, 0, header_len);
+    struct eppp_hc_header hc;
+    uint8_t *payload = frame + sizeof(struct eppp_stream_header);
+    switch (eppp_hc_compress(&stream->hc_tx, header, header_len, len, &hc)) {
+    case EPPP_HC_UNCOMPRESSED:
+        frame_header(frame, EPPP_STREAM_MAGIC_HC, EPPP_STREAM_HC_UNCOMPRESSED | hc.slot, len);
+        eppp_iov_copy(payload, iov, iovcnt, 0, len);
+        return sizeof(struct eppp_stream_header) + len;
+    case EPPP_HC_COMPRESSED:
+        len = len - hc.skip;
+        frame_header(frame, EPPP_STREAM_MAGIC_HC, EPPP_STREAM_HC_COMPRESSED | hc.slot, hc.len + len);
+        memcpy(payload, hc.data, hc.len);
+        eppp_iov_copy(payload + hc.len, iov, iovcnt, hc.skip, len);
+        return sizeof(struct eppp_stream_header) + hc.len + len;
+    default:
+        return 0;
+    }
+}
+
+size_t eppp_stream_control(struct eppp_stream *stream, uint8_t *frame)
+{
+    if (stream->hc_advertised && !stream->hc_reply) {
+        return 0;
+    }
+    uint8_t *payload = frame + frame_header(frame, EPPP_STREAM_MAGIC_HC, EPPP_STREAM_HC_ADVERTISE, 3);
+    payload[0] = HC_VERSION;
+    payload[1] = EPPP_HC_SLOTS;
+    payload[2] = stream->hc_reply ? HC_REPLY : 0;
+    stream->hc_advertised = true;
+    stream->hc_reply = false;
+    return EPPP_STREAM_CONTROL_FRAME;
+}
+
+static void hc_receive(struct eppp_stream *stream, uint8_t type, uint8_t *data, size_t len, eppp_stream_deliver_fn_t deliver, void *ctx)
+{
+    uint8_t slot = type & EPPP_STREAM_HC_SLOT_MASK;
+    switch (type & ~EPPP_STREAM_HC_SLOT_MASK) {
+    case EPPP_STREAM_HC_ADVERTISE:
+        if (len < 3 || data[0] != HC_VERSION) {
+            ESP_LOGW(TAG, "Unsupported header compression from peer");
+            return;
+        }
+        ESP_LOGI(TAG, "Peer decompresses TCP/IP headers (%d flows)", data[1]);
+        stream->peer_slots = data[1];
+        stream->hc_reset = true;
+        if (!(data[2] & HC_REPLY)) {
+            // the peer (re)started: forget its flows and let it know we decompress too
+            memset(&stream->hc_rx, 0, sizeof(stream->hc_rx));
+            stream->hc_reply = true;
+        }
+        return;
+    case EPPP_STREAM_HC_UNCOMPRESSED:
+        if (!eppp_hc_uncompressed(&stream->hc_rx, slot, data, len)) {
+            ESP_LOGD(TAG, "Cannot store flow %d", slot);
+        }
+        deliver(ctx, 0, data, len);
+        return;
+    case EPPP_STREAM_HC_COMPRESSED:
+        len = eppp_hc_decompress(&stream->hc_rx, slot, data, len, stream->packet, sizeof(stream->packet));
+        if (len == 0) {
+            ESP_LOGD(TAG, "Dropped compressed packet of unknown flow %d", slot);
+            return;
+        }
+        deliver(ctx, 0, stream->packet, len);
+        return;
+    default:
+        ESP_LOGW(TAG, "Unknown frame type 0x%02x", type);
+        return;
+    }
+}
+
+static bool is_magic(uint8_t byte)
+{
+    return byte == EPPP_STREAM_MAGIC || byte == EPPP_STREAM_MAGIC_HC;
+}
+
+static uint8_t *find_magic(uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        if (is_magic(data[i])) {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+#else
+static bool is_magic(uint8_t byte)
+{
+    return byte == EPPP_STREAM_MAGIC;
+}
+
+static uint8_t *find_magic(uint8_t *data, size_t len)
+{
+    return memchr(data, EPPP_STREAM_MAGIC, len);
+}
+#endif // CONFIG_EPPP_LINK_HEADER_COMPRESSION
+
+size_t eppp_stream_frame(struct eppp_stream *stream, uint8_t *frame, int channel, const struct eppp_iov *iov, size_t iovcnt)
+{
+    size_t len = eppp_iov_len(iov, iovcnt);
+    if (len > EPPP_STREAM_MAX_PAYLOAD) {
+        return 0;
+    }
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+    if (channel == 0) {
+        size_t frame_len = compress_frame(stream, frame, iov, iovcnt, len);
+        if (frame_len > 0) {
+            return frame_len;
+        }
+    }
+#endif
+    frame_header(frame, EPPP_STREAM_MAGIC, channel, len);
+    eppp_iov_copy(frame + sizeof(struct eppp_stream_header), iov, iovcnt, 0, len);
+    return sizeof(struct eppp_stream_header) + len;
+}
+
+uint8_t *eppp_stream_rx_space(struct eppp_stream *stream, size_t *space)
+{
+    *space = sizeof(stream->buffer) - stream->end;
+    return stream->buffer + stream->end;
+}
+
+static void compact(struct eppp_stream *stream)
+{
+    // compact if we don't have enough space for one more frame
+    if (stream->start > (sizeof(stream->buffer) / 2) || (sizeof(stream->buffer) - stream->end) < EPPP_STREAM_MAX_FRAME) {
+        if (stream->start < stream->end) {
+            size_t remaining_data = stream->end - stream->start;
+            memmove(stream->buffer, stream->buffer + stream->start, remaining_data);
+            stream->end = remaining_data;
+        } else {
+            stream->end = 0;
+        }
+        stream->start = 0;
+    }
+}
+
+void eppp_stream_rx_process(struct eppp_stream *stream, size_t len, eppp_stream_deliver_fn_t deliver, void *ctx)
+{
+    if (stream->end + len > sizeof(stream->buffer)) {
+        ESP_LOGW(TAG, "Buffer overflow, discarding data");
+        stream->start = stream->end = 0;
+        return;
+    }
+    stream->end += len;
+
+    // Process while we have enough data for at least a header
+    while ((stream->end - stream->start) >= sizeof(struct eppp_stream_header)) {
+        struct eppp_stream_header *head = (void *)(stream->buffer + stream->start);
+
+        if (!is_magic(head->magic)) {
+            goto recover;
+        }
+
+        uint8_t calculated_check = (head->size & 0xFF) ^ (head->size >> 8);
+        if (head->check != calculated_check) {
+            ESP_LOGW(TAG, "Checksum mismatch: expected 0x%04x, got 0x%04x", calculated_check, head->check);
+            goto recover;
+        }
+
+        // Check if we have the complete packet
+        uint16_t payload_size = head->size;
+        size_t total_packet_size = sizeof(struct eppp_stream_header) + payload_size;
+
+        if (payload_size > EPPP_STREAM_MAX_PAYLOAD) {
+            ESP_LOGW(TAG, "Invalid payload size: %d", payload_size);
+            goto recover;
+        }
+
+        // If we don't have the complete packet yet, wait for more data
+        if ((stream->end - stream->start) < total_packet_size) {
+            ESP_LOGD(TAG, "Incomplete packet: got %d bytes, need %d bytes", (int)(stream->end - stream->start), (int)total_packet_size);
+            break;
+        }
+
+        // Got a complete packet, pass it to network
+        uint8_t *payload = stream->buffer + stream->start + sizeof(struct eppp_stream_header);
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+        if (head->magic == EPPP_STREAM_MAGIC_HC) {
+            hc_receive(stream, head->channel, payload, payload_size, deliver, ctx);
+        } else
+#endif
+        {
+            deliver(ctx, head->channel, payload, payload_size);
+        }
+
+        // Advance start pointer past this packet
+        stream->start += total_packet_size;
+        compact(stream);
+        continue;
+
+recover:
+        {
+            // Search for next magic occurrence
+            uint8_t *next_magic = find_magic(stream->buffer + stream->start + 1, stream->end - stream->start - 1);
+            if (next_magic) {
+                // Found next potential header, advance start to that position
+                stream->start = next_magic - stream->buffer;
+                compact(stream);
+            } else {
+                // No more magic found, discard all data
+                stream->start = stream->end = 0;
+            }
+        }
+    }
+}
+
+void eppp_stream_deliver(void *ctx, int channel, uint8_t *data, size_t len)
+{
+    esp_netif_t *netif = ctx;
+    if (channel == 0) {
+        esp_netif_receive(netif, data, len, NULL);
+        return;
+    }
+#ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
+    struct eppp_handle *h = esp_netif_get_io_driver(netif);
+    if (h->channel_rx) {
+        h->channel_rx(netif, channel, data, len);
+    }
+#endif
+}
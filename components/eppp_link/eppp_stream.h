@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+#include "eppp_hc.h"
+#endif
+
+// Framing of TUN packets on byte stream transports (UART, Linux host)
+#define EPPP_STREAM_MAX_PAYLOAD (1500)
+#define EPPP_STREAM_MAGIC (0x7E)
+// Frames of the header compression, the channel field holds the frame type (and the slot of the flow).
+// Peers without the compression skip them as garbage.
+#define EPPP_STREAM_MAGIC_HC (0x7D)
+#define EPPP_STREAM_HC_ADVERTISE    (0x00)
+#define EPPP_STREAM_HC_UNCOMPRESSED (0x10)
+#define EPPP_STREAM_HC_COMPRESSED   (0x20)
+#define EPPP_STREAM_HC_SLOT_MASK    (0x0F)
+
+struct eppp_stream_header {
+    uint8_t magic;
+    uint8_t channel;
+    uint8_t check;
+    uint16_t size;
+} __attribute__((packed));
+
+#define EPPP_STREAM_MAX_FRAME (sizeof(struct eppp_stream_header) + EPPP_STREAM_MAX_PAYLOAD)
+#define EPPP_STREAM_CONTROL_FRAME (sizeof(struct eppp_stream_header) + 3)
+
+struct eppp_iov;
+
+/**
+ * @brief Called for every complete packet found in the stream
+ */
+typedef void (*eppp_stream_deliver_fn_t)(void *ctx, int channel, uint8_t *data, size_t len);
+
+// State of the stream: receive buffer, which keeps partial frames until the rest arrives,
+// and the header compression contexts of both directions
+struct eppp_stream {
+    uint8_t buffer[2 * EPPP_STREAM_MAX_FRAME];
+    size_t start;
+    size_t end;
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+    struct eppp_hc_tx hc_tx;
+    struct eppp_hc_rx hc_rx;
+    uint8_t packet[EPPP_STREAM_MAX_PAYLOAD];    // decompressed packet
+    uint8_t peer_slots;     // flows the peer decompresses, as advertised
+    bool hc_reset;          // the peer advertised, restart the compressor (Tx)
+    bool hc_reply;          // the peer (re)started, advertise to it
+    bool hc_advertised;
+#endif
+};
+
+/**
+ * @brief Writes the header and the packet to the frame buffer (of at least EPPP_STREAM_MAX_FRAME bytes)
+ *
+ * With header compression, packets of channel 0 are compressed once the peer advertised it could decompress them
+ * @return Length of the frame, 0 if the packet is too long
+ */
+size_t eppp_stream_frame(struct eppp_stream *stream, uint8_t *frame, int channel, const struct eppp_iov *iov, size_t iovcnt);
+
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+/**
+ * @brief Writes the advertisement of the header compression if it's due (when starting, or when the peer restarted)
+ *
+ * Transports call it periodically from eppp_perform()
+ * @param frame Buffer of EPPP_STREAM_CONTROL_FRAME bytes
+ * @return Length of the frame, 0 if there's nothing to send
+ */
+size_t eppp_stream_control(struct eppp_stream *stream, uint8_t *frame);
+#endif
+
+/**
+ * @brief Returns the free space at the end of the receive buffer, where the transport reads new data
+ */
+uint8_t *eppp_stream_rx_space(struct eppp_stream *stream, size_t *space);
+
+/**
+ * @brief Appends len bytes read to the receive space and delivers all complete packets
+ *
+ * Corrupted data are skipped up to the next header magic
+ */
+void eppp_stream_rx_process(struct eppp_stream *stream, size_t len, eppp_stream_deliver_fn_t deliver, void *ctx);
+
+/**
+ * @brief Delivers the packet to the netif given as ctx (or its channel callback)
+ */
+void eppp_stream_deliver(void *ctx, int channel, uint8_t *data, size_t len);
@@ -13,12 +13,22 @@
 #define NR_OF_CHANNELS 1
 #endif
 
+// Maximum number of segments of a pbuf chain passed to transmit_iov(), longer chains are copied
+#define EPPP_MAX_IOV 8
+
+struct eppp_iov {
+    const void *base;
+    size_t len;
+};
+
 struct eppp_handle {
     esp_netif_driver_base_t base;
     eppp_type_t role;
     bool stop;
     bool exited;
     bool netif_stop;
+    // optional, transmits a packet scattered in several buffers (returns ESP_ERR_NOT_SUPPORTED to have it copied)
+    esp_err_t (*transmit_iov)(void *h, const struct eppp_iov *iov, size_t iovcnt);
 #ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
     eppp_channel_fn_t channel_tx;
     eppp_channel_fn_t channel_rx;
@@ -27,3 +37,36 @@ struct eppp_handle {
 };
 
 esp_err_t eppp_check_connection(esp_netif_t *netif);
+
+/**
+ * @brief Returns the total length of the buffers
+ */
+size_t eppp_iov_len(const struct eppp_iov *iov, size_t iovcnt);
+
+/**
+ * @brief Gathers len bytes starting at the offset of the scattered buffers to dst
+ * @return Number of bytes copied
+ */
+size_t eppp_iov_copy(uint8_t *dst, const struct eppp_iov *iov, size_t iovcnt, size_t offset, size_t len);
+
+#ifdef CONFIG_EPPP_LINK_PACKET_AGGREGATION
+// Prefix of every packet in an aggregated transfer, the payload is padded to 4 bytes
+struct eppp_record {
+    uint8_t channel;
+    uint8_t reserved;
+    uint16_t size;
+} __attribute__((packed));
+
+#define EPPP_RECORD_LEN(size) (sizeof(struct eppp_record) + (((size) + 3U) & ~(3U)))
+
+/**
+ * @brief Writes a record of len bytes starting at the offset of the scattered packet to the buffer
+ * @return Length of the record (EPPP_RECORD_LEN)
+ */
+size_t eppp_record_write(uint8_t *buffer, int channel, const struct eppp_iov *iov, size_t iovcnt, size_t offset, size_t len);
+
+/**
+ * @brief Passes all packets of the received records to the netif (or channel callback)
+ */
+esp_err_t eppp_record_receive(esp_netif_t *netif, uint8_t *buffer, size_t len);
+#endif
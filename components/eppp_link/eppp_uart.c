@@ -12,6 +12,7 @@
 #include "esp_event.h"
 #include "eppp_link.h"
 #include "eppp_transport.h"
+#include "eppp_stream.h"
 #include "driver/uart.h"
 
 #define TAG "eppp_uart"
@@ -20,38 +21,27 @@ struct eppp_uart {
     struct eppp_handle parent;
     QueueHandle_t uart_event_queue;
     uart_port_t uart_port;
+#ifndef CONFIG_EPPP_LINK_USES_PPP
+    struct eppp_stream stream;
+#endif
 };
 
-#define MAX_PAYLOAD (1500)
-#define HEADER_MAGIC (0x7E)
-#define HEADER_SIZE (4)
-#define MAX_PACKET_SIZE (MAX_PAYLOAD + HEADER_SIZE)
 /* Maximum size of a packet sent over UART, including header and payload */
-#define UART_BUF_SIZE   (MAX_PACKET_SIZE)
-
-struct header {
-    uint8_t magic;
-    uint8_t channel;
-    uint8_t check;
-    uint16_t size;
-} __attribute__((packed));
+#define UART_BUF_SIZE   (EPPP_STREAM_MAX_FRAME)
 
-static esp_err_t transmit_generic(struct eppp_uart *handle, int channel, void *buffer, size_t len)
+static esp_err_t transmit_generic(struct eppp_uart *handle, int channel, const struct eppp_iov *iov, size_t iovcnt)
 {
 #ifndef CONFIG_EPPP_LINK_USES_PPP
-    static uint8_t out_buf[MAX_PACKET_SIZE] = {};
-    struct header *head = (void *)out_buf;
-    head->magic = HEADER_MAGIC;
-    head->check = 0;
-    head->channel = channel;
-    head->size = len;
-    head->check = (0xFF & len) ^ (len >> 8);
-    memcpy(out_buf + sizeof(struct header), buffer, len);
-    ESP_LOG_BUFFER_HEXDUMP("ppp_uart_send", out_buf, len + sizeof(struct header), ESP_LOG_DEBUG);
-    uart_write_bytes(handle->uart_port, out_buf, len + sizeof(struct header));
+    static uint8_t out_buf[EPPP_STREAM_MAX_FRAME] = {};
+    size_t len = eppp_stream_frame(&handle->stream, out_buf, channel, iov, iovcnt);
+    ESP_RETURN_ON_FALSE(len > 0, ESP_ERR_INVALID_SIZE, TAG, "Packet too long (%d bytes)", (int)eppp_iov_len(iov, iovcnt));
+    ESP_LOG_BUFFER_HEXDUMP("ppp_uart_send", out_buf, len, ESP_LOG_DEBUG);
+    uart_write_bytes(handle->uart_port, out_buf, len);
 #else
-    ESP_LOG_BUFFER_HEXDUMP("ppp_uart_send", buffer, len, ESP_LOG_DEBUG);
-    uart_write_bytes(handle->uart_port, buffer, len);
+    for (size_t i = 0; i < iovcnt; ++i) {
+        ESP_LOG_BUFFER_HEXDUMP("ppp_uart_send", iov[i].base, iov[i].len, ESP_LOG_DEBUG);
+        uart_write_bytes(handle->uart_port, iov[i].base, iov[i].len);
+    }
 #endif
     return ESP_OK;
 }
@@ -60,7 +50,15 @@ static esp_err_t transmit(void *h, void *buffer, size_t len)
 {
     struct eppp_handle *handle = h;
     struct eppp_uart *uart_handle = __containerof(handle, struct eppp_uart, parent);
-    return transmit_generic(uart_handle, 0, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_generic(uart_handle, 0, &iov, 1);
+}
+
+static esp_err_t transmit_iov(void *h, const struct eppp_iov *iov, size_t iovcnt)
+{
+    struct eppp_handle *handle = h;
+    struct eppp_uart *uart_handle = __containerof(handle, struct eppp_uart, parent);
+    return transmit_generic(uart_handle, 0, iov, iovcnt);
 }
 
 #ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
@@ -68,7 +66,8 @@ static esp_err_t transmit_channel(esp_netif_t *netif, int channel, void *buffer,
 {
     struct eppp_handle *handle = esp_netif_get_io_driver(netif);
     struct eppp_uart *uart_handle = __containerof(handle, struct eppp_uart, parent);
-    return transmit_generic(uart_handle, channel, buffer, len);
+    struct eppp_iov iov = { .base = buffer, .len = len };
+    return transmit_generic(uart_handle, channel, &iov, 1);
 }
 #endif
 
@@ -99,112 +98,18 @@ static void deinit_uart(struct eppp_uart *h)
 /**
  * @brief Process incoming UART data and extract packets
  */
-static void process_packet(esp_netif_t *netif, uart_port_t uart_port, size_t available_data)
+static void process_packet(esp_netif_t *netif, struct eppp_uart *h, size_t available_data)
 {
-    static uint8_t in_buf[2 * UART_BUF_SIZE] = {};
-    static size_t buf_start = 0;
-    static size_t buf_end = 0;
-    struct header *head;
-
-    // Read data directly into our buffer
-    size_t available_space = sizeof(in_buf) - buf_end;
+    // Read data directly into the stream buffer
+    size_t available_space;
+    uint8_t *buffer = eppp_stream_rx_space(&h->stream, &available_space);
     size_t read_size = (available_data < available_space) ? available_data : available_space;
-    if (read_size > 0) {
-        size_t len = uart_read_bytes(uart_port, in_buf + buf_end, read_size, 0);
-        ESP_LOG_BUFFER_HEXDUMP("ppp_uart_recv", in_buf + buf_end, len, ESP_LOG_DEBUG);
-
-        if (buf_end + len <= sizeof(in_buf)) {
-            buf_end += len;
-        } else {
-            ESP_LOGW(TAG, "Buffer overflow, discarding data");
-            buf_start = buf_end = 0;
-            return;
-        }
-    }
-
-    // Process while we have enough data for at least a header
-    while ((buf_end - buf_start) >= sizeof(struct header)) {
-        head = (void *)(in_buf + buf_start);
-
-        if (head->magic != HEADER_MAGIC) {
-            goto recover;
-        }
-
-        uint8_t calculated_check = (head->size & 0xFF) ^ (head->size >> 8);
-        if (head->check != calculated_check) {
-            ESP_LOGW(TAG, "Checksum mismatch: expected 0x%04x, got 0x%04x", calculated_check, head->check);
-            goto recover;
-        }
-
-        // Check if we have the complete packet
-        uint16_t payload_size = head->size;
-        int channel = head->channel;
-        size_t total_packet_size = sizeof(struct header) + payload_size;
-
-        if (payload_size > MAX_PAYLOAD) {
-            ESP_LOGW(TAG, "Invalid payload size: %d", payload_size);
-            goto recover;
-        }
-
-        // If we don't have the complete packet yet, wait for more data
-        if ((buf_end - buf_start) < total_packet_size) {
-            ESP_LOGD(TAG, "Incomplete packet: got %d bytes, need %d bytes", (buf_end - buf_start), total_packet_size);
-            break;
-        }
-
-        // Got a complete packet, pass it to network
-        if (channel == 0) {
-            esp_netif_receive(netif, in_buf + buf_start + sizeof(struct header), payload_size, NULL);
-        } else {
-#ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
-            struct eppp_handle *handle = esp_netif_get_io_driver(netif);
-            struct eppp_uart *h = __containerof(handle, struct eppp_uart, parent);
-            if (h->parent.channel_rx) {
-                h->parent.channel_rx(netif, channel, in_buf + buf_start + sizeof(struct header), payload_size);
-            }
-#endif
-        }
-
-        // Advance start pointer past this packet
-        buf_start += total_packet_size;
-
-        // compact if we don't have enough space for 1x UART_BUF_SIZE
-        if (buf_start > (sizeof(in_buf) / 2) || (sizeof(in_buf) - buf_end) < UART_BUF_SIZE) {
-            if (buf_start < buf_end) {
-                size_t remaining_data = buf_end - buf_start;
-                memmove(in_buf, in_buf + buf_start, remaining_data);
-                buf_end = remaining_data;
-            } else {
-                buf_end = 0;
-            }
-            buf_start = 0;
-        }
-
-        continue;
-
-recover:
-        // Search for next HEADER_MAGIC occurrence
-        uint8_t *next_magic = memchr(in_buf + buf_start + 1, HEADER_MAGIC, buf_end - buf_start - 1);
-        if (next_magic) {
-            // Found next potential header, advance start to that position
-            buf_start = next_magic - in_buf;
-
-            // Check if we need to compact after recovery too
-            if (buf_start > (sizeof(in_buf) / 2) || (sizeof(in_buf) - buf_end) < UART_BUF_SIZE) {
-                if (buf_start < buf_end) {
-                    size_t remaining_data = buf_end - buf_start;
-                    memmove(in_buf, in_buf + buf_start, remaining_data);
-                    buf_end = remaining_data;
-                } else {
-                    buf_end = 0;
-                }
-                buf_start = 0;
-            }
-        } else {
-            // No more HEADER_MAGIC found, discard all data
-            buf_start = buf_end = 0;
-        }
+    int len = read_size > 0 ? uart_read_bytes(h->uart_port, buffer, read_size, 0) : 0;
+    if (len < 0) {
+        return;
     }
+    ESP_LOG_BUFFER_HEXDUMP("ppp_uart_recv", buffer, len, ESP_LOG_DEBUG);
+    eppp_stream_rx_process(&h->stream, len, eppp_stream_deliver, netif);
 }
 #endif
 
@@ -217,6 +122,13 @@ esp_err_t eppp_perform(esp_netif_t *netif)
     if (h->parent.stop) {
         return ESP_ERR_TIMEOUT;
     }
+#ifdef CONFIG_EPPP_LINK_HEADER_COMPRESSION
+    uint8_t control[EPPP_STREAM_CONTROL_FRAME];
+    size_t control_len = eppp_stream_control(&h->stream, control);
+    if (control_len > 0) {
+        uart_write_bytes(h->uart_port, control, control_len);
+    }
+#endif
 
     if (xQueueReceive(h->uart_event_queue, &event, pdMS_TO_TICKS(100)) != pdTRUE) {
         return ESP_OK;
@@ -232,7 +144,7 @@ esp_err_t eppp_perform(esp_netif_t *netif)
             esp_netif_receive(netif, buffer, len, NULL);
 #else
             // Read directly in process_packet to save one buffer
-            process_packet(netif, h->uart_port, len);
+            process_packet(netif, h, len);
 #endif
         }
     } else {
@@ -268,6 +180,7 @@ eppp_transport_handle_t eppp_uart_init(struct eppp_config_uart_s *config)
     h->parent.channel_tx = transmit_channel;
 #endif
     h->parent.base.post_attach = post_attach;
+    h->parent.transmit_iov = transmit_iov;
     ESP_GOTO_ON_ERROR(init_uart(h, config), err, TAG, "Failed to init UART");
     return &h->parent;
 err:
@@ -58,6 +58,11 @@ extern "C" {
         .rst_io= 5,                 \
     },                              \
 
+#define EPPP_DEFAULT_HOST_CONFIG()  \
+    .host = {                       \
+        .fd = -1,                   \
+    },                              \
+
 #if CONFIG_EPPP_LINK_DEVICE_SPI
 #define EPPP_DEFAULT_TRANSPORT_CONFIG() EPPP_DEFAULT_SPI_CONFIG()
 #define EPPP_TRANSPORT_INIT(cfg)        eppp_spi_init(&cfg->spi)
@@ -78,6 +83,11 @@ extern "C" {
 #define EPPP_TRANSPORT_INIT(cfg)        eppp_eth_init(&cfg->ethernet)
 #define EPPP_TRANSPORT_DEINIT(handle)   eppp_eth_deinit(handle)
 
+#elif CONFIG_EPPP_LINK_DEVICE_HOST
+#define EPPP_DEFAULT_TRANSPORT_CONFIG() EPPP_DEFAULT_HOST_CONFIG()
+#define EPPP_TRANSPORT_INIT(cfg)        eppp_host_init(&cfg->host)
+#define EPPP_TRANSPORT_DEINIT(handle)   eppp_host_deinit(handle)
+
 #else
 #error Unexpeted transport
 #endif
@@ -112,6 +122,7 @@ typedef enum eppp_transport {
     EPPP_TRANSPORT_SPI,
     EPPP_TRANSPORT_SDIO,
     EPPP_TRANSPORT_ETHERNET,
+    EPPP_TRANSPORT_HOST,
 } eppp_transport_t;
 
 
@@ -161,6 +172,10 @@ typedef struct eppp_config_t {
         int rst_io;
     } ethernet;
 
+    struct eppp_config_host_s {
+        int fd;     // connected socket (e.g. one end of a socketpair) or pty, owned by the caller
+    } host;
+
     struct eppp_config_task_s {
         bool run_task;
         int stack_size;
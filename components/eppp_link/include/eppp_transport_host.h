@@ -0,0 +1,11 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include "eppp_link.h"
+
+eppp_transport_handle_t eppp_host_init(struct eppp_config_host_s *config);
+void eppp_host_deinit(eppp_transport_handle_t h);
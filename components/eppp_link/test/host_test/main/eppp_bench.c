@@ -0,0 +1,522 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+// Benchmarks of the eppp link between two endpoints running in this Linux process, connected by
+// a socketpair (or a pty) through the host transport. Each measurement is appended as one JSON line
+// to the file given by BENCHMARK_RESULTS (stdout if not set).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "eppp_link.h"
+#include "lwip/sockets.h"
+#include "host_fd.h"
+#if !CONFIG_EPPP_LINK_USES_PPP
+#include "eppp_transport.h"
+#include "eppp_stream.h"
+#endif
+
+#if CONFIG_EPPP_LINK_USES_PPP
+#define MODE "ppp"
+#elif CONFIG_EPPP_LINK_HEADER_COMPRESSION
+#define MODE "tun_hc"
+#else
+#define MODE "tun"
+#endif
+
+#ifdef CONFIG_EPPP_LINK_CHANNELS_SUPPORT
+#define BENCH_CHANNELS CONFIG_EPPP_LINK_NR_OF_CHANNELS
+#else
+#define BENCH_CHANNELS 1
+#endif
+
+#define BENCH_PORT 5001
+#define RX_TIMEOUT_MS 500
+
+static const char *TAG = "eppp_bench";
+static const char *s_desc[] = { [EPPP_SERVER] = "bench_server", [EPPP_CLIENT] = "bench_client" };
+static const char *s_ip[] = { [EPPP_SERVER] = "192.168.11.1", [EPPP_CLIENT] = "192.168.11.2" };
+static esp_netif_t *s_netif[2];
+static EventGroupHandle_t s_events;
+static int s_failures = 0;
+
+static int env_int(const char *name, int default_value)
+{
+    const char *env = getenv(name);
+    return env ? atoi(env) : default_value;
+}
+
+static const char *link_name(void)
+{
+    return env_int("BENCH_PTY", 0) ? "pty" : "socketpair";
+}
+
+static uint64_t now_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Appends one result with the netif mode and the link type, so results of different runs can be compared
+ */
+static void record(const char *benchmark, const char *fields)
+{
+    const char *path = getenv("BENCHMARK_RESULTS");
+    FILE *out = path ? fopen(path, "a") : stdout;
+    if (out == NULL) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        s_failures++;
+        return;
+    }
+    fprintf(out, "{\"benchmark\":\"%s\",\"mode\":\"%s\",\"link\":\"%s\",%s}\n", benchmark, MODE, link_name(), fields);
+    if (out != stdout) {
+        fclose(out);
+    }
+}
+
+#if !CONFIG_EPPP_LINK_USES_PPP
+// Frames of the stream fed repeatedly to the parser
+#define FRAMING_STREAM_PACKETS 64
+
+struct framing_stats {
+    size_t packets;
+    size_t bytes;
+    size_t channels[BENCH_CHANNELS];
+};
+
+static void count_packet(void *ctx, int channel, uint8_t *data, size_t len)
+{
+    struct framing_stats *stats = ctx;
+    stats->packets++;
+    stats->bytes += len;
+    if (channel < BENCH_CHANNELS) {
+        stats->channels[channel]++;
+    }
+}
+
+/**
+ * @brief Measures the framing of TUN packets alone (header, checks and channel demux), without the link
+ *
+ * The stream is parsed in chunks of the given size, as if read from the transport
+ */
+static void bench_framing(size_t payload, size_t chunk)
+{
+    static uint8_t stream_data[FRAMING_STREAM_PACKETS * EPPP_STREAM_MAX_FRAME];
+    static uint8_t packet[EPPP_STREAM_MAX_PAYLOAD];
+    static struct eppp_stream stream;
+    static struct eppp_stream tx_stream;    // without a peer, packets are framed as is
+    struct framing_stats stats = {};
+    const int packets = env_int("BENCH_FRAMING_PACKETS", 200000);
+    const size_t frame_len = sizeof(struct eppp_stream_header) + payload;
+    const size_t stream_len = FRAMING_STREAM_PACKETS * frame_len;
+    memset(&stream, 0, sizeof(stream));
+    memset(packet, 0x55, payload);
+
+    struct eppp_iov iov = { .base = packet, .len = payload };
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    for (int i = 0; i < packets; ++i) {
+        eppp_stream_frame(&tx_stream, stream_data + (i % FRAMING_STREAM_PACKETS) * frame_len, i % BENCH_CHANNELS, &iov, 1);
+    }
+    uint64_t encode_ns = now_ns(CLOCK_MONOTONIC) - start;
+
+    size_t remaining = packets * frame_len;
+    size_t pos = 0;
+    start = now_ns(CLOCK_MONOTONIC);
+    uint64_t cpu_start = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    while (remaining > 0) {
+        size_t space;
+        uint8_t *buffer = eppp_stream_rx_space(&stream, &space);
+        size_t len = chunk < space ? chunk : space;
+        len = len < remaining ? len : remaining;
+        len = len < stream_len - pos ? len : stream_len - pos;
+        memcpy(buffer, stream_data + pos, len);  // stands for the read() of the transport
+        eppp_stream_rx_process(&stream, len, count_packet, &stats);
+        pos = (pos + len) % stream_len;
+        remaining -= len;
+    }
+    uint64_t decode_ns = now_ns(CLOCK_MONOTONIC) - start;
+    uint64_t decode_cpu_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+
+    if (stats.packets != (size_t)packets || stats.bytes != (size_t)packets * payload) {
+        ESP_LOGE(TAG, "Framing: %d packets encoded, %d decoded", packets, (int)stats.packets);
+        s_failures++;
+    }
+    char fields[384];
+    snprintf(fields, sizeof(fields),
+             "\"payload\":%d,\"chunk\":%d,\"channels\":%d,\"packets\":%d,\"encode_ns_per_packet\":%.1f,"
+             "\"decode_ns_per_packet\":%.1f,\"decode_cpu_ns_per_packet\":%.1f,\"decode_mbit_per_s\":%.1f",
+             (int)payload, (int)chunk, BENCH_CHANNELS, packets, (double)encode_ns / packets,
+             (double)decode_ns / packets, (double)decode_cpu_ns / packets,
+             decode_ns ? (double)stats.bytes * 8 * 1000 / decode_ns : 0.0);
+    record("framing", fields);
+}
+#endif // !CONFIG_EPPP_LINK_USES_PPP
+
+static void on_ip_event(void *arg, esp_event_base_t base, int32_t event_id, void *data)
+{
+    ip_event_got_ip_t *event = data;
+    const char *desc = esp_netif_get_desc(event->esp_netif);
+    for (int role = EPPP_SERVER; role <= EPPP_CLIENT; ++role) {
+        if (desc && strcmp(desc, s_desc[role]) == 0) {
+            xEventGroupSetBits(s_events, BIT(role));
+        }
+    }
+}
+
+static esp_netif_t *open_endpoint(eppp_type_t role, int fd)
+{
+    eppp_config_t server_config = EPPP_DEFAULT_SERVER_CONFIG();
+    eppp_config_t client_config = EPPP_DEFAULT_CLIENT_CONFIG();
+    eppp_config_t config = role == EPPP_SERVER ? server_config : client_config;
+    config.transport = EPPP_TRANSPORT_HOST;
+    config.host.fd = fd;
+    config.ppp.netif_description = s_desc[role];
+    // don't wait for the connection, the peer is not running yet
+    return eppp_open(role, &config, 0);
+}
+
+/**
+ * @brief Creates a socket bound to the netif of the endpoint
+ *
+ * Both endpoints share one lwIP stack, so without binding to the netif,
+ * the packets between their addresses would be looped back locally instead of crossing the link
+ */
+static int endpoint_socket(eppp_type_t role, int type, uint16_t port)
+{
+    int sock = lwip_socket(AF_INET, type, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    struct ifreq ifr = {};
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    addr.sin_addr.s_addr = inet_addr(s_ip[role]);
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = RX_TIMEOUT_MS * 1000 };
+    int one = 1;
+    if (esp_netif_get_netif_impl_name(s_netif[role], ifr.ifr_name) != ESP_OK ||
+            lwip_setsockopt(sock, SOL_SOCKET, SO_BINDTODEVICE, &ifr, sizeof(ifr)) < 0 ||
+            lwip_setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+            lwip_setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0 ||
+            lwip_bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Failed to bind socket to %s: errno %d", s_desc[role], errno);
+        lwip_close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static struct sockaddr_in server_addr(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    addr.sin_addr.s_addr = inet_addr(s_ip[EPPP_SERVER]);
+    return addr;
+}
+
+struct receiver {
+    int sock;
+    volatile bool sender_done;
+    size_t datagrams;
+    size_t bytes;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    SemaphoreHandle_t finished;
+};
+
+static void udp_receiver(void *arg)
+{
+    struct receiver *rx = arg;
+    static uint8_t buffer[2048];
+    while (true) {
+        int len = lwip_recv(rx->sock, buffer, sizeof(buffer), 0);
+        if (len < 0) {
+            if (rx->sender_done) {
+                break;
+            }
+            continue;
+        }
+        rx->last_ns = now_ns(CLOCK_MONOTONIC);
+        if (rx->datagrams++ == 0) {
+            rx->first_ns = rx->last_ns;
+        }
+        rx->bytes += len;
+    }
+    xSemaphoreGive(rx->finished);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Sends datagrams from the client to the server as fast as the link accepts them
+ */
+static void bench_udp_throughput(size_t payload)
+{
+    static uint8_t buffer[1472];
+    const int datagrams = env_int("BENCH_UDP_DATAGRAMS", 20000);
+    struct receiver rx = { .finished = xSemaphoreCreateBinary() };
+    int sock = endpoint_socket(EPPP_CLIENT, SOCK_DGRAM, 0);
+    rx.sock = endpoint_socket(EPPP_SERVER, SOCK_DGRAM, BENCH_PORT);
+    if (sock < 0 || rx.sock < 0 || rx.finished == NULL) {
+        s_failures++;
+        goto cleanup;
+    }
+    xTaskCreate(udp_receiver, "udp_receiver", 4096, &rx, 5, NULL);
+
+    struct sockaddr_in to = server_addr();
+    int retries = 0;
+    uint64_t cpu_start = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < datagrams; ++i) {
+        while (lwip_sendto(sock, buffer, payload, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+            // link busy (ENOMEM), let the endpoints drain it
+            retries++;
+            vTaskDelay(1);
+        }
+    }
+    rx.sender_done = true;
+    xSemaphoreTake(rx.finished, portMAX_DELAY);
+    uint64_t cpu_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    uint64_t elapsed_ns = rx.last_ns - rx.first_ns;
+
+    char fields[384];
+    snprintf(fields, sizeof(fields),
+             "\"payload\":%d,\"sent\":%d,\"received\":%d,\"send_retries\":%d,\"loss_percent\":%.2f,"
+             "\"mbit_per_s\":%.1f,\"cpu_us_per_packet\":%.2f",
+             (int)payload, datagrams, (int)rx.datagrams, retries, 100.0 * (datagrams - (int)rx.datagrams) / datagrams,
+             elapsed_ns ? (double)rx.bytes * 8 * 1000 / elapsed_ns : 0.0,
+             rx.datagrams ? (double)cpu_ns / 1000 / rx.datagrams : 0.0);
+    record("udp_throughput", fields);
+    if (rx.datagrams == 0) {
+        s_failures++;
+    }
+cleanup:
+    if (sock >= 0) {
+        lwip_close(sock);
+    }
+    if (rx.sock >= 0) {
+        lwip_close(rx.sock);
+    }
+    if (rx.finished) {
+        vSemaphoreDelete(rx.finished);
+    }
+}
+
+static void tcp_receiver(void *arg)
+{
+    struct receiver *rx = arg;
+    static uint8_t buffer[4096];
+    int sock = -1;
+    while (sock < 0 && !rx->sender_done) {
+        sock = lwip_accept(rx->sock, NULL, NULL);
+    }
+    while (sock >= 0) {
+        int len = lwip_recv(sock, buffer, sizeof(buffer), 0);
+        if (len == 0 || (len < 0 && rx->sender_done)) {
+            break;
+        }
+        if (len > 0) {
+            rx->last_ns = now_ns(CLOCK_MONOTONIC);
+            rx->bytes += len;
+            rx->datagrams++;
+        }
+    }
+    if (sock >= 0) {
+        lwip_close(sock);
+    }
+    xSemaphoreGive(rx->finished);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Streams data over TCP from the client to the server, the ACKs cross the link in the other direction
+ */
+static void bench_tcp_throughput(void)
+{
+    static uint8_t buffer[4096];
+    const int total = env_int("BENCH_TCP_BYTES", 8 * 1024 * 1024);
+    struct receiver rx = { .finished = xSemaphoreCreateBinary() };
+    int sock = endpoint_socket(EPPP_CLIENT, SOCK_STREAM, 0);
+    rx.sock = endpoint_socket(EPPP_SERVER, SOCK_STREAM, BENCH_PORT);
+    if (sock < 0 || rx.sock < 0 || rx.finished == NULL || lwip_listen(rx.sock, 1) < 0) {
+        s_failures++;
+        goto cleanup;
+    }
+    xTaskCreate(tcp_receiver, "tcp_receiver", 4096, &rx, 5, NULL);
+
+    struct sockaddr_in to = server_addr();
+    uint64_t cpu_start = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    rx.first_ns = now_ns(CLOCK_MONOTONIC);
+    if (lwip_connect(sock, (struct sockaddr *)&to, sizeof(to)) < 0) {
+        ESP_LOGE(TAG, "Failed to connect: errno %d", errno);
+        s_failures++;
+    } else {
+        int sent = 0;
+        while (sent < total) {
+            int len = lwip_send(sock, buffer, total - sent < (int)sizeof(buffer) ? total - sent : (int)sizeof(buffer), 0);
+            if (len < 0) {
+                ESP_LOGE(TAG, "Failed to send: errno %d", errno);
+                s_failures++;
+                break;
+            }
+            sent += len;
+        }
+    }
+    lwip_shutdown(sock, SHUT_WR);
+    rx.sender_done = true;
+    xSemaphoreTake(rx.finished, portMAX_DELAY);
+    uint64_t cpu_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    uint64_t elapsed_ns = rx.last_ns > rx.first_ns ? rx.last_ns - rx.first_ns : 0;
+
+    char fields[256];
+    snprintf(fields, sizeof(fields), "\"bytes\":%d,\"received\":%d,\"mbit_per_s\":%.1f,\"cpu_us_per_kbyte\":%.2f",
+             total, (int)rx.bytes, elapsed_ns ? (double)rx.bytes * 8 * 1000 / elapsed_ns : 0.0,
+             rx.bytes ? (double)cpu_ns / rx.bytes : 0.0);
+    record("tcp_throughput", fields);
+    if (rx.bytes != (size_t)total) {
+        s_failures++;
+    }
+cleanup:
+    if (sock >= 0) {
+        lwip_close(sock);
+    }
+    if (rx.sock >= 0) {
+        lwip_close(rx.sock);
+    }
+    if (rx.finished) {
+        vSemaphoreDelete(rx.finished);
+    }
+}
+
+static void udp_echo(void *arg)
+{
+    struct receiver *rx = arg;
+    static uint8_t buffer[2048];
+    while (!rx->sender_done) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = lwip_recvfrom(rx->sock, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_len);
+        if (len > 0) {
+            lwip_sendto(rx->sock, buffer, len, 0, (struct sockaddr *)&from, from_len);
+        }
+    }
+    xSemaphoreGive(rx->finished);
+    vTaskDelete(NULL);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Measures round trips of small datagrams echoed by the server
+ */
+static void bench_udp_latency(size_t payload)
+{
+    static uint8_t buffer[1472];
+    const int samples = env_int("BENCH_LATENCY_SAMPLES", 1000);
+    uint64_t *rtt = calloc(samples, sizeof(uint64_t));
+    struct receiver rx = { .finished = xSemaphoreCreateBinary() };
+    int sock = endpoint_socket(EPPP_CLIENT, SOCK_DGRAM, 0);
+    rx.sock = endpoint_socket(EPPP_SERVER, SOCK_DGRAM, BENCH_PORT);
+    if (rtt == NULL || sock < 0 || rx.sock < 0 || rx.finished == NULL) {
+        s_failures++;
+        goto cleanup;
+    }
+    xTaskCreate(udp_echo, "udp_echo", 4096, &rx, 5, NULL);
+
+    struct sockaddr_in to = server_addr();
+    int received = 0;
+    uint64_t cpu_start = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < samples; ++i) {
+        uint64_t start = now_ns(CLOCK_MONOTONIC);
+        if (lwip_sendto(sock, buffer, payload, 0, (struct sockaddr *)&to, sizeof(to)) < 0 ||
+                lwip_recv(sock, buffer, sizeof(buffer), 0) < 0) {
+            continue;
+        }
+        rtt[received++] = now_ns(CLOCK_MONOTONIC) - start;
+    }
+    uint64_t cpu_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    rx.sender_done = true;
+    xSemaphoreTake(rx.finished, portMAX_DELAY);
+
+    if (received == 0) {
+        ESP_LOGE(TAG, "No echo received");
+        s_failures++;
+        goto cleanup;
+    }
+    qsort(rtt, received, sizeof(uint64_t), compare_u64);
+    char fields[384];
+    snprintf(fields, sizeof(fields),
+             "\"payload\":%d,\"samples\":%d,\"received\":%d,\"min_us\":%.1f,\"median_us\":%.1f,\"p95_us\":%.1f,"
+             "\"max_us\":%.1f,\"cpu_us_per_round_trip\":%.2f",
+             (int)payload, samples, received, rtt[0] / 1000.0, rtt[received / 2] / 1000.0,
+             rtt[received * 95 / 100] / 1000.0, rtt[received - 1] / 1000.0, (double)cpu_ns / 1000 / received);
+    record("udp_latency", fields);
+cleanup:
+    free(rtt);
+    if (sock >= 0) {
+        lwip_close(sock);
+    }
+    if (rx.sock >= 0) {
+        lwip_close(rx.sock);
+    }
+    if (rx.finished) {
+        vSemaphoreDelete(rx.finished);
+    }
+}
+
+void app_main(void)
+{
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+#if !CONFIG_EPPP_LINK_USES_PPP
+    const size_t payloads[] = { 64, 512, 1500 };
+    const size_t chunks[] = { 128, 4096 };
+    for (int i = 0; i < sizeof(payloads) / sizeof(payloads[0]); ++i) {
+        for (int j = 0; j < sizeof(chunks) / sizeof(chunks[0]); ++j) {
+            bench_framing(payloads[i], chunks[j]);
+        }
+    }
+#endif
+
+    int fds[2];
+    s_events = xEventGroupCreate();
+    if (s_events == NULL || host_fd_open_pair(env_int("BENCH_PTY", 0), fds) < 0) {
+        ESP_LOGE(TAG, "Failed to create the link");
+        exit(1);
+    }
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_PPP_GOT_IP, on_ip_event, NULL));
+    s_netif[EPPP_SERVER] = open_endpoint(EPPP_SERVER, fds[0]);
+    s_netif[EPPP_CLIENT] = open_endpoint(EPPP_CLIENT, fds[1]);
+    EventBits_t bits = xEventGroupWaitBits(s_events, BIT(EPPP_SERVER) | BIT(EPPP_CLIENT), pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(env_int("BENCH_CONNECT_TIMEOUT_MS", 30000)));
+    if (s_netif[EPPP_SERVER] == NULL || s_netif[EPPP_CLIENT] == NULL || bits != (BIT(EPPP_SERVER) | BIT(EPPP_CLIENT))) {
+        ESP_LOGE(TAG, "Endpoints not connected");
+        exit(1);
+    }
+    ESP_LOGI(TAG, "Both endpoints connected over %s (%s mode)", link_name(), MODE);
+
+    const size_t datagrams[] = { 64, 512, 1400 };
+    for (int i = 0; i < sizeof(datagrams) / sizeof(datagrams[0]); ++i) {
+        bench_udp_throughput(datagrams[i]);
+    }
+    bench_tcp_throughput();
+    bench_udp_latency(64);
+    bench_udp_latency(1400);
+
+    ESP_LOGI(TAG, "Benchmarks finished with %d failures", s_failures);
+    exit(s_failures ? 1 : 0);
+}
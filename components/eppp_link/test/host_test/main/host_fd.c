@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+// Host side of the link, kept apart from lwIP headers which redefine the socket API
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pty.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include "host_fd.h"
+
+int host_fd_open_pair(bool use_pty, int fds[2])
+{
+    if (!use_pty) {
+        return socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    }
+    if (openpty(&fds[0], &fds[1], NULL, NULL, NULL) < 0) {
+        return -1;
+    }
+    // raw mode on both ends, the link carries binary frames
+    for (int i = 0; i < 2; ++i) {
+        struct termios tio;
+        if (tcgetattr(fds[i], &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(fds[i], TCSANOW, &tio);
+        }
+    }
+    return 0;
+}
+
+void host_fd_close_pair(int fds[2])
+{
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -0,0 +1,16 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief Opens two connected file descriptors, a socketpair or a pty (master, slave)
+ * @return 0 on success, -1 on failure
+ */
+int host_fd_open_pair(bool use_pty, int fds[2]);
+
+void host_fd_close_pair(int fds[2]);
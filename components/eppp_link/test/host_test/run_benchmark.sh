@@ -0,0 +1,41 @@
+#!/bin/bash
+#
+# SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# Benchmark harness: builds the app for every netif mode (TUN, TUN with header compression, PPP),
+# runs it over every link type (socketpair, pty) and collects results as JSON lines.
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+MODES="${BENCH_MODES:-tun tun_hc ppp}"
+LINKS="${BENCH_LINKS:-socketpair pty}"
+TEST_TIMEOUT="${TEST_TIMEOUT:-300}"
+export BENCHMARK_RESULTS="${BENCHMARK_RESULTS:-${SCRIPT_DIR}/build/benchmark_results.jsonl}"
+
+mkdir -p "$(dirname "$BENCHMARK_RESULTS")"
+: > "$BENCHMARK_RESULTS"
+RESULT=0
+
+for mode in $MODES; do
+    BUILD_DIR="${SCRIPT_DIR}/build_${mode}"
+    if [ ! -f "${BUILD_DIR}/eppp_host_test.elf" ]; then
+        echo "Building ${mode} mode..."
+        idf.py -C "$SCRIPT_DIR" -B "$BUILD_DIR" -DSDKCONFIG="${BUILD_DIR}/sdkconfig" \
+            -DSDKCONFIG_DEFAULTS="sdkconfig.defaults;sdkconfig.ci.${mode}" build || exit 1
+    fi
+    for link in $LINKS; do
+        echo "Benchmark: mode=$mode, link=$link"
+        BENCH_PTY=$([ "$link" = "pty" ] && echo 1 || echo 0) \
+            timeout --signal=KILL "$TEST_TIMEOUT" "${BUILD_DIR}/eppp_host_test.elf" > /dev/null
+        TEST_RESULT=$?
+        if [ $TEST_RESULT -ne 0 ]; then
+            echo "Error: benchmark failed (exit code: $TEST_RESULT)"
+            RESULT=$TEST_RESULT
+        fi
+    done
+done
+
+echo ""
+echo "Results written to $BENCHMARK_RESULTS"
+cat "$BENCHMARK_RESULTS"
+exit $RESULT
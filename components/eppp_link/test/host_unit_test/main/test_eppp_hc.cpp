@@ -0,0 +1,405 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+#include "sdkconfig.h"
+#include "esp_netif.h"
+extern "C" {
+#include "eppp_link.h"
+#include "eppp_transport.h"
+#include "eppp_stream.h"
+#include "eppp_hc.h"
+}
+
+namespace {
+
+using packet_t = std::vector<uint8_t>;
+
+void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v >> 16);
+    put16(p + 2, v);
+}
+
+// State of one direction of a TCP connection
+struct flow {
+    uint8_t host;       // last byte of the source address
+    uint16_t port;
+    uint32_t seq;
+    uint32_t ack;
+    uint16_t win;
+    uint16_t id;
+};
+
+/**
+ * @brief Builds the next segment of the flow (IPv4 and TCP headers without options)
+ */
+packet_t segment(flow &f, size_t payload, bool push = false)
+{
+    packet_t p(40 + payload);
+    uint8_t *ip = p.data();
+    ip[0] = 0x45;
+    put16(ip + 2, p.size());
+    put16(ip + 4, f.id++);
+    ip[6] = 0x40;       // don't fragment
+    ip[8] = 64;
+    ip[9] = 6;
+    const uint8_t addr[8] = { 192, 168, 11, f.host, 192, 168, 11, 1 };
+    memcpy(ip + 12, addr, sizeof(addr));
+    uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2) {
+        sum += (ip[i] << 8) | ip[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    put16(ip + 10, ~sum);
+
+    uint8_t *tcp = ip + 20;
+    put16(tcp, f.port);
+    put16(tcp + 2, 1883);
+    put32(tcp + 4, f.seq);
+    put32(tcp + 8, f.ack);
+    tcp[12] = 0x50;
+    tcp[13] = push ? 0x18 : 0x10;
+    put16(tcp + 14, f.win);
+    put16(tcp + 16, f.seq ^ f.ack);     // not verified, only carried over
+    for (size_t i = 0; i < payload; ++i) {
+        tcp[20 + i] = f.seq + i;
+    }
+    f.seq += payload;
+    return p;
+}
+
+// Both ends of the header compression, the way eppp_stream.c drives them
+struct hc_link {
+    eppp_hc_tx tx;
+    eppp_hc_rx rx;
+
+    explicit hc_link(uint8_t slots = EPPP_HC_SLOTS)
+    {
+        eppp_hc_tx_reset(&tx, slots);
+        memset(&rx, 0, sizeof(rx));
+    }
+
+    /**
+     * @brief Compresses the packet and returns its frame payload, the type and the slot of the flow
+     */
+    packet_t send(const packet_t &p, eppp_hc_type_t *type, uint8_t *slot)
+    {
+        eppp_hc_header hc;
+        size_t header_len = p.size() < EPPP_HC_MAX_HEADER ? p.size() : EPPP_HC_MAX_HEADER;
+        *type = eppp_hc_compress(&tx, p.data(), header_len, p.size(), &hc);
+        *slot = hc.slot;
+        if (*type != EPPP_HC_COMPRESSED) {
+            return p;
+        }
+        REQUIRE(hc.len <= EPPP_HC_MAX_COMPRESSED);
+        packet_t frame(hc.data, hc.data + hc.len);
+        frame.insert(frame.end(), p.begin() + hc.skip, p.end());
+        return frame;
+    }
+
+    /**
+     * @brief Rebuilds the packet from the frame payload, empty if it was dropped
+     */
+    packet_t receive(const packet_t &frame, eppp_hc_type_t type, uint8_t slot)
+    {
+        if (type == EPPP_HC_UNCOMPRESSED) {
+            CHECK(eppp_hc_uncompressed(&rx, slot, frame.data(), frame.size()));
+        }
+        if (type != EPPP_HC_COMPRESSED) {
+            return frame;
+        }
+        packet_t p(EPPP_STREAM_MAX_PAYLOAD);
+        p.resize(eppp_hc_decompress(&rx, slot, frame.data(), frame.size(), p.data(), p.size()));
+        return p;
+    }
+
+    packet_t transfer(const packet_t &p, eppp_hc_type_t *type)
+    {
+        uint8_t slot;
+        packet_t frame = send(p, type, &slot);
+        return receive(frame, *type, slot);
+    }
+};
+
+// Stream endpoint, collects the packets delivered on channel 0
+struct endpoint {
+    eppp_stream stream = {};
+    std::vector<packet_t> received;
+
+    static void deliver(void *ctx, int channel, uint8_t *data, size_t len)
+    {
+        auto *self = static_cast<endpoint *>(ctx);
+        CHECK(channel == 0);
+        self->received.emplace_back(data, data + len);
+    }
+
+    void receive(const uint8_t *data, size_t len)
+    {
+        size_t space;
+        uint8_t *buffer = eppp_stream_rx_space(&stream, &space);
+        REQUIRE(len <= space);
+        memcpy(buffer, data, len);
+        eppp_stream_rx_process(&stream, len, deliver, this);
+    }
+
+    /**
+     * @brief Frames the packet, passes it to the peer and returns the frame header (magic and type)
+     */
+    eppp_stream_header send(endpoint &peer, const packet_t &p)
+    {
+        uint8_t frame[EPPP_STREAM_MAX_FRAME];
+        eppp_iov iov = { p.data(), p.size() };
+        size_t len = eppp_stream_frame(&stream, frame, 0, &iov, 1);
+        REQUIRE(len > 0);
+        peer.receive(frame, len);
+        eppp_stream_header head;
+        memcpy(&head, frame, sizeof(head));
+        return head;
+    }
+
+    /**
+     * @brief Sends the advertisement to the peer if it's due, returns its reply flag (-1 if nothing was sent)
+     */
+    int advertise(endpoint &peer)
+    {
+        uint8_t frame[EPPP_STREAM_CONTROL_FRAME];
+        size_t len = eppp_stream_control(&stream, frame);
+        if (len == 0) {
+            return -1;
+        }
+        REQUIRE(len == EPPP_STREAM_CONTROL_FRAME);
+        peer.receive(frame, len);
+        return frame[sizeof(eppp_stream_header) + 2];
+    }
+};
+
+} // namespace
+
+TEST_CASE("Compressed headers are restored byte for byte", "[eppp_hc]")
+{
+    hc_link link;
+    flow f = { 2, 50000, 0xFFFFF000, 1000, 5744, 0xFFFE };    // sequence and IP ID wrap around
+    eppp_hc_type_t type;
+
+    packet_t p = segment(f, 100);
+    CHECK(link.transfer(p, &type) == p);
+    CHECK(type == EPPP_HC_UNCOMPRESSED);
+
+    for (int i = 0; i < 200; ++i) {
+        size_t payload = (i % 3) ? (i * 7) % 1461 : 0;
+        f.ack += (i % 4) ? 0 : 536;
+        if (i % 10 == 0) {
+            f.win -= 1000;
+        }
+        if (i % 50 == 0) {
+            f.id += 1000;   // other traffic of the host in between
+            f.seq += 70000; // too far, sent in full
+        }
+        p = segment(f, payload, i % 5 == 0);
+        uint8_t slot;
+        packet_t frame = link.send(p, &type, &slot);
+        if (type == EPPP_HC_COMPRESSED) {
+            CHECK(frame.size() <= payload + EPPP_HC_MAX_COMPRESSED);
+        }
+        CHECK(link.receive(frame, type, slot) == p);
+    }
+}
+
+TEST_CASE("A retransmission resyncs the flow after a lost compressed frame", "[eppp_hc]")
+{
+    hc_link link;
+    flow f = { 2, 50000, 1, 1, 5744, 1 };
+    eppp_hc_type_t type;
+    uint8_t slot;
+
+    packet_t first = segment(f, 100);
+    CHECK(link.transfer(first, &type) == first);
+    flow before_lost = f;
+    packet_t lost = segment(f, 100);
+    link.send(lost, &type, &slot);
+    CHECK(type == EPPP_HC_COMPRESSED);
+
+    // the context of the receiver lags behind, the packet comes out wrong (TCP checksum fails)
+    packet_t next = segment(f, 100);
+    CHECK(link.transfer(next, &type) != next);
+    CHECK(type == EPPP_HC_COMPRESSED);
+
+    // the retransmission of the lost segment goes back in sequence, so it's sent in full
+    before_lost.id = f.id;
+    packet_t retransmitted = segment(before_lost, 100);
+    CHECK(link.transfer(retransmitted, &type) == retransmitted);
+    CHECK(type == EPPP_HC_UNCOMPRESSED);
+    for (int i = 0; i < 3; ++i) {
+        packet_t p = segment(before_lost, 100);
+        CHECK(link.transfer(p, &type) == p);
+        CHECK(type == EPPP_HC_COMPRESSED);
+    }
+}
+
+TEST_CASE("A retransmitted last segment is sent in full", "[eppp_hc]")
+{
+    hc_link link;
+    flow f = { 2, 50000, 1, 1, 5744, 1 };
+    eppp_hc_type_t type;
+
+    link.transfer(segment(f, 100), &type);
+    flow again = f;
+    link.transfer(segment(f, 100), &type);
+    CHECK(type == EPPP_HC_COMPRESSED);
+    packet_t p = segment(again, 100);
+    CHECK(link.transfer(p, &type) == p);
+    CHECK(type == EPPP_HC_UNCOMPRESSED);
+}
+
+TEST_CASE("The least recently used flow is evicted", "[eppp_hc]")
+{
+    hc_link link(2);
+    flow f[3] = {
+        { 2, 50000, 1, 1, 5744, 1 },
+        { 3, 50001, 1, 1, 5744, 1 },
+        { 4, 50002, 1, 1, 5744, 1 },
+    };
+    eppp_hc_type_t type;
+    uint8_t slot[3];
+
+    for (int i = 0; i < 2; ++i) {
+        packet_t p = segment(f[i], 10);
+        packet_t frame = link.send(p, &type, &slot[i]);
+        CHECK(type == EPPP_HC_UNCOMPRESSED);
+        CHECK(link.receive(frame, type, slot[i]) == p);
+    }
+    CHECK(slot[0] != slot[1]);
+    packet_t p = segment(f[1], 10);
+    CHECK(link.transfer(p, &type) == p);
+    CHECK(type == EPPP_HC_COMPRESSED);
+
+    // the third flow takes the slot of the first one, which was used least recently
+    p = segment(f[2], 10);
+    packet_t frame = link.send(p, &type, &slot[2]);
+    CHECK(type == EPPP_HC_UNCOMPRESSED);
+    CHECK(slot[2] == slot[0]);
+    CHECK(link.receive(frame, type, slot[2]) == p);
+
+    p = segment(f[1], 10);
+    CHECK(link.transfer(p, &type) == p);
+    CHECK(type == EPPP_HC_COMPRESSED);
+    p = segment(f[2], 10);
+    CHECK(link.transfer(p, &type) == p);
+    CHECK(type == EPPP_HC_COMPRESSED);
+
+    // the evicted flow comes back in full, now in place of the second one
+    uint8_t back;
+    p = segment(f[0], 10);
+    frame = link.send(p, &type, &back);
+    CHECK(type == EPPP_HC_UNCOMPRESSED);
+    CHECK(back == slot[1]);
+    CHECK(link.receive(frame, type, back) == p);
+    for (int i = 0; i < 2; ++i) {
+        p = segment(f[i], 10);
+        CHECK(link.transfer(p, &type) == p);
+    }
+}
+
+TEST_CASE("Headers are compressed towards a peer that advertised", "[eppp_stream]")
+{
+    auto a = std::make_unique<endpoint>();
+    auto b = std::make_unique<endpoint>();
+    flow f = { 2, 50000, 1, 1, 5744, 1 };
+
+    // no advertisement yet, the packet is framed as is
+    packet_t p = segment(f, 10);
+    CHECK(a->send(*b, p).magic == EPPP_STREAM_MAGIC);
+
+    CHECK(a->advertise(*b) == 0);
+    CHECK(b->advertise(*a) == 1);
+    CHECK(a->advertise(*b) == -1);
+    CHECK(b->advertise(*a) == -1);
+
+    p = segment(f, 10);
+    eppp_stream_header head = a->send(*b, p);
+    CHECK(head.magic == EPPP_STREAM_MAGIC_HC);
+    CHECK((head.channel & ~EPPP_STREAM_HC_SLOT_MASK) == EPPP_STREAM_HC_UNCOMPRESSED);
+    p = segment(f, 10);
+    head = a->send(*b, p);
+    CHECK((head.channel & ~EPPP_STREAM_HC_SLOT_MASK) == EPPP_STREAM_HC_COMPRESSED);
+    REQUIRE(b->received.size() == 3);
+    CHECK(b->received.back() == p);
+}
+
+TEST_CASE("A restarted peer is answered and its flows start over", "[eppp_stream]")
+{
+    auto a = std::make_unique<endpoint>();
+    auto b = std::make_unique<endpoint>();
+    flow fa = { 2, 50000, 1, 1, 5744, 1 };
+    flow fb = { 3, 1883, 1, 1, 5744, 1 };
+
+    a->advertise(*b);
+    b->advertise(*a);
+    for (int i = 0; i < 3; ++i) {
+        a->send(*b, segment(fa, 10));
+        b->send(*a, segment(fb, 10));
+    }
+    b->received.clear();
+    a->received.clear();
+
+    // b restarts and forgot the flows of a
+    b = std::make_unique<endpoint>();
+    CHECK(b->advertise(*a) == 0);
+
+    // not compressed towards b until a answers
+    packet_t p = segment(fb, 10);
+    CHECK(b->send(*a, p).magic == EPPP_STREAM_MAGIC);
+    CHECK(a->advertise(*b) == 1);
+    CHECK(a->advertise(*b) == -1);
+
+    // a restarts its compressor, so the flow is sent in full first
+    p = segment(fa, 10);
+    eppp_stream_header head = a->send(*b, p);
+    CHECK((head.channel & ~EPPP_STREAM_HC_SLOT_MASK) == EPPP_STREAM_HC_UNCOMPRESSED);
+    packet_t q = segment(fa, 10);
+    head = a->send(*b, q);
+    CHECK((head.channel & ~EPPP_STREAM_HC_SLOT_MASK) == EPPP_STREAM_HC_COMPRESSED);
+    REQUIRE(b->received.size() == 2);
+    CHECK(b->received[0] == p);
+    CHECK(b->received[1] == q);
+
+    // the new b starts its flows in full as well
+    p = segment(fb, 10);
+    head = b->send(*a, p);
+    CHECK((head.channel & ~EPPP_STREAM_HC_SLOT_MASK) == EPPP_STREAM_HC_UNCOMPRESSED);
+    q = segment(fb, 10);
+    b->send(*a, q);
+    REQUIRE(a->received.size() == 3);
+    CHECK(a->received[1] == p);
+    CHECK(a->received[2] == q);
+}
+
+extern "C" void app_main(void)
+{
+    int result = Catch::Session().run();
+    if (result != 0) {
+        printf("Test failed with result %d.\n", result);
+    } else {
+        printf("All tests passed successfully.\n");
+    }
+    std::exit(result);
+}
@@ -59,6 +59,18 @@ static esp_dns_handle_t esp_dns_create_handle(void)
     return &instance;
 }
 
+/**
+ * @brief Return a handle obtained from esp_dns_create_handle() that failed to initialize
+ *
+ * The handle is statically allocated, so it is only cleared for the next esp_dns_init()
+ *
+ * @param handle DNS module handle
+ */
+static void esp_dns_release_handle(esp_dns_handle_t handle)
+{
+    memset(handle, 0, sizeof(*handle));
+}
+
 /**
  * @brief Initialize the DNS module with provided configuration
  *
@@ -106,9 +118,19 @@ esp_dns_handle_t esp_dns_init(const esp_dns_config_t *config)
     handle->lock = xSemaphoreCreateMutex();
     if (handle->lock == NULL) {
         ESP_LOGE(TAG, "Failed to create handle mutex");
-        free(handle);
-        xSemaphoreGive(s_dns_global_mutex);
-        return NULL;
+        goto err_handle;
+    }
+
+    /* Allocate the answer cache */
+    if (esp_dns_cache_init(handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate DNS cache");
+        goto err_lock;
+    }
+
+    /* Set up the upstream servers and their connections */
+    if (esp_dns_servers_init(handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up DNS servers");
+        goto err_cache;
     }
 
     /* Set global handle */
@@ -119,6 +141,15 @@ esp_dns_handle_t esp_dns_init(const esp_dns_config_t *config)
     xSemaphoreGive(s_dns_global_mutex);
 
     return handle;
+
+err_cache:
+    esp_dns_cache_deinit(handle);
+err_lock:
+    vSemaphoreDelete(handle->lock);
+err_handle:
+    esp_dns_release_handle(handle);
+    xSemaphoreGive(s_dns_global_mutex);
+    return NULL;
 }
 
 /**
@@ -130,6 +161,9 @@ esp_dns_handle_t esp_dns_init(const esp_dns_config_t *config)
  */
 int esp_dns_cleanup(esp_dns_handle_t handle)
 {
+    /* Stop workers and close connections while the handle mutex still exists */
+    esp_dns_servers_deinit(handle);
+
     /* Take the handle mutex */
     if (xSemaphoreTake(handle->lock, portMAX_DELAY) != pdTRUE) {
         ESP_LOGE(TAG, "Failed to take handle mutex during cleanup");
@@ -140,6 +174,8 @@ int esp_dns_cleanup(esp_dns_handle_t handle)
     xSemaphoreGive(handle->lock);
     vSemaphoreDelete(handle->lock);
 
+    esp_dns_cache_deinit(handle);
+
     /* Take global mutex before modifying global handle */
     if (s_dns_global_mutex != NULL && xSemaphoreTake(s_dns_global_mutex, portMAX_DELAY) == pdTRUE) {
         /* Clear global handle if it matches this one */
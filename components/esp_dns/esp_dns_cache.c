@@ -0,0 +1,205 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file esp_dns_cache.c
+ * @brief TTL-aware answer cache for TCP, DoT and DoH lookups
+ *
+ * Keeps a bounded number of positive and negative answers keyed by hostname and
+ * record type. The cache has its own mutex so hits are served without waiting
+ * for queries that are in progress on the transport.
+ */
+
+#include <inttypes.h>
+#include <strings.h>
+#include "esp_dns_priv.h"
+#include "esp_dns.h"
+
+#define TAG "ESP_DNS_CACHE"
+
+/**
+ * @brief Returns true if the entry holds an answer that has not expired yet
+ */
+static bool cache_entry_fresh(const esp_dns_cache_entry_t *entry, TickType_t now)
+{
+    return entry->name[0] != '\0' && (int32_t)(entry->expires - now) > 0;
+}
+
+/**
+ * @brief Finds the entry for a name and record type, fresh or not
+ */
+static esp_dns_cache_entry_t *cache_find(esp_dns_handle_t handle, const char *name, u8_t rrtype)
+{
+    for (int i = 0; i < handle->cache_size; i++) {
+        esp_dns_cache_entry_t *entry = &handle->cache[i];
+        if (entry->rrtype == rrtype && strcasecmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Picks the entry to overwrite: an unused or expired one, else the one expiring first
+ */
+static esp_dns_cache_entry_t *cache_victim(esp_dns_handle_t handle, TickType_t now)
+{
+    esp_dns_cache_entry_t *victim = &handle->cache[0];
+
+    for (int i = 0; i < handle->cache_size; i++) {
+        esp_dns_cache_entry_t *entry = &handle->cache[i];
+        if (!cache_entry_fresh(entry, now)) {
+            return entry;
+        }
+        if ((int32_t)(entry->expires - victim->expires) < 0) {
+            victim = entry;
+        }
+    }
+    return victim;
+}
+
+esp_err_t esp_dns_cache_init(esp_dns_handle_t handle)
+{
+    if (handle->config.cache_config.disable) {
+        return ESP_OK;
+    }
+
+    handle->cache_size = handle->config.cache_config.max_entries ? : ESP_DNS_DEFAULT_CACHE_ENTRIES;
+    handle->cache = calloc(handle->cache_size, sizeof(esp_dns_cache_entry_t));
+    handle->cache_lock = xSemaphoreCreateMutex();
+    if (handle->cache == NULL || handle->cache_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate DNS cache");
+        esp_dns_cache_deinit(handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void esp_dns_cache_deinit(esp_dns_handle_t handle)
+{
+    free(handle->cache);
+    handle->cache = NULL;
+    handle->cache_size = 0;
+
+    if (handle->cache_lock) {
+        vSemaphoreDelete(handle->cache_lock);
+        handle->cache_lock = NULL;
+    }
+}
+
+bool esp_dns_cache_lookup(esp_dns_handle_t handle, const char *name, u8_t rrtype, ip_addr_t *addr, err_t *err)
+{
+    bool hit = false;
+
+    if (handle->cache == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(handle->cache_lock, portMAX_DELAY);
+    esp_dns_cache_entry_t *entry = cache_find(handle, name, rrtype);
+    if (entry != NULL && cache_entry_fresh(entry, xTaskGetTickCount())) {
+        memcpy(addr, entry->addrs, sizeof(entry->addrs));
+        *err = entry->status;
+        handle->cache_stats.hits++;
+        hit = true;
+    } else {
+        handle->cache_stats.misses++;
+    }
+    xSemaphoreGive(handle->cache_lock);
+
+    ESP_LOGD(TAG, "%s: %s (type %d)", hit ? "Hit" : "Miss", name, rrtype);
+    return hit;
+}
+
+void esp_dns_cache_store(esp_dns_handle_t handle, const char *name, u8_t rrtype, const dns_response_t *response)
+{
+    ip_addr_t addrs[DNS_MAX_HOST_IP];
+    uint32_t ttl = DNS_MAX_TTL;
+    err_t status = ERR_OK;
+    int count = 0;
+
+    if (handle->cache == NULL || strlen(name) >= DNS_MAX_NAME_LENGTH) {
+        return;
+    }
+
+    memset(addrs, 0, sizeof(addrs));
+    if (response->status_code == ERR_OK) {
+        /* Positive answer lives as long as its shortest lived address */
+        for (int i = 0; i < response->num_answers && count < DNS_MAX_HOST_IP; i++) {
+            if (response->answers[i].status != ERR_OK) {
+                continue;
+            }
+            addrs[count++] = response->answers[i].ip;
+            if (response->answers[i].ttl < ttl) {
+                ttl = response->answers[i].ttl;
+            }
+        }
+        if (count == 0) {
+            return;
+        }
+    } else if (response->status_code == ERR_VAL && response->negative_ttl > 0) {
+        status = ERR_VAL;
+        ttl = response->negative_ttl;
+    } else {
+        return;
+    }
+
+    if (ttl == 0) {
+        return;
+    }
+
+    xSemaphoreTake(handle->cache_lock, portMAX_DELAY);
+    TickType_t now = xTaskGetTickCount();
+    esp_dns_cache_entry_t *entry = cache_find(handle, name, rrtype);
+    if (entry == NULL) {
+        entry = cache_victim(handle, now);
+        strlcpy(entry->name, name, sizeof(entry->name));
+        entry->rrtype = rrtype;
+    }
+    entry->status = status;
+    memcpy(entry->addrs, addrs, sizeof(entry->addrs));
+    entry->expires = now + pdMS_TO_TICKS(ttl * 1000);
+    xSemaphoreGive(handle->cache_lock);
+
+    ESP_LOGD(TAG, "Stored %s answer for %s (type %d), ttl %" PRIu32 "s",
+             status == ERR_OK ? "positive" : "negative", name, rrtype, ttl);
+}
+
+esp_err_t esp_dns_get_cache_stats(esp_dns_handle_t handle, esp_dns_cache_stats_t *stats)
+{
+    if (handle == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (handle->cache == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(handle->cache_lock, portMAX_DELAY);
+    *stats = handle->cache_stats;
+    xSemaphoreGive(handle->cache_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_dns_flush_cache(esp_dns_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (handle->cache == NULL) {
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(handle->cache_lock, portMAX_DELAY);
+    memset(handle->cache, 0, handle->cache_size * sizeof(esp_dns_cache_entry_t));
+    xSemaphoreGive(handle->cache_lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,629 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file esp_dns_conn.c
+ * @brief Connection pool for stream based DNS transports (TCP, DoT)
+ *
+ * Keeps connections to a DNS server open between lookups and pipelines queries
+ * from concurrent tasks over one stream, matching responses by DNS ID as allowed
+ * by RFC 7766. All I/O on a stream is serialized, since a TLS session must not be
+ * read and written at the same time; the reading task waits for data in short
+ * slices so that other tasks can write their queries in between. Connections,
+ * including the persistent DoH client, are closed after the configured idle time.
+ */
+
+#include "esp_random.h"
+#include "esp_transport.h"
+#include "esp_dns_priv.h"
+#include "esp_dns.h"
+
+#define TAG "ESP_DNS_CONN"
+
+/** Longest a reader holds the I/O lock while waiting for a response to start */
+#define ESP_DNS_CONN_READ_SLICE_MS 20
+
+/**
+ * @brief Returns the ticks left until the query deadline, 0 if it has passed
+ */
+static TickType_t conn_ticks_left(TickType_t start, TickType_t timeout)
+{
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    return elapsed < timeout ? timeout - elapsed : 0;
+}
+
+/**
+ * @brief Closes the transport of a connection slot
+ *
+ * Must be called with the server lock held and no queries in flight on the slot.
+ */
+static void conn_close(esp_dns_conn_t *conn)
+{
+    if (conn->transport) {
+        esp_transport_close(conn->transport);
+        esp_transport_destroy(conn->transport);
+        conn->transport = NULL;
+    }
+    free(conn->frame);
+    conn->frame = NULL;
+    conn->broken = false;
+}
+
+/**
+ * @brief Looks up an undelivered pending query by DNS ID
+ */
+static esp_dns_pending_t *conn_find_pending(esp_dns_conn_t *conn, uint16_t id)
+{
+    for (esp_dns_pending_t *p = conn->pending; p != NULL; p = p->next) {
+        if (p->id == id && !p->done) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Wakes all tasks waiting on a connection so one of them picks up reading
+ */
+static void conn_wake_all(esp_dns_conn_t *conn)
+{
+    for (esp_dns_pending_t *p = conn->pending; p != NULL; p = p->next) {
+        xSemaphoreGive(p->wakeup);
+    }
+}
+
+/**
+ * @brief Takes the I/O lock of a connection to connect or write
+ *
+ * Registers the task as a waiter first, so that the task reading the stream
+ * does not take the lock again before the queries are written.
+ */
+static bool conn_io_lock(esp_dns_server_t *server, esp_dns_conn_t *conn, TickType_t wait)
+{
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    conn->io_waiters++;
+    xSemaphoreGive(server->lock);
+
+    bool locked = xSemaphoreTake(conn->io_lock, wait) == pdTRUE;
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    conn->io_waiters--;
+    if (!locked) {
+        conn_wake_all(conn);
+    }
+    xSemaphoreGive(server->lock);
+
+    return locked;
+}
+
+/**
+ * @brief Releases the I/O lock taken by conn_io_lock() and lets a waiting task resume reading
+ */
+static void conn_io_unlock(esp_dns_server_t *server, esp_dns_conn_t *conn)
+{
+    xSemaphoreGive(conn->io_lock);
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    conn_wake_all(conn);
+    xSemaphoreGive(server->lock);
+}
+
+/**
+ * @brief Marks the stream as unusable and fails all queries waiting on it
+ */
+static void conn_fail(esp_dns_conn_t *conn, err_t status)
+{
+    conn->broken = true;
+    for (esp_dns_pending_t *p = conn->pending; p != NULL; p = p->next) {
+        if (!p->done) {
+            p->done = true;
+            p->status = status;
+        }
+    }
+    conn_wake_all(conn);
+}
+
+/**
+ * @brief Hands a received response to the query with the matching DNS ID
+ */
+static void conn_dispatch(esp_dns_conn_t *conn, const char *frame, int len)
+{
+    if (len < sizeof(dns_header_t)) {
+        ESP_LOGW(TAG, "Dropping short DNS response (%d bytes)", len);
+        return;
+    }
+
+    uint16_t id = ((uint8_t)frame[0] << 8) | (uint8_t)frame[1];
+    esp_dns_pending_t *p = conn_find_pending(conn, id);
+    if (p == NULL) {
+        ESP_LOGD(TAG, "Dropping response with unknown ID 0x%04x", id);
+        return;
+    }
+
+    p->response_len = len < p->response_size ? len : p->response_size;
+    memcpy(p->response, frame, p->response_len);
+    p->status = ERR_OK;
+    p->done = true;
+    xSemaphoreGive(p->wakeup);
+}
+
+/**
+ * @brief Reads exactly len bytes from the transport
+ *
+ * Read timeouts only mean that no data arrived yet, the loop keeps reading until
+ * the deadline passes.
+ *
+ * @return Number of bytes read (less than len only on timeout), -1 if the stream
+ *         failed or was closed by the server
+ */
+static int conn_read_exact(esp_transport_handle_t transport, char *buffer, int len, TickType_t start, TickType_t timeout)
+{
+    int received = 0;
+
+    while (received < len) {
+        TickType_t left = conn_ticks_left(start, timeout);
+        if (left == 0) {
+            break;
+        }
+        int ret = esp_transport_read(transport, buffer + received, len - received, pdTICKS_TO_MS(left));
+        if (ret == ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            /* Closed by FIN or failed */
+            return -1;
+        }
+        received += ret;
+    }
+
+    return received;
+}
+
+/**
+ * @brief Reads one length-prefixed DNS message from the stream
+ *
+ * Messages larger than the buffer are truncated and the remainder is discarded.
+ * Only the start of a message is bounded by wait; once it begins to arrive, the
+ * rest is read until the query deadline so that framing is not lost.
+ *
+ * @return Length of the message stored in buffer, 0 on timeout before any data
+ *         arrived, -1 if the stream failed or lost framing
+ */
+static int conn_read_frame(esp_dns_conn_t *conn, char *buffer, int size, TickType_t wait,
+                           TickType_t start, TickType_t timeout)
+{
+    char prefix[2];
+    char discard[32];
+
+    int ret = conn_read_exact(conn->transport, prefix, 1, xTaskGetTickCount(), wait);
+    if (ret <= 0) {
+        return ret;
+    }
+    if (conn_read_exact(conn->transport, prefix + 1, 1, start, timeout) != 1) {
+        return -1;
+    }
+
+    int frame_len = ((uint8_t)prefix[0] << 8) | (uint8_t)prefix[1];
+    int stored = frame_len < size ? frame_len : size;
+    if (conn_read_exact(conn->transport, buffer, stored, start, timeout) != stored) {
+        return -1;
+    }
+
+    for (int left = frame_len - stored; left > 0;) {
+        int chunk = left < sizeof(discard) ? left : sizeof(discard);
+        if (conn_read_exact(conn->transport, discard, chunk, start, timeout) != chunk) {
+            return -1;
+        }
+        left -= chunk;
+    }
+
+    return stored;
+}
+
+/**
+ * @brief Picks the connection slot for a new query
+ *
+ * Prefers pipelining onto an open connection; a new connection is only opened when
+ * all open ones already carry ESP_DNS_MAX_IN_FLIGHT queries.
+ */
+static esp_dns_conn_t *conn_select(esp_dns_server_t *server)
+{
+    esp_dns_conn_t *best = NULL;
+    esp_dns_conn_t *free_slot = NULL;
+
+    for (int i = 0; i < server->max_conns; i++) {
+        esp_dns_conn_t *conn = &server->conns[i];
+        if (conn->broken) {
+            continue;
+        }
+        if (conn->transport == NULL && conn->in_flight == 0) {
+            if (free_slot == NULL) {
+                free_slot = conn;
+            }
+            continue;
+        }
+        if (best == NULL || conn->in_flight < best->in_flight) {
+            best = conn;
+        }
+    }
+
+    if (best != NULL && (best->in_flight < ESP_DNS_MAX_IN_FLIGHT || free_slot == NULL)) {
+        return best;
+    }
+    return free_slot;
+}
+
+/**
+ * @brief Removes finished queries from their connection
+ *
+ * Must be called with the server lock held.
+ */
+static void conn_release(esp_dns_conn_t *conn, esp_dns_pending_t *pending, int count)
+{
+    for (int i = 0; i < count; i++) {
+        for (esp_dns_pending_t **pp = &conn->pending; *pp != NULL; pp = &(*pp)->next) {
+            if (*pp == &pending[i]) {
+                *pp = pending[i].next;
+                break;
+            }
+        }
+    }
+    conn->in_flight -= count;
+    conn->last_used = xTaskGetTickCount();
+
+    if (conn->broken && conn->in_flight == 0) {
+        conn_close(conn);
+    }
+
+    /* Let a remaining query take over reading the stream */
+    conn_wake_all(conn);
+}
+
+/**
+ * @brief Waits for the responses to queries, reading the stream if nobody else does
+ *
+ * Returns when all responses arrived, when the grace period after the first one
+ * expired, or at the query deadline.
+ */
+static void conn_wait_responses(esp_dns_server_t *server, esp_dns_conn_t *conn, esp_dns_pending_t *pending,
+                                int count, TickType_t start, TickType_t timeout, TickType_t grace)
+{
+    TickType_t slice = pdMS_TO_TICKS(ESP_DNS_CONN_READ_SLICE_MS) ? : 1;
+    TickType_t first = 0;
+    bool answered = false;
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    while (true) {
+        int done = 0;
+        for (int i = 0; i < count; i++) {
+            done += pending[i].done;
+        }
+        if (done == count) {
+            break;
+        }
+
+        TickType_t left = conn_ticks_left(start, timeout);
+        if (done > 0) {
+            if (!answered) {
+                answered = true;
+                first = xTaskGetTickCount();
+            }
+            TickType_t grace_left = conn_ticks_left(first, grace);
+            if (grace_left < left) {
+                left = grace_left;
+            }
+        }
+        if (left == 0) {
+            break;
+        }
+
+        /* Read unless another task does or a writer is waiting for the stream */
+        if (!conn->reading && !conn->broken && conn->io_waiters == 0) {
+            conn->reading = true;
+            xSemaphoreGive(server->lock);
+
+            /* Wait for a response only briefly under the I/O lock, writers get their turn in between */
+            int len = 0;
+            if (xSemaphoreTake(conn->io_lock, left) == pdTRUE) {
+                len = conn_read_frame(conn, conn->frame, ESP_DNS_BUFFER_SIZE, left < slice ? left : slice,
+                                      start, timeout);
+                xSemaphoreGive(conn->io_lock);
+            }
+
+            xSemaphoreTake(server->lock, portMAX_DELAY);
+            conn->reading = false;
+            if (len < 0) {
+                ESP_LOGE(TAG, "Connection to DNS server lost");
+                conn_fail(conn, ERR_CONN);
+            } else if (len > 0) {
+                conn_dispatch(conn, conn->frame, len);
+            }
+        } else {
+            xSemaphoreGive(server->lock);
+            xSemaphoreTake(pending[0].wakeup, left);
+            xSemaphoreTake(server->lock, portMAX_DELAY);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!pending[i].done) {
+            pending[i].status = ERR_TIMEOUT;
+        }
+    }
+    xSemaphoreGive(server->lock);
+}
+
+/**
+ * @brief Runs queries over one pooled connection, connecting on demand
+ *
+ * @param reused Set to true if the queries were sent on an already open connection
+ *
+ * @return ERR_OK if the queries were sent (their results are in pending), error code otherwise
+ */
+static err_t conn_exchange(esp_dns_server_t *server, esp_dns_conn_query_t *queries, esp_dns_pending_t *pending,
+                           int count, TickType_t start, TickType_t timeout, TickType_t grace, bool *reused)
+{
+    err_t err = ERR_OK;
+    esp_dns_conn_t *conn;
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    conn = conn_select(server);
+    if (conn == NULL) {
+        xSemaphoreGive(server->lock);
+        ESP_LOGE(TAG, "No connection available");
+        return ERR_CONN;
+    }
+
+    for (int i = 0; i < count; i++) {
+        esp_dns_conn_query_t *query = &queries[i];
+
+        /* IDs must be unique among the queries in flight on one stream (RFC 7766, Section 7) */
+        while (conn_find_pending(conn, query->id) != NULL) {
+            query->id = (uint16_t)(esp_random() & 0xFFFF);
+        }
+        query->query[2] = (query->id >> 8) & 0xFF;
+        query->query[3] = query->id & 0xFF;
+
+        pending[i].id = query->id;
+        pending[i].done = false;
+        pending[i].status = ERR_OK;
+        pending[i].response = query->response;
+        pending[i].response_size = query->response_size;
+        pending[i].response_len = 0;
+        pending[i].next = conn->pending;
+        conn->pending = &pending[i];
+    }
+    conn->in_flight += count;
+    xSemaphoreGive(server->lock);
+
+    if (!conn_io_lock(server, conn, conn_ticks_left(start, timeout))) {
+        err = ERR_TIMEOUT;
+        goto release;
+    }
+
+    /* Do not write into a stream that failed while these queries were queued */
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    bool broken = conn->broken;
+    xSemaphoreGive(server->lock);
+    if (broken) {
+        conn_io_unlock(server, conn);
+        *reused = true;
+        err = ERR_CONN;
+        goto release;
+    }
+
+    *reused = conn->transport != NULL;
+    if (conn->transport == NULL) {
+        esp_transport_handle_t transport = NULL;
+        if (conn->frame == NULL) {
+            conn->frame = malloc(ESP_DNS_BUFFER_SIZE);
+        }
+        if (conn->frame != NULL) {
+            transport = server->create_transport(server);
+        }
+        if (transport == NULL) {
+            conn_io_unlock(server, conn);
+            err = ERR_MEM;
+            goto release;
+        }
+        if (esp_transport_connect(transport, server->config.dns_server, server->port,
+                                  pdTICKS_TO_MS(conn_ticks_left(start, timeout))) < 0) {
+            ESP_LOGE(TAG, "Connection to DNS server failed");
+            esp_transport_destroy(transport);
+            conn_io_unlock(server, conn);
+            err = ERR_CONN;
+            goto release;
+        }
+        conn->transport = transport;
+    }
+
+    /* Send all queries back to back, the server may answer them in any order */
+    for (int i = 0; i < count; i++) {
+        if (esp_transport_write(conn->transport, queries[i].query, queries[i].query_len,
+                                pdTICKS_TO_MS(conn_ticks_left(start, timeout))) != queries[i].query_len) {
+            ESP_LOGE(TAG, "Failed to send DNS query");
+            xSemaphoreTake(server->lock, portMAX_DELAY);
+            conn_fail(conn, ERR_CONN);
+            xSemaphoreGive(server->lock);
+            break;
+        }
+    }
+    conn_io_unlock(server, conn);
+
+    conn_wait_responses(server, conn, pending, count, start, timeout, grace);
+
+release:
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    conn_release(conn, pending, count);
+    xSemaphoreGive(server->lock);
+
+    return err;
+}
+
+err_t esp_dns_conn_query(esp_dns_server_t *server, esp_dns_conn_query_t *queries, int count, uint32_t grace_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(server->handle->config.timeout_ms ? : ESP_DNS_DEFAULT_TIMEOUT_MS);
+    esp_dns_pending_t pending[ESP_DNS_MAX_RRTYPES] = { 0 };
+    StaticSemaphore_t wakeup_buf;
+    SemaphoreHandle_t wakeup;
+    bool answered = false;
+
+    if (server->create_transport == NULL || count < 1 || count > ESP_DNS_MAX_RRTYPES) {
+        return ERR_ARG;
+    }
+
+    /* One semaphore serves all queries of this task, whichever gets delivered first wakes it */
+    wakeup = xSemaphoreCreateBinaryStatic(&wakeup_buf);
+    for (int i = 0; i < count; i++) {
+        pending[i].wakeup = wakeup;
+    }
+
+    /* The server may have closed an idle connection under us; retry once on a fresh one */
+    for (int attempt = 0; ; attempt++) {
+        bool reused = false;
+        err_t err = conn_exchange(server, queries, pending, count, start, timeout, pdMS_TO_TICKS(grace_ms), &reused);
+        bool conn_lost = err == ERR_CONN;
+
+        for (int i = 0; i < count; i++) {
+            queries[i].err = err != ERR_OK ? err : pending[i].status;
+            queries[i].response_len = pending[i].response_len;
+            answered |= queries[i].err == ERR_OK;
+            conn_lost |= queries[i].err == ERR_CONN;
+        }
+        if (answered || !conn_lost || !reused || attempt > 0) {
+            break;
+        }
+        ESP_LOGD(TAG, "Retrying query on a new connection");
+    }
+
+    vSemaphoreDelete(wakeup);
+
+    return answered ? ERR_OK : queries[0].err;
+}
+
+void esp_dns_conn_resolve(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count)
+{
+    esp_dns_conn_query_t queries[ESP_DNS_MAX_RRTYPES] = { 0 };
+
+    for (int i = 0; i < count; i++) {
+        results[i].err = ERR_OK;
+        memset(results[i].addr, 0, sizeof(results[i].addr));
+    }
+
+    /* Query and response buffers live on the heap, this runs on application and worker stacks */
+    char (*buffer)[ESP_DNS_BUFFER_SIZE] = calloc(count, ESP_DNS_BUFFER_SIZE);
+    if (buffer == NULL) {
+        for (int i = 0; i < count; i++) {
+            results[i].err = ERR_MEM;
+        }
+        return;
+    }
+
+    /* Create DNS queries in wire format, leaving 2 bytes at start for length prefix as required by RFC 7858 */
+    for (int i = 0; i < count; i++) {
+        size_t query_size = esp_dns_create_query((uint8_t *)(buffer[i] + 2), ESP_DNS_BUFFER_SIZE - 2,
+                                                 name, results[i].rrtype, &queries[i].id);
+        if (query_size == -1) {
+            ESP_LOGE(TAG, "Error: Hostname too big");
+            for (int j = 0; j < count; j++) {
+                results[j].err = ERR_MEM;
+            }
+            free(buffer);
+            return;
+        }
+
+        /* Prepends the 2-byte length field to DNS messages as required by RFC 7858 */
+        buffer[i][0] = (query_size >> 8) & 0xFF;
+        buffer[i][1] = query_size & 0xFF;
+
+        /* The response (without length prefix) is received into the same buffer */
+        queries[i].query = buffer[i];
+        queries[i].query_len = query_size + 2;
+        queries[i].response = buffer[i];
+        queries[i].response_size = ESP_DNS_BUFFER_SIZE;
+    }
+
+    esp_dns_conn_query(server, queries, count, ESP_DNS_RESOLUTION_DELAY_MS);
+
+    for (int i = 0; i < count; i++) {
+        dns_response_t dns_response = { 0 };
+
+        if (queries[i].err != ERR_OK) {
+            ESP_LOGE(TAG, "Failed to receive DNS response (type %d)", results[i].rrtype);
+            results[i].err = queries[i].err;
+            continue;
+        }
+
+        if (queries[i].response_len < sizeof(dns_header_t)) {
+            ESP_LOGE(TAG, "DNS response too small");
+            results[i].err = ERR_ABRT;
+            continue;
+        }
+
+        /* Parse the DNS response */
+        dns_response.id = queries[i].id;
+        esp_dns_parse_response((uint8_t *)buffer[i], queries[i].response_len, &dns_response);
+        esp_dns_cache_store(server->handle, name, results[i].rrtype, &dns_response);
+
+        /* Extract IP addresses from DNS response */
+        results[i].err = esp_dns_extract_ip_addresses_from_response(&dns_response, results[i].addr);
+        if (results[i].err != ERR_OK) {
+            ESP_LOGE(TAG, "Failed to extract IP address from DNS response");
+        }
+    }
+
+    free(buffer);
+}
+
+void esp_dns_conn_init(esp_dns_server_t *server, esp_dns_transport_create_t create_transport, int max_conns)
+{
+    server->create_transport = create_transport;
+    server->max_conns = create_transport ? max_conns : 0;
+
+    for (int i = 0; i < server->max_conns; i++) {
+        memset(&server->conns[i], 0, sizeof(esp_dns_conn_t));
+        server->conns[i].io_lock = xSemaphoreCreateMutexStatic(&server->conns[i].io_lock_buf);
+    }
+}
+
+void esp_dns_conn_deinit(esp_dns_server_t *server)
+{
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    for (int i = 0; i < server->max_conns; i++) {
+        conn_close(&server->conns[i]);
+        vSemaphoreDelete(server->conns[i].io_lock);
+        server->conns[i].io_lock = NULL;
+    }
+    server->max_conns = 0;
+    server->create_transport = NULL;
+
+    if (server->doh_client) {
+        esp_http_client_cleanup(server->doh_client);
+        server->doh_client = NULL;
+    }
+    xSemaphoreGive(server->lock);
+}
+
+void esp_dns_conn_close_idle(esp_dns_server_t *server, TickType_t now)
+{
+    TickType_t idle_timeout = server->handle->idle_timeout;
+
+    for (int i = 0; i < server->max_conns; i++) {
+        esp_dns_conn_t *conn = &server->conns[i];
+        if (conn->transport != NULL && conn->in_flight == 0 &&
+                now - conn->last_used >= idle_timeout) {
+            ESP_LOGD(TAG, "Closing idle connection %d to %s", i, server->config.dns_server);
+            conn_close(conn);
+        }
+    }
+
+    if (server->doh_client != NULL && now - server->doh_last_used >= idle_timeout) {
+        ESP_LOGD(TAG, "Closing idle DoH connection to %s", server->config.dns_server);
+        esp_http_client_cleanup(server->doh_client);
+        server->doh_client = NULL;
+    }
+}
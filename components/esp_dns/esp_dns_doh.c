@@ -99,7 +99,7 @@ esp_err_t esp_dns_http_event_handler(esp_http_client_event_t *evt)
 {
     char *temp_buff = NULL;
     size_t temp_buff_len = 0;
-    esp_dns_handle_t handle = (esp_dns_handle_t)evt->user_data;
+    esp_dns_server_t *server = (esp_dns_server_t *)evt->user_data;
 
     switch (evt->event_id) {
     case HTTP_EVENT_ERROR:
@@ -117,32 +117,32 @@ esp_err_t esp_dns_http_event_handler(esp_http_client_event_t *evt)
     case HTTP_EVENT_ON_DATA:
         ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
         /* Check if buffer is null, if yes, initialize it */
-        if (handle->response_buffer.buffer == NULL) {
+        if (server->response_buffer.buffer == NULL) {
             if (evt->data_len == 0) {
                 ESP_LOGW(TAG, "Received empty HTTP data");
                 return ESP_ERR_INVALID_ARG;
             }
             temp_buff = malloc(evt->data_len);
             if (temp_buff) {
-                handle->response_buffer.buffer = temp_buff;
-                handle->response_buffer.length = evt->data_len;
-                memcpy(handle->response_buffer.buffer, evt->data, evt->data_len);
+                server->response_buffer.buffer = temp_buff;
+                server->response_buffer.length = evt->data_len;
+                memcpy(server->response_buffer.buffer, evt->data, evt->data_len);
             } else {
                 ESP_LOGE(TAG, "Buffer allocation error");
                 return ESP_ERR_NO_MEM;
             }
         } else {
             /* Reallocate buffer to hold the new data chunk */
-            int new_len = handle->response_buffer.length + evt->data_len;
+            int new_len = server->response_buffer.length + evt->data_len;
             if (new_len == 0) {
                 ESP_LOGW(TAG, "New data length is zero after receiving HTTP data");
                 return ESP_ERR_INVALID_ARG;
             }
-            temp_buff = realloc(handle->response_buffer.buffer, new_len);
+            temp_buff = realloc(server->response_buffer.buffer, new_len);
             if (temp_buff) {
-                handle->response_buffer.buffer = temp_buff;
-                memcpy(handle->response_buffer.buffer + handle->response_buffer.length, evt->data, evt->data_len);
-                handle->response_buffer.length = new_len;
+                server->response_buffer.buffer = temp_buff;
+                memcpy(server->response_buffer.buffer + server->response_buffer.length, evt->data, evt->data_len);
+                server->response_buffer.length = new_len;
             } else {
                 ESP_LOGE(TAG, "Buffer allocation error");
                 return ESP_ERR_NO_MEM;
@@ -152,29 +152,29 @@ esp_err_t esp_dns_http_event_handler(esp_http_client_event_t *evt)
     case HTTP_EVENT_ON_FINISH:
         ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
         /* Entire response received, process it here */
-        ESP_LOGD(TAG, "Received full response, length: %d", handle->response_buffer.length);
+        ESP_LOGD(TAG, "Received full response, length: %d", server->response_buffer.length);
 
         /* Check if the buffer indicates an HTTP error response */
         if (HttpStatus_Ok == esp_http_client_get_status_code(evt->client)) {
-            if (handle->response_buffer.length >= sizeof(dns_header_t)) {
+            if (server->response_buffer.length >= sizeof(dns_header_t)) {
                 /* Parse the DNS response */
-                esp_dns_parse_response((uint8_t *)handle->response_buffer.buffer,
-                                       handle->response_buffer.length,
-                                       &handle->response_buffer.dns_response);
+                esp_dns_parse_response((uint8_t *)server->response_buffer.buffer,
+                                       server->response_buffer.length,
+                                       &server->response_buffer.dns_response);
             } else {
                 ESP_LOGE(TAG, "DNS response too small");
-                handle->response_buffer.dns_response.status_code = ERR_VAL;
+                server->response_buffer.dns_response.status_code = ERR_ABRT;
             }
         } else {
             ESP_LOGE(TAG, "HTTP Error: %d", esp_http_client_get_status_code(evt->client));
-            temp_buff_len = handle->response_buffer.length > ESP_DNS_BUFFER_SIZE ? ESP_DNS_BUFFER_SIZE : handle->response_buffer.length;
-            ESP_LOG_BUFFER_HEXDUMP(TAG, handle->response_buffer.buffer, temp_buff_len, ESP_LOG_ERROR);
-            handle->response_buffer.dns_response.status_code = ERR_VAL;    /* TBD: Not handled properly yet */
+            temp_buff_len = server->response_buffer.length > ESP_DNS_BUFFER_SIZE ? ESP_DNS_BUFFER_SIZE : server->response_buffer.length;
+            ESP_LOG_BUFFER_HEXDUMP(TAG, server->response_buffer.buffer, temp_buff_len, ESP_LOG_ERROR);
+            server->response_buffer.dns_response.status_code = ERR_ABRT;
         }
 
-        free(handle->response_buffer.buffer);
-        handle->response_buffer.buffer = NULL;
-        handle->response_buffer.length = 0;
+        free(server->response_buffer.buffer);
+        server->response_buffer.buffer = NULL;
+        server->response_buffer.length = 0;
         break;
     case HTTP_EVENT_DISCONNECTED:
         ESP_LOGD(TAG, "HTTP_EVENT_DISCONNECTED");
@@ -190,47 +190,39 @@ esp_err_t esp_dns_http_event_handler(esp_http_client_event_t *evt)
 }
 
 /**
- * @brief Resolves a hostname using DNS over HTTPS
+ * @brief Creates the persistent HTTP client used for DoH requests
  *
- * This function generates a DNS request, sends it via HTTPS, and processes
- * the response to extract IP addresses.
+ * The client is kept in the server state so that the HTTPS connection to the server
+ * stays open (HTTP keep-alive) across lookups until it has been idle for
+ * the configured time.
  *
- * @param handle Pointer to the DNS handle
- * @param name The hostname to resolve
- * @param addr Pointer to store the resolved IP addresses
- * @param rrtype The address RR type (A or AAAA)
+ * @param server Upstream server
  *
- * @return ERR_OK on success, or an error code on failure
+ * @return HTTP client handle on success, NULL on failure
  */
-err_t dns_resolve_doh(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype)
+static esp_http_client_handle_t doh_create_client(esp_dns_server_t *server)
 {
-    uint8_t buffer_qry[ESP_DNS_BUFFER_SIZE];
-
-    /* Initialize error status */
-    err_t err = ERR_OK;
     const char *prefix = "https://";
 
     /* Set default values for DoH configuration if not specified */
-    const char *url_path = handle->config.protocol_config.doh_config.url_path ?
-                           handle->config.protocol_config.doh_config.url_path : "dns-query";
-    int port = handle->config.port ?
-               handle->config.port : ESP_DNS_DEFAULT_DOH_PORT;
+    const char *url_path = server->config.url_path ?
+                           server->config.url_path : "dns-query";
 
     /* Calculate required URL length: https:// + server + / + path + null terminator */
     size_t url_len = strlen(prefix) + \
-                     strlen(handle->config.dns_server) + 1 + \
+                     strlen(server->config.dns_server) + 1 + \
                      strlen(url_path) + 1;  /* 1 for '/' and 1 for '\0' */
 
     /* Allocate memory for the full server URL */
     char *dns_server_url = malloc(url_len);
     if (dns_server_url == NULL) {
         ESP_LOGE(TAG, "Memory allocation failed");
-        return ERR_MEM;
+        return NULL;
     }
 
     /* Construct the complete server URL by combining prefix, server and path */
     snprintf(dns_server_url, url_len, "%s%s/%s", prefix,
-             handle->config.dns_server,
+             server->config.dns_server,
              url_path);
 
     /* Configure the HTTP client with base settings */
@@ -238,80 +230,137 @@ err_t dns_resolve_doh(const esp_dns_handle_t handle, const char *name, ip_addr_t
         .url = dns_server_url,
         .event_handler = esp_dns_http_event_handler,
         .method = HTTP_METHOD_POST,
-        .user_data = handle,
-        .port = port,
+        .user_data = server,
+        .port = server->port,
     };
 
     /* Configure TLS certificate settings - either using bundle or PEM cert */
-    if (handle->config.tls_config.crt_bundle_attach) {
-        config.crt_bundle_attach = handle->config.tls_config.crt_bundle_attach;
+    if (server->config.tls_config.crt_bundle_attach) {
+        config.crt_bundle_attach = server->config.tls_config.crt_bundle_attach;
     } else {
-        config.cert_pem = handle->config.tls_config.cert_pem;  /* Use the root certificate for dns.google if needed */
+        config.cert_pem = server->config.tls_config.cert_pem;  /* Use the root certificate for dns.google if needed */
     }
 
-    /* Clear the response buffer to ensure no residual data remains */
-    memset(&handle->response_buffer, 0, sizeof(response_buffer_t));
-
-    /* Create DNS query in wire format */
-    size_t query_size = esp_dns_create_query(buffer_qry, sizeof(buffer_qry), name, rrtype, &handle->response_buffer.dns_response.id);
-    if (query_size == -1) {
-        ESP_LOGE(TAG, "Error: Hostname too big");
-        err = ERR_MEM;
-        goto cleanup;
-    }
-
-    /* Initialize HTTP client with the configuration */
+    /* Initialize HTTP client with the configuration (the URL is copied by the client) */
     esp_http_client_handle_t client = esp_http_client_init(&config);
+    free(dns_server_url);
     if (client == NULL) {
         ESP_LOGE(TAG, "Error initializing HTTP client");
-        err = ERR_VAL;
-        goto cleanup;
+        return NULL;
     }
 
     /* Set Content-Type header for DNS-over-HTTPS */
     esp_err_t ret = esp_http_client_set_header(client, "Content-Type", "application/dns-message");
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error setting HTTP header: %s", esp_err_to_name(ret));
-        err = ERR_VAL;
-        goto client_cleanup;
+        esp_http_client_cleanup(client);
+        return NULL;
+    }
+
+    return client;
+}
+
+/**
+ * @brief Resolves one record type of a hostname using DNS over HTTPS
+ *
+ * This function generates a DNS request, sends it via HTTPS on the persistent
+ * client of the server, and processes the response to extract IP addresses.
+ *
+ * @param server Upstream server
+ * @param name The hostname to resolve
+ * @param addr Pointer to store the resolved IP addresses
+ * @param rrtype The address RR type (A or AAAA)
+ *
+ * @return ERR_OK on success, or an error code on failure
+ */
+static err_t doh_query(esp_dns_server_t *server, const char *name, ip_addr_t *addr, u8_t rrtype)
+{
+    uint8_t buffer_qry[ESP_DNS_BUFFER_SIZE];
+
+    /* Initialize error status */
+    err_t err = ERR_OK;
+
+    /* The client and the response buffer are shared, serialize requests */
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+
+    if (server->doh_client == NULL) {
+        server->doh_client = doh_create_client(server);
+        if (server->doh_client == NULL) {
+            err = ERR_CONN;
+            goto cleanup;
+        }
+    }
+
+    /* Clear the response buffer to ensure no residual data remains */
+    memset(&server->response_buffer, 0, sizeof(response_buffer_t));
+
+    /* Create DNS query in wire format */
+    size_t query_size = esp_dns_create_query(buffer_qry, sizeof(buffer_qry), name, rrtype, &server->response_buffer.dns_response.id);
+    if (query_size == -1) {
+        ESP_LOGE(TAG, "Error: Hostname too big");
+        err = ERR_MEM;
+        goto cleanup;
     }
 
     /* Set the DNS query as POST data */
-    ret = esp_http_client_set_post_field(client, (const char *)buffer_qry, query_size);
+    esp_err_t ret = esp_http_client_set_post_field(server->doh_client, (const char *)buffer_qry, query_size);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error setting POST field: %s", esp_err_to_name(ret));
-        err = ERR_VAL;
-        goto client_cleanup;
+        err = ERR_ARG;
+        goto cleanup;
     }
 
-    /* Execute the HTTP request */
-    ret = esp_http_client_perform(client);
+    /* Execute the HTTP request, reusing the open connection if the server kept it alive */
+    ret = esp_http_client_perform(server->doh_client);
     if (ret == ESP_OK) {
         ESP_LOGD(TAG, "HTTP POST Status = %d, content_length = %lld",
-                 esp_http_client_get_status_code(client),
-                 esp_http_client_get_content_length(client));
-
-        /* Verify HTTP status code and DNS response status */
-        if ((HttpStatus_Ok != esp_http_client_get_status_code(client)) ||
-                (handle->response_buffer.dns_response.status_code != ERR_OK)) {
-            err = ERR_ARG;
-            goto client_cleanup;
+                 esp_http_client_get_status_code(server->doh_client),
+                 esp_http_client_get_content_length(server->doh_client));
+
+        if (HttpStatus_Ok == esp_http_client_get_status_code(server->doh_client)) {
+            esp_dns_cache_store(server->handle, name, rrtype, &server->response_buffer.dns_response);
         }
 
-        /* Extract IP addresses from DNS response */
-        err = esp_dns_extract_ip_addresses_from_response(&handle->response_buffer.dns_response, addr);
+        /* Any other HTTP status carries no DNS answer */
+        if (HttpStatus_Ok != esp_http_client_get_status_code(server->doh_client)) {
+            err = ERR_ABRT;
+            goto cleanup;
+        }
+
+        /* Extract IP addresses from DNS response, or the status of a negative or unusable one */
+        err = esp_dns_extract_ip_addresses_from_response(&server->response_buffer.dns_response, addr);
     } else {
         ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(ret));
-        err = ERR_VAL;
-    }
+        err = ERR_CONN;
 
-    /* Clean up HTTP client */
-client_cleanup:
-    esp_http_client_cleanup(client);
+        /* Drop the client, the next lookup starts over with a fresh connection */
+        esp_http_client_cleanup(server->doh_client);
+        server->doh_client = NULL;
+    }
 
-    /* Free allocated memory */
 cleanup:
-    free(dns_server_url);
+    server->doh_last_used = xTaskGetTickCount();
+    xSemaphoreGive(server->lock);
 
     return err;
 }
+
+/**
+ * @brief Resolves a hostname using DNS over HTTPS
+ *
+ * Unlike TCP and DoT, the record types are not requested concurrently: they go one
+ * after another over the keep-alive connection, since the HTTP/1.1 client carries a
+ * single request at a time and a second client would cost another TLS session.
+ * A dual-stack lookup over DoH therefore takes two round trips.
+ *
+ * @param server Upstream server
+ * @param name The hostname to resolve
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types
+ */
+void dns_resolve_doh(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count)
+{
+    for (int i = 0; i < count; i++) {
+        results[i].err = doh_query(server, name, results[i].addr, results[i].rrtype);
+    }
+}
@@ -12,6 +12,41 @@
 #define TAG "ESP_DNS_DOT"
 
 
+/**
+ * @brief Creates the TLS transport for a pooled connection
+ *
+ * Configures the server certificate verification using either the certificate
+ * bundle or the PEM certificate from the configuration.
+ *
+ * @param server Upstream server
+ *
+ * @return Transport handle on success, NULL on failure
+ */
+esp_transport_handle_t esp_dns_dot_create_transport(const esp_dns_server_t *server)
+{
+    esp_transport_handle_t transport = esp_transport_ssl_init();
+    if (!transport) {
+        ESP_LOGE(TAG, "Failed to initialize transport");
+        return NULL;
+    }
+
+    /* Configure TLS certificate settings - either using bundle or PEM cert */
+    if (server->config.tls_config.crt_bundle_attach) {
+        esp_transport_ssl_crt_bundle_attach(transport, server->config.tls_config.crt_bundle_attach);
+    } else {
+        if (server->config.tls_config.cert_pem == NULL) {
+            ESP_LOGE(TAG, "Certificate PEM data is null");
+            esp_transport_destroy(transport);
+            return NULL;
+        }
+        esp_transport_ssl_set_cert_data(transport,
+                                        server->config.tls_config.cert_pem,
+                                        strlen(server->config.tls_config.cert_pem));
+    }
+
+    return transport;
+}
+
 /**
  * @brief Initializes the DNS over TLS (DoT) module
  *
@@ -86,127 +121,16 @@ int esp_dns_cleanup_dot(esp_dns_handle_t handle)
 /**
  * @brief Resolves a hostname using DNS over TLS (DoT)
  *
- * Performs DNS resolution over a TLS-encrypted connection. Creates a DNS query,
- * establishes a TLS connection, sends the query, and processes the response.
+ * Performs DNS resolution over a TLS-encrypted connection. Sends the queries for all
+ * record types back to back over a pooled TLS connection (established on first use
+ * and kept open to avoid a handshake per lookup), and processes the responses.
  *
- * @param handle Pointer to the DNS handle
+ * @param server Upstream server
  * @param name Hostname to resolve
- * @param addr Pointer to store the resolved IP address
- * @param rrtype DNS record type to query
- *
- * @return ERR_OK on success, or an error code on failure
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types
  */
-err_t dns_resolve_dot(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype)
+void dns_resolve_dot(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count)
 {
-    int err = ERR_OK;
-    esp_transport_handle_t transport = NULL;
-    int len = 0;
-    char dot_buffer[ESP_DNS_BUFFER_SIZE];
-    size_t query_size;
-    int timeout_ms;
-    int dot_port;
-
-    if (addr == NULL) {
-        return ERR_ARG;
-    }
-
-    /* Set timeout and port values, using defaults if not specified in config */
-    timeout_ms = handle->config.timeout_ms ? : ESP_DNS_DEFAULT_TIMEOUT_MS;
-    dot_port = handle->config.port ? : ESP_DNS_DEFAULT_DOT_PORT;
-
-    /* Clear the response buffer to ensure no residual data remains */
-    memset(&handle->response_buffer, 0, sizeof(response_buffer_t));
-
-    /* Create DNS query in wire format, leaving 2 bytes at start for length prefix as required by RFC 7858 */
-    memset(dot_buffer, 0, ESP_DNS_BUFFER_SIZE);
-    query_size = esp_dns_create_query((uint8_t *)(dot_buffer + 2), sizeof(dot_buffer) - 2,
-                                      name, rrtype, &handle->response_buffer.dns_response.id);
-    if (query_size == -1) {
-        ESP_LOGE(TAG, "Error: Hostname too big");
-        return ERR_MEM;
-    }
-
-    /* Prepends the 2-byte length field to DNS messages as required by RFC 7858 */
-    dot_buffer[0] = (query_size >> 8) & 0xFF;
-    dot_buffer[1] = query_size & 0xFF;
-
-    transport = esp_transport_ssl_init();
-    if (!transport) {
-        ESP_LOGE(TAG, "Failed to initialize transport");
-        return ERR_MEM;
-    }
-
-    /* Configure TLS certificate settings - either using bundle or PEM cert */
-    if (handle->config.tls_config.crt_bundle_attach) {
-        esp_transport_ssl_crt_bundle_attach(transport, handle->config.tls_config.crt_bundle_attach);
-    } else {
-        if (handle->config.tls_config.cert_pem == NULL) {
-            ESP_LOGE(TAG, "Certificate PEM data is null");
-            err = ERR_VAL;
-            goto cleanup;
-        }
-        esp_transport_ssl_set_cert_data(transport,
-                                        handle->config.tls_config.cert_pem,
-                                        strlen(handle->config.tls_config.cert_pem));
-    }
-
-    if (esp_transport_connect(transport, handle->config.dns_server, dot_port, timeout_ms) < 0) {
-        ESP_LOGE(TAG, "TLS connection failed");
-        err = ERR_CONN;
-        goto cleanup;
-    }
-
-    /* Send DNS query */
-    len = esp_transport_write(transport,
-                              dot_buffer,
-                              query_size + 2,
-                              timeout_ms);
-    if (len < 0) {
-        ESP_LOGE(TAG, "Failed to send DNS query");
-        err = ERR_ABRT;
-        goto cleanup;
-    }
-
-    /* Read response */
-    memset(dot_buffer, 0, ESP_DNS_BUFFER_SIZE);
-    len = esp_transport_read(transport,
-                             dot_buffer,
-                             sizeof(dot_buffer),
-                             timeout_ms);
-    if (len >= 2 + sizeof(dns_header_t)) {
-        size_t expected_len = ((uint8_t)dot_buffer[0] << 8) | (uint8_t)dot_buffer[1];
-        if (expected_len > len - 2) {
-            ESP_LOGE(TAG, "Incomplete DNS response");
-            err = ERR_ABRT;
-            goto cleanup;
-        }
-
-        /* Skip the 2-byte length field that prepends DNS messages as required by RFC 7858 */
-        handle->response_buffer.buffer = dot_buffer + 2;
-        handle->response_buffer.length = len - 2;
-
-        /* Parse the DNS response */
-        esp_dns_parse_response((uint8_t *)handle->response_buffer.buffer,
-                               handle->response_buffer.length,
-                               &handle->response_buffer.dns_response);
-
-        /* Extract IP addresses from DNS response */
-        err = esp_dns_extract_ip_addresses_from_response(&handle->response_buffer.dns_response, addr);
-        if (err != ERR_OK) {
-            ESP_LOGE(TAG, "Failed to extract IP address from DNS response");
-            goto cleanup;
-        }
-    } else {
-        ESP_LOGE(TAG, "Failed to receive response or response too small");
-        err = ERR_ABRT;
-        goto cleanup;
-    }
-
-cleanup:
-    if (transport) {
-        esp_transport_close(transport);
-        esp_transport_destroy(transport);
-    }
-
-    return err;
+    esp_dns_conn_resolve(server, name, results, count);
 }
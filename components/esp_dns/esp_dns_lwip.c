@@ -65,8 +65,8 @@ int lwip_hook_netconn_external_resolve(const char *name, ip_addr_t *addr, u8_t a
         return 0;
     }
 
-    /* Check if DNS server name matches or if it's localhost */
-    if ((strcmp(name, g_dns_handle->config.dns_server) == 0) ||
+    /* Check if the name of a DNS server matches or if it's localhost */
+    if (esp_dns_is_server_name(g_dns_handle, name) ||
 #if LWIP_HAVE_LOOPIF
             (strcmp(name, "localhost") == 0) ||
 #endif
@@ -74,11 +74,23 @@ int lwip_hook_netconn_external_resolve(const char *name, ip_addr_t *addr, u8_t a
         return 0;
     }
 
-    u8_t rrtype;
-    if ((addrtype == NETCONN_DNS_IPV4) || (addrtype == NETCONN_DNS_IPV4_IPV6)) {
-        rrtype = DNS_RRTYPE_A;
-    } else if ((addrtype == NETCONN_DNS_IPV6) || (addrtype == NETCONN_DNS_IPV6_IPV4)) {
-        rrtype = DNS_RRTYPE_AAAA;
+    /* Dual-stack lookups ask for both record types at once, preferred type first */
+    u8_t rrtypes[ESP_DNS_MAX_RRTYPES];
+    int count;
+    if (addrtype == NETCONN_DNS_IPV4) {
+        rrtypes[0] = DNS_RRTYPE_A;
+        count = 1;
+    } else if (addrtype == NETCONN_DNS_IPV6) {
+        rrtypes[0] = DNS_RRTYPE_AAAA;
+        count = 1;
+    } else if (addrtype == NETCONN_DNS_IPV4_IPV6) {
+        rrtypes[0] = DNS_RRTYPE_A;
+        rrtypes[1] = DNS_RRTYPE_AAAA;
+        count = 2;
+    } else if (addrtype == NETCONN_DNS_IPV6_IPV4) {
+        rrtypes[0] = DNS_RRTYPE_AAAA;
+        rrtypes[1] = DNS_RRTYPE_A;
+        count = 2;
     } else {
         ESP_LOGE(TAG, "Invalid address type");
         *err = ERR_VAL;
@@ -91,13 +103,10 @@ int lwip_hook_netconn_external_resolve(const char *name, ip_addr_t *addr, u8_t a
         /* Return zero as lwIP DNS can handle UDP DNS */
         return 0;
     case ESP_DNS_PROTOCOL_TCP:
-        *err = dns_resolve_tcp(g_dns_handle, name, addr, rrtype);
-        break;
     case ESP_DNS_PROTOCOL_DOT:
-        *err = dns_resolve_dot(g_dns_handle, name, addr, rrtype);
-        break;
     case ESP_DNS_PROTOCOL_DOH:
-        *err = dns_resolve_doh(g_dns_handle, name, addr, rrtype);
+        /* Cached answer, or the preferred of the configured servers */
+        *err = esp_dns_resolve(g_dns_handle, name, addr, rrtypes, count);
         break;
     default:
         ESP_LOGE(TAG, "Invalid transport type");
@@ -24,14 +24,146 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
+#include "freertos/queue.h"
 #include "lwip/prot/dns.h"
 #include "lwip/ip_addr.h"
 #include "lwip/err.h"
 #include "esp_log.h"
 
+#include "esp_transport.h"
+#include "esp_http_client.h"
+
 #include "esp_dns.h"
 #include "esp_dns_utils.h"
 
+/** Upper bound for esp_dns_config_t::conn_config.max_connections */
+#define ESP_DNS_MAX_CONNECTIONS 4
+
+/** Maximum number of queries pipelined on a single stream connection (RFC 7766, Section 6.2.1.1) */
+#define ESP_DNS_MAX_IN_FLIGHT 8
+
+/** Maximum number of record types resolved by one lookup (A and AAAA) */
+#define ESP_DNS_MAX_RRTYPES 2
+
+/**
+ * Time to wait for the remaining record type once the first one was answered
+ * (Resolution Delay, RFC 8305, Section 3)
+ */
+#define ESP_DNS_RESOLUTION_DELAY_MS 50
+
+/**
+ * @brief Result of resolving one record type
+ */
+typedef struct {
+    u8_t rrtype;                           /* Record type (A or AAAA) */
+    err_t err;                             /* ERR_OK if addr holds at least one address */
+    ip_addr_t addr[DNS_MAX_HOST_IP];       /* Resolved addresses */
+} esp_dns_result_t;
+
+/**
+ * @brief Query handed to the connection pool
+ */
+typedef struct {
+    char *query;                           /* Query in wire format including the 2-byte length prefix */
+    size_t query_len;                      /* Length of the query including the prefix */
+    uint16_t id;                           /* DNS ID, replaced (in the query too) if it collides with an in-flight query */
+    char *response;                        /* Buffer receiving the response without the length prefix */
+    size_t response_size;                  /* Size of the response buffer */
+    int response_len;                      /* Length of the received response */
+    err_t err;                             /* ERR_OK if the response arrived, else the reason it did not */
+} esp_dns_conn_query_t;
+
+/**
+ * @brief Query waiting for its response on a pooled stream connection
+ *
+ * One per query in a local array of esp_dns_conn_query(), linked into the connection
+ * while the query is in flight. Responses are matched by DNS ID and copied into the
+ * buffer of the esp_dns_conn_query_t, which esp_dns_conn_resolve() allocates on the
+ * heap, by whichever task currently reads the stream.
+ */
+typedef struct esp_dns_pending {
+    uint16_t id;                           /* DNS transaction ID of the outstanding query */
+    bool done;                             /* Response (or error) has been delivered */
+    err_t status;                          /* ERR_OK or the reason the query failed */
+    char *response;                        /* Buffer receiving the response (without length prefix) */
+    size_t response_size;                  /* Size of the response buffer */
+    int response_len;                      /* Length of the delivered response */
+    SemaphoreHandle_t wakeup;              /* Signalled on delivery or when the stream reader changes, shared by
+                                              the queries one task sends together */
+    struct esp_dns_pending *next;          /* Next pending query on the same connection */
+} esp_dns_pending_t;
+
+/**
+ * @brief Long-lived stream connection shared by TCP and DoT lookups
+ */
+typedef struct {
+    esp_transport_handle_t transport;      /* Transport, NULL when the slot is closed */
+    bool broken;                           /* Stream failed, close once the last query leaves */
+    bool reading;                          /* A task is currently reading responses from the stream */
+    int in_flight;                         /* Queries using this connection */
+    TickType_t last_used;                  /* Tick count of the last completed exchange */
+    esp_dns_pending_t *pending;            /* Queries waiting for a response */
+    char *frame;                           /* Receive buffer of the task reading the stream, allocated with the transport */
+    int io_waiters;                        /* Tasks waiting for io_lock to connect or write */
+    SemaphoreHandle_t io_lock;             /* Serializes connect, reads and writes on the stream, as a TLS
+                                              session must not be read and written concurrently */
+    StaticSemaphore_t io_lock_buf;         /* Storage for the I/O lock */
+} esp_dns_conn_t;
+
+/**
+ * @brief Cached answer for one (name, record type) pair
+ */
+typedef struct {
+    char name[DNS_MAX_NAME_LENGTH];        /* Queried hostname, empty if the entry is unused */
+    u8_t rrtype;                           /* Record type (A or AAAA) */
+    err_t status;                          /* ERR_OK for addresses, ERR_VAL for a negative answer */
+    ip_addr_t addrs[DNS_MAX_HOST_IP];      /* Resolved addresses (positive answers only) */
+    TickType_t expires;                    /* Tick count at which the entry becomes stale */
+} esp_dns_cache_entry_t;
+
+typedef struct esp_dns_server esp_dns_server_t;
+
+/**
+ * @brief Creates an unconnected transport for a pooled connection
+ */
+typedef esp_transport_handle_t (*esp_dns_transport_create_t)(const esp_dns_server_t *server);
+
+/**
+ * @brief Upstream DNS server with its connections and statistics
+ *
+ * Entry 0 is the primary server from the top level configuration, the others
+ * come from esp_dns_config_t::fallback_config.
+ */
+struct esp_dns_server {
+    esp_dns_handle_t handle;               /* Owning DNS handle */
+    esp_dns_server_config_t config;        /* Protocol, address and TLS settings */
+    int port;                              /* Server port (protocol default if not configured) */
+    SemaphoreHandle_t lock;                /* Protects the connection state of this server */
+
+    /* Stream connections (TCP, DoT) */
+    esp_dns_conn_t conns[ESP_DNS_MAX_CONNECTIONS]; /* Pooled connections */
+    int max_conns;                         /* Number of usable entries in conns */
+    esp_dns_transport_create_t create_transport; /* Transport factory, NULL if the pool is not used */
+
+    /* DoH */
+    esp_http_client_handle_t doh_client;   /* Persistent DoH client (keep-alive) */
+    TickType_t doh_last_used;              /* Tick count of the last DoH exchange */
+    response_buffer_t response_buffer;     /* Buffer for storing DNS response data during processing */
+
+    /* Fallback resolution */
+    TaskHandle_t worker;                   /* Task running queries for concurrent lookups, NULL with a single server */
+    QueueHandle_t jobs;                    /* Lookups queued for the worker */
+    SemaphoreHandle_t worker_done;         /* Given by the worker when it exits */
+
+    /* Set by the idle timer, the connections are checked by the worker or by the next lookup */
+    volatile bool idle_check;
+
+    /* Statistics, protected by the handle lock */
+    esp_dns_server_stats_t stats;          /* RTT, query and failure counters */
+    uint32_t consecutive_failures;         /* Failures since the last answer */
+};
+
 /**
  * @brief Opaque handle type for DNS module instances
  */
@@ -42,7 +174,17 @@ struct esp_dns_handle {
     /* Connection state */
     bool initialized;                      /* Flag indicating successful initialization */
 
-    response_buffer_t response_buffer;     /* Buffer for storing DNS response data during processing */
+    /* Upstream servers */
+    esp_dns_server_t servers[ESP_DNS_MAX_SERVERS]; /* Primary server followed by the fallback servers */
+    int num_servers;                       /* Number of configured servers */
+    TickType_t idle_timeout;               /* Idle time after which connections are closed */
+    TimerHandle_t idle_timer;              /* Periodic timer requesting idle connection checks */
+
+    /* Answer cache */
+    esp_dns_cache_entry_t *cache;          /* Cache entries, NULL if caching is disabled */
+    int cache_size;                        /* Number of cache entries */
+    esp_dns_cache_stats_t cache_stats;     /* Hit and miss counters */
+    SemaphoreHandle_t cache_lock;          /* Protects the cache, independent of transport activity */
 
     /* Thread safety */
     SemaphoreHandle_t lock;                /* Mutex for synchronization */
@@ -68,49 +210,210 @@ esp_dns_handle_t esp_dns_init(const esp_dns_config_t *config);
 int esp_dns_cleanup(esp_dns_handle_t handle);
 
 /**
- * @brief Resolve hostname using DNS over HTTPS
+ * @brief Set up the upstream servers from the configuration
+ *
+ * Creates the connection pools, the idle connection timer and, if more than one
+ * server is configured, a worker task per server.
+ *
+ * @param handle DNS module handle
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_dns_servers_init(esp_dns_handle_t handle);
+
+/**
+ * @brief Stop the worker tasks and close all connections
+ *
+ * @param handle DNS module handle
+ */
+void esp_dns_servers_deinit(esp_dns_handle_t handle);
+
+/**
+ * @brief Resolve a hostname using the cache and the configured servers
+ *
+ * With several servers, they are asked in order of preference (fastest healthy
+ * server first), either all at once or staggered, and the first answer is used.
+ * With several record types, all of them are queried at once; the addresses are
+ * merged alternating between the types, starting with the first one (RFC 8305,
+ * Section 4).
  *
  * @param handle DNS module handle
  * @param name Hostname to resolve
- * @param addr Pointer to store resolved IP address
- * @param rrtype Record type (A or AAAA)
+ * @param addr Array of DNS_MAX_HOST_IP entries receiving the addresses
+ * @param rrtypes Record types (A or AAAA) in order of preference
+ * @param count Number of record types, at most ESP_DNS_MAX_RRTYPES
  *
- * @return err_t Error code
+ * @return err_t ERR_OK if any address was found, else the error of the preferred record type
  */
-err_t dns_resolve_doh(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype);
+err_t esp_dns_resolve(esp_dns_handle_t handle, const char *name, ip_addr_t *addr, const u8_t *rrtypes, int count);
 
 /**
- * @brief Resolve hostname using DNS over TLS
+ * @brief Check whether a name is the hostname of one of the configured servers
+ *
+ * Such names must be resolved by lwIP to avoid recursing into esp_dns.
  *
  * @param handle DNS module handle
+ * @param name Hostname to check
+ *
+ * @return true if name belongs to a configured server
+ */
+bool esp_dns_is_server_name(esp_dns_handle_t handle, const char *name);
+
+/**
+ * @brief Set up the connection pool of a server
+ *
+ * @param server Upstream server
+ * @param create_transport Factory for the protocol specific transport, NULL for DoH
+ * @param max_conns Maximum number of concurrent connections
+ */
+void esp_dns_conn_init(esp_dns_server_t *server, esp_dns_transport_create_t create_transport, int max_conns);
+
+/**
+ * @brief Close all connections of a server and release the pool resources
+ *
+ * @param server Upstream server
+ */
+void esp_dns_conn_deinit(esp_dns_server_t *server);
+
+/**
+ * @brief Close connections of a server that have been unused for the idle timeout
+ *
+ * Must be called with the server lock held.
+ *
+ * @param server Upstream server
+ * @param now Current tick count
+ */
+void esp_dns_conn_close_idle(esp_dns_server_t *server, TickType_t now);
+
+/**
+ * @brief Send length-prefixed queries over a pooled connection and wait for their responses
+ *
+ * Several tasks may call this concurrently; their queries are pipelined on the same
+ * stream and responses are matched by DNS ID (RFC 7766). The queries of one call
+ * share a connection. Once the first of them is answered, the others get at most
+ * grace_ms more to arrive.
+ *
+ * @param server Upstream server
+ * @param queries Queries to send; their id, response_len and err are updated
+ * @param count Number of queries, at most ESP_DNS_MAX_RRTYPES
+ * @param grace_ms Time to wait for the remaining responses after the first one
+ *
+ * @return err_t ERR_OK if at least one response arrived, else the error of the first query
+ */
+err_t esp_dns_conn_query(esp_dns_server_t *server, esp_dns_conn_query_t *queries, int count, uint32_t grace_ms);
+
+/**
+ * @brief Resolve record types of a hostname over a pooled stream connection (TCP, DoT)
+ *
+ * All record types are queried at once on the same connection.
+ *
+ * @param server Upstream server
  * @param name Hostname to resolve
- * @param addr Pointer to store resolved IP address
- * @param rrtype Record type (A or AAAA)
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types, at most ESP_DNS_MAX_RRTYPES
+ */
+void esp_dns_conn_resolve(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count);
+
+/**
+ * @brief Creates the TCP transport for a pooled connection
  *
- * @return err_t Error code
+ * @param server Upstream server
+ *
+ * @return Transport handle on success, NULL on failure
  */
-err_t dns_resolve_dot(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype);
+esp_transport_handle_t esp_dns_tcp_create_transport(const esp_dns_server_t *server);
 
 /**
- * @brief Resolve hostname using TCP DNS
+ * @brief Creates the TLS transport for a pooled DoT connection
+ *
+ * @param server Upstream server
+ *
+ * @return Transport handle on success, NULL on failure
+ */
+esp_transport_handle_t esp_dns_dot_create_transport(const esp_dns_server_t *server);
+
+/**
+ * @brief Allocate the answer cache according to the configuration
+ *
+ * @param handle DNS module handle
+ *
+ * @return ESP_OK on success (also if caching is disabled), ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_dns_cache_init(esp_dns_handle_t handle);
+
+/**
+ * @brief Release the answer cache
+ *
+ * @param handle DNS module handle
+ */
+void esp_dns_cache_deinit(esp_dns_handle_t handle);
+
+/**
+ * @brief Look up a fresh cached answer
+ *
+ * Counts a hit or a miss in the cache statistics.
  *
  * @param handle DNS module handle
  * @param name Hostname to resolve
- * @param addr Pointer to store resolved IP address
  * @param rrtype Record type (A or AAAA)
+ * @param addr Array of DNS_MAX_HOST_IP entries receiving the cached addresses
+ * @param err Pointer to store the cached result (ERR_OK or the error of a negative answer)
  *
- * @return err_t Error code
+ * @return true if the answer was served from the cache
  */
-err_t dns_resolve_tcp(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype);
+bool esp_dns_cache_lookup(esp_dns_handle_t handle, const char *name, u8_t rrtype, ip_addr_t *addr, err_t *err);
 
 /**
- * @brief Resolve hostname using UDP DNS
+ * @brief Store a parsed response in the cache
+ *
+ * Positive answers are kept for the smallest TTL of their address records,
+ * NXDOMAIN/NODATA answers for the negative TTL from their SOA record.
  *
  * @param handle DNS module handle
+ * @param name Queried hostname
+ * @param rrtype Record type (A or AAAA)
+ * @param response Parsed DNS response
+ */
+void esp_dns_cache_store(esp_dns_handle_t handle, const char *name, u8_t rrtype, const dns_response_t *response);
+
+/**
+ * @brief Resolve hostname using DNS over HTTPS
+ *
+ * @param server Upstream server
+ * @param name Hostname to resolve
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types, at most ESP_DNS_MAX_RRTYPES
+ */
+void dns_resolve_doh(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count);
+
+/**
+ * @brief Resolve hostname using DNS over TLS
+ *
+ * @param server Upstream server
+ * @param name Hostname to resolve
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types, at most ESP_DNS_MAX_RRTYPES
+ */
+void dns_resolve_dot(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count);
+
+/**
+ * @brief Resolve hostname using TCP DNS
+ *
+ * @param server Upstream server
+ * @param name Hostname to resolve
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types, at most ESP_DNS_MAX_RRTYPES
+ */
+void dns_resolve_tcp(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count);
+
+/**
+ * @brief Resolve hostname using UDP DNS
+ *
+ * @param server Upstream server
  * @param name Hostname to resolve
  * @param addr Pointer to store resolved IP address
  * @param rrtype Record type (A or AAAA)
  *
  * @return err_t Error code
  */
-err_t dns_resolve_udp(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype);
+err_t dns_resolve_udp(esp_dns_server_t *server, const char *name, ip_addr_t *addr, u8_t rrtype);
@@ -0,0 +1,662 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file esp_dns_server.c
+ * @brief Upstream server selection and failover
+ *
+ * Holds the list of upstream servers (the primary one and optional fallbacks,
+ * possibly on different protocols), tracks their round trip time and failures,
+ * and resolves a name on the preferred server. With more than one server, every
+ * server gets a worker task; the resolving task hands the lookup to the workers
+ * either all at once (race) or one after another on a staggered timer, and returns
+ * as soon as one of them gets an answer. Dual-stack lookups ask for both record
+ * types at once and merge the answers in the requested order of preference.
+ */
+
+#include <strings.h>
+#include "esp_dns_priv.h"
+#include "esp_dns.h"
+
+#define TAG "ESP_DNS_SERVER"
+
+/** Stack size of a worker task; DoT and DoH run TLS on it */
+#define ESP_DNS_WORKER_STACK_SIZE (8 * 1024)
+
+/** Priority of the worker tasks */
+#define ESP_DNS_WORKER_PRIORITY 5
+
+/** Lookups that can be queued for one worker */
+#define ESP_DNS_WORKER_QUEUE_LEN 4
+
+/** Queued to a worker by the idle timer instead of a lookup, see idle_timer_cb() */
+static char s_idle_job;
+#define ESP_DNS_IDLE_JOB ((esp_dns_race_t *)&s_idle_job)
+
+/**
+ * @brief Lookup shared between the resolving task and the workers it was handed to
+ *
+ * Reference counted, since workers may still be busy with it after the resolving
+ * task returned. All fields are protected by the handle lock.
+ */
+typedef struct {
+    char name[DNS_MAX_NAME_LENGTH];        /* Hostname to resolve */
+    esp_dns_result_t results[ESP_DNS_MAX_RRTYPES]; /* Record types with the addresses from the first answer */
+    int count;                             /* Number of record types */
+    err_t err;                             /* Result of the first answer, or the last failure */
+    bool done;                             /* A server answered */
+    int outstanding;                       /* Workers still working on the lookup */
+    int refs;                              /* Resolving task plus outstanding workers */
+    SemaphoreHandle_t event;               /* Given whenever a worker finishes */
+} esp_dns_race_t;
+
+/**
+ * @brief Returns true if the server answered, even if the answer holds no address
+ *
+ * Only addresses (ERR_OK) and negative answers such as NXDOMAIN (ERR_VAL) count.
+ * Connection failures, timeouts, HTTP errors and unusable responses mean another
+ * server should be asked.
+ */
+static bool server_answered(err_t err)
+{
+    return err == ERR_OK || err == ERR_VAL;
+}
+
+/**
+ * @brief Combines the results of the record types of one lookup
+ *
+ * @return ERR_OK if any type has addresses, else the first answer from the server,
+ *         else the failure of the preferred type
+ */
+static err_t results_status(const esp_dns_result_t *results, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (results[i].err == ERR_OK) {
+            return ERR_OK;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (server_answered(results[i].err)) {
+            return results[i].err;
+        }
+    }
+    return results[0].err;
+}
+
+/**
+ * @brief Merges the addresses of all record types into one list
+ *
+ * Alternates between the types, starting with the preferred one, so that a caller
+ * trying the addresses in order switches address family early (RFC 8305, Section 4).
+ */
+static void results_merge(const esp_dns_result_t *results, int count, ip_addr_t *addr)
+{
+    int next[ESP_DNS_MAX_RRTYPES] = { 0 };
+    int merged = 0;
+    bool added = true;
+
+    memset(addr, 0, DNS_MAX_HOST_IP * sizeof(ip_addr_t));
+    while (added && merged < DNS_MAX_HOST_IP) {
+        added = false;
+        for (int i = 0; i < count && merged < DNS_MAX_HOST_IP; i++) {
+            if (results[i].err != ERR_OK || next[i] == DNS_MAX_HOST_IP ||
+                    ip_addr_isany_val(results[i].addr[next[i]])) {
+                continue;
+            }
+            addr[merged++] = results[i].addr[next[i]++];
+            added = true;
+        }
+    }
+}
+
+/**
+ * @brief Resolves a name on one server and updates its statistics
+ *
+ * @return Combined result of all record types
+ */
+static err_t server_resolve(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count)
+{
+    esp_dns_handle_t handle = server->handle;
+    TickType_t start = xTaskGetTickCount();
+    err_t err;
+
+    switch (server->config.protocol) {
+    case ESP_DNS_PROTOCOL_TCP:
+        dns_resolve_tcp(server, name, results, count);
+        break;
+    case ESP_DNS_PROTOCOL_DOT:
+        dns_resolve_dot(server, name, results, count);
+        break;
+    case ESP_DNS_PROTOCOL_DOH:
+        dns_resolve_doh(server, name, results, count);
+        break;
+    default:
+        ESP_LOGE(TAG, "Invalid transport type");
+        return ERR_VAL;
+    }
+    err = results_status(results, count);
+
+    uint32_t rtt = pdTICKS_TO_MS(xTaskGetTickCount() - start) ? : 1;
+
+    xSemaphoreTake(handle->lock, portMAX_DELAY);
+    server->stats.queries++;
+    if (server_answered(err)) {
+        /* Smoothed RTT with gain 1/8, as for TCP (RFC 6298) */
+        server->stats.rtt_ms = server->stats.rtt_ms ? (7 * server->stats.rtt_ms + rtt) / 8 : rtt;
+        server->consecutive_failures = 0;
+    } else {
+        server->stats.failures++;
+        server->consecutive_failures++;
+    }
+    xSemaphoreGive(handle->lock);
+
+    return err;
+}
+
+/**
+ * @brief Returns true if server a should be asked before server b
+ *
+ * Healthy servers come first, the fastest measured one leading; servers without
+ * a measurement keep their configured order behind them. Failing servers go last.
+ */
+static bool server_preferred(const esp_dns_server_t *a, const esp_dns_server_t *b)
+{
+    if ((a->consecutive_failures > 0) != (b->consecutive_failures > 0)) {
+        return a->consecutive_failures == 0;
+    }
+    if (a->consecutive_failures > 0) {
+        return a->consecutive_failures < b->consecutive_failures;
+    }
+    if ((a->stats.rtt_ms > 0) != (b->stats.rtt_ms > 0)) {
+        return a->stats.rtt_ms > 0;
+    }
+    return a->stats.rtt_ms < b->stats.rtt_ms;
+}
+
+/**
+ * @brief Sorts the server indexes by preference
+ *
+ * Must be called with the handle lock held.
+ */
+static void server_order(esp_dns_handle_t handle, int order[])
+{
+    for (int i = 0; i < handle->num_servers; i++) {
+        order[i] = i;
+    }
+
+    /* Insertion sort keeps the configured order among equals */
+    for (int i = 1; i < handle->num_servers; i++) {
+        int index = order[i];
+        int j = i - 1;
+        while (j >= 0 && server_preferred(&handle->servers[index], &handle->servers[order[j]])) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = index;
+    }
+}
+
+/**
+ * @brief Closes the idle connections of a server if the idle timer asked for it
+ *
+ * Closing a TLS session or the DoH client blocks, so this runs on the worker or
+ * on the resolving task rather than on the timer task.
+ */
+static void server_close_idle(esp_dns_server_t *server)
+{
+    if (!server->idle_check) {
+        return;
+    }
+    server->idle_check = false;
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    esp_dns_conn_close_idle(server, xTaskGetTickCount());
+    xSemaphoreGive(server->lock);
+}
+
+/**
+ * @brief Drops a reference to a lookup, freeing it with the last one
+ *
+ * Must be called with the handle lock held.
+ *
+ * @return true if the lookup was freed
+ */
+static bool race_unref(esp_dns_race_t *race)
+{
+    if (--race->refs > 0) {
+        return false;
+    }
+    vSemaphoreDelete(race->event);
+    free(race);
+    return true;
+}
+
+/**
+ * @brief Worker task running lookups on one server
+ */
+static void server_worker(void *arg)
+{
+    esp_dns_server_t *server = (esp_dns_server_t *)arg;
+    esp_dns_handle_t handle = server->handle;
+    esp_dns_race_t *race;
+
+    while (xQueueReceive(server->jobs, &race, portMAX_DELAY) == pdTRUE) {
+        if (race == NULL) {
+            break;
+        }
+        if (race == ESP_DNS_IDLE_JOB) {
+            server_close_idle(server);
+            continue;
+        }
+
+        esp_dns_result_t results[ESP_DNS_MAX_RRTYPES];
+        err_t err = ERR_ABRT;
+
+        /* Skip lookups another server already answered while this one was queued */
+        xSemaphoreTake(handle->lock, portMAX_DELAY);
+        bool done = race->done;
+        int count = race->count;
+        memcpy(results, race->results, sizeof(results));
+        xSemaphoreGive(handle->lock);
+        if (!done) {
+            err = server_resolve(server, race->name, results, count);
+        }
+
+        xSemaphoreTake(handle->lock, portMAX_DELAY);
+        race->outstanding--;
+        if (!race->done && !done) {
+            race->err = err;
+            if (server_answered(err)) {
+                race->done = true;
+                memcpy(race->results, results, sizeof(race->results));
+            }
+        }
+        xSemaphoreGive(race->event);
+        race_unref(race);
+        xSemaphoreGive(handle->lock);
+    }
+
+    xSemaphoreGive(server->worker_done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Resolves a name using all configured servers
+ */
+static err_t resolve_fallback(esp_dns_handle_t handle, const char *name, esp_dns_result_t *results, int count)
+{
+    int order[ESP_DNS_MAX_SERVERS];
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(handle->config.timeout_ms ? : ESP_DNS_DEFAULT_TIMEOUT_MS);
+    TickType_t stagger = handle->config.fallback_config.race ? 0 :
+                         pdMS_TO_TICKS(handle->config.fallback_config.stagger_ms ? : ESP_DNS_DEFAULT_STAGGER_MS);
+    TickType_t last_start = start;
+    int next = 0;
+    err_t err;
+
+    esp_dns_race_t *race = calloc(1, sizeof(esp_dns_race_t));
+    if (race == NULL) {
+        return ERR_MEM;
+    }
+    race->event = xSemaphoreCreateBinary();
+    if (race->event == NULL) {
+        free(race);
+        return ERR_MEM;
+    }
+    strlcpy(race->name, name, sizeof(race->name));
+    memcpy(race->results, results, count * sizeof(esp_dns_result_t));
+    race->count = count;
+    race->err = ERR_TIMEOUT;
+    race->refs = 1;
+
+    xSemaphoreTake(handle->lock, portMAX_DELAY);
+    server_order(handle, order);
+
+    while (!race->done) {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t elapsed = now - start;
+        if (elapsed >= timeout) {
+            break;
+        }
+
+        /* Ask the next server right away if nothing is outstanding, else once the stagger delay passed */
+        if (next < handle->num_servers && (race->outstanding == 0 || now - last_start >= stagger)) {
+            esp_dns_server_t *server = &handle->servers[order[next++]];
+            race->outstanding++;
+            race->refs++;
+            if (xQueueSend(server->jobs, &race, 0) != pdTRUE) {
+                ESP_LOGW(TAG, "Server %s busy, skipping", server->config.dns_server);
+                race->outstanding--;
+                race->refs--;
+            } else {
+                ESP_LOGD(TAG, "Asking %s for %s", server->config.dns_server, name);
+                last_start = now;
+            }
+            continue;
+        }
+
+        if (race->outstanding == 0) {
+            /* Every server failed */
+            break;
+        }
+
+        TickType_t wait = timeout - elapsed;
+        if (next < handle->num_servers && stagger - (now - last_start) < wait) {
+            wait = stagger - (now - last_start);
+        }
+        xSemaphoreGive(handle->lock);
+        xSemaphoreTake(race->event, wait);
+        xSemaphoreTake(handle->lock, portMAX_DELAY);
+    }
+
+    err = race->err;
+    if (race->done) {
+        memcpy(results, race->results, count * sizeof(esp_dns_result_t));
+    } else {
+        for (int i = 0; i < count; i++) {
+            results[i].err = err;
+        }
+    }
+    race_unref(race);
+    xSemaphoreGive(handle->lock);
+
+    return err;
+}
+
+err_t esp_dns_resolve(esp_dns_handle_t handle, const char *name, ip_addr_t *addr, const u8_t *rrtypes, int count)
+{
+    esp_dns_result_t results[ESP_DNS_MAX_RRTYPES] = { 0 };
+    esp_dns_result_t lookups[ESP_DNS_MAX_RRTYPES] = { 0 };
+    int index[ESP_DNS_MAX_RRTYPES];
+    int num_lookups = 0;
+
+    if (addr == NULL || rrtypes == NULL || count < 1 || count > ESP_DNS_MAX_RRTYPES) {
+        return ERR_ARG;
+    }
+
+    /* Servers without a worker get their idle connections closed here */
+    for (int i = 0; i < handle->num_servers; i++) {
+        if (handle->servers[i].worker == NULL) {
+            server_close_idle(&handle->servers[i]);
+        }
+    }
+
+    /* Serve repeated lookups from the answer cache, only ask for the missing types */
+    for (int i = 0; i < count; i++) {
+        results[i].rrtype = rrtypes[i];
+        if (!esp_dns_cache_lookup(handle, name, rrtypes[i], results[i].addr, &results[i].err)) {
+            index[num_lookups] = i;
+            lookups[num_lookups].rrtype = rrtypes[i];
+            lookups[num_lookups].err = ERR_TIMEOUT;
+            num_lookups++;
+        }
+    }
+
+    if (num_lookups > 0) {
+        if (handle->num_servers == 1) {
+            server_resolve(&handle->servers[0], name, lookups, num_lookups);
+        } else {
+            resolve_fallback(handle, name, lookups, num_lookups);
+        }
+        for (int i = 0; i < num_lookups; i++) {
+            results[index[i]] = lookups[i];
+        }
+    }
+
+    results_merge(results, count, addr);
+    return results_status(results, count);
+}
+
+/**
+ * @brief Periodically requests closing connections that have been idle for too long
+ *
+ * Runs on the timer task, which must not block and has little stack, so it only
+ * flags the servers. Their workers close the connections right away, a server
+ * without a worker is checked by the next lookup.
+ */
+static void idle_timer_cb(TimerHandle_t timer)
+{
+    esp_dns_handle_t handle = (esp_dns_handle_t)pvTimerGetTimerID(timer);
+
+    for (int i = 0; i < handle->num_servers; i++) {
+        esp_dns_server_t *server = &handle->servers[i];
+
+        /* A check still pending keeps its queued job, do not queue another */
+        if (server->idle_check) {
+            continue;
+        }
+        server->idle_check = true;
+        if (server->worker) {
+            esp_dns_race_t *job = ESP_DNS_IDLE_JOB;
+            if (xQueueSend(server->jobs, &job, 0) != pdTRUE) {
+                /* Worker busy with lookups, try again next period */
+                server->idle_check = false;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs on the timer task once the idle timer is deleted, see esp_dns_servers_deinit()
+ */
+static void idle_timer_stopped(void *arg, uint32_t unused)
+{
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+/**
+ * @brief Sets up one upstream server
+ */
+static esp_err_t server_init(esp_dns_handle_t handle, esp_dns_server_t *server, const esp_dns_server_config_t *config)
+{
+    int max_conns = handle->config.conn_config.max_connections ? : ESP_DNS_DEFAULT_MAX_CONNECTIONS;
+    esp_dns_transport_create_t create_transport = NULL;
+
+    if (max_conns > ESP_DNS_MAX_CONNECTIONS) {
+        ESP_LOGW(TAG, "Limiting connections to %d", ESP_DNS_MAX_CONNECTIONS);
+        max_conns = ESP_DNS_MAX_CONNECTIONS;
+    }
+
+    memset(server, 0, sizeof(esp_dns_server_t));
+    server->handle = handle;
+    server->config = *config;
+
+    switch (config->protocol) {
+    case ESP_DNS_PROTOCOL_UDP:
+        server->port = config->port ? : DNS_SERVER_PORT;
+        break;
+    case ESP_DNS_PROTOCOL_TCP:
+        server->port = config->port ? : ESP_DNS_DEFAULT_TCP_PORT;
+        create_transport = esp_dns_tcp_create_transport;
+        break;
+    case ESP_DNS_PROTOCOL_DOT:
+        server->port = config->port ? : ESP_DNS_DEFAULT_DOT_PORT;
+        create_transport = esp_dns_dot_create_transport;
+        break;
+    case ESP_DNS_PROTOCOL_DOH:
+        server->port = config->port ? : ESP_DNS_DEFAULT_DOH_PORT;
+        break;
+    default:
+        ESP_LOGE(TAG, "Invalid protocol %d", config->protocol);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    server->lock = xSemaphoreCreateMutex();
+    if (server->lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_dns_conn_init(server, create_transport, max_conns);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Starts the worker task of a server
+ */
+static esp_err_t server_start_worker(esp_dns_server_t *server)
+{
+    server->jobs = xQueueCreate(ESP_DNS_WORKER_QUEUE_LEN, sizeof(esp_dns_race_t *));
+    server->worker_done = xSemaphoreCreateBinary();
+    if (server->jobs == NULL || server->worker_done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(server_worker, "dns_worker", ESP_DNS_WORKER_STACK_SIZE, server,
+                    ESP_DNS_WORKER_PRIORITY, &server->worker) != pdPASS) {
+        server->worker = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Stops the worker task of a server and releases the server resources
+ */
+static void server_deinit(esp_dns_server_t *server)
+{
+    if (server->worker) {
+        esp_dns_race_t *stop = NULL;
+        xQueueSend(server->jobs, &stop, portMAX_DELAY);
+        xSemaphoreTake(server->worker_done, portMAX_DELAY);
+        server->worker = NULL;
+    }
+    if (server->jobs) {
+        vQueueDelete(server->jobs);
+        server->jobs = NULL;
+    }
+    if (server->worker_done) {
+        vSemaphoreDelete(server->worker_done);
+        server->worker_done = NULL;
+    }
+    if (server->lock) {
+        esp_dns_conn_deinit(server);
+        vSemaphoreDelete(server->lock);
+        server->lock = NULL;
+    }
+}
+
+esp_err_t esp_dns_servers_init(esp_dns_handle_t handle)
+{
+    const esp_dns_config_t *config = &handle->config;
+    esp_dns_server_config_t primary = {
+        .protocol = config->protocol,
+        .dns_server = config->dns_server,
+        .port = config->port,
+        .tls_config = {
+            .cert_pem = config->tls_config.cert_pem,
+            .crt_bundle_attach = config->tls_config.crt_bundle_attach,
+        },
+        .url_path = config->protocol_config.doh_config.url_path,
+    };
+    esp_err_t ret;
+
+    handle->num_servers = 0;
+    handle->idle_timeout = pdMS_TO_TICKS(config->conn_config.idle_timeout_ms ? : ESP_DNS_DEFAULT_IDLE_TIMEOUT_MS);
+
+    ret = server_init(handle, &handle->servers[handle->num_servers++], &primary);
+    if (ret != ESP_OK) {
+        goto err;
+    }
+
+    /* UDP is resolved by lwIP, which has its own list of servers */
+    if (config->protocol == ESP_DNS_PROTOCOL_UDP) {
+        if (config->fallback_config.num_servers > 0) {
+            ESP_LOGW(TAG, "Fallback servers are ignored with UDP, configure them in lwIP");
+        }
+        return ESP_OK;
+    }
+
+    for (int i = 0; i < config->fallback_config.num_servers; i++) {
+        const esp_dns_server_config_t *fallback = &config->fallback_config.servers[i];
+        if (handle->num_servers == ESP_DNS_MAX_SERVERS) {
+            ESP_LOGW(TAG, "Limiting servers to %d", ESP_DNS_MAX_SERVERS);
+            break;
+        }
+        if (fallback->protocol == ESP_DNS_PROTOCOL_UDP) {
+            ESP_LOGE(TAG, "UDP is not supported for fallback server %s", fallback->dns_server);
+            ret = ESP_ERR_INVALID_ARG;
+            goto err;
+        }
+        ret = server_init(handle, &handle->servers[handle->num_servers++], fallback);
+        if (ret != ESP_OK) {
+            goto err;
+        }
+    }
+
+    /* Each server gets a worker so lookups can run on several servers at once */
+    if (handle->num_servers > 1) {
+        for (int i = 0; i < handle->num_servers; i++) {
+            ret = server_start_worker(&handle->servers[i]);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to start DNS worker");
+                goto err;
+            }
+        }
+    }
+
+    /* Check twice per idle period so a connection lives at most 1.5x the idle time */
+    TickType_t period = handle->idle_timeout / 2 ? : 1;
+    handle->idle_timer = xTimerCreate("dns_idle", period, pdTRUE, handle, idle_timer_cb);
+    if (handle->idle_timer == NULL || xTimerStart(handle->idle_timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start idle timer");
+        ret = ESP_ERR_NO_MEM;
+        goto err;
+    }
+
+    return ESP_OK;
+
+err:
+    esp_dns_servers_deinit(handle);
+    return ret;
+}
+
+void esp_dns_servers_deinit(esp_dns_handle_t handle)
+{
+    if (handle->idle_timer) {
+        StaticSemaphore_t stopped_buf;
+        SemaphoreHandle_t stopped = xSemaphoreCreateBinaryStatic(&stopped_buf);
+
+        /* Deleting only queues a command to the timer task, which may be running the callback
+         * right now. A function pended after it runs once the callback is done for good,
+         * only then can the worker queues go. */
+        xTimerDelete(handle->idle_timer, portMAX_DELAY);
+        if (xTimerPendFunctionCall(idle_timer_stopped, stopped, 0, portMAX_DELAY) == pdPASS) {
+            xSemaphoreTake(stopped, portMAX_DELAY);
+        }
+        vSemaphoreDelete(stopped);
+        handle->idle_timer = NULL;
+    }
+
+    for (int i = 0; i < handle->num_servers; i++) {
+        server_deinit(&handle->servers[i]);
+    }
+    handle->num_servers = 0;
+}
+
+bool esp_dns_is_server_name(esp_dns_handle_t handle, const char *name)
+{
+    for (int i = 0; i < handle->num_servers; i++) {
+        if (handle->servers[i].config.dns_server != NULL &&
+                strcasecmp(name, handle->servers[i].config.dns_server) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t esp_dns_get_server_stats(esp_dns_handle_t handle, int index, esp_dns_server_stats_t *stats)
+{
+    if (handle == NULL || stats == NULL || index < 0 || index >= handle->num_servers) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(handle->lock, portMAX_DELAY);
+    *stats = handle->servers[index].stats;
+    xSemaphoreGive(handle->lock);
+
+    return ESP_OK;
+}
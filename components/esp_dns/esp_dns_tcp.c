@@ -10,6 +10,22 @@
 
 #define TAG "ESP_DNS_TCP"
 
+/**
+ * @brief Creates the TCP transport for a pooled connection
+ *
+ * @param server Upstream server
+ *
+ * @return Transport handle on success, NULL on failure
+ */
+esp_transport_handle_t esp_dns_tcp_create_transport(const esp_dns_server_t *server)
+{
+    esp_transport_handle_t transport = esp_transport_tcp_init();
+    if (!transport) {
+        ESP_LOGE(TAG, "Failed to initialize transport");
+    }
+    return transport;
+}
+
 /**
  * @brief Initializes the TCP DNS module
  *
@@ -83,113 +99,16 @@ int esp_dns_cleanup_tcp(esp_dns_handle_t handle)
 /**
  * @brief Resolves a hostname using TCP DNS
  *
- * Performs DNS resolution over TCP for the given hostname. Creates a TCP connection,
- * sends the DNS query, and processes the response.
+ * Performs DNS resolution over TCP for the given hostname. Sends the queries for all
+ * record types back to back over a pooled TCP connection, opening it if needed, and
+ * processes the responses.
  *
- * @param handle DNS handle
+ * @param server Upstream server
  * @param name Hostname to resolve
- * @param addr Pointer to store the resolved IP address
- * @param rrtype DNS record type
- *
- * @return ERR_OK on success, error code on failure
+ * @param results Record types to resolve, receiving the addresses and per type result
+ * @param count Number of record types
  */
-err_t dns_resolve_tcp(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype)
+void dns_resolve_tcp(esp_dns_server_t *server, const char *name, esp_dns_result_t *results, int count)
 {
-    int err = ERR_OK;
-    esp_transport_handle_t transport = NULL;
-    int len = 0;
-    char tcp_buffer[ESP_DNS_BUFFER_SIZE];
-    size_t query_size;
-    int timeout_ms;
-    int tcp_port;
-
-    if (addr == NULL) {
-        return ERR_ARG;
-    }
-
-    /* Set timeout and port values, using defaults if not specified in config */
-    timeout_ms = handle->config.timeout_ms ? : ESP_DNS_DEFAULT_TIMEOUT_MS;
-    tcp_port = handle->config.port ? : ESP_DNS_DEFAULT_TCP_PORT;
-
-    /* Clear the response buffer to ensure no residual data remains */
-    memset(&handle->response_buffer, 0, sizeof(response_buffer_t));
-
-    /* Create DNS query in wire format, leaving 2 bytes at start for length prefix as required by RFC 7858 */
-    memset(tcp_buffer, 0, ESP_DNS_BUFFER_SIZE);
-    query_size = esp_dns_create_query((uint8_t *)(tcp_buffer + 2), sizeof(tcp_buffer) - 2,
-                                      name, rrtype, &handle->response_buffer.dns_response.id);
-    if (query_size == -1) {
-        ESP_LOGE(TAG, "Error: Hostname too big");
-        return ERR_MEM;
-    }
-
-    /* Prepends the 2-byte length field to DNS messages as required by RFC 7858 */
-    tcp_buffer[0] = (query_size >> 8) & 0xFF;
-    tcp_buffer[1] = query_size & 0xFF;
-
-    transport = esp_transport_tcp_init();
-    if (!transport) {
-        ESP_LOGE(TAG, "Failed to initialize transport");
-        return ERR_MEM;
-    }
-
-    if (esp_transport_connect(transport, handle->config.dns_server, tcp_port, timeout_ms) < 0) {
-        ESP_LOGE(TAG, "TCP connection failed");
-        err = ERR_CONN;
-        goto cleanup;
-    }
-
-    /* Send DNS query */
-    len = esp_transport_write(transport,
-                              tcp_buffer,
-                              query_size + 2,
-                              timeout_ms);
-    if (len < 0) {
-        ESP_LOGE(TAG, "Failed to send DNS query");
-        err = ERR_ABRT;
-        goto cleanup;
-    }
-
-    /* Read response */
-    memset(tcp_buffer, 0, ESP_DNS_BUFFER_SIZE);
-    len = esp_transport_read(transport,
-                             tcp_buffer,
-                             sizeof(tcp_buffer),
-                             timeout_ms);
-    if (len >= 2 + sizeof(dns_header_t)) {
-        size_t expected_len = ((uint8_t)tcp_buffer[0] << 8) | (uint8_t)tcp_buffer[1];
-        if (expected_len > len - 2) {
-            ESP_LOGE(TAG, "Incomplete DNS response");
-            err = ERR_ABRT;
-            goto cleanup;
-        }
-
-        /* Skip the 2-byte length field that prepends DNS messages as required by RFC 7858 */
-        handle->response_buffer.buffer = tcp_buffer + 2;
-        handle->response_buffer.length = len - 2;
-
-        /* Parse the DNS response */
-        esp_dns_parse_response((uint8_t *)handle->response_buffer.buffer,
-                               handle->response_buffer.length,
-                               &handle->response_buffer.dns_response);
-
-        /* Extract IP addresses from DNS response */
-        err = esp_dns_extract_ip_addresses_from_response(&handle->response_buffer.dns_response, addr);
-        if (err != ERR_OK) {
-            ESP_LOGE(TAG, "Failed to extract IP address from DNS response");
-            goto cleanup;
-        }
-    } else {
-        ESP_LOGE(TAG, "Failed to receive response or response too small");
-        err = ERR_ABRT;
-        goto cleanup;
-    }
-
-cleanup:
-    if (transport) {
-        esp_transport_close(transport);
-        esp_transport_destroy(transport);
-    }
-
-    return err;
+    esp_dns_conn_resolve(server, name, results, count);
 }
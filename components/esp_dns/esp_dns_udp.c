@@ -92,14 +92,14 @@ int esp_dns_cleanup_udp(esp_dns_handle_t handle)
  *       for UDP DNS resolution. The implementation needs to be added.
  *       As of now the resolution is performed by lwip dns module.
  *
- * @param handle DNS handle
+ * @param server Upstream server
  * @param name Hostname to resolve
  * @param addr Pointer to store the resolved IP address
  * @param rrtype DNS record type
  *
  * @return ERR_OK on success, error code on failure
  */
-err_t dns_resolve_udp(const esp_dns_handle_t handle, const char *name, ip_addr_t *addr, u8_t rrtype)
+err_t dns_resolve_udp(esp_dns_server_t *server, const char *name, ip_addr_t *addr, u8_t rrtype)
 {
     // TBD: Implement UDP DNS resolution
     if (addr == NULL) {
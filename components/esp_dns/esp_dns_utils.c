@@ -64,10 +64,12 @@ size_t esp_dns_create_query(uint8_t *buffer, size_t buffer_size, const char *hos
     }
     *qname++ = 0;  /* Null-terminate the question name */
 
-    /* Set question fields */
-    dns_question_t *question = (dns_question_t *)qname;
-    question->qtype = htons(addrtype);
-    question->qclass = htons(DNS_RRCLASS_IN);
+    /* Set question fields, the name may have left qname at an odd offset */
+    dns_question_t question = {
+        .qtype = htons(addrtype),
+        .qclass = htons(DNS_RRCLASS_IN),
+    };
+    memcpy(qname, &question, sizeof(question));
 
     /* Return the total query size */
     return (qname + sizeof(dns_question_t)) - buffer;
@@ -130,6 +132,67 @@ static uint8_t *skip_dns_name(uint8_t *ptr, size_t remaining_bytes)
     return ptr + offset;
 }
 
+/**
+ * @brief Extracts the negative caching TTL from the authority section of a DNS reply
+ *
+ * RFC 2308, Section 5: the TTL of a negative answer is the minimum of the SOA record's
+ * own TTL and its MINIMUM field. Without an SOA record the answer must not be cached.
+ *
+ * @param ptr Pointer to the start of the authority section
+ * @param buffer_end Pointer past the end of the DNS message
+ * @param authority_count Number of records in the authority section
+ *
+ * @return uint32_t Negative TTL in seconds, or 0 if no usable SOA record was found
+ */
+static uint32_t parse_negative_ttl(uint8_t *ptr, uint8_t *buffer_end, int authority_count)
+{
+    for (int i = 0; i < authority_count; i++) {
+        if (ptr > buffer_end) {
+            return 0;
+        }
+        ptr = skip_dns_name(ptr, buffer_end - ptr);
+        if (ptr == NULL || ptr + SIZEOF_DNS_ANSWER_FIXED > buffer_end) {
+            return 0;
+        }
+
+        /* Records follow names of any length, copy the fixed part to get aligned fields */
+        dns_answer_t record;
+        memcpy(&record, ptr, SIZEOF_DNS_ANSWER_FIXED);
+        uint16_t type = ntohs(record.type);
+        uint32_t ttl = ntohl(record.ttl);
+        uint16_t data_len = ntohs(record.data_len);
+
+        ptr += SIZEOF_DNS_ANSWER_FIXED;
+        if (ptr + data_len > buffer_end) {
+            return 0;
+        }
+
+        if (type == DNS_RRTYPE_SOA) {
+            /* SOA RDATA: MNAME, RNAME, SERIAL, REFRESH, RETRY, EXPIRE, MINIMUM */
+            uint8_t *rdata_end = ptr + data_len;
+            uint8_t *field = skip_dns_name(ptr, data_len);
+            if (field == NULL) {
+                return 0;
+            }
+            field = skip_dns_name(field, rdata_end - field);
+            if (field == NULL || field + 5 * sizeof(uint32_t) > rdata_end) {
+                return 0;
+            }
+
+            uint32_t minimum;
+            memcpy(&minimum, field + 4 * sizeof(uint32_t), sizeof(minimum));
+            minimum = ntohl(minimum);
+
+            ttl = ttl < minimum ? ttl : minimum;
+            return ttl > DNS_MAX_TTL ? DNS_MAX_TTL : ttl;
+        }
+
+        ptr += data_len;
+    }
+
+    return 0;
+}
+
 /**
  * @brief Parses a DNS response message
  *
@@ -144,9 +207,10 @@ void esp_dns_parse_response(uint8_t *buffer, size_t response_size, dns_response_
     assert(buffer != NULL);
 
     dns_response->status_code = ERR_OK; /* Initialize DNS response code */
+    dns_response->negative_ttl = 0;
 
     if (response_size < sizeof(dns_header_t)) {
-        dns_response->status_code = ERR_VAL;
+        dns_response->status_code = ERR_ABRT;
         return;
     }
 
@@ -154,12 +218,13 @@ void esp_dns_parse_response(uint8_t *buffer, size_t response_size, dns_response_
 
     dns_header_t *header = (dns_header_t *)buffer;
 
-    /* Check if there are answers and Transaction id matches */
+    /* Check if Transaction id matches */
     int answer_count = ntohs(header->ancount);
-    if ((ntohs(header->id) != dns_response->id) || (answer_count == 0)) {
-        dns_response->status_code = ERR_VAL; /* DNS response code */
+    if (ntohs(header->id) != dns_response->id) {
+        dns_response->status_code = ERR_ABRT;
         return;
     }
+    dns_response->rcode = ntohs(header->flags) & 0x0F;
 
     /* Ensure only MAX_ANSWERS are processed */
     dns_response->num_answers = (answer_count < MAX_ANSWERS ? answer_count : MAX_ANSWERS);
@@ -169,52 +234,66 @@ void esp_dns_parse_response(uint8_t *buffer, size_t response_size, dns_response_
 
     /* Skip the question name */
     if (ptr > buffer_end) {
-        dns_response->status_code = ERR_VAL;
+        dns_response->status_code = ERR_ABRT;
         return;
     }
     ptr = skip_dns_name(ptr, buffer_end - ptr);
     if (ptr == NULL) {
-        dns_response->status_code = ERR_VAL;
+        dns_response->status_code = ERR_ABRT;
         return;
     }
 
     /* Skip the question type and class */
     if (ptr + sizeof(dns_question_t) > buffer_end) {
-        dns_response->status_code = ERR_VAL;
+        dns_response->status_code = ERR_ABRT;
         return;
     }
     ptr += sizeof(dns_question_t);
 
+    /* No answers: NXDOMAIN or NODATA is an answer, pick up the negative caching TTL if the server sent one.
+     * Any other response code (SERVFAIL, REFUSED, ...) means the server could not answer. */
+    if (answer_count == 0) {
+        if (dns_response->rcode == DNS_RCODE_NOERROR || dns_response->rcode == DNS_RCODE_NXDOMAIN) {
+            dns_response->negative_ttl = parse_negative_ttl(ptr, buffer_end, ntohs(header->nscount));
+            dns_response->status_code = ERR_VAL;
+        } else {
+            dns_response->status_code = ERR_ABRT;
+        }
+        return;
+    }
+
     /* Parse each answer record */
     for (int i = 0; i < dns_response->num_answers; i++) {
 
         /* Answer fields */
         if (ptr > buffer_end) {
-            dns_response->status_code = ERR_VAL;
+            dns_response->status_code = ERR_ABRT;
             return;
         }
         ptr = skip_dns_name(ptr, buffer_end - ptr);
         if (ptr == NULL) {
-            dns_response->status_code = ERR_VAL;
+            dns_response->status_code = ERR_ABRT;
             return;
         }
 
         if (ptr + SIZEOF_DNS_ANSWER_FIXED > buffer_end) {
-            dns_response->status_code = ERR_VAL;
+            dns_response->status_code = ERR_ABRT;
             return;
         }
 
-        dns_answer_t *answer = (dns_answer_t *)ptr;
-        uint16_t type = ntohs(answer->type);
-        uint16_t class = ntohs(answer->class);
-        uint32_t ttl = ntohl(answer->ttl);
-        uint16_t data_len = ntohs(answer->data_len);
+        /* Copy the fixed part, the record may start at any offset */
+        dns_answer_t answer;
+        memcpy(&answer, ptr, SIZEOF_DNS_ANSWER_FIXED);
+        uint16_t type = ntohs(answer.type);
+        uint16_t class = ntohs(answer.class);
+        uint32_t ttl = ntohl(answer.ttl);
+        uint16_t data_len = ntohs(answer.data_len);
 
         /* Skip fixed parts of answer (type, class, ttl, data_len) */
         ptr += SIZEOF_DNS_ANSWER_FIXED;
 
         if (ptr + data_len > buffer_end) {
-            dns_response->status_code = ERR_VAL;
+            dns_response->status_code = ERR_ABRT;
             return;
         }
 
@@ -226,6 +305,7 @@ void esp_dns_parse_response(uint8_t *buffer, size_t response_size, dns_response_
 
         /* Initialize status for this answer */
         dns_response->answers[i].status = ERR_OK;
+        dns_response->answers[i].ttl = ttl;
 
         /* Check the type of answer */
         if (type == DNS_RRTYPE_A && data_len == 4) {
@@ -63,6 +63,10 @@ typedef struct {
 /** Maximum TTL value for DNS resource records (one week) */
 #define DNS_MAX_TTL 604800
 
+/** Response codes (RFC 1035, Section 4.1.1) */
+#define DNS_RCODE_NOERROR  0
+#define DNS_RCODE_NXDOMAIN 3
+
 #ifndef CONFIG_LWIP_DNS_MAX_HOST_IP
 #define CONFIG_LWIP_DNS_MAX_HOST_IP 1
 #endif
@@ -78,14 +82,17 @@ typedef struct {
 typedef struct {
     err_t status;      /* Status of the answer */
     ip_addr_t ip;      /* IP address from the answer */
+    uint32_t ttl;      /* Time-to-live of the answer in seconds */
 } dns_answer_storage_t;
 
 /**
  * @brief Structure to store a complete DNS response
  */
 typedef struct {
-    err_t status_code;           /* Overall status of the DNS response */
+    err_t status_code;           /* ERR_OK, ERR_VAL for a negative answer, ERR_ABRT for an unusable response */
     uint16_t id;                 /* Transaction ID */
+    uint8_t rcode;               /* Response code from the header flags */
+    uint32_t negative_ttl;       /* Negative caching TTL from the SOA record of NXDOMAIN/NODATA answers (RFC 2308), 0 if absent */
     int num_answers;             /* Number of valid answers */
     dns_answer_storage_t answers[MAX_ANSWERS];  /* Array of answers */
 } dns_response_t;
@@ -5,6 +5,8 @@
  */
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "sdkconfig.h"
 #include "esp_err.h"
 
@@ -17,6 +19,12 @@ extern "C" {
 #define ESP_DNS_DEFAULT_DOH_PORT 443   /* Default HTTPS port for DNS over HTTPS */
 
 #define ESP_DNS_DEFAULT_TIMEOUT_MS 10000 /* Default timeout for DNS queries in milliseconds */
+#define ESP_DNS_DEFAULT_IDLE_TIMEOUT_MS 30000 /* Default time an unused TCP/DoT/DoH connection is kept open */
+#define ESP_DNS_DEFAULT_MAX_CONNECTIONS 1 /* Default number of concurrent TCP/DoT connections */
+#define ESP_DNS_DEFAULT_CACHE_ENTRIES 8 /* Default number of cached answers */
+#define ESP_DNS_DEFAULT_STAGGER_MS 1000 /* Default delay before asking the next server */
+
+#define ESP_DNS_MAX_SERVERS 4          /* Maximum number of upstream servers (primary and fallbacks) */
 
 typedef enum {
     ESP_DNS_PROTOCOL_UDP,           /* Traditional UDP DNS (Port 53) */
@@ -25,6 +33,20 @@ typedef enum {
     ESP_DNS_PROTOCOL_DOH,           /* DNS over HTTPS (Port 443) */
 } esp_dns_protocol_type_t;
 
+/**
+ * @brief Fallback DNS server configuration
+ */
+typedef struct {
+    esp_dns_protocol_type_t protocol;  /* DNS protocol type (TCP, DoT or DoH) */
+    const char *dns_server;            /* DNS server IP address or hostname */
+    uint16_t port;                     /* Custom port number (if not using default) */
+    struct {
+        const char *cert_pem;          /* SSL server certification in PEM format as string */
+        esp_err_t (*crt_bundle_attach)(void *conf); /* Function pointer to attach cert bundle */
+    } tls_config;                      /* Used for DoT and DoH */
+    const char *url_path;              /* URL path for DoH service (e.g., "/dns-query") */
+} esp_dns_server_config_t;
+
 /**
  * @brief DNS configuration structure
  */
@@ -43,6 +65,26 @@ typedef struct {
         esp_err_t (*crt_bundle_attach)(void *conf); /* Function pointer to attach cert bundle */
     } tls_config;                      /* Used for DoT, DoH, DoH3, DNSCrypt, DoQ */
 
+    /* Connection reuse options */
+    struct {
+        uint32_t idle_timeout_ms;      /* Close a connection after this long without queries (0 for default) */
+        uint8_t max_connections;       /* Maximum number of concurrent TCP/DoT connections (0 for default, max 4) */
+    } conn_config;                     /* Used for TCP, DoT and DoH */
+
+    /* Answer cache options */
+    struct {
+        bool disable;                  /* Send every query to the server */
+        uint8_t max_entries;           /* Number of (name, record type) answers kept (0 for default) */
+    } cache_config;                    /* Used for TCP, DoT and DoH */
+
+    /* Fallback servers */
+    struct {
+        const esp_dns_server_config_t *servers; /* Servers used besides the primary one */
+        uint8_t num_servers;           /* Number of entries in servers (up to ESP_DNS_MAX_SERVERS - 1) */
+        uint32_t stagger_ms;           /* Delay before the next server is asked while no answer arrived (0 for default) */
+        bool race;                     /* Ask all servers at once and use the first answer */
+    } fallback_config;                 /* Used for TCP, DoT and DoH */
+
     /* Protocol-specific options */
     union {
         /* DoH options */
@@ -54,6 +96,23 @@ typedef struct {
 
 typedef struct esp_dns_handle* esp_dns_handle_t;
 
+/**
+ * @brief Answer cache statistics
+ */
+typedef struct {
+    uint32_t hits;                     /* Lookups answered from the cache (positive or negative) */
+    uint32_t misses;                   /* Lookups sent to the DNS server */
+} esp_dns_cache_stats_t;
+
+/**
+ * @brief Per server statistics
+ */
+typedef struct {
+    uint32_t rtt_ms;                   /* Smoothed round trip time of answered queries (0 until measured) */
+    uint32_t queries;                  /* Queries sent to the server */
+    uint32_t failures;                 /* Queries that failed or timed out */
+} esp_dns_server_stats_t;
+
 /**
  * @brief Initialize DNS over HTTPS (DoH) module
  *
@@ -150,6 +209,36 @@ int esp_dns_cleanup_tcp(esp_dns_handle_t handle);
  */
 int esp_dns_cleanup_udp(esp_dns_handle_t handle);
 
+/**
+ * @brief Get answer cache statistics
+ *
+ * @param handle DNS handle
+ * @param stats Pointer to store the hit and miss counters
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if an argument is NULL
+ */
+esp_err_t esp_dns_get_cache_stats(esp_dns_handle_t handle, esp_dns_cache_stats_t *stats);
+
+/**
+ * @brief Drop all cached answers
+ *
+ * @param handle DNS handle
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if handle is NULL
+ */
+esp_err_t esp_dns_flush_cache(esp_dns_handle_t handle);
+
+/**
+ * @brief Get statistics of an upstream server
+ *
+ * @param handle DNS handle
+ * @param index Server index, 0 for the primary server, 1 and up for fallback_config.servers
+ * @param stats Pointer to store the statistics
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if an argument is NULL or index is out of range
+ */
+esp_err_t esp_dns_get_server_stats(esp_dns_handle_t handle, int index, esp_dns_server_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,372 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "dns_test_server.h"
+
+#define DNS_TEST_MAX_CLIENTS 8
+#define DNS_TEST_POLL_MS 5
+
+#define DNS_TEST_RRTYPE_A    1
+#define DNS_TEST_RRTYPE_SOA  6
+#define DNS_TEST_RRTYPE_AAAA 28
+#define DNS_TEST_RRCLASS_IN  1
+
+/** Compression pointer to the question name, which follows the 12 byte header */
+#define DNS_TEST_QNAME_PTR 0xC00C
+
+/** Largest answer and authority sections added to a question */
+#define DNS_TEST_MAX_RECORDS_LEN 96
+
+typedef struct {
+    int fd;                                 /* Socket, -1 if the slot is unused */
+    uint8_t buf[2 + DNS_TEST_MESSAGE_SIZE]; /* Length prefix and message being received */
+    size_t len;                             /* Bytes in buf */
+} dns_test_client_t;
+
+struct dns_test_server {
+    dns_test_script_t script;
+    int listen_fd;
+    uint16_t port;
+    pthread_t thread;
+    atomic_bool stop;                       /* Asks the thread to exit */
+    atomic_bool close_requested;            /* Asks the thread to close all connections, cleared once done */
+    atomic_int queries;
+    atomic_int connections;
+    atomic_int open;
+    dns_test_client_t clients[DNS_TEST_MAX_CLIENTS];
+};
+
+static uint8_t *put16(uint8_t *p, uint16_t value)
+{
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+    return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t value)
+{
+    p = put16(p, value >> 16);
+    return put16(p, value & 0xFFFF);
+}
+
+static uint8_t *put_name(uint8_t *p, const char *name)
+{
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        size_t len = dot ? dot - name : strlen(name);
+        *p++ = len;
+        memcpy(p, name, len);
+        p += len;
+        name += dot ? len + 1 : len;
+    }
+    *p++ = 0;
+    return p;
+}
+
+size_t dns_test_build_response(const uint8_t *query, size_t query_len, const dns_test_script_t *script,
+                               uint8_t *buffer, size_t size)
+{
+    /* Header, question name, type and class */
+    size_t pos = 12;
+    while (pos < query_len && query[pos] != 0) {
+        pos += query[pos] + 1;
+    }
+    pos += 1 + 4;
+    if (pos > query_len || pos + DNS_TEST_MAX_RECORDS_LEN > size) {
+        return 0;
+    }
+    uint16_t qtype = (query[pos - 4] << 8) | query[pos - 3];
+
+    bool address = script->rcode == DNS_TEST_RCODE_NOERROR && !script->nodata &&
+                   (qtype == DNS_TEST_RRTYPE_A || qtype == DNS_TEST_RRTYPE_AAAA);
+    bool soa = !address && script->soa_minimum > 0 &&
+               (script->rcode == DNS_TEST_RCODE_NOERROR || script->rcode == DNS_TEST_RCODE_NXDOMAIN);
+
+    /* Keep ID and question, turn the header into a response */
+    memcpy(buffer, query, pos);
+    uint8_t *p = put16(buffer + 2, 0x8180 | script->rcode); /* QR, RD, RA */
+    p = put16(p, 1);
+    p = put16(p, address ? 1 : 0);
+    p = put16(p, soa ? 1 : 0);
+    p = put16(p, 0);
+
+    p = buffer + pos;
+    if (address) {
+        p = put16(p, DNS_TEST_QNAME_PTR);
+        p = put16(p, qtype);
+        p = put16(p, DNS_TEST_RRCLASS_IN);
+        p = put32(p, script->ttl);
+        if (qtype == DNS_TEST_RRTYPE_A) {
+            const uint8_t addr[4] = { 192, 0, 2, script->host };
+            p = put16(p, sizeof(addr));
+            memcpy(p, addr, sizeof(addr));
+            p += sizeof(addr);
+        } else {
+            uint8_t addr[16] = { 0x20, 0x01, 0x0d, 0xb8 };
+            addr[15] = script->host;
+            p = put16(p, sizeof(addr));
+            memcpy(p, addr, sizeof(addr));
+            p += sizeof(addr);
+        }
+    }
+    if (soa) {
+        /* Authority record: MNAME, RNAME, SERIAL, REFRESH, RETRY, EXPIRE, MINIMUM */
+        p = put16(p, DNS_TEST_QNAME_PTR);
+        p = put16(p, DNS_TEST_RRTYPE_SOA);
+        p = put16(p, DNS_TEST_RRCLASS_IN);
+        p = put32(p, 3600);
+        uint8_t *rdata_len = p;
+        uint8_t *rdata = p + 2;
+        p = put_name(rdata, "ns.test");
+        p = put_name(p, "hostmaster.test");
+        p = put32(p, 1);
+        p = put32(p, 3600);
+        p = put32(p, 600);
+        p = put32(p, 86400);
+        p = put32(p, script->soa_minimum);
+        put16(rdata_len, p - rdata);
+    }
+
+    return p - buffer;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static void client_close(dns_test_server_t *server, dns_test_client_t *client)
+{
+    close(client->fd);
+    client->fd = -1;
+    client->len = 0;
+    server->open--;
+}
+
+static void client_accept(dns_test_server_t *server)
+{
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < DNS_TEST_MAX_CLIENTS; i++) {
+        if (server->clients[i].fd < 0) {
+            server->clients[i].fd = fd;
+            server->clients[i].len = 0;
+            server->connections++;
+            server->open++;
+            return;
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief Answers all complete queries a client sent, in order
+ *
+ * @return false if the connection has to be closed
+ */
+static bool client_serve(dns_test_server_t *server, dns_test_client_t *client)
+{
+    ssize_t ret = recv(client->fd, client->buf + client->len, sizeof(client->buf) - client->len, 0);
+    if (ret <= 0) {
+        return false;
+    }
+    client->len += ret;
+
+    while (client->len >= 2) {
+        size_t query_len = (client->buf[0] << 8) | client->buf[1];
+        if (query_len > DNS_TEST_MESSAGE_SIZE) {
+            return false;
+        }
+        if (client->len < 2 + query_len) {
+            break;
+        }
+
+        uint8_t response[2 + DNS_TEST_MESSAGE_SIZE];
+        size_t response_len = dns_test_build_response(client->buf + 2, query_len, &server->script,
+                                                      response + 2, sizeof(response) - 2);
+        server->queries++;
+        if (response_len == 0) {
+            return false;
+        }
+        if (server->script.delay_ms > 0) {
+            sleep_ms(server->script.delay_ms);
+        }
+        put16(response, response_len);
+        if (send(client->fd, response, response_len + 2, MSG_NOSIGNAL) != response_len + 2) {
+            return false;
+        }
+
+        client->len -= 2 + query_len;
+        memmove(client->buf, client->buf + 2 + query_len, client->len);
+    }
+
+    return true;
+}
+
+static void *server_thread(void *arg)
+{
+    dns_test_server_t *server = arg;
+
+    while (!server->stop) {
+        struct pollfd fds[1 + DNS_TEST_MAX_CLIENTS];
+        dns_test_client_t *polled[1 + DNS_TEST_MAX_CLIENTS];
+        int count = 0;
+
+        if (server->close_requested) {
+            for (int i = 0; i < DNS_TEST_MAX_CLIENTS; i++) {
+                if (server->clients[i].fd >= 0) {
+                    client_close(server, &server->clients[i]);
+                }
+            }
+            server->close_requested = false;
+        }
+
+        fds[count].fd = server->listen_fd;
+        fds[count].events = POLLIN;
+        polled[count++] = NULL;
+        for (int i = 0; i < DNS_TEST_MAX_CLIENTS; i++) {
+            if (server->clients[i].fd >= 0) {
+                fds[count].fd = server->clients[i].fd;
+                fds[count].events = POLLIN;
+                polled[count++] = &server->clients[i];
+            }
+        }
+
+        if (poll(fds, count, DNS_TEST_POLL_MS) <= 0) {
+            continue;
+        }
+        for (int i = 1; i < count; i++) {
+            if (fds[i].revents && !client_serve(server, polled[i])) {
+                client_close(server, polled[i]);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            client_accept(server);
+        }
+    }
+
+    for (int i = 0; i < DNS_TEST_MAX_CLIENTS; i++) {
+        if (server->clients[i].fd >= 0) {
+            client_close(server, &server->clients[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Binds a TCP socket to 127.0.0.1 on an ephemeral port
+ */
+static int bind_loopback(uint16_t *port)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            getsockname(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+dns_test_server_t *dns_test_server_start(const dns_test_script_t *script)
+{
+    dns_test_server_t *server = calloc(1, sizeof(dns_test_server_t));
+    if (server == NULL) {
+        return NULL;
+    }
+    server->script = *script;
+    for (int i = 0; i < DNS_TEST_MAX_CLIENTS; i++) {
+        server->clients[i].fd = -1;
+    }
+
+    server->listen_fd = bind_loopback(&server->port);
+    if (server->listen_fd < 0 || listen(server->listen_fd, DNS_TEST_MAX_CLIENTS) != 0) {
+        goto err;
+    }
+
+    /* The thread must not take the signals the FreeRTOS port uses to drive its tasks */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int ret = pthread_create(&server->thread, NULL, server_thread, server);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (ret != 0) {
+        goto err;
+    }
+    return server;
+
+err:
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    free(server);
+    return NULL;
+}
+
+void dns_test_server_stop(dns_test_server_t *server)
+{
+    server->stop = true;
+    pthread_join(server->thread, NULL);
+    close(server->listen_fd);
+    free(server);
+}
+
+uint16_t dns_test_server_port(const dns_test_server_t *server)
+{
+    return server->port;
+}
+
+int dns_test_server_queries(const dns_test_server_t *server)
+{
+    return server->queries;
+}
+
+int dns_test_server_connections(const dns_test_server_t *server)
+{
+    return server->connections;
+}
+
+int dns_test_server_open_connections(const dns_test_server_t *server)
+{
+    return server->open;
+}
+
+void dns_test_server_close_connections(dns_test_server_t *server)
+{
+    server->close_requested = true;
+    while (server->close_requested) {
+        sleep_ms(1);
+    }
+}
+
+uint16_t dns_test_closed_port(void)
+{
+    uint16_t port = 0;
+    int fd = bind_loopback(&port);
+    if (fd >= 0) {
+        close(fd);
+    }
+    return port;
+}
@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest message the server handles */
+#define DNS_TEST_MESSAGE_SIZE 512
+
+/** Response codes (RFC 1035, Section 4.1.1) */
+#define DNS_TEST_RCODE_NOERROR  0
+#define DNS_TEST_RCODE_SERVFAIL 2
+#define DNS_TEST_RCODE_NXDOMAIN 3
+#define DNS_TEST_RCODE_REFUSED  5
+
+/**
+ * @brief How every query is answered
+ */
+typedef struct {
+    uint8_t rcode;                  /* Response code */
+    bool nodata;                    /* NOERROR without records */
+    uint8_t host;                   /* NOERROR answers are 192.0.2.<host> or 2001:db8::<host> */
+    uint32_t ttl;                   /* TTL of the address records */
+    uint32_t soa_minimum;           /* Negative answers carry an SOA record with this MINIMUM, none if 0 */
+    int delay_ms;                   /* Time before each response is sent */
+} dns_test_script_t;
+
+typedef struct dns_test_server dns_test_server_t;
+
+/**
+ * @brief Builds the response to a query, both without TCP length prefix
+ *
+ * @return Length of the response, 0 if the query cannot be parsed
+ */
+size_t dns_test_build_response(const uint8_t *query, size_t query_len, const dns_test_script_t *script,
+                               uint8_t *buffer, size_t size);
+
+/**
+ * @brief Starts a DNS over TCP server on 127.0.0.1 with an ephemeral port
+ *
+ * Connections are served on a plain thread and stay open until the client or
+ * dns_test_server_close_connections() closes them.
+ */
+dns_test_server_t *dns_test_server_start(const dns_test_script_t *script);
+
+/** Stops the server and closes all its connections */
+void dns_test_server_stop(dns_test_server_t *server);
+
+/** Port the server listens on */
+uint16_t dns_test_server_port(const dns_test_server_t *server);
+
+/** Queries received so far */
+int dns_test_server_queries(const dns_test_server_t *server);
+
+/** Connections accepted so far */
+int dns_test_server_connections(const dns_test_server_t *server);
+
+/** Connections open right now */
+int dns_test_server_open_connections(const dns_test_server_t *server);
+
+/** Closes all open connections, as a server does with idle clients, and returns once they are closed */
+void dns_test_server_close_connections(dns_test_server_t *server);
+
+/** Returns a port on 127.0.0.1 nobody listens on */
+uint16_t dns_test_closed_port(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdatomic.h>
+#include "esp_dns_priv.h"
+#include "esp_dns_utils.h"
+#include "esp_dns_test_api.h"
+
+static atomic_uint s_tick_offset;
+
+TickType_t __real_xTaskGetTickCount(void);
+
+TickType_t __wrap_xTaskGetTickCount(void)
+{
+    return __real_xTaskGetTickCount() + s_tick_offset;
+}
+
+void test_advance_time(uint32_t ms)
+{
+    s_tick_offset += pdMS_TO_TICKS(ms);
+}
+
+size_t test_create_query(uint8_t *buffer, size_t size, const char *name, uint8_t rrtype, uint16_t *id)
+{
+    return esp_dns_create_query(buffer, size, name, rrtype, id);
+}
+
+void test_parse_response(uint8_t *response, size_t len, uint16_t id, test_parsed_t *parsed)
+{
+    dns_response_t dns_response = { 0 };
+
+    dns_response.id = id;
+    esp_dns_parse_response(response, len, &dns_response);
+
+    parsed->err = esp_dns_extract_ip_addresses_from_response(&dns_response, parsed->addr);
+    parsed->rcode = dns_response.rcode;
+    parsed->negative_ttl = dns_response.negative_ttl;
+    parsed->ttl = dns_response.num_answers > 0 ? dns_response.answers[0].ttl : 0;
+}
+
+err_t test_resolve(esp_dns_handle_t handle, const char *name, const uint8_t *rrtypes, int count, ip_addr_t *addr)
+{
+    return esp_dns_resolve(handle, name, addr, rrtypes, count);
+}
+
+err_t test_resolve_a(esp_dns_handle_t handle, const char *name, ip_addr_t *addr)
+{
+    const u8_t rrtypes[] = { DNS_RRTYPE_A };
+    return esp_dns_resolve(handle, name, addr, rrtypes, 1);
+}
+
+bool test_is_ipv4(const ip_addr_t *addr, uint8_t host)
+{
+    ip_addr_t expected;
+    IP_ADDR4(&expected, 192, 0, 2, host);
+    return IP_IS_V4(addr) && ip4_addr_get_u32(ip_2_ip4(addr)) == ip4_addr_get_u32(ip_2_ip4(&expected));
+}
+
+bool test_is_ipv6(const ip_addr_t *addr, uint8_t host)
+{
+    const uint8_t expected[16] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, host };
+    return IP_IS_V6(addr) && memcmp(ip_2_ip6(addr)->addr, expected, sizeof(expected)) == 0;
+}
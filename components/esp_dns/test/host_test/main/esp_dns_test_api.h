@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lwip/ip_addr.h"
+#include "lwip/err.h"
+#include "lwip/dns.h"
+#include "lwip/prot/dns.h"
+#include "esp_dns.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Internal API of the component under test, wrapped in C because the private
+ * headers do not compile as C++
+ */
+
+/** Result of esp_dns_parse_response() and esp_dns_extract_ip_addresses_from_response() */
+typedef struct {
+    err_t err;                             /* Result of the address extraction */
+    uint8_t rcode;                         /* Response code from the header */
+    uint32_t negative_ttl;                 /* Negative caching TTL, 0 if absent */
+    uint32_t ttl;                          /* TTL of the first answer */
+    ip_addr_t addr[DNS_MAX_HOST_IP];       /* Extracted addresses */
+} test_parsed_t;
+
+/**
+ * @brief Creates a query with esp_dns_create_query()
+ *
+ * @return Length of the query without TCP length prefix
+ */
+size_t test_create_query(uint8_t *buffer, size_t size, const char *name, uint8_t rrtype, uint16_t *id);
+
+/** Runs the response parser of the component on a message */
+void test_parse_response(uint8_t *response, size_t len, uint16_t id, test_parsed_t *parsed);
+
+/** Resolves name with esp_dns_resolve(), asking for the record types in order of preference */
+err_t test_resolve(esp_dns_handle_t handle, const char *name, const uint8_t *rrtypes, int count, ip_addr_t *addr);
+
+/** Resolves the A record of name */
+err_t test_resolve_a(esp_dns_handle_t handle, const char *name, ip_addr_t *addr);
+
+/**
+ * @brief Moves the tick count the component sees forward
+ *
+ * The test is linked with --wrap=xTaskGetTickCount, so TTLs expire without waiting.
+ */
+void test_advance_time(uint32_t ms);
+
+/** Returns true if addr is 192.0.2.<host> */
+bool test_is_ipv4(const ip_addr_t *addr, uint8_t host);
+
+/** Returns true if addr is 2001:db8::<host> */
+bool test_is_ipv6(const ip_addr_t *addr, uint8_t host);
+
+#ifdef __cplusplus
+}
+#endif
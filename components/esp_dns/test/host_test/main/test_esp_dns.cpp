@@ -0,0 +1,545 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <cstdio>
+#include <cstdlib>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "dns_test_server.h"
+#include "esp_dns_test_api.h"
+
+namespace {
+
+/** Scripted DNS over TCP server, stopped when it goes out of scope */
+class TestServer {
+public:
+    explicit TestServer(const dns_test_script_t &script) : server(dns_test_server_start(&script))
+    {
+        REQUIRE(server != nullptr);
+    }
+
+    ~TestServer()
+    {
+        dns_test_server_stop(server);
+    }
+
+    TestServer(const TestServer &) = delete;
+    TestServer &operator=(const TestServer &) = delete;
+
+    uint16_t port() const
+    {
+        return dns_test_server_port(server);
+    }
+
+    int queries() const
+    {
+        return dns_test_server_queries(server);
+    }
+
+    int connections() const
+    {
+        return dns_test_server_connections(server);
+    }
+
+    int open_connections() const
+    {
+        return dns_test_server_open_connections(server);
+    }
+
+    void close_connections()
+    {
+        dns_test_server_close_connections(server);
+    }
+
+private:
+    dns_test_server_t *server;
+};
+
+dns_test_script_t answer(uint8_t host, uint32_t ttl = 300)
+{
+    dns_test_script_t script = {};
+    script.rcode = DNS_TEST_RCODE_NOERROR;
+    script.host = host;
+    script.ttl = ttl;
+    return script;
+}
+
+dns_test_script_t failure(uint8_t rcode, uint32_t soa_minimum = 0)
+{
+    dns_test_script_t script = {};
+    script.rcode = rcode;
+    script.soa_minimum = soa_minimum;
+    return script;
+}
+
+esp_dns_server_config_t fallback(uint16_t port)
+{
+    esp_dns_server_config_t server = {};
+    server.protocol = ESP_DNS_PROTOCOL_TCP;
+    server.dns_server = "127.0.0.1";
+    server.port = port;
+    return server;
+}
+
+esp_dns_config_t make_config(uint16_t port, const esp_dns_server_config_t *fallbacks = nullptr, int num_fallbacks = 0)
+{
+    esp_dns_config_t config = {};
+    config.dns_server = "127.0.0.1";
+    config.port = port;
+    config.timeout_ms = 2000;
+    config.cache_config.disable = true;
+    config.fallback_config.servers = fallbacks;
+    config.fallback_config.num_servers = num_fallbacks;
+    config.fallback_config.stagger_ms = 500;
+    return config;
+}
+
+/** Waits up to timeout_ms for condition to become true */
+template<typename Condition>
+bool wait_until(Condition condition, int timeout_ms = 1000)
+{
+    for (int waited = 0; !condition(); waited += 5) {
+        if (waited >= timeout_ms) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
+}
+
+/** Parses the response a script gives to a query with the component's parser */
+test_parsed_t parse(const dns_test_script_t &script, uint8_t rrtype, int truncate = 0, int id_offset = 0)
+{
+    uint8_t query[DNS_TEST_MESSAGE_SIZE];
+    uint8_t response[DNS_TEST_MESSAGE_SIZE];
+    uint16_t id;
+
+    size_t query_len = test_create_query(query, sizeof(query), "www.example.com", rrtype, &id);
+    size_t response_len = dns_test_build_response(query, query_len, &script, response, sizeof(response));
+    REQUIRE(response_len > 0);
+
+    test_parsed_t parsed = {};
+    test_parse_response(response, response_len - truncate, id + id_offset, &parsed);
+    return parsed;
+}
+
+struct Lookup {
+    esp_dns_handle_t handle;
+    const char *name;
+    err_t err;
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    SemaphoreHandle_t done;
+};
+
+void lookup_task(void *arg)
+{
+    Lookup *lookup = static_cast<Lookup *>(arg);
+    lookup->err = test_resolve_a(lookup->handle, lookup->name, lookup->addr);
+    xSemaphoreGive(lookup->done);
+    vTaskDelete(nullptr);
+}
+
+} // namespace
+
+TEST_CASE("Parser extracts the addresses of an answer", "[parser]")
+{
+    test_parsed_t parsed = parse(answer(1, 120), DNS_RRTYPE_A);
+    CHECK(parsed.err == ERR_OK);
+    CHECK(parsed.ttl == 120);
+    CHECK(test_is_ipv4(&parsed.addr[0], 1));
+
+    parsed = parse(answer(2), DNS_RRTYPE_AAAA);
+    CHECK(parsed.err == ERR_OK);
+    CHECK(test_is_ipv6(&parsed.addr[0], 2));
+}
+
+TEST_CASE("Parser reports NXDOMAIN and NODATA as negative answers", "[parser]")
+{
+    /* RFC 2308: the negative TTL is the smaller of the SOA TTL (3600) and its MINIMUM */
+    test_parsed_t parsed = parse(failure(DNS_TEST_RCODE_NXDOMAIN, 60), DNS_RRTYPE_A);
+    CHECK(parsed.err == ERR_VAL);
+    CHECK(parsed.rcode == DNS_TEST_RCODE_NXDOMAIN);
+    CHECK(parsed.negative_ttl == 60);
+
+    parsed = parse(failure(DNS_TEST_RCODE_NXDOMAIN, 7200), DNS_RRTYPE_A);
+    CHECK(parsed.err == ERR_VAL);
+    CHECK(parsed.negative_ttl == 3600);
+
+    /* Not cacheable without SOA record */
+    parsed = parse(failure(DNS_TEST_RCODE_NXDOMAIN), DNS_RRTYPE_A);
+    CHECK(parsed.err == ERR_VAL);
+    CHECK(parsed.negative_ttl == 0);
+
+    dns_test_script_t nodata = failure(DNS_TEST_RCODE_NOERROR, 30);
+    nodata.nodata = true;
+    parsed = parse(nodata, DNS_RRTYPE_AAAA);
+    CHECK(parsed.err == ERR_VAL);
+    CHECK(parsed.negative_ttl == 30);
+}
+
+TEST_CASE("Parser rejects server failures and unusable responses", "[parser]")
+{
+    CHECK(parse(failure(DNS_TEST_RCODE_SERVFAIL, 60), DNS_RRTYPE_A).err == ERR_ABRT);
+    CHECK(parse(failure(DNS_TEST_RCODE_REFUSED), DNS_RRTYPE_A).err == ERR_ABRT);
+
+    /* Response to another query */
+    CHECK(parse(answer(1), DNS_RRTYPE_A, 0, 1).err == ERR_ABRT);
+
+    /* Address cut short */
+    CHECK(parse(answer(1), DNS_RRTYPE_A, 2).err == ERR_ABRT);
+}
+
+TEST_CASE("Lookups reuse the pooled connection", "[conn]")
+{
+    TestServer server(answer(1));
+    esp_dns_config_t config = make_config(server.port());
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    for (int i = 0; i < 3; i++) {
+        CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+        CHECK(test_is_ipv4(&addr[0], 1));
+    }
+    CHECK(server.queries() == 3);
+    CHECK(server.connections() == 1);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Dual-stack lookups pipeline both queries and merge the answers", "[conn]")
+{
+    TestServer server(answer(4));
+    esp_dns_config_t config = make_config(server.port());
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    /* Preferred type first, then alternating between the families */
+    const uint8_t rrtypes[] = { DNS_RRTYPE_AAAA, DNS_RRTYPE_A };
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve(handle, "www.example.com", rrtypes, 2, addr) == ERR_OK);
+    CHECK(test_is_ipv6(&addr[0], 4));
+    CHECK(test_is_ipv4(&addr[1], 4));
+    CHECK(server.queries() == 2);
+    CHECK(server.connections() == 1);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Concurrent lookups share one connection", "[conn]")
+{
+    TestServer server(answer(5));
+    esp_dns_config_t config = make_config(server.port());
+    config.conn_config.max_connections = 1;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    Lookup lookups[3] = {};
+    const char *names[] = { "a.example.com", "b.example.com", "c.example.com" };
+    for (int i = 0; i < 3; i++) {
+        lookups[i].handle = handle;
+        lookups[i].name = names[i];
+        lookups[i].err = ERR_INPROGRESS;
+        lookups[i].done = xSemaphoreCreateBinary();
+        REQUIRE(xTaskCreate(lookup_task, "lookup", 8192, &lookups[i], 5, nullptr) == pdPASS);
+    }
+    for (int i = 0; i < 3; i++) {
+        CHECK(xSemaphoreTake(lookups[i].done, pdMS_TO_TICKS(5000)) == pdTRUE);
+        vSemaphoreDelete(lookups[i].done);
+        CHECK(lookups[i].err == ERR_OK);
+        CHECK(test_is_ipv4(&lookups[i].addr[0], 5));
+    }
+    CHECK(server.queries() == 3);
+    CHECK(server.connections() == 1);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Answers slower than one read slice keep the connection", "[conn]")
+{
+    dns_test_script_t script = answer(6);
+    script.delay_ms = 100;
+    TestServer server(script);
+    esp_dns_config_t config = make_config(server.port());
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    for (int i = 0; i < 2; i++) {
+        CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+        CHECK(test_is_ipv4(&addr[0], 6));
+    }
+    CHECK(server.queries() == 2);
+    CHECK(server.connections() == 1);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Lookups retry on a new connection when the server closed the pooled one", "[conn]")
+{
+    TestServer server(answer(7));
+    esp_dns_config_t config = make_config(server.port());
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+
+    /* Servers close idle clients at will, the FIN is only seen by the next lookup */
+    server.close_connections();
+
+    TickType_t start = xTaskGetTickCount();
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK((xTaskGetTickCount() - start) < pdMS_TO_TICKS(config.timeout_ms / 2));
+    CHECK(test_is_ipv4(&addr[0], 7));
+    CHECK(server.connections() == 2);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Answers are cached for their TTL", "[cache]")
+{
+    TestServer server(answer(1, 30));
+    esp_dns_config_t config = make_config(server.port());
+    config.cache_config.disable = false;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(test_is_ipv4(&addr[0], 1));
+    CHECK(server.queries() == 1);
+
+    esp_dns_cache_stats_t stats;
+    REQUIRE(esp_dns_get_cache_stats(handle, &stats) == ESP_OK);
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 1);
+
+    test_advance_time(29 * 1000);
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(server.queries() == 1);
+
+    test_advance_time(2 * 1000);
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(test_is_ipv4(&addr[0], 1));
+    CHECK(server.queries() == 2);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("NXDOMAIN is cached for the negative TTL of its SOA record", "[cache]")
+{
+    TestServer server(failure(DNS_TEST_RCODE_NXDOMAIN, 10));
+    esp_dns_config_t config = make_config(server.port());
+    config.cache_config.disable = false;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "missing.example.com", addr) == ERR_VAL);
+    CHECK(test_resolve_a(handle, "missing.example.com", addr) == ERR_VAL);
+    CHECK(server.queries() == 1);
+
+    test_advance_time(11 * 1000);
+    CHECK(test_resolve_a(handle, "missing.example.com", addr) == ERR_VAL);
+    CHECK(server.queries() == 2);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Negative answers without SOA record are not cached", "[cache]")
+{
+    TestServer server(failure(DNS_TEST_RCODE_NXDOMAIN));
+    esp_dns_config_t config = make_config(server.port());
+    config.cache_config.disable = false;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "missing.example.com", addr) == ERR_VAL);
+    CHECK(test_resolve_a(handle, "missing.example.com", addr) == ERR_VAL);
+    CHECK(server.queries() == 2);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Failover skips a server that cannot be reached", "[failover]")
+{
+    TestServer good(answer(2));
+    esp_dns_server_config_t fallbacks[] = { fallback(good.port()) };
+    esp_dns_config_t config = make_config(dns_test_closed_port(), fallbacks, 1);
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(test_is_ipv4(&addr[0], 2));
+
+    esp_dns_server_stats_t stats;
+    REQUIRE(esp_dns_get_server_stats(handle, 0, &stats) == ESP_OK);
+    CHECK(stats.failures == 1);
+    REQUIRE(esp_dns_get_server_stats(handle, 1, &stats) == ESP_OK);
+    CHECK(stats.failures == 0);
+
+    /* The failing server drops behind the one that answered */
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    REQUIRE(esp_dns_get_server_stats(handle, 0, &stats) == ESP_OK);
+    CHECK(stats.queries == 1);
+    CHECK(good.queries() == 2);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Failover does not take SERVFAIL or REFUSED for an answer", "[failover]")
+{
+    TestServer servfail(failure(DNS_TEST_RCODE_SERVFAIL));
+    TestServer refused(failure(DNS_TEST_RCODE_REFUSED));
+    TestServer good(answer(3));
+    esp_dns_server_config_t fallbacks[] = { fallback(refused.port()), fallback(good.port()) };
+    esp_dns_config_t config = make_config(servfail.port(), fallbacks, 2);
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(test_is_ipv4(&addr[0], 3));
+    CHECK(servfail.queries() == 1);
+    CHECK(refused.queries() == 1);
+    CHECK(good.queries() == 1);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Failover stops at NXDOMAIN", "[failover]")
+{
+    TestServer nxdomain(failure(DNS_TEST_RCODE_NXDOMAIN, 60));
+    TestServer good(answer(2));
+    esp_dns_server_config_t fallbacks[] = { fallback(good.port()) };
+    esp_dns_config_t config = make_config(nxdomain.port(), fallbacks, 1);
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "missing.example.com", addr) == ERR_VAL);
+    CHECK(nxdomain.queries() == 1);
+    CHECK(good.queries() == 0);
+
+    esp_dns_server_stats_t stats;
+    REQUIRE(esp_dns_get_server_stats(handle, 0, &stats) == ESP_OK);
+    CHECK(stats.failures == 0);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Racing servers returns the first answer", "[failover]")
+{
+    TestServer servfail(failure(DNS_TEST_RCODE_SERVFAIL));
+    TestServer good(answer(3));
+    esp_dns_server_config_t fallbacks[] = { fallback(dns_test_closed_port()), fallback(good.port()) };
+    esp_dns_config_t config = make_config(servfail.port(), fallbacks, 2);
+    config.fallback_config.race = true;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(test_is_ipv4(&addr[0], 3));
+    CHECK(good.queries() == 1);
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Idle connections are closed by the workers", "[idle]")
+{
+    TestServer primary(answer(1));
+    TestServer secondary(answer(2));
+    esp_dns_server_config_t fallbacks[] = { fallback(secondary.port()) };
+    esp_dns_config_t config = make_config(primary.port(), fallbacks, 1);
+    config.conn_config.idle_timeout_ms = 50;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(primary.connections() == 1);
+    CHECK(wait_until([&] { return primary.open_connections() == 0; }));
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Idle connections of a single server are closed by the next lookup", "[idle]")
+{
+    TestServer server(answer(1));
+    esp_dns_config_t config = make_config(server.port());
+    config.conn_config.idle_timeout_ms = 50;
+
+    esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+    REQUIRE(handle != nullptr);
+
+    ip_addr_t addr[DNS_MAX_HOST_IP];
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+
+    /* The timer task only flags the server */
+    vTaskDelay(pdMS_TO_TICKS(200));
+    CHECK(server.open_connections() == 1);
+
+    CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+    CHECK(server.connections() == 2);
+    CHECK(wait_until([&] { return server.open_connections() == 1; }));
+
+    CHECK(esp_dns_cleanup_tcp(handle) == 0);
+}
+
+TEST_CASE("Cleanup stops idle checks queued for the workers", "[idle]")
+{
+    TestServer primary(answer(1));
+    TestServer secondary(answer(2));
+    esp_dns_server_config_t fallbacks[] = { fallback(secondary.port()) };
+
+    for (int i = 0; i < 10; i++) {
+        esp_dns_config_t config = make_config(primary.port(), fallbacks, 1);
+        config.conn_config.idle_timeout_ms = 2;
+
+        esp_dns_handle_t handle = esp_dns_init_tcp(&config);
+        REQUIRE(handle != nullptr);
+
+        ip_addr_t addr[DNS_MAX_HOST_IP];
+        CHECK(test_resolve_a(handle, "www.example.com", addr) == ERR_OK);
+        vTaskDelay(pdMS_TO_TICKS(i));
+
+        CHECK(esp_dns_cleanup_tcp(handle) == 0);
+    }
+    CHECK(wait_until([&] { return primary.open_connections() == 0; }));
+}
+
+extern "C" void app_main(void)
+{
+    int result = Catch::Session().run();
+    if (result != 0) {
+        printf("Test failed with result %d.\n", result);
+    } else {
+        printf("All tests passed successfully.\n");
+    }
+    std::exit(result);
+}
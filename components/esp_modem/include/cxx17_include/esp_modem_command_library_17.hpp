@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2025-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -8,10 +8,13 @@
 #include "esp_log.h"
 #include "cxx_include/esp_modem_dte.hpp"
 #include "cxx_include/esp_modem_dce_module.hpp"
+#include "cxx_include/esp_modem_response_matcher.hpp"
 
 namespace esp_modem::dce_commands {
 command_result generic_command(CommandableIf *t, const std::string &command,
                                const std::list<std::string_view> &pass_phrase,
                                const std::list<std::string_view> &fail_phrase,
                                uint32_t timeout_ms);
+command_result generic_command(CommandableIf *t, const std::string &command,
+                               const ResponseMatcher &matcher, uint32_t timeout_ms);
 }
@@ -6,12 +6,15 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <vector>
 #include "esp_modem_terminal.hpp"
 #include "cxx_include/esp_modem_buffer.hpp"
 
 namespace esp_modem {
 
-constexpr size_t MAX_TERMINALS_NUM = 2;
+constexpr size_t MAX_TERMINALS_NUM = 2;         /*!< Default number of virtual terminals (command and data) */
+constexpr size_t CMUX_MAX_TERMINALS = 62;       /*!< Maximum number of virtual terminals (DLCI 1..62) */
 /**
  * @defgroup ESP_MODEM_CMUX ESP_MODEM CMUX class
  * @brief Definition of CMUX terminal
@@ -31,6 +34,50 @@ enum class cmux_state {
     RECOVER,
 };
 
+/**
+ * @brief Frame Check Sequence of the CMUX protocol (3GPP TS 27.010, Annex B)
+ *
+ * Reversed CRC-8 with polynomial 0xE0, computed byte-wise from a table generated at compile time.
+ */
+struct CMuxFcs {
+    static constexpr uint8_t INIT = 0xFF;   /*!< Initial value of the running CRC */
+    static constexpr uint8_t GOOD = 0xCF;   /*!< Running CRC after the checked fields and their valid FCS */
+
+    /**
+     * @brief Adds data to a running CRC
+     * @param crc Running CRC (INIT to start)
+     * @param data Data to add
+     * @param len Data length
+     * @return Updated running CRC
+     */
+    static uint8_t update(uint8_t crc, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Computes the FCS to transmit for the given fields
+     * @param data Checked fields (address, control, length and, for UI frames, the payload)
+     * @param len Length of the checked fields
+     * @return FCS octet
+     */
+    static uint8_t calc(const uint8_t *data, size_t len)
+    {
+        return 0xFF - update(INIT, data, len);
+    }
+};
+
+/**
+ * @brief Configuration of a CMUX virtual terminal (DLC)
+ *
+ * If frame_size is set, the parameters are proposed to the module with DLC parameter
+ * negotiation (PN) before the DLC is opened, and the values accepted by the module apply.
+ * Otherwise the DLC is opened with the module defaults and frames of
+ * CONFIG_ESP_MODEM_CMUX_MAX_FRAME_SIZE bytes are sent.
+ */
+struct CMuxTermConfig {
+    size_t frame_size{0};   /*!< Maximum frame payload (N1) to negotiate, 0 to skip negotiation */
+    uint8_t priority{0};    /*!< DLC priority, 0 (highest) to 63 */
+    uint8_t window{2};      /*!< Window size k (1 to 7), used by modules in error recovery mode */
+};
+
 /**
  * @brief CMUX terminal abstraction
  *
@@ -48,7 +95,15 @@ class CMuxInstance;
 class CMux {
 public:
     explicit CMux(std::shared_ptr<Terminal> t, unique_buffer &&b):
-        term(std::move(t)), payload_start(nullptr), total_payload_size(0), buffer(std::move(b))  {}
+        CMux(std::move(t), std::move(b), std::vector<CMuxTermConfig>(MAX_TERMINALS_NUM)) {}
+
+    /**
+     * @brief Creates CMux with the given virtual terminals
+     * @param t The original terminal
+     * @param b Processing buffer
+     * @param terms Configuration of each virtual terminal (DLCI 1 is the first one)
+     */
+    explicit CMux(std::shared_ptr<Terminal> t, unique_buffer &&b, const std::vector<CMuxTermConfig> &terms);
     ~CMux();
 
     /**
@@ -86,6 +141,30 @@ public:
      */
     int write(int i, uint8_t *data, size_t len);
 
+    /**
+     * @brief Asks the module to hold (or to resume) sending frames to the appropriate terminal
+     *
+     * Uses the flow control bit of the Modem Status Command (MSC), other virtual terminals are not affected.
+     * @param i Index of the terminal
+     * @param pause true to hold, false to resume
+     */
+    void pause_rx(int i, bool pause);
+
+    /**
+     * @brief Returns the number of virtual terminals
+     */
+    size_t terminals() const
+    {
+        return dlcs.size();
+    }
+
+    /**
+     * @brief Returns the maximum frame payload used for sending on a virtual terminal
+     * @param i Index of the terminal
+     * @return Frame size (N1), as negotiated with the module if negotiation was requested
+     */
+    size_t frame_size(int i);
+
     /**
      * @brief Recovers the protocol
      *
@@ -116,9 +195,17 @@ private:
         UNKNOWN
     };
 
-    static uint8_t fcs_crc(const uint8_t frame[6]);     /*!< Utility to calculate FCS CRC */
     bool data_available(uint8_t *data, size_t len);     /*!< Called when valid data available (returns false on unexpected data format) */
     void send_sabm(size_t i);                           /*!< Sending initial SABM */
+    void send_pn(size_t i);                             /*!< Sending DLC parameter negotiation for a virtual terminal */
+    void on_control_message();                          /*!< Called when a complete control channel message is available */
+    void send_control(const uint8_t *msg, size_t len);  /*!< Sends a message on the control channel */
+    void send_msc(size_t i, bool flow_off);             /*!< Sends modem status of a virtual terminal (with our flow control) */
+    bool wait_for(const std::function<bool()> &done, uint32_t time_ms); /*!< Waits until the DLC state satisfies done() */
+    void negotiate_dlcs(uint64_t dlcis);                /*!< Negotiates parameters of the given DLCs */
+    [[nodiscard]] bool open_dlcs(uint64_t dlcis);       /*!< Opens the given DLCs and waits for their acknowledgement */
+    [[nodiscard]] bool close_dlcs(uint64_t dlcis);      /*!< Closes the given virtual terminals and waits for their acknowledgement */
+    void settle_dlcs(uint64_t dlcis);                   /*!< Waits for the module to report the status of newly opened DLCs */
     void send_disconnect(size_t i);                     /*!< Sending closing request for each virtual or control terminal */
     bool on_cmux_data(uint8_t *data, size_t len);       /*!< Called from terminal layer when raw CMUX protocol data available */
 
@@ -135,8 +222,18 @@ private:
     bool on_payload(CMuxFrame &frame);
     bool on_footer(CMuxFrame &frame);
     void recover_protocol(protocol_mismatch_reason reason);
+    void update_payload_fcs(const uint8_t *data, size_t len);  /*!< Adds received payload to the FCS of UI frames */
 
-    std::function<bool(uint8_t *data, size_t len)> read_cb[MAX_TERMINALS_NUM];  /*!< Function pointers to read callbacks */
+    /**
+     * @brief State of a virtual terminal (DLC)
+     */
+    struct Dlc {
+        CMuxTermConfig config;                               /*!< Requested parameters */
+        size_t frame_size;                                   /*!< Frame payload used for sending (N1) */
+        std::function<bool(uint8_t *data, size_t len)> read_cb;  /*!< Read callback */
+    };
+
+    std::vector<Dlc> dlcs;                            /*!< Virtual terminals, index 0 is DLCI 1 */
     std::shared_ptr<Terminal> term;                   /*!< The original terminal */
     cmux_state state;                                 /*!< CMux protocol state */
 
@@ -150,16 +247,37 @@ private:
     size_t frame_header_offset;
     uint8_t *payload_start;
     size_t total_payload_size;
-    int sabm_ack;
+    uint8_t rx_fcs;                                   /*!< Running FCS of the frame being received */
+    uint8_t ctrl_msg[16];                             /*!< Control channel message being received */
+    size_t ctrl_msg_len;
+
+    /**
+     * DLC handshake state, one bit per DLCI, updated from the receiving task and signalled through `dlc_changed`
+     */
+    uint64_t dlc_ua;                                  /*!< UA received (SABM or DISC accepted) */
+    uint64_t dlc_dm;                                  /*!< DM received (DLC refused or already closed) */
+    uint64_t dlc_pn;                                  /*!< PN response received */
+    uint64_t dlc_msc;                                 /*!< MSC received from the module */
+    bool pn_unsupported;                              /*!< Module rejected PN with NSC */
+    bool cld_ack;                                     /*!< Multiplexer close down acknowledged */
+    uint64_t rx_paused;                               /*!< DLCs we asked the module to hold (MSC flow control) */
+    uint64_t tx_paused;                               /*!< DLCs the module asked us to hold (MSC flow control) */
+    bool tx_paused_all;                               /*!< The module asked us to hold all DLCs (FCoff) */
+    std::condition_variable_any dlc_changed;          /*!< Broadcasts any change of the DLC handshake state */
 
     /**
      * Processing unique buffer (reused and transferred from it's parent DTE)
      */
     unique_buffer buffer;
 
+    /**
+     * Buffer to assemble outgoing frames, so that each frame is written to the terminal at once
+     */
+    std::unique_ptr<uint8_t[]> tx_frame;
+
     Lock lock;
     /**
-     * @brief Serializes (re)assignment of read_cb[] (set_read_cb()) against their invocation from
+     * @brief Serializes (re)assignment of read callbacks (set_read_cb()) against their invocation from
      * the underlying terminal's RX task. Deliberately separate from `lock`: the read callback
      * upcall may take a long time (or block in the network stack) and must not block write(),
      * which uses `lock`. Recursive, so the upcall may re-enter write().
@@ -194,6 +312,10 @@ public:
     {
         cmux->stop();
     }
+    void pause_rx(bool pause) override
+    {
+        cmux->pause_rx(instance, pause);
+    }
 private:
     std::shared_ptr<CMux> cmux;
     size_t instance;
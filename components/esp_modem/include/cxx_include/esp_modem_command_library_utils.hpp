@@ -1,11 +1,13 @@
 /*
- * SPDX-FileCopyrightText: 2021-2024 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #pragma once
 
+#include "cxx_include/esp_modem_response_matcher.hpp"
+
 namespace esp_modem::dce_commands {
 
 /**
@@ -21,6 +23,17 @@ command_result generic_command(CommandableIf *t, const std::string &command,
                                const std::string &pass_phrase,
                                const std::string &fail_phrase, uint32_t timeout_ms);
 
+/**
+ * @brief Generic command that completes when the matcher finds one of its pass or fail phrases
+ * @param t Any "Command-able" class that implements "command()" method
+ * @param command Command to issue
+ * @param matcher Pass and fail phrases, preferably a `static constexpr` object
+ * @param timeout_ms Command timeout in ms
+ * @return Generic command return type (OK, FAIL, TIMEOUT)
+ */
+command_result generic_command(CommandableIf *t, const std::string &command,
+                               const ResponseMatcher &matcher, uint32_t timeout_ms);
+
 /**
  * @brief Utility command to send command and return reply (after DCE says OK)
  * @param t Anything that is "command-able"
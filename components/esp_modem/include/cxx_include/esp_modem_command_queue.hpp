@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+#include "cxx_include/esp_modem_primitives.hpp"
+#include "cxx_include/esp_modem_types.hpp"
+
+namespace esp_modem {
+
+/**
+ * @defgroup ESP_MODEM_COMMAND_QUEUE
+ * @brief Asynchronous command execution
+ */
+/** @addtogroup ESP_MODEM_COMMAND_QUEUE
+* @{
+*/
+
+/**
+ * @brief Queue of AT commands executed asynchronously by a dedicated task
+ *
+ * Requests are executed in the order they were submitted, back-to-back, so the command channel
+ * stays busy while the submitters are free to do other work. Every request completes its own
+ * future (or callback), which ties the responses back to the requests.
+ *
+ * The modem processes one command at a time (V.250), so the queue does not send a command before
+ * the previous one finished. Commands sent directly to the DTE from other tasks are interleaved
+ * between the queued requests.
+ */
+class CommandQueue {
+public:
+    /**
+     * @brief Request executed by the queue task, typically a call to the command library,
+     * e.g. `dce_commands::get_signal_quality(t, rssi, ber)`
+     */
+    using job_cb = std::function<command_result(CommandableIf *t)>;
+    /**
+     * @brief Completion callback, called from the queue task
+     */
+    using done_cb = std::function<void(command_result result)>;
+
+    /**
+     * @brief Creates the queue and starts its task
+     * @param t DTE (or other commandable object) to execute the requests on, must outlive the queue
+     * @param stack_size Stack size of the queue task
+     * @param priority Priority of the queue task
+     */
+    explicit CommandQueue(CommandableIf *t, size_t stack_size = 4096, size_t priority = 5);
+
+    /**
+     * @brief Stops the queue task; requests which haven't started complete with command_result::FAIL
+     */
+    ~CommandQueue();
+
+    /**
+     * @brief Submits a request
+     * @return Future of the request's result
+     */
+    std::future<command_result> submit(job_cb job);
+
+    /**
+     * @brief Submits a request and calls the completion callback with its result
+     */
+    void submit(job_cb job, done_cb done);
+
+    /**
+     * @brief Submits a custom AT command, asynchronous variant of CommandableIf::command()
+     * @note The got_line callback is called from the queue task
+     */
+    std::future<command_result> command(const std::string &command, got_line_cb got_line, uint32_t time_ms, char separator = '\n');
+
+    /**
+     * @brief Submits independent requests which are executed together, without other queued requests in between
+     * @return Future of command_result::OK if all the requests succeeded, or the result of the first failed one
+     * (all requests are executed anyway)
+     */
+    std::future<command_result> batch(std::vector<job_cb> jobs);
+
+    /**
+     * @brief Number of requests waiting for execution
+     */
+    size_t pending();
+
+private:
+    struct request {
+        job_cb job;
+        done_cb done;
+    };
+
+    void task();
+    void push(request req);
+
+    static const size_t QUEUED = SignalGroup::bit0;
+    static const size_t TASK_STOP = SignalGroup::bit1;
+    static const size_t TASK_STOPPED = SignalGroup::bit2;
+
+    CommandableIf *term;
+    Lock queue_lock;
+    std::deque<request> queue;
+    SignalGroup signal;
+    Task task_handle;           /*!< Must be the last member, the task starts running in the constructor */
+};
+
+/**
+ * @}
+ */
+
+} // namespace esp_modem
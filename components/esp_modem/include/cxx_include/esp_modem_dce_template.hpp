@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2025-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -98,6 +98,14 @@ public:
         return dte->recover();
     }
 
+    /**
+     * @brief Get the statistics of the data received in data mode
+     */
+    NetifStats get_netif_stats() const
+    {
+        return netif.get_stats();
+    }
+
 #ifdef CONFIG_ESP_MODEM_URC_HANDLER
     void set_urc(got_line_cb on_read_cb)
     {
@@ -8,19 +8,20 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 #include <cstddef>
 #include <cstdint>
 #include "cxx_include/esp_modem_primitives.hpp"
 #include "cxx_include/esp_modem_terminal.hpp"
 #include "cxx_include/esp_modem_types.hpp"
 #include "cxx_include/esp_modem_buffer.hpp"
+#include "cxx_include/esp_modem_cmux.hpp"
+#include "cxx_include/esp_modem_response_matcher.hpp"
 
 struct esp_modem_dte_config;
 
 namespace esp_modem {
 
-class CMux;
-
 /**
  * @defgroup ESP_MODEM_DTE
  * @brief Definition of DTE and related classes
@@ -106,6 +107,15 @@ public:
      */
     void set_error_cb(std::function<void(terminal_error err)> f);
 
+    /**
+     * @brief Pauses or resumes receiving in data mode
+     *
+     * Asks the modem to hold the data by flow control of the data terminal (MSC in CMUX mode,
+     * RTS or XOFF of UART with flow control configured), e.g. while the network stack is out of buffers
+     * @param pause true to pause, false to resume
+     */
+    void pause_rx(bool pause);
+
 #ifdef CONFIG_ESP_MODEM_URC_HANDLER
     /**
      * @brief Allow setting a line callback for all incoming data
@@ -174,6 +184,14 @@ public:
      */
     command_result command(const std::string &command, got_line_cb got_line, uint32_t time_ms, char separator) override;
 
+    /**
+     * @brief Sends the command and waits until the matcher finds a pass or fail phrase in the reply
+     *
+     * The reply is scanned incrementally as it arrives, so it doesn't have to be kept in the DTE buffer
+     * (unless the URC handler is enabled, which needs the accumulated reply)
+     */
+    command_result command_until(const std::string &command, const ResponseMatcher &matcher, uint32_t time_ms) override;
+
     /**
      * @brief Allows this DTE to recover from a generic connection issue
      *
@@ -181,6 +199,24 @@ public:
      */
     bool recover();
 
+    /**
+     * @brief Configures the virtual terminals opened when entering CMUX mode
+     *
+     * The first terminal is used for commands and the second for data, the others
+     * are available with get_cmux_terminal(). Takes effect on the next CMUX mode entry.
+     *
+     * @param terms Configuration of each virtual terminal (2 to CMUX_MAX_TERMINALS)
+     * @return true on success
+     */
+    [[nodiscard]] bool set_cmux_terminals(std::vector<CMuxTermConfig> terms);
+
+    /**
+     * @brief Returns an additional CMUX virtual terminal
+     * @param i Index of the terminal (from 2, the first two belong to this DTE)
+     * @return The virtual terminal, nullptr if not in CMUX mode or out of range
+     */
+    std::shared_ptr<Terminal> get_cmux_terminal(size_t i);
+
     /**
      * @brief Set internal command callbacks to the underlying terminal.
      * Here we capture command replies to be processed by supplied command callbacks in  struct command_cb.
@@ -206,6 +242,7 @@ private:
     [[nodiscard]] bool setup_cmux();                        /*!< Internal setup of CMUX mode */
     [[nodiscard]] bool exit_cmux();                         /*!< Exit of CMUX mode and cleanup  */
     void exit_cmux_internal();                              /*!< Cleanup CMUX */
+    command_result send_and_wait(const std::string &command, uint32_t time_ms); /*!< Sends the command and waits for the armed command_cb */
 
 #ifdef CONFIG_ESP_MODEM_URC_HANDLER
     /**
@@ -237,6 +274,7 @@ private:
     Lock internal_lock{};                                   /*!< Locks DTE operations */
     unique_buffer buffer;                                   /*!< DTE buffer */
     std::shared_ptr<CMux> cmux_term;                        /*!< Primary terminal for this DTE */
+    std::vector<CMuxTermConfig> cmux_config;                /*!< Virtual terminals to open in CMUX mode */
     std::shared_ptr<Terminal> primary_term;                 /*!< Reference to the primary terminal (mostly for sending commands) */
     std::shared_ptr<Terminal> secondary_term;               /*!< Secondary terminal for this DTE */
     modem_mode mode;                                        /*!< DTE operation mode */
@@ -257,9 +295,11 @@ private:
         std::vector<uint8_t> *buffer;
         size_t consumed{0};
         void grow(size_t need_size);
-        void deflate()
+        void deflate()                                      /*!< Releases the data, but keeps the capacity for next replies */
         {
-            grow(0);
+            if (buffer) {
+                buffer->clear();
+            }
             consumed = 0;
         }
         [[nodiscard]] uint8_t *begin() const
@@ -283,6 +323,9 @@ private:
 #endif
         static const size_t GOT_LINE = SignalGroup::bit0;       /*!< Bit indicating response available */
         got_line_cb got_line;                                   /*!< Supplied command callback */
+        const ResponseMatcher *matcher{};                       /*!< Supplied reply matcher (used instead of the callback) */
+        ResponseMatcher::cursor cursor{};                       /*!< Matcher state, kept between the received chunks */
+        command_result matched{};                               /*!< Strongest result found by the matcher so far */
         Lock line_lock{};                                       /*!< Command callback locking mechanism */
         char separator{};                                       /*!< Command reply separator (end of line/processing unit) */
         command_result result{};                                /*!< Command return code */
@@ -306,8 +349,24 @@ private:
                 }
             }
             got_line = std::move(l);
+            matcher = nullptr;
             separator = s;
         }
+        void set_matcher(const ResponseMatcher *m, char s = '\n') /*!< Sets the reply matcher atomically */
+        {
+            Scoped<Lock> lock(line_lock);
+            signal.clear(GOT_LINE);
+            result = command_result::TIMEOUT;
+            matched = command_result::TIMEOUT;
+            cursor = 0;
+            got_line = nullptr;
+            matcher = m;
+            separator = s;
+        }
+        [[nodiscard]] bool waiting() const                      /*!< Whether a command is waiting for its reply */
+        {
+            return (got_line != nullptr || matcher != nullptr) && result == command_result::TIMEOUT;
+        }
         void give_up()                                          /*!< Reports other than timeout error when processing replies (out of buffer) */
         {
             result = command_result::FAIL;
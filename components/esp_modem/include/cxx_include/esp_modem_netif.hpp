@@ -1,13 +1,15 @@
 /*
- * SPDX-FileCopyrightText: 2021-2024 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <cstddef>
+#include <cstdint>
 #include "esp_netif.h"
 #include "cxx_include/esp_modem_primitives.hpp"
 
@@ -30,6 +32,15 @@ struct ppp_netif_driver {
 * @{
 */
 
+/**
+ * @brief Statistics of the data received from the modem in data mode
+ */
+struct NetifStats {
+    uint32_t rx_bytes;      /*!< Bytes passed to the network stack */
+    uint32_t rx_chunks;     /*!< Number of reads passed to the network stack */
+    uint32_t rx_dropped;    /*!< Bytes the network stack refused (e.g. no free pbuf) */
+};
+
 /**
  * @brief Network interface class responsible to glue the esp-netif to the modem's DCE
  */
@@ -66,6 +77,16 @@ public:
 
     void receive(uint8_t *data, size_t len);
 
+    /**
+     * @brief Get the receive statistics
+     */
+    NetifStats get_stats() const
+    {
+        return { rx_bytes.load(std::memory_order_relaxed),
+                 rx_chunks.load(std::memory_order_relaxed),
+                 rx_dropped.load(std::memory_order_relaxed) };
+    }
+
 private:
 
     static esp_err_t esp_modem_dte_transmit(void *h, void *buffer, size_t len);
@@ -74,11 +95,17 @@ private:
 
     static void on_ppp_changed(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 
+    void throttle_rx();     /*!< Holds the received data while the network stack is out of buffers */
+
     std::shared_ptr<DTE> ppp_dte;
     struct ppp_netif_driver driver {};
     SignalGroup signal;
     static const size_t PPP_STARTED = SignalGroup::bit0;
     static const size_t PPP_EXIT = SignalGroup::bit1;
+    // updated from the terminal task only, relaxed ordering is enough for reading them elsewhere
+    std::atomic<uint32_t> rx_bytes{0};
+    std::atomic<uint32_t> rx_chunks{0};
+    std::atomic<uint32_t> rx_dropped{0};
 };
 
 /**
@@ -80,6 +80,7 @@ public:
     static constexpr size_t bit1 = 1 << 1;
     static constexpr size_t bit2 = 1 << 2;
     static constexpr size_t bit3 = 1 << 3;
+    static constexpr size_t bit4 = 1 << 4;
 
     explicit SignalGroup();
 
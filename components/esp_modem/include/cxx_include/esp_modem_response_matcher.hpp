@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include "cxx_include/esp_modem_types.hpp"
+
+namespace esp_modem {
+
+/**
+ * @defgroup ESP_MODEM_RESPONSE_MATCHER
+ * @brief Matching of pass/fail phrases in replies
+ */
+/** @addtogroup ESP_MODEM_RESPONSE_MATCHER
+* @{
+*/
+
+/**
+ * @brief Finds pass and fail phrases in replies in a single pass (Aho-Corasick automaton)
+ *
+ * The automaton is built without allocations, at compile time if the matcher is declared `constexpr`:
+ * @code{cpp}
+ * static constexpr ResponseMatcher ok_error({"OK"}, {"ERROR"});
+ * @endcode
+ * Replies can be matched at once with match(), or scanned incrementally with feed(), which keeps
+ * the state between the calls, so every byte is examined only once and phrases split between
+ * two fragments are found as well.
+ */
+class ResponseMatcher {
+public:
+    static constexpr size_t max_nodes = 64;     /*!< Total length of all phrases must be less than this */
+
+    /**
+     * @brief State of incremental scanning, initialize to zero for a new reply
+     */
+    using cursor = uint8_t;
+
+    constexpr ResponseMatcher(std::initializer_list<std::string_view> pass_phrases,
+                              std::initializer_list<std::string_view> fail_phrases = {})
+    {
+        for (auto phrase : pass_phrases) {
+            add(phrase, PASS);
+        }
+        for (auto phrase : fail_phrases) {
+            add(phrase, FAIL);
+        }
+        build();
+    }
+
+    /**
+     * @brief Creates the matcher from containers of phrases (e.g. std::list<std::string_view>)
+     */
+    template<typename Container>
+    ResponseMatcher(const Container &pass_phrases, const Container &fail_phrases)
+    {
+        for (auto &phrase : pass_phrases) {
+            add(phrase, PASS);
+        }
+        for (auto &phrase : fail_phrases) {
+            add(phrase, FAIL);
+        }
+        build();
+    }
+
+    /**
+     * @brief Scans the entire reply
+     * @return OK if a pass phrase is found, FAIL if only a fail phrase is found, TIMEOUT otherwise
+     */
+    command_result match(std::string_view reply) const
+    {
+        cursor c = 0;
+        return feed(reply, c);
+    }
+
+    /**
+     * @brief Scans the next part of a reply
+     * @param data Data received after the previous call
+     * @param c Cursor, kept between the calls
+     * @return OK if a pass phrase is found, FAIL if only a fail phrase is found in this part, TIMEOUT otherwise
+     */
+    command_result feed(std::string_view data, cursor &c) const;
+
+private:
+    static constexpr uint8_t PASS = 1;
+    static constexpr uint8_t FAIL = 2;
+    static constexpr uint8_t none = 0;          /*!< root node, also used as "no node" in child and sibling links */
+
+    struct node {
+        char symbol;
+        uint8_t child;
+        uint8_t sibling;
+        uint8_t fail;
+        uint8_t out;
+    };
+
+    constexpr uint8_t child(uint8_t n, char symbol) const
+    {
+        for (uint8_t it = nodes[n].child; it != none; it = nodes[it].sibling) {
+            if (nodes[it].symbol == symbol) {
+                return it;
+            }
+        }
+        return none;
+    }
+
+    constexpr void add(std::string_view phrase, uint8_t out)
+    {
+        uint8_t n = 0;
+        for (char symbol : phrase) {
+            uint8_t next = child(n, symbol);
+            if (next == none) {
+                if (size >= max_nodes) {
+                    throw_too_long();
+                }
+                next = size++;
+                nodes[next] = { symbol, none, nodes[n].child, 0, 0 };
+                nodes[n].child = next;
+            }
+            n = next;
+        }
+        nodes[n].out |= out;
+    }
+
+    // failure links in breadth-first order, so the outputs of shorter suffixes are already merged
+    constexpr void build()
+    {
+        uint8_t queue[max_nodes] = {};
+        size_t head = 0, tail = 0;
+        for (uint8_t it = nodes[0].child; it != none; it = nodes[it].sibling) {
+            queue[tail++] = it;
+        }
+        while (head < tail) {
+            uint8_t n = queue[head++];
+            for (uint8_t it = nodes[n].child; it != none; it = nodes[it].sibling) {
+                uint8_t f = nodes[n].fail;
+                while (f != none && child(f, nodes[it].symbol) == none) {
+                    f = nodes[f].fail;
+                }
+                nodes[it].fail = child(f, nodes[it].symbol);
+                nodes[it].out |= nodes[nodes[it].fail].out;
+                queue[tail++] = it;
+            }
+        }
+    }
+
+    static void throw_too_long();
+
+    node nodes[max_nodes] = {};
+    uint8_t size = 1;
+};
+
+/**
+ * @}
+ */
+
+} // namespace esp_modem
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -75,6 +75,16 @@ public:
 
     virtual void stop() = 0;
 
+    /**
+     * @brief Pauses or resumes receiving (flow control towards the peer)
+     *
+     * While paused, the terminal asks the peer to hold the data if it can (by RTS or XOFF with flow control
+     * configured, by MSC on CMUX virtual terminals) and it doesn't have to notify the read callback.
+     * Terminals without any means of flow control ignore this.
+     * @param pause true to pause, false to resume
+     */
+    virtual void pause_rx(bool pause) {}
+
 protected:
     /**
      * @brief Serializes (re)assignment of on_read/on_error (set_read_cb/set_error_cb) against their
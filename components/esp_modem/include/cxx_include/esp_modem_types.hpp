@@ -86,6 +86,8 @@ struct PdpContext {
     std::string apn;
 };
 
+class ResponseMatcher;
+
 /**
  * @brief Interface for classes eligible to send AT commands (Modules, DCEs, DTEs)
  */
@@ -108,6 +110,18 @@ public:
     virtual command_result command(const std::string &command, got_line_cb got_line, uint32_t time_ms, const char separator) = 0;
     virtual command_result command(const std::string &command, got_line_cb got_line, uint32_t time_ms) = 0;
 
+    /**
+     * @brief Sends custom AT command and waits for a pass or fail phrase of the matcher in the reply
+     *
+     * The default implementation matches the accumulated reply on every received line,
+     * implementations could scan the reply incrementally instead.
+     * @param command Command to be sent
+     * @param matcher Pass and fail phrases, must outlive the call
+     * @param time_ms timeout in milliseconds
+     * @return OK, FAIL or TIMEOUT
+     */
+    virtual command_result command_until(const std::string &command, const ResponseMatcher &matcher, uint32_t time_ms);
+
     virtual int write(uint8_t *data, size_t len) = 0;
     virtual void on_read(got_line_cb on_data) = 0;
 };
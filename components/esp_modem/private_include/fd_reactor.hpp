@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "cxx_include/esp_modem_primitives.hpp"
+
+namespace esp_modem {
+
+/**
+ * @brief Shared epoll reactor serving the file descriptors of all VFS terminals from a small pool of threads
+ *
+ * Descriptors are watched edge-triggered and one-shot, so each descriptor is served by one thread at a time.
+ * On every edge, the ready callback is called for as long as it keeps consuming the available data.
+ * If it doesn't consume anything (e.g. the DTE isn't waiting for a reply), the descriptor is parked
+ * until resume() is called, instead of waking up the reactor over and over.
+ */
+class FdReactor {
+public:
+    /**
+     * @brief Called from a reactor thread when the descriptor has data
+     * @return Number of bytes consumed from the descriptor
+     */
+    using ready_cb = std::function<size_t()>;
+
+    /**
+     * @brief The reactor instance, starts the threads on first use
+     */
+    static FdReactor &get();
+
+    /**
+     * @brief Starts watching the descriptor
+     */
+    void add(int fd, ready_cb on_ready);
+
+    /**
+     * @brief Stops watching the descriptor, no callback is in progress once this returns
+     */
+    void remove(int fd);
+
+    /**
+     * @brief Re-arms a parked descriptor, e.g. after a command has been sent or the read callback has changed
+     */
+    void resume(int fd);
+
+private:
+    struct watch {
+        int fd;
+        ready_cb on_ready;
+        Lock lock;                          /*!< Held while the callback is running */
+        bool removed{false};
+        std::atomic<bool> parked{false};
+        std::atomic<uint32_t> resumes{0};
+    };
+
+    FdReactor();
+    void worker();
+    void dispatch(int fd, uint32_t events);
+    void arm(int fd, int op);
+    std::shared_ptr<watch> find(int fd);
+
+    int epoll_fd;
+    Lock lock;
+    std::unordered_map<int, std::shared_ptr<watch>> watches;
+    std::vector<std::unique_ptr<Task>> threads;
+};
+
+} // namespace esp_modem
@@ -1,11 +1,12 @@
 /*
- * SPDX-FileCopyrightText: 2021-2024 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <array>
+#include <chrono>
 #include <cstring>
-#include <unistd.h>
 #include <cxx_include/esp_modem_cmux.hpp>
 #include "cxx_include/esp_modem_dte.hpp"
 #include "esp_log.h"
@@ -56,26 +57,87 @@ using namespace esp_modem;
 #define CMD_SNC    0x68  /* Service Negotiation Command              */
 #define CMD_MSC    0x70  /* Modem Status Command                     */
 
+/* V.24 signals of the Modem Status Command */
+#define MSC_FC     0x02  /* Flow control, unable to accept frames on the DLC        */
+#define MSC_RTC    0x04  /* Ready to communicate                                    */
+#define MSC_RTR    0x08  /* Ready to receive                                        */
+
 /* Flag sequence field between messages (start of frame) */
 #define SOF_MARKER 0xF9
 
-uint8_t CMux::fcs_crc(const uint8_t frame[6])
-{
-    //    #define FCS_GOOD_VALUE 0xCF
-    uint8_t crc = 0xFF; // FCS_INIT_VALUE
+/* Longest payload of a frame with a 1-byte length field */
+#define SHORT_PAYLOAD_MAX 127
+
+/* Maximum payload of a transmitted frame (N1) */
+#ifdef CONFIG_ESP_MODEM_CMUX_USE_SHORT_PAYLOADS_ONLY
+#define TX_PAYLOAD_MAX SHORT_PAYLOAD_MAX
+#define TX_PAYLOAD_MAX_NEGOTIATED SHORT_PAYLOAD_MAX
+#else
+#define TX_PAYLOAD_MAX CONFIG_ESP_MODEM_CMUX_MAX_FRAME_SIZE
+#define TX_PAYLOAD_MAX_NEGOTIATED 32767
+#endif
+
+/* Frame overhead: opening flag, address, control, 2-byte length, FCS, closing flag */
+#define FRAME_OVERHEAD_MAX 7
 
-    for (int i = 1; i < 4; i++) {
-        crc ^= frame[i];
+/* Time to wait for the module to answer SABM, DISC, PN and CLD */
+#define RESPONSE_TIMEOUT_MS 1000
 
+/* Longest time to hold outgoing frames while the module asks for it (FCoff, or flow control in MSC) */
+#define TX_FLOW_TIMEOUT_MS 5000
+
+/* Default DLC parameters proposed in PN (acknowledgement timer T1 in 10ms units, retransmissions N2) */
+#define PN_DEFAULT_T1 10
+#define PN_DEFAULT_N2 3
+
+namespace {
+
+/**
+ * @brief Generates the lookup table of the reversed CRC-8 (polynomial 0xE0) used as CMUX FCS
+ */
+constexpr std::array<uint8_t, 256> make_fcs_table()
+{
+    std::array<uint8_t, 256> table{};
+    for (int i = 0; i < 256; i++) {
+        uint8_t crc = i;
         for (int j = 0; j < 8; j++) {
-            if (crc & 0x01) {
-                crc = (crc >> 1) ^ 0xe0; // FCS_POLYNOMIAL
-            } else {
-                crc >>= 1;
-            }
+            crc = (crc & 0x01) ? (crc >> 1) ^ 0xE0 : crc >> 1;
         }
+        table[i] = crc;
     }
+    return table;
+}
+
+constexpr auto fcs_table = make_fcs_table();
+
+/**
+ * @brief Frames carrying user data: UIH (FCS over header only) and UI (FCS over header and payload)
+ */
+bool is_info_frame(uint8_t type)
+{
+    return (type & ~PF) == FT_UIH || (type & ~PF) == FT_UI;
+}
+
+constexpr uint64_t dlci_bit(size_t i)
+{
+    return 1ULL << i;
+}
 
+/**
+ * @brief Mask of DLCIs from first to last (inclusive)
+ */
+constexpr uint64_t dlci_range(size_t first, size_t last)
+{
+    return first > last ? 0 : ((dlci_bit(last) << 1) - 1) & ~(dlci_bit(first) - 1);
+}
+
+} // namespace
+
+uint8_t CMuxFcs::update(uint8_t crc, const uint8_t *data, size_t len)
+{
+    while (len--) {
+        crc = fcs_table[crc ^ *data++];
+    }
     return crc;
 }
 
@@ -91,11 +153,111 @@ void CMux::send_disconnect(size_t i)
             SOF_MARKER, 0x3, FT_DISC | PF, 0x1, 0, SOF_MARKER
         };
         frame[1] |= i << 2;
-        frame[4] = 0xFF - fcs_crc(frame);
+        frame[4] = CMuxFcs::calc(frame + 1, 3);
         term->write(frame, sizeof(frame));
     }
 }
 
+void CMux::send_pn(size_t i)
+{
+    auto &config = dlcs[i - 1].config;
+    size_t n1 = dlcs[i - 1].frame_size;
+    uint8_t frame[] = {
+        SOF_MARKER, 0x3, FT_UIH, (10 << 1) | EA,
+        (CMD_PN << 1) | CR | EA, (8 << 1) | EA,                 // message type and length
+        static_cast<uint8_t>(i), 0,                             // DLCI, UIH frames without convergence layer
+        static_cast<uint8_t>(config.priority & 0x3F), PN_DEFAULT_T1,
+        static_cast<uint8_t>(n1 & 0xFF), static_cast<uint8_t>(n1 >> 8),
+        PN_DEFAULT_N2, static_cast<uint8_t>(config.window & 0x07),
+        0, SOF_MARKER
+    };
+    frame[14] = CMuxFcs::calc(frame + 1, 3);
+    term->write(frame, sizeof(frame));
+}
+
+void CMux::send_control(const uint8_t *msg, size_t len)
+{
+    uint8_t frame[sizeof(ctrl_msg) + 6] = { SOF_MARKER, 0x3, FT_UIH, static_cast<uint8_t>((len << 1) | EA) };
+    memcpy(frame + 4, msg, len);
+    frame[4 + len] = CMuxFcs::calc(frame + 1, 3);
+    frame[5 + len] = SOF_MARKER;
+    term->write(frame, len + 6);
+}
+
+void CMux::send_msc(size_t i, bool flow_off)
+{
+    uint8_t msg[] = {
+        (CMD_MSC << 1) | CR | EA, (2 << 1) | EA,
+        static_cast<uint8_t>((i << 2) | 0x02 | EA),
+        static_cast<uint8_t>(MSC_RTC | MSC_RTR | EA | (flow_off ? MSC_FC : 0))
+    };
+    send_control(msg, sizeof(msg));
+}
+
+void CMux::on_control_message()
+{
+    if (ctrl_msg_len < 2) {
+        return;
+    }
+    uint8_t command = (ctrl_msg[0] & ~(CR | EA)) >> 1;
+    bool response = (ctrl_msg[0] & CR) == 0;
+    Scoped<Lock> l(lock);
+    if (command == CMD_MSC) {
+        // Modem status of a DLC, the module reports it once the DLC is open
+        if (ctrl_msg_len >= 3) {
+            size_t i = ctrl_msg[2] >> 2;
+            dlc_msc |= dlci_bit(i);
+            if (!response && ctrl_msg_len >= 4 && i > 0 && i <= dlcs.size()) {
+                // The module is (un)able to accept frames on this DLC
+                if (ctrl_msg[3] & MSC_FC) {
+                    tx_paused |= dlci_bit(i);
+                } else {
+                    tx_paused &= ~dlci_bit(i);
+                }
+            }
+        }
+        if (!response) {
+            ctrl_msg[0] &= ~CR;
+            send_control(ctrl_msg, ctrl_msg_len);
+        }
+    } else if (command == CMD_FCOFF || command == CMD_FCON) {
+        if (response) {
+            return;
+        }
+        // The module is (un)able to accept frames on any DLC
+        tx_paused_all = command == CMD_FCOFF;
+        ctrl_msg[0] &= ~CR;
+        send_control(ctrl_msg, ctrl_msg_len);
+    } else if (command == CMD_PN) {
+        if (!response || ctrl_msg_len < 10) {
+            // Parameters proposed by the module, keep the defaults
+            return;
+        }
+        size_t i = ctrl_msg[2] & 0x3F;
+        size_t n1 = ctrl_msg[6] | (ctrl_msg[7] << 8);
+        if (i > 0 && i <= dlcs.size()) {
+            // The module may only accept the proposed frame size or lower it
+            if (n1 > 0 && n1 < dlcs[i - 1].frame_size) {
+                dlcs[i - 1].frame_size = n1;
+            }
+            dlc_pn |= dlci_bit(i);
+        }
+    } else if (command == CMD_NSC) {
+        pn_unsupported = true;
+    } else if (command == CMD_CLD) {
+        // Response to the multiplexer close down
+        cld_ack = true;
+    } else if (!response) {
+        // Tell the module we do not support this command, echoing its type
+        uint8_t nsc[] = { (CMD_NSC << 1) | EA, (1 << 1) | EA, ctrl_msg[0] };
+        send_control(nsc, sizeof(nsc));
+        return;
+    } else {
+        return;
+    }
+    dlc_changed.notify_all();
+}
+
 void CMux::send_sabm(size_t i)
 {
     uint8_t frame[6];
@@ -103,7 +265,7 @@ void CMux::send_sabm(size_t i)
     frame[1] = (i << 2) | 0x3;
     frame[2] = FT_SABM | PF;
     frame[3] = 1;
-    frame[4] = 0xFF - fcs_crc(frame);
+    frame[4] = CMuxFcs::calc(frame + 1, 3);
     frame[5] = SOF_MARKER;
     term->write(frame, 6);
 }
@@ -121,14 +283,14 @@ struct CMux::CMuxFrame {
 
 bool CMux::data_available(uint8_t *data, size_t len)
 {
-    if (data && (type & FT_UIH) == FT_UIH && len > 0 && dlci > 0) { // valid payload on a virtual term
+    if (data && is_info_frame(type) && len > 0 && dlci > 0) { // valid payload on a virtual term
         int virtual_term = dlci - 1;
-        if (virtual_term < MAX_TERMINALS_NUM) {
+        if (virtual_term < dlcs.size()) {
             // Hold cb_lock (not the state lock) across the read_cb check and invocation, so the
             // callback cannot be reassigned/cleared (set_read_cb()/teardown) while we're using it,
             // without blocking write() during the (potentially long) upcall.
             Scoped<Lock> l(cb_lock);
-            if (read_cb[virtual_term] == nullptr) {
+            if (dlcs[virtual_term].read_cb == nullptr) {
                 // ignore all virtual terminal's data before we completely establish CMUX
                 ESP_LOG_BUFFER_HEXDUMP("CMUX Rx before init", data, len, ESP_LOG_DEBUG);
                 return true;
@@ -141,35 +303,43 @@ bool CMux::data_available(uint8_t *data, size_t len)
             }
             total_payload_size += len;
 #else
-            read_cb[virtual_term](data, len);
+            dlcs[virtual_term].read_cb(data, len);
 #endif
         } else {
             return false;
         }
-    } else if (data == nullptr && type == (FT_UA | PF) && len == 0) { // notify the initial SABM command
+    } else if (data == nullptr && type == (FT_UA | PF) && len == 0) { // notify the SABM or DISC command
         Scoped<Lock> l(lock);
-        sabm_ack = dlci;
+        dlc_ua |= dlci_bit(dlci);
+        dlc_changed.notify_all();
+    } else if (data == nullptr && (type & ~PF) == FT_DM && len == 0) { // SABM refused, or DISC of a closed DLC
+        Scoped<Lock> l(lock);
+        dlc_dm |= dlci_bit(dlci);
+        dlc_changed.notify_all();
     } else if (data == nullptr && dlci > 0) {
         int virtual_term = dlci - 1;
-        if (virtual_term < MAX_TERMINALS_NUM) {
+        if (virtual_term < dlcs.size()) {
             Scoped<Lock> l(cb_lock);
-            if (read_cb[virtual_term] == nullptr) {
+            if (dlcs[virtual_term].read_cb == nullptr) {
                 // silently ignore this CMUX frame (not finished entering CMUX, yet)
                 return true;
             }
 #ifdef DEFRAGMENT_CMUX_PAYLOAD
-            read_cb[virtual_term](payload_start, total_payload_size);
+            dlcs[virtual_term].read_cb(payload_start, total_payload_size);
 #endif
         } else {
             return false;
         }
-    } else if ((type & FT_UIH) == FT_UIH && dlci == 0) { // notify the internal DISC command
-        if ((data == nullptr) || (len > 0 && (data[0] & 0xE1) == 0xE1)) {
-            // Not a DISC, ignore (MSC frame)
-            return true;
+    } else if (is_info_frame(type) && dlci == 0) { // control channel message (CLD, PN, MSC, ...)
+        if (data) {
+            // Collect the message, it is processed on the frame footer
+            size_t copy_len = std::min(len, sizeof(ctrl_msg) - ctrl_msg_len);
+            memcpy(ctrl_msg + ctrl_msg_len, data, copy_len);
+            ctrl_msg_len += copy_len;
+        } else {
+            on_control_message();
+            ctrl_msg_len = 0;
         }
-        Scoped<Lock> l(lock);
-        sabm_ack = dlci;
     } else {
         return false;
     }
@@ -232,7 +402,8 @@ bool CMux::on_header(CMuxFrame &frame)
     }
     size_t payload_offset = std::min(frame.len, 4 - frame_header_offset);
     memcpy(frame_header + frame_header_offset, frame.ptr, payload_offset);
-#ifndef ESP_MODEM_CMUX_USE_SHORT_PAYLOADS_ONLY
+    size_t length_bytes = 1;
+#ifndef CONFIG_ESP_MODEM_CMUX_USE_SHORT_PAYLOADS_ONLY
     if ((frame_header[3] & 1) == 0) {
         if (frame_header_offset + frame.len <= 4) {
             frame_header_offset += frame.len;
@@ -241,9 +412,10 @@ bool CMux::on_header(CMuxFrame &frame)
         payload_offset = std::min(frame.len, 5 - frame_header_offset);
         memcpy(frame_header + frame_header_offset, frame.ptr, payload_offset);
         payload_len = frame_header[4] << 7;
+        length_bytes = 2;
         frame_header_offset += payload_offset - 1; // rewind frame_header back to hold only 6 bytes size
     } else
-#endif // ! ESP_MODEM_CMUX_USE_SHORT_PAYLOADS_ONLY
+#endif // ! CONFIG_ESP_MODEM_CMUX_USE_SHORT_PAYLOADS_ONLY
     {
         payload_len = 0;
         frame_header_offset += payload_offset;
@@ -252,17 +424,30 @@ bool CMux::on_header(CMuxFrame &frame)
     type = frame_header[2];
     // Sanity check for expected values of DLCI and type,
     // since CRC could be evaluated after the frame payload gets received
-    if (dlci > MAX_TERMINALS_NUM || (frame_header[1] & 0x01) == 0 ||
-            (((type & FT_UIH) != FT_UIH) &&  type != (FT_UA | PF))) {
+    if (dlci > dlcs.size() || (frame_header[1] & 0x01) == 0 ||
+            (!is_info_frame(type) &&  type != (FT_UA | PF) && (type & ~PF) != FT_DM)) {
         recover_protocol(protocol_mismatch_reason::UNEXPECTED_HEADER);
         return true;
     }
     payload_len += (frame_header[3] >> 1);
+    ctrl_msg_len = 0;
+    // Start the FCS over address, control and length fields, before the 2nd length byte gets overwritten
+    rx_fcs = CMuxFcs::update(CMuxFcs::INIT, frame_header + 1, 2 + length_bytes);
     frame.advance(payload_offset);
     state = cmux_state::PAYLOAD;
     return true;
 }
 
+void CMux::update_payload_fcs(const uint8_t *data, size_t len)
+{
+#ifdef CONFIG_ESP_MODEM_CMUX_VERIFY_FCS
+    // Only UI frames protect their payload, UIH frames check the header only
+    if ((type & ~PF) == FT_UI) {
+        rx_fcs = CMuxFcs::update(rx_fcs, data, len);
+    }
+#endif
+}
+
 bool CMux::on_payload(CMuxFrame &frame)
 {
     ESP_LOGD("CMUX", "Payload frame: dlci:%02x type:%02x payload:%" PRIsize_t " available:%" PRIsize_t, dlci, type, payload_len, frame.len);
@@ -272,10 +457,12 @@ bool CMux::on_payload(CMuxFrame &frame)
             recover_protocol(protocol_mismatch_reason::UNEXPECTED_DATA);
             return true;
         }
+        update_payload_fcs(frame.ptr, frame.len);
         payload_len -= frame.len;
         return false;
     } else { // complete
         if (payload_len > 0) {
+            update_payload_fcs(frame.ptr, payload_len);
             if (!data_available(&frame.ptr[0], payload_len)) { // rest read
                 recover_protocol(protocol_mismatch_reason::UNEXPECTED_DATA);
                 return true;
@@ -302,9 +489,8 @@ bool CMux::on_footer(CMuxFrame &frame)
             recover_protocol(protocol_mismatch_reason::MISSED_TRAIL_SOF);
             return true;
         }
-#ifdef ESP_MODEM_CMUX_USE_SHORT_PAYLOADS_ONLY
-        uint8_t crc = 0xFF - fcs_crc(frame_header);
-        if (crc != frame_header[4]) {
+#ifdef CONFIG_ESP_MODEM_CMUX_VERIFY_FCS
+        if (CMuxFcs::update(rx_fcs, &frame_header[4], 1) != CMuxFcs::GOOD) {
             recover_protocol(protocol_mismatch_reason::WRONG_CRC);
             return true;
         }
@@ -397,40 +583,109 @@ bool CMux::on_cmux_data(uint8_t *data, size_t actual_len)
     return true;
 }
 
-bool CMux::deinit()
+bool CMux::wait_for(const std::function<bool()> &done, uint32_t time_ms)
 {
-    int timeout;
-    sabm_ack = -1;
-    // First disconnect all (2) virtual terminals
-    for (size_t i = 1; i < 3; i++) {
-        send_disconnect(i);
-        timeout = 0;
-        while (true) {
-            usleep(10'000);
-            Scoped<Lock> l(lock);
-            if (sabm_ack == i) {
-                sabm_ack = -1;
-                break;
-            }
-            if (timeout++ > 100) {
-                return false;
-            }
+    // The state is changed under the lock and every change is broadcast, so all the waiters re-check it
+    Scoped<Lock> l(lock);
+    return dlc_changed.wait_for(lock, std::chrono::milliseconds(time_ms), done);
+}
+
+void CMux::negotiate_dlcs(uint64_t dlcis)
+{
+    {
+        Scoped<Lock> l(lock);
+        if (pn_unsupported) {
+            dlcis = 0;
         }
     }
-    sabm_ack = -1;
-    // Then disconnect the control terminal
-    send_disconnect(0);
-    timeout = 0;
-    while (true) {
-        usleep(10'000);
-        Scoped<Lock> l(lock);
-        if (sabm_ack == 0) {
-            break;
+    for (size_t i = 1; i <= dlcs.size(); i++) {
+        if (dlcis & dlci_bit(i)) {
+            send_pn(i);
+        }
+    }
+    bool answered = dlcis == 0 || wait_for([&] { return (dlc_pn & dlcis) == dlcis || pn_unsupported; }, RESPONSE_TIMEOUT_MS);
+    Scoped<Lock> l(lock);
+    if (!answered) {
+        // Do not delay opening the remaining DLCs if the module ignores PN
+        pn_unsupported = true;
+    }
+    for (size_t i = 1; i <= dlcs.size(); i++) {
+        if ((dlcis & dlci_bit(i)) == 0) {
+            continue;
         }
-        if (timeout++ > 100) {
+        if (dlc_pn & dlci_bit(i)) {
+            ESP_LOGD("CMUX", "DLCI %" PRIsize_t " uses frame size %" PRIsize_t, i, dlcs[i - 1].frame_size);
+        } else {
+            // Not negotiated, fall back to the default frame size
+            ESP_LOGW("CMUX", "DLC parameter negotiation not supported, using defaults for DLCI %" PRIsize_t, i);
+            dlcs[i - 1].frame_size = std::min<size_t>(dlcs[i - 1].frame_size, TX_PAYLOAD_MAX);
+        }
+    }
+}
+
+bool CMux::open_dlcs(uint64_t dlcis)
+{
+    for (size_t i = 0; i <= dlcs.size(); i++) {
+        if (dlcis & dlci_bit(i)) {
+            send_sabm(i);
+        }
+    }
+    if (!wait_for([&] { return ((dlc_ua | dlc_dm) & dlcis) == dlcis; }, RESPONSE_TIMEOUT_MS)) {
+        ESP_LOGE("CMUX", "No response to SABM");
+        return false;
+    }
+    Scoped<Lock> l(lock);
+    if (dlc_dm & dlcis) {
+        ESP_LOGE("CMUX", "DLC refused by the module");
+        return false;
+    }
+    return true;
+}
+
+bool CMux::close_dlcs(uint64_t dlcis)
+{
+    for (size_t i = 1; i <= dlcs.size(); i++) {
+        if (dlcis & dlci_bit(i)) {
+            send_disconnect(i);
+        }
+    }
+    // DM means the DLC has already been closed
+    return wait_for([&] { return ((dlc_ua | dlc_dm) & dlcis) == dlcis; }, RESPONSE_TIMEOUT_MS);
+}
+
+void CMux::settle_dlcs(uint64_t dlcis)
+{
+    // Some devices (SIM800) send MSC just after opening a DLC and fail requests in the meantime,
+    // so wait for their MSC, up to the configured delay
+    if (CONFIG_ESP_MODEM_CMUX_DELAY_AFTER_DLCI_SETUP > 0 && dlcis) {
+        wait_for([&] { return (dlc_msc & dlcis) == dlcis; }, CONFIG_ESP_MODEM_CMUX_DELAY_AFTER_DLCI_SETUP);
+    }
+}
+
+bool CMux::deinit()
+{
+    {
+        Scoped<Lock> l(lock);
+        dlc_ua = dlc_dm = 0;
+        cld_ack = false;
+    }
+    // First disconnect all virtual terminals
+#ifdef CONFIG_ESP_MODEM_CMUX_PIPELINE_SETUP
+    if (!close_dlcs(dlci_range(1, dlcs.size()))) {
+        return false;
+    }
+#else
+    for (size_t i = 1; i <= dlcs.size(); i++) {
+        if (!close_dlcs(dlci_bit(i))) {
             return false;
         }
     }
+#endif
+    // Then disconnect the control terminal
+    send_disconnect(0);
+    if (!wait_for([&] { return cld_ack; }, RESPONSE_TIMEOUT_MS)) {
+        return false;
+    }
     term->set_read_cb(nullptr);
     return true;
 }
@@ -438,7 +693,7 @@ bool CMux::deinit()
 CMux::~CMux()
 {
     // The underlying terminal's RX task drives on_cmux_data(), which touches CMux state (lock,
-    // buffer, read_cb[]). Detach it before that state is destroyed, otherwise a late RX event
+    // buffer, read callbacks). Detach it before that state is destroyed, otherwise a late RX event
     // would use this CMux after free. set_read_cb()/set_error_cb() are synchronized against the
     // RX task, so once they return no callback is in flight.
     if (term) {
@@ -447,78 +702,154 @@ CMux::~CMux()
     }
 }
 
+CMux::CMux(std::shared_ptr<Terminal> t, unique_buffer &&b, const std::vector<CMuxTermConfig> &terms):
+    term(std::move(t)), payload_start(nullptr), total_payload_size(0), ctrl_msg_len(0),
+    dlc_ua(0), dlc_dm(0), dlc_pn(0), dlc_msc(0), pn_unsupported(false), cld_ack(false),
+    rx_paused(0), tx_paused(0), tx_paused_all(false), buffer(std::move(b))
+{
+    for (size_t i = 0; i < terms.size() && i < CMUX_MAX_TERMINALS; i++) {
+        dlcs.push_back({terms[i], 0, nullptr});
+    }
+}
+
+size_t CMux::frame_size(int i)
+{
+    Scoped<Lock> l(lock);
+    return i >= 0 && i < dlcs.size() ? dlcs[i].frame_size : 0;
+}
+
 bool CMux::init()
 {
     frame_header_offset = 0;
     state = cmux_state::INIT;
+    // Start from the requested frame sizes, PN responses may lower them
+    size_t max_frame_size = 0;
+    for (auto &dlc : dlcs) {
+        dlc.frame_size = dlc.config.frame_size ? std::min<size_t>(dlc.config.frame_size, TX_PAYLOAD_MAX_NEGOTIATED) : TX_PAYLOAD_MAX;
+        max_frame_size = std::max(max_frame_size, dlc.frame_size);
+    }
+    if (tx_frame == nullptr) {
+        tx_frame = std::make_unique<uint8_t[]>(max_frame_size + FRAME_OVERHEAD_MAX);
+    }
     term->set_read_cb([this](uint8_t *data, size_t len) {
         this->on_cmux_data(data, len);
         return false;
     });
 
-    sabm_ack = -1;
-    for (size_t i = 0; i < 3; i++) {
-        int timeout = 0;
-        send_sabm(i);
-        while (true) {
-            usleep(10'000);
-            Scoped<Lock> l(lock);
-            if (sabm_ack == i) {
-                sabm_ack = -1;
-                break;
-            }
-            if (timeout++ > 100) {
-                return false;
-            }
+    {
+        Scoped<Lock> l(lock);
+        dlc_ua = dlc_dm = dlc_pn = dlc_msc = 0;
+        rx_paused = tx_paused = 0;
+        pn_unsupported = cld_ack = tx_paused_all = false;
+    }
+    // DLCs requesting parameter negotiation
+    uint64_t pn_dlcis = 0;
+    for (size_t i = 1; i <= dlcs.size(); i++) {
+        if (dlcs[i - 1].config.frame_size) {
+            pn_dlcis |= dlci_bit(i);
+        }
+    }
+    // The control channel has to be open first
+    if (!open_dlcs(dlci_bit(0))) {
+        return false;
+    }
+#ifdef CONFIG_ESP_MODEM_CMUX_PIPELINE_SETUP
+    negotiate_dlcs(pn_dlcis);
+    if (!open_dlcs(dlci_range(1, dlcs.size()))) {
+        return false;
+    }
+    settle_dlcs(dlci_range(2, dlcs.size()));
+#else
+    for (size_t i = 1; i <= dlcs.size(); i++) {
+        negotiate_dlcs(pn_dlcis & dlci_bit(i));
+        if (!open_dlcs(dlci_bit(i))) {
+            return false;
         }
-        if (i > 1) {    // wait for each virtual terminal to settle MSC (no need for control term, DLCI=0)
-            usleep(CONFIG_ESP_MODEM_CMUX_DELAY_AFTER_DLCI_SETUP * 1'000);
+        if (i > 1) {    // wait for each virtual terminal to settle MSC (no need for the first one)
+            settle_dlcs(dlci_bit(i));
         }
     }
+#endif
     return true;
 }
 
 int CMux::write(int virtual_term, uint8_t *data, size_t len)
 {
-    const size_t cmux_max_len = 127;
-    Scoped<Lock> l(lock);
+    if (virtual_term < 0 || virtual_term >= dlcs.size()) {
+        return -1;
+    }
     int i = virtual_term + 1;
+    {
+        // The CMux terminals may outlive the CMUX mode, which hands the original terminal back
+        Scoped<Lock> l(lock);
+        if (!term) {
+            return -1;
+        }
+    }
+    // Hold the frames while the module cannot accept them, but not forever, it might have missed our frames
+    if (!wait_for([&] { return !tx_paused_all && (tx_paused & dlci_bit(i)) == 0; }, TX_FLOW_TIMEOUT_MS)) {
+        ESP_LOGW("CMUX", "DLCI %d held by flow control for too long, sending anyway", i);
+    }
+    Scoped<Lock> l(lock);
+    if (!term) {
+        return -1;
+    }
+    size_t max_batch = dlcs[virtual_term].frame_size;
     size_t need_write = len;
+    uint8_t *frame = tx_frame.get();
     while (need_write > 0) {
-        size_t batch_len = need_write;
-        if (batch_len > cmux_max_len) {
-            batch_len = cmux_max_len;
-        }
-        uint8_t frame[6];
+        size_t batch_len = std::min<size_t>(need_write, max_batch);
+        size_t header_len = 4;
         frame[0] = SOF_MARKER;
         frame[1] = (i << 2) + 1;
         frame[2] = FT_UIH;
-        frame[3] = (batch_len << 1) + 1;
-        frame[4] = 0xFF - fcs_crc(frame);
-        frame[5] = SOF_MARKER;
-
-        term->write(frame, 4);
-        term->write(data, batch_len);
-        term->write(frame + 4, 2);
-        ESP_LOG_BUFFER_HEXDUMP("Send", frame, 4, ESP_LOG_VERBOSE);
-        ESP_LOG_BUFFER_HEXDUMP("Send", data, batch_len, ESP_LOG_VERBOSE);
-        ESP_LOG_BUFFER_HEXDUMP("Send", frame + 4, 2, ESP_LOG_VERBOSE);
+        if (batch_len > SHORT_PAYLOAD_MAX) {
+            // 2-byte length field: EA bit cleared, the second octet holds the upper bits
+            frame[3] = (batch_len & 0x7F) << 1;
+            frame[4] = batch_len >> 7;
+            header_len = 5;
+        } else {
+            frame[3] = (batch_len << 1) + 1;
+        }
+        memcpy(frame + header_len, data, batch_len);
+        frame[header_len + batch_len] = CMuxFcs::calc(frame + 1, header_len - 1);
+        frame[header_len + batch_len + 1] = SOF_MARKER;
+
+        // Emit the whole frame in one write, not to interleave header, payload and footer on the wire
+        size_t frame_len = header_len + batch_len + 2;
+        term->write(frame, frame_len);
+        ESP_LOG_BUFFER_HEXDUMP("Send", frame, frame_len, ESP_LOG_VERBOSE);
         need_write -= batch_len;
         data += batch_len;
     }
     return len;
 }
 
+void CMux::pause_rx(int inst, bool pause)
+{
+    Scoped<Lock> l(lock);
+    if (inst < 0 || inst >= dlcs.size()) {
+        return;
+    }
+    size_t i = inst + 1;
+    if (!term || ((rx_paused & dlci_bit(i)) != 0) == pause) {
+        return;     // already requested
+    }
+    rx_paused ^= dlci_bit(i);
+    send_msc(i, pause);
+}
+
 void CMux::set_read_cb(int inst, std::function<bool(uint8_t *, size_t)> f)
 {
     Scoped<Lock> l(cb_lock);
-    if (inst < MAX_TERMINALS_NUM) {
-        read_cb[inst] = std::move(f);
+    if (inst < dlcs.size()) {
+        dlcs[inst].read_cb = std::move(f);
     }
 }
 
 std::pair<std::shared_ptr<Terminal>, unique_buffer> CMux::detach()
 {
+    Scoped<Lock> l(lock);
     return std::make_pair(std::move(term), std::move(buffer));
 }
 
@@ -528,6 +859,7 @@ void esp_modem::CMux::recover_protocol(protocol_mismatch_reason reason)
     payload_start = nullptr;
     total_payload_size = 0;
     frame_header_offset = 0;
+    ctrl_msg_len = 0;
     state = cmux_state::RECOVER;
 }
 
@@ -18,10 +18,35 @@ namespace esp_modem::dce_commands {
 
 static const char *TAG = "command_lib";
 
+static constexpr ResponseMatcher ok_error({"OK"}, {"ERROR"});
+
 command_result generic_command(CommandableIf *t, const std::string &command,
-                               const std::list<std::string_view> &pass_phrase,
-                               const std::list<std::string_view> &fail_phrase,
-                               uint32_t timeout_ms)
+                               const ResponseMatcher &matcher, uint32_t timeout_ms)
+{
+    ESP_LOGD(TAG, "%s command %s\n", __func__, command.c_str());
+    return t->command_until(command, matcher, timeout_ms);
+}
+
+/*
+ * Phrases supplied at runtime may not fit into the automaton of ResponseMatcher,
+ * such commands search the replies for each of the phrases instead
+ */
+static bool fit_matcher(const std::list<std::string_view> &pass_phrase, const std::list<std::string_view> &fail_phrase)
+{
+    size_t len = 0;
+    for (auto &phrase : pass_phrase) {
+        len += phrase.size();
+    }
+    for (auto &phrase : fail_phrase) {
+        len += phrase.size();
+    }
+    return len < ResponseMatcher::max_nodes;
+}
+
+static command_result generic_command_find(CommandableIf *t, const std::string &command,
+                                           const std::list<std::string_view> &pass_phrase,
+                                           const std::list<std::string_view> &fail_phrase,
+                                           uint32_t timeout_ms)
 {
     ESP_LOGD(TAG, "%s command %s\n", __func__, command.c_str());
     return t->command(command, [&](uint8_t *data, size_t len) {
@@ -40,7 +65,19 @@ command_result generic_command(CommandableIf *t, const std::string &command,
             }
         return command_result::TIMEOUT;
     }, timeout_ms);
+}
 
+command_result generic_command(CommandableIf *t, const std::string &command,
+                               const std::list<std::string_view> &pass_phrase,
+                               const std::list<std::string_view> &fail_phrase,
+                               uint32_t timeout_ms)
+{
+    ESP_LOGV(TAG, "%s", __func__);
+    if (!fit_matcher(pass_phrase, fail_phrase)) {
+        return generic_command_find(t, command, pass_phrase, fail_phrase, timeout_ms);
+    }
+    const ResponseMatcher matcher(pass_phrase, fail_phrase);
+    return generic_command(t, command, matcher, timeout_ms);
 }
 
 command_result generic_command(CommandableIf *t, const std::string &command,
@@ -48,8 +85,8 @@ command_result generic_command(CommandableIf *t, const std::string &command,
                                const std::string &fail_phrase, uint32_t timeout_ms)
 {
     ESP_LOGV(TAG, "%s", __func__);
-    const auto pass = std::list<std::string_view>({pass_phrase});
-    const auto fail = std::list<std::string_view>({fail_phrase});
+    const std::list<std::string_view> pass({pass_phrase});
+    const std::list<std::string_view> fail({fail_phrase});
     return generic_command(t, command, pass, fail, timeout_ms);
 }
 
@@ -94,10 +131,8 @@ template <typename T> command_result generic_get_string(CommandableIf *t, const
             }
             ESP_LOGV(TAG, "Token: {%.*s}\n", static_cast<int>(token.size()), token.data());
 
-            if (token.find("OK") != std::string::npos) {
-                return command_result::OK;
-            } else if (token.find("ERROR") != std::string::npos) {
-                return command_result::FAIL;
+            if (auto result = ok_error.match(token); result != command_result::TIMEOUT) {
+                return result;
             } else if (token.size() > 2) {
                 if (!str_copy::set(output, token)) {
                     return command_result::FAIL;
@@ -112,7 +147,7 @@ template <typename T> command_result generic_get_string(CommandableIf *t, const
 command_result generic_command_common(CommandableIf *t, const std::string &command, uint32_t timeout_ms)
 {
     ESP_LOGV(TAG, "%s", __func__);
-    return generic_command(t, command, "OK", "ERROR", timeout_ms);
+    return generic_command(t, command, ok_error, timeout_ms);
 }
 
 command_result sync(CommandableIf *t)
@@ -317,9 +352,8 @@ command_result resume_data_mode(CommandableIf *t)
 command_result set_command_mode(CommandableIf *t)
 {
     ESP_LOGV(TAG, "%s", __func__);
-    const auto pass = std::list<std::string_view>({"NO CARRIER", "OK"});
-    const auto fail = std::list<std::string_view>({"ERROR"});
-    return generic_command(t, "+++", pass, fail, 5000);
+    static constexpr ResponseMatcher matcher({"NO CARRIER", "OK"}, {"ERROR"});
+    return generic_command(t, "+++", matcher, 5000);
 }
 
 command_result get_imsi(CommandableIf *t, std::string &imsi_number)
@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <memory>
+#include "cxx_include/esp_modem_command_queue.hpp"
+#include "esp_log.h"
+
+static const char *TAG = "command_queue";
+
+namespace esp_modem {
+
+CommandQueue::CommandQueue(CommandableIf *t, size_t stack_size, size_t priority) :
+    term(t), signal(),
+    task_handle(stack_size, priority, this, [](void *p)
+{
+    auto q = static_cast<CommandQueue *>(p);
+    q->task();
+    // task() returns only after the destructor requested it, this is the last access to any member
+    q->signal.set(TASK_STOPPED);
+#if !defined(CONFIG_IDF_TARGET_LINUX)
+    // FreeRTOS: a task function must not return, idle until the Task destructor deletes us
+    while (true) {
+        Task::Delay(3600 * 1000);
+    }
+#endif
+})
+{}
+
+CommandQueue::~CommandQueue()
+{
+    signal.set(TASK_STOP);
+    // the request in progress finishes first, so wait for the task regardless of the time it takes
+    signal.wait_any(TASK_STOPPED, portMAX_DELAY);
+    std::deque<request> cancelled;
+    {
+        Scoped<Lock> l(queue_lock);
+        cancelled.swap(queue);
+    }
+    for (auto &req : cancelled) {
+        req.done(command_result::FAIL);
+    }
+}
+
+void CommandQueue::push(request req)
+{
+    {
+        Scoped<Lock> l(queue_lock);
+        queue.push_back(std::move(req));
+    }
+    signal.set(QUEUED);
+}
+
+std::future<command_result> CommandQueue::submit(job_cb job)
+{
+    auto promise = std::make_shared<std::promise<command_result>>();
+    auto future = promise->get_future();
+    push({std::move(job), [promise](command_result result) {
+        promise->set_value(result);
+    }});
+    return future;
+}
+
+void CommandQueue::submit(job_cb job, done_cb done)
+{
+    push({std::move(job), std::move(done)});
+}
+
+std::future<command_result> CommandQueue::command(const std::string &command, got_line_cb got_line, uint32_t time_ms, char separator)
+{
+    return submit([command, got_line = std::move(got_line), time_ms, separator](CommandableIf * t) {
+        return t->command(command, got_line, time_ms, separator);
+    });
+}
+
+std::future<command_result> CommandQueue::batch(std::vector<job_cb> jobs)
+{
+    return submit([jobs = std::move(jobs)](CommandableIf * t) {
+        auto ret = command_result::OK;
+        for (auto &job : jobs) {
+            auto res = job(t);
+            if (ret == command_result::OK) {
+                ret = res;
+            }
+        }
+        return ret;
+    });
+}
+
+size_t CommandQueue::pending()
+{
+    Scoped<Lock> l(queue_lock);
+    return queue.size();
+}
+
+void CommandQueue::task()
+{
+    while (true) {
+        signal.wait_any(QUEUED | TASK_STOP, portMAX_DELAY);
+        if (signal.is_any(TASK_STOP)) {
+            return;
+        }
+        request req;
+        {
+            Scoped<Lock> l(queue_lock);
+            if (queue.empty()) {
+                // cleared under the lock, so a concurrent push() sets the bit again
+                signal.clear(QUEUED);
+                continue;
+            }
+            req = std::move(queue.front());
+            queue.pop_front();
+        }
+        auto result = req.job(term);
+        ESP_LOGD(TAG, "Request finished with %d", static_cast<int>(result));
+        req.done(result);
+    }
+}
+
+} // namespace esp_modem
@@ -1,15 +1,15 @@
 /*
- * SPDX-FileCopyrightText: 2021-2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <list>
 #include <unistd.h>
 #include <cstring>
 
 #include "cxx_include/esp_modem_dte.hpp"
 #include "cxx_include/esp_modem_dce.hpp"
+#include "cxx_include/esp_modem_response_matcher.hpp"
 #include "esp_log.h"
 
 namespace esp_modem {
@@ -31,15 +31,14 @@ static bool exit_data(DTE &dte, ModuleIf &device, Netif &netif)
         if (memchr(data, '\n', len))
         {
             ESP_LOG_BUFFER_HEXDUMP("esp-modem: debug_data (CMD)", data, len, ESP_LOG_DEBUG);
-            const auto pass = std::list<std::string_view>({"NO CARRIER", "DISCONNECTED", "OK"});
+            static constexpr ResponseMatcher exited({"NO CARRIER", "DISCONNECTED", "OK"});
             std::string_view response((char *) data, len);
-            for (auto &it : pass)
-                if (response.find(it) != std::string::npos) {
-                    if (auto signal = weak_signal.lock()) {
-                        signal->set(1);
-                    }
-                    return true;
+            if (exited.match(response) == command_result::OK) {
+                if (auto signal = weak_signal.lock()) {
+                    signal->set(1);
                 }
+                return true;
+            }
         }
         return false;
     });
@@ -17,6 +17,7 @@ static const size_t dte_default_buffer_size = 1000;
 DTE::DTE(const esp_modem_dte_config *config, std::unique_ptr<Terminal> terminal)
     : buffer(config->dte_buffer_size),
       cmux_term(nullptr),
+      cmux_config(MAX_TERMINALS_NUM),
       primary_term(std::move(terminal)),
       secondary_term(primary_term),
       mode(modem_mode::UNDEF)
@@ -28,6 +29,7 @@ DTE::DTE(const esp_modem_dte_config *config, std::unique_ptr<Terminal> terminal)
 DTE::DTE(std::unique_ptr<Terminal> terminal)
     : buffer(dte_default_buffer_size),
       cmux_term(nullptr),
+      cmux_config(MAX_TERMINALS_NUM),
       primary_term(std::move(terminal)),
       secondary_term(primary_term),
       mode(modem_mode::UNDEF)
@@ -39,6 +41,7 @@ DTE::DTE(std::unique_ptr<Terminal> terminal)
 DTE::DTE(const esp_modem_dte_config *config, std::unique_ptr<Terminal> t, std::unique_ptr<Terminal> s)
     : buffer(config->dte_buffer_size),
       cmux_term(nullptr),
+      cmux_config(MAX_TERMINALS_NUM),
       primary_term(std::move(t)),
       secondary_term(std::move(s)),
       mode(modem_mode::DUAL_MODE)
@@ -51,6 +54,7 @@ DTE::DTE(const esp_modem_dte_config *config, std::unique_ptr<Terminal> t, std::u
 DTE::DTE(std::unique_ptr<Terminal> t, std::unique_ptr<Terminal> s)
     : buffer(dte_default_buffer_size),
       cmux_term(nullptr),
+      cmux_config(MAX_TERMINALS_NUM),
       primary_term(std::move(t)),
       secondary_term(std::move(s)),
       mode(modem_mode::DUAL_MODE)
@@ -92,11 +96,17 @@ void DTE::set_command_callbacks()
         update_buffer_state(len);
 #endif
 #ifndef CONFIG_ESP_MODEM_URC_HANDLER
-        if (command_cb.got_line == nullptr || command_cb.result != command_result::TIMEOUT) {
+        if (!command_cb.waiting()) {
             return false;   // this line has been processed already (got OK or FAIL previously)
         }
 #endif
         if (data) {
+#ifndef CONFIG_ESP_MODEM_URC_HANDLER
+            if (command_cb.matcher) {
+                // the matcher keeps its state between fragments, no need to defragment the reply
+                return command_cb.process_line(data, 0, len, this);
+            }
+#endif
             // For terminals which post data directly with the callback (CMUX)
             // we cannot defragment unless we allocate, but
             // we'll try to process the data on the actual buffer
@@ -134,6 +144,11 @@ void DTE::set_command_callbacks()
             if (command_cb.process_line(data, buffer.consumed, len, this)) {
                 return true;
             }
+#ifndef CONFIG_ESP_MODEM_URC_HANDLER
+            if (command_cb.matcher) {
+                return false;   // the matcher has seen this data already, reuse the buffer for the next chunk
+            }
+#endif
             buffer.consumed += len;
             return false;
         }
@@ -176,12 +191,24 @@ void DTE::set_command_callbacks()
 command_result DTE::command(const std::string &command, got_line_cb got_line, uint32_t time_ms, const char separator)
 {
     Scoped<Lock> l1(internal_lock);
+    command_cb.set(got_line, separator);
+    return send_and_wait(command, time_ms);
+}
+
+command_result DTE::command_until(const std::string &command, const ResponseMatcher &matcher, uint32_t time_ms)
+{
+    Scoped<Lock> l1(internal_lock);
+    command_cb.set_matcher(&matcher);
+    return send_and_wait(command, time_ms);
+}
+
+command_result DTE::send_and_wait(const std::string &command, uint32_t time_ms)
+{
 #ifdef CONFIG_ESP_MODEM_URC_HANDLER
     // Track command start
     buffer_state.command_waiting = true;
     buffer_state.command_start_offset = buffer_state.total_processed;
 #endif
-    command_cb.set(got_line, separator);
     primary_term->write((uint8_t *)command.c_str(), command.length());
     command_cb.wait_for_line(time_ms);
     command_cb.set(nullptr);
@@ -233,7 +260,7 @@ bool DTE::setup_cmux()
         ESP_LOGE("esp_modem_dte", "Cannot setup_cmux(), cmux_term already exists");
         return false;
     }
-    cmux_term = std::make_shared<CMux>(primary_term, std::move(buffer));
+    cmux_term = std::make_shared<CMux>(primary_term, std::move(buffer), cmux_config);
     if (cmux_term == nullptr) {
         return false;
     }
@@ -255,6 +282,26 @@ bool DTE::setup_cmux()
     return true;
 }
 
+bool DTE::set_cmux_terminals(std::vector<CMuxTermConfig> terms)
+{
+    if (terms.size() < MAX_TERMINALS_NUM || terms.size() > CMUX_MAX_TERMINALS) {
+        ESP_LOGE("esp_modem_dte", "Invalid number of CMUX terminals: %d", static_cast<int>(terms.size()));
+        return false;
+    }
+    Scoped<Lock> l(internal_lock);
+    cmux_config = std::move(terms);
+    return true;
+}
+
+std::shared_ptr<Terminal> DTE::get_cmux_terminal(size_t i)
+{
+    Scoped<Lock> l(internal_lock);
+    if (!cmux_term || i < MAX_TERMINALS_NUM || i >= cmux_term->terminals()) {
+        return nullptr;
+    }
+    return std::make_shared<CMuxInstance>(cmux_term, i);
+}
+
 bool DTE::set_mode(modem_mode m)
 {
     // transitions (any) -> UNDEF
@@ -353,6 +400,11 @@ void DTE::set_error_cb(std::function<void(terminal_error err)> f)
     set_command_callbacks();
 }
 
+void DTE::pause_rx(bool pause)
+{
+    secondary_term->pause_rx(pause);
+}
+
 int DTE::read(uint8_t **d, size_t len)
 {
     auto data_to_read = std::min(len, buffer.size);
@@ -431,6 +483,13 @@ bool DTE::command_cb::process_line(uint8_t *data, size_t consumed, size_t len, D
             data += consume_info.consume_size;
             consumed = (consumed + len) - consume_info.consume_size;
             len = 0;
+            if (matcher) {
+                // the matcher might have seen the consumed URC, rescan what's left of the reply
+                cursor = 0;
+                matched = command_result::TIMEOUT;
+                len = consumed;
+                consumed = 0;
+            }
             break;
 
         case UrcConsumeResult::CONSUME_ALL:
@@ -443,17 +502,32 @@ bool DTE::command_cb::process_line(uint8_t *data, size_t consumed, size_t len, D
     // Fallback to legacy URC handler if enhanced handler not set
     if (urc_handler) {
         bool consume_buffer = urc_handler(data, consumed + len) != command_result::TIMEOUT;
-        if (result != command_result::TIMEOUT || got_line == nullptr) {
+        if (!waiting()) {
             return consume_buffer;   // this line has been processed already (got OK or FAIL previously)
         }
     }
 #endif
 
     // Continue with normal command processing
-    if (result != command_result::TIMEOUT || got_line == nullptr) {
+    if (!waiting()) {
         return false;  // Command processing continues
     }
 
+    if (matcher) {
+        // scan only the new data, the matcher keeps its state from the previous chunks
+        auto found = matcher->feed(std::string_view((char *)data + consumed, len), cursor);
+        if (found != command_result::TIMEOUT && matched != command_result::OK) {
+            matched = found;
+        }
+        // report the result on the end of line, as the line callbacks do
+        if (matched != command_result::TIMEOUT && memchr(data + consumed, separator, len)) {
+            result = matched;
+            signal.set(GOT_LINE);
+            return true;
+        }
+        return false;
+    }
+
     if (memchr(data + consumed, separator, len)) {
         result = got_line(data, consumed + len);
         if (result == command_result::OK || result == command_result::FAIL) {
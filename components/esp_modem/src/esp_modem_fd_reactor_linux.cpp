@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include "cxx_include/esp_modem_exception.hpp"
+#include "fd_reactor.hpp"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "fd_reactor";
+
+namespace esp_modem {
+
+FdReactor &FdReactor::get()
+{
+    // Never destroyed, terminals might be stopped from destructors of static objects
+    static FdReactor *reactor = new FdReactor();
+    return *reactor;
+}
+
+FdReactor::FdReactor(): epoll_fd(epoll_create1(EPOLL_CLOEXEC))
+{
+    ESP_MODEM_THROW_IF_FALSE(epoll_fd >= 0, "Failed to create epoll instance");
+    for (int i = 0; i < CONFIG_ESP_MODEM_LINUX_FD_REACTOR_THREADS; i++) {
+        threads.push_back(std::make_unique<Task>(0, 0, this, [](void *p) {
+            static_cast<FdReactor *>(p)->worker();
+        }));
+    }
+}
+
+void FdReactor::arm(int fd, int op)
+{
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, op, fd, &ev) < 0 && op == EPOLL_CTL_ADD) {
+        ESP_MODEM_THROW_IF_FALSE(false, "Failed to add descriptor to epoll");
+    }
+}
+
+std::shared_ptr<FdReactor::watch> FdReactor::find(int fd)
+{
+    Scoped<Lock> l(lock);
+    auto it = watches.find(fd);
+    return it == watches.end() ? nullptr : it->second;
+}
+
+void FdReactor::add(int fd, ready_cb on_ready)
+{
+    auto w = std::make_shared<watch>();
+    w->fd = fd;
+    w->on_ready = std::move(on_ready);
+    {
+        Scoped<Lock> l(lock);
+        watches[fd] = w;
+    }
+    arm(fd, EPOLL_CTL_ADD);
+}
+
+void FdReactor::remove(int fd)
+{
+    std::shared_ptr<watch> w;
+    {
+        Scoped<Lock> l(lock);
+        auto it = watches.find(fd);
+        if (it == watches.end()) {
+            return;
+        }
+        w = std::move(it->second);
+        watches.erase(it);
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    // wait for the callback in progress (if any), it might have fetched the event before removal
+    Scoped<Lock> l(w->lock);
+    w->removed = true;
+}
+
+void FdReactor::resume(int fd)
+{
+    // Must not take the watch lock, resume() is called from writes, which could be waiting
+    // for the same lock as the callback in progress
+    auto w = find(fd);
+    if (w == nullptr) {
+        return;
+    }
+    w->resumes.fetch_add(1);
+    if (w->parked.exchange(false)) {
+        arm(fd, EPOLL_CTL_MOD);
+    }
+}
+
+void FdReactor::dispatch(int fd, uint32_t events)
+{
+    auto w = find(fd);
+    if (w == nullptr) {
+        return;
+    }
+    Scoped<Lock> l(w->lock);
+    if (w->removed) {
+        return;
+    }
+    int available = 0;
+    if (ioctl(fd, FIONREAD, &available) < 0) {
+        // unknown amount of data, let the callback read and rearm, as with level-triggered events
+        w->on_ready();
+        arm(fd, EPOLL_CTL_MOD);
+        return;
+    }
+    if (available == 0 && (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+        ESP_LOGW(TAG, "Descriptor %d has been closed by peer", fd);
+        return;     // leave disarmed, there's nothing to read anymore
+    }
+    while (available > 0) {
+        uint32_t resumes = w->resumes.load();
+        if (w->on_ready() == 0) {
+            // the data is not wanted now, park until the terminal resumes it
+            w->parked = true;
+            if (w->resumes.load() != resumes && w->parked.exchange(false)) {
+                arm(fd, EPOLL_CTL_MOD);     // resumed while we were deciding to park
+            }
+            return;
+        }
+        if (ioctl(fd, FIONREAD, &available) < 0) {
+            break;
+        }
+    }
+    arm(fd, EPOLL_CTL_MOD);
+}
+
+void FdReactor::worker()
+{
+    struct epoll_event events[16];
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+        if (n < 0) {
+            if (errno != EINTR) {
+                ESP_LOGE(TAG, "epoll_wait failed: %d", errno);
+                Task::Delay(100);
+            }
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            dispatch(events[i].data.fd, events[i].events);
+        }
+    }
+}
+
+} // namespace esp_modem
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2025 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,6 +13,7 @@
 #include "cxx_include/esp_modem_netif.hpp"
 #include "cxx_include/esp_modem_dte.hpp"
 #include "esp_netif_ppp.h"
+#include "lwip/tcpip.h"
 
 namespace esp_modem {
 
@@ -66,7 +67,32 @@ esp_err_t Netif::esp_modem_post_attach(esp_netif_t *esp_netif, void *args)
 
 void Netif::receive(uint8_t *data, size_t len)
 {
-    esp_netif_receive(driver.base.netif, data, len, nullptr);
+    rx_chunks.fetch_add(1, std::memory_order_relaxed);
+    // PPP netif copies the data into a pbuf, so the DTE buffer can be reused when this returns
+    if (esp_netif_receive(driver.base.netif, data, len, nullptr) != ESP_OK) {
+        rx_dropped.fetch_add(len, std::memory_order_relaxed);
+        throttle_rx();
+        return;
+    }
+    rx_bytes.fetch_add(len, std::memory_order_relaxed);
+}
+
+void Netif::throttle_rx()
+{
+    // The network stack is out of pbufs (or its input queue is full), so ask the modem to hold the data
+    // until the TCP/IP task has processed the packets queued so far, instead of dropping whole frames.
+    // Resume from the TCP/IP task: waiting for it here would deadlock if it was writing to the DTE,
+    // as the writer might wait for the terminal task (e.g. CMUX flow control)
+    ppp_dte->pause_rx(true);
+    auto dte = new std::shared_ptr<DTE>(ppp_dte);
+    auto resume = [](void *ctx) {
+        auto dte = static_cast<std::shared_ptr<DTE> *>(ctx);
+        (*dte)->pause_rx(false);
+        delete dte;
+    };
+    if (tcpip_try_callback(resume, dte) != ERR_OK) {
+        resume(dte);
+    }
 }
 
 Netif::Netif(std::shared_ptr<DTE> e, esp_netif_t *ppp_netif) :
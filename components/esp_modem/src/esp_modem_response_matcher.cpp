@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "cxx_include/esp_modem_response_matcher.hpp"
+#include "cxx_include/esp_modem_exception.hpp"
+
+namespace esp_modem {
+
+command_result ResponseMatcher::feed(std::string_view data, cursor &c) const
+{
+    uint8_t found = 0;
+    uint8_t n = c;
+    for (char symbol : data) {
+        uint8_t next;
+        while ((next = child(n, symbol)) == none && n != none) {
+            n = nodes[n].fail;
+        }
+        n = next;
+        found |= nodes[n].out;
+        if (found & PASS) {
+            // pass phrases take precedence, no need to scan further
+            break;
+        }
+    }
+    c = n;
+    if (found & PASS) {
+        return command_result::OK;
+    }
+    return (found & FAIL) ? command_result::FAIL : command_result::TIMEOUT;
+}
+
+command_result CommandableIf::command_until(const std::string &cmd, const ResponseMatcher &matcher, uint32_t time_ms)
+{
+    return command(cmd, [&matcher](uint8_t *data, size_t len) {
+        if (data == nullptr || len == 0) {
+            return command_result::TIMEOUT;
+        }
+        return matcher.match(std::string_view((char *)data, len));
+    }, time_ms);
+}
+
+void ResponseMatcher::throw_too_long()
+{
+    ESP_MODEM_THROW_IF_FALSE(false, "Phrases too long for the response matcher");
+}
+
+} // namespace esp_modem
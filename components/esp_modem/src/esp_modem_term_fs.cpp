@@ -1,15 +1,19 @@
 /*
- * SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <atomic>
 #include <optional>
 #include <unistd.h>
 #include "cxx_include/esp_modem_dte.hpp"
 #include "esp_log.h"
 #include "esp_modem_config.h"
 #include "exception_stub.hpp"
+#ifdef CONFIG_ESP_MODEM_LINUX_FD_REACTOR
+#include "fd_reactor.hpp"
+#endif
 
 static const char *TAG = "fs_terminal";
 
@@ -67,6 +71,16 @@ public:
         on_read = std::move(f);
     }
 
+    void pause_rx(bool pause) override
+    {
+        // the data stay in the kernel, which holds the peer (by TCP window, or by RTS of a serial port with flow control)
+        if (pause) {
+            signal.set(RX_PAUSED);
+        } else {
+            signal.clear(RX_PAUSED);
+        }
+    }
+
 private:
     void task();
 
@@ -84,17 +98,115 @@ private:
     static const size_t TASK_START = SignalGroup::bit1;
     static const size_t TASK_STOP = SignalGroup::bit2;
     static const size_t TASK_STOPPED = SignalGroup::bit3;   /*!< Set by the task once it has left the processing loop */
+    static const size_t RX_PAUSED = SignalGroup::bit4;      /*!< Received data are left in the descriptor */
     static const uint32_t stop_timeout_ms = 2000;           /*!< Max wait for a graceful stop (must exceed the select() timeout) */
+    static const uint32_t paused_poll_ms = 10;              /*!< Period of checking whether receiving has been resumed */
 
     File f;
     SignalGroup signal;
     Task task_handle;
 };
 
+#ifdef CONFIG_ESP_MODEM_LINUX_FD_REACTOR
+/**
+ * @brief File descriptor terminal served by the shared FdReactor instead of its own task
+ */
+class FdReactorTerminal : public Terminal {
+public:
+    explicit FdReactorTerminal(const esp_modem_dte_config *config): f(config), consumed(0), started(false) {}
+
+    ~FdReactorTerminal() override
+    {
+        FdReactorTerminal::stop();
+    }
+
+    void start() override
+    {
+        if (!started) {
+            FdReactor::get().add(f.fd, [this] { return notify_read(); });
+            started = true;
+        }
+    }
+
+    void stop() override
+    {
+        if (started) {
+            FdReactor::get().remove(f.fd);  // no read callback is in flight once this returns
+            started = false;
+        }
+    }
+
+    int write(uint8_t *data, size_t len) override
+    {
+        int size = ::write(f.fd, data, len);
+        if (size < 0) {
+            ESP_LOGE(TAG, "Error occurred during write: %d", errno);
+            return 0;
+        }
+        // a reply is expected, any data parked by the reactor has to be processed now
+        FdReactor::get().resume(f.fd);
+        return size;
+    }
+
+    int read(uint8_t *data, size_t len) override
+    {
+        int size = ::read(f.fd, data, len);
+        if (size < 0) {
+            if (errno != EAGAIN) {
+                ESP_LOGE(TAG, "Error occurred during read: %d", errno);
+            }
+            return 0;
+        }
+        consumed += size;
+        return size;
+    }
+
+    void set_read_cb(std::function<bool(uint8_t *data, size_t len)> cb) override
+    {
+        {
+            Scoped<Lock> l(cb_lock);
+            on_read = std::move(cb);
+        }
+        FdReactor::get().resume(f.fd);
+    }
+
+    void pause_rx(bool pause) override
+    {
+        paused = pause;
+        if (!pause) {
+            FdReactor::get().resume(f.fd);
+        }
+    }
+
+private:
+    size_t notify_read()
+    {
+        if (paused) {
+            return 0;   // the reactor parks the descriptor until resumed, the data stay in the kernel
+        }
+        Scoped<Lock> l(cb_lock);
+        consumed = 0;
+        if (on_read) {
+            on_read(nullptr, 0);
+        }
+        return consumed;
+    }
+
+    File f;
+    std::atomic<size_t> consumed;   /*!< Bytes read during the last notification */
+    std::atomic<bool> paused{false};
+    bool started;
+};
+#endif // CONFIG_ESP_MODEM_LINUX_FD_REACTOR
+
 std::unique_ptr<Terminal> create_vfs_terminal(const esp_modem_dte_config *config)
 {
     TRY_CATCH_RET_NULL(
+#ifdef CONFIG_ESP_MODEM_LINUX_FD_REACTOR
+        auto term = std::make_unique<FdReactorTerminal>(config);
+#else
         auto term = std::make_unique<FdTerminal>(config);
+#endif
         term->start();
         return term;
     )
@@ -129,6 +241,10 @@ void FdTerminal::task()
     }
 
     while (signal.is_any(TASK_START)) {
+        if (signal.is_any(RX_PAUSED)) {
+            Task::Delay(paused_poll_ms);
+            continue;
+        }
         int s;
         fd_set rfds;
         struct timeval tv = {
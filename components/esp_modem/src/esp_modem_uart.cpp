@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2024 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2026 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -44,6 +44,7 @@ class UartTerminal : public Terminal {
 public:
     explicit UartTerminal(const esp_modem_dte_config *config) :
         event_queue(), uart(&config->uart_config, &event_queue, -1), signal(),
+        flow_control(config->uart_config.flow_control != ESP_MODEM_FLOW_CONTROL_NONE),
         task_handle(config->task_stack_size, config->task_priority, this, s_task) {}
 
     ~UartTerminal() override
@@ -82,6 +83,19 @@ public:
         on_read = std::move(f);
     }
 
+    void pause_rx(bool pause) override
+    {
+        if (pause) {
+            signal.set(RX_PAUSED);
+            return;
+        }
+        signal.clear(RX_PAUSED);
+        // wake up the task to read what has been held meanwhile
+        uart_event_t event = {};
+        event.type = UART_DATA;
+        xQueueSend(event_queue, &event, 0);
+    }
+
 private:
     static void s_task(void *task_param)
     {
@@ -107,6 +121,11 @@ private:
     // lock, since the callback may have been cleared between the outer check and acquiring it.
     void notify_read(size_t len)
     {
+        if (signal.is_any(RX_PAUSED)) {
+            // Leave the data in the driver: once its ring buffer is full, it stops draining the HW FIFO,
+            // so the peer is held by RTS or XOFF (if flow control is configured)
+            return;
+        }
         Scoped<Lock> l(cb_lock);
         if (on_read) {
             on_read(nullptr, len);
@@ -130,11 +149,13 @@ private:
     static const size_t TASK_START = BIT1;
     static const size_t TASK_STOP = BIT2;
     static const size_t TASK_STOPPED = BIT3;        /*!< Set by the task once it has left the processing loop */
+    static const size_t RX_PAUSED = BIT4;           /*!< Received data are held in the driver */
     static const uint32_t stop_timeout_ms = 1000;   /*!< Max wait for a graceful stop before forcing deletion */
 
     QueueHandle_t event_queue;
     uart_resource uart;
     SignalGroup signal;
+    bool flow_control;                              /*!< The peer stops sending when the driver's buffers are full */
     uart_task task_handle;
 };
 
@@ -171,6 +192,12 @@ void UartTerminal::task()
                 reset_events();
                 break;
             case UART_BUFFER_FULL:
+                if (flow_control) {
+                    // nothing has been lost, the driver holds the data in HW FIFO and flow control holds the peer
+                    uart_get_buffered_data_len(uart.port, &len);
+                    notify_read(len);
+                    break;
+                }
                 ESP_LOGW(TAG, "Ring Buffer Full");
                 notify_error(terminal_error::BUFFER_OVERFLOW);
                 reset_events();
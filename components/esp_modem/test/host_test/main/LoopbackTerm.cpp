@@ -7,6 +7,10 @@
 #include <future>
 #include <cstring>
 #include "LoopbackTerm.h"
+#include "cxx_include/esp_modem_cmux.hpp"
+
+// Set in the injection loop: replies written from the read callback don't start another loop
+static thread_local bool injecting = false;
 
 void LoopbackTerm::start()
 {
@@ -22,69 +26,87 @@ void LoopbackTerm::stop()
     finish_async();
 }
 
+std::string LoopbackTerm::at_response(const std::string &command)
+{
+    last_command = command;
+    std::string response;
+    if (command == "+++") {
+        response = "NO CARRIER\r\n";
+    } else if (command == "ATE1\r" || command == "ATE0\r") {
+        response = "OK\r\n ";
+    } else if (command == "ATO\r") {
+        response = "ERROR\r\n";
+    } else if (command.find("ATD") != std::string::npos) {
+        response = "CONNECT\n";
+    } else if (command.find("AT+CSQ\r") != std::string::npos) {
+        response = "+CSQ: 123,456\n\r\nOK\r\n";
+    } else if (command.find("AT+CGMM\r") != std::string::npos) {
+        response = "0G Dummy Model\n\r\nOK\r\n";
+    } else if (command.find("AT+COPS?\r") != std::string::npos) {
+        response = "+COPS: 0,0,\"OperatorName\",5\n\r\nOK\r\n";
+    } else if (command.find("AT+CBC\r") != std::string::npos) {
+        response = is_bg96 ? "+CBC: 1,20,123456\r\r\n\r\nOK\r\n\n\r\n" :
+                   "+CBC: 123.456V\r\r\n\r\nOK\r\n\n\r\n";
+    } else if (command.find("AT+CPIN=") != std::string::npos) {
+        if (command.find(',') != std::string::npos) {
+            response = "OK\r\n";
+            pin_ok = true;
+            needs_puk = false;
+        } else if (command.find("AT+CPIN=1234\r") != std::string::npos) {
+            response = "OK\r\n";
+            pin_ok = true;
+            needs_puk = false;
+        } else if (needs_puk) {
+            response = "ERROR\r\n";
+        } else {
+            response = "OK\r\n";
+            pin_ok = true;
+        }
+    } else if (command.find("AT+CPIN?\r") != std::string::npos) {
+        if (pin_ok) {
+            response = "+CPIN: READY\r\nOK\r\n";
+        } else if (needs_puk) {
+            response = "+CPIN: SIM PUK\r\nOK\r\n";
+        } else {
+            response = "+CPIN: SIM PIN\r\nOK\r\n";
+        }
+    } else if (command.find("AT") != std::string::npos) {
+        if (command.length() > 4) {
+            response = command;
+            response[0] = 'O';
+            response[1] = 'K';
+            response[2] = '\r';
+            response[3] = '\n';
+        } else {
+            response = "OK\r\n";
+        }
+
+    }
+    return response;
+}
+
 int LoopbackTerm::write(uint8_t *data, size_t len)
 {
+    write_count++;
+    {
+        std::lock_guard<std::mutex> l(last_write_lock);
+        last_write.assign(data, data + len);
+    }
     if (inject_by) {    // injection test: ignore what we write, but respond with injected data
+        if (injecting) {
+            return len;     // replies from the read callback
+        }
+        std::lock_guard<std::mutex> l(async_lock);
+        if (!async_results.empty() &&
+                async_results.back().wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return len;     // the injection is still in progress
+        }
         auto ret = std::async(&LoopbackTerm::batch_read, this);
         async_results.push_back(std::move(ret));
         return len;
     }
     if (len > 2 && (data[len - 1] == '\r' || data[len - 1] == '+')) {  // Simple AT responder
-        std::string command((char *)data, len);
-        last_command = command;
-        std::string response;
-        if (command == "+++") {
-            response = "NO CARRIER\r\n";
-        } else if (command == "ATE1\r" || command == "ATE0\r") {
-            response = "OK\r\n ";
-        } else if (command == "ATO\r") {
-            response = "ERROR\r\n";
-        } else if (command.find("ATD") != std::string::npos) {
-            response = "CONNECT\n";
-        } else if (command.find("AT+CSQ\r") != std::string::npos) {
-            response = "+CSQ: 123,456\n\r\nOK\r\n";
-        } else if (command.find("AT+CGMM\r") != std::string::npos) {
-            response = "0G Dummy Model\n\r\nOK\r\n";
-        } else if (command.find("AT+COPS?\r") != std::string::npos) {
-            response = "+COPS: 0,0,\"OperatorName\",5\n\r\nOK\r\n";
-        } else if (command.find("AT+CBC\r") != std::string::npos) {
-            response = is_bg96 ? "+CBC: 1,20,123456\r\r\n\r\nOK\r\n\n\r\n" :
-                       "+CBC: 123.456V\r\r\n\r\nOK\r\n\n\r\n";
-        } else if (command.find("AT+CPIN=") != std::string::npos) {
-            if (command.find(',') != std::string::npos) {
-                response = "OK\r\n";
-                pin_ok = true;
-                needs_puk = false;
-            } else if (command.find("AT+CPIN=1234\r") != std::string::npos) {
-                response = "OK\r\n";
-                pin_ok = true;
-                needs_puk = false;
-            } else if (needs_puk) {
-                response = "ERROR\r\n";
-            } else {
-                response = "OK\r\n";
-                pin_ok = true;
-            }
-        } else if (command.find("AT+CPIN?\r") != std::string::npos) {
-            if (pin_ok) {
-                response = "+CPIN: READY\r\nOK\r\n";
-            } else if (needs_puk) {
-                response = "+CPIN: SIM PUK\r\nOK\r\n";
-            } else {
-                response = "+CPIN: SIM PIN\r\nOK\r\n";
-            }
-        } else if (command.find("AT") != std::string::npos) {
-            if (command.length() > 4) {
-                response = command;
-                response[0] = 'O';
-                response[1] = 'K';
-                response[2] = '\r';
-                response[3] = '\n';
-            } else {
-                response = "OK\r\n";
-            }
-
-        }
+        auto response = at_response(std::string((char *)data, len));
         if (!response.empty()) {
             data_len = response.length();
             loopback_data.resize(data_len);
@@ -95,14 +117,46 @@ int LoopbackTerm::write(uint8_t *data, size_t len)
     }
     if (len > 2 && data[0] == 0xf9) { // Simple CMUX responder
         // turn the request into a reply -> implements CMUX loopback
-        // Note: This simple CMUX responder only updates CMUX headers and replaces payload.
-        // It means that all responses (that we test) must be shorter or equal to the requests
-        // For example ATD (dial command): sizeof("ATD*99#") >= sizeof("CONNECT");
-        if (data[2] == 0x3f || data[2] == 0x53) {  // SABM command
+        // Note: This simple CMUX responder only updates CMUX headers, except for AT commands
+        // on virtual terminals, which are answered by the AT responder in a new frame
+        if (data[2] == 0x3f && (data[1] >> 2) == refused_dlci) {    // refused SABM
+            data[2] = 0x1f;     // DM response
+        } else if (data[2] == 0x3f || data[2] == 0x53) {  // SABM command
             data[2] = 0x73;
         } else if (data[2] == 0xef) { // Generic request
+            size_t header_len = (data[3] & 0x01) ? 3 : 4;
+            if ((data[1] >> 2) > 0 && len > header_len + 4 && data[len - 3] == '\r') {
+                auto response = at_response(std::string((char *)data + 1 + header_len, len - header_len - 3));
+                if (!response.empty()) {
+                    std::vector<uint8_t> reply = { 0xf9, data[1], 0xff };
+                    if (response.size() <= 127) {
+                        reply.push_back((response.size() << 1) | 0x01);
+                    } else {
+                        reply.push_back((response.size() & 0x7f) << 1);
+                        reply.push_back(response.size() >> 7);
+                    }
+                    reply.push_back(CMuxFcs::calc(&reply[1], reply.size() - 1));
+                    reply.insert(reply.end() - 1, response.begin(), response.end());
+                    reply.push_back(0xf9);
+                    loopback_data.resize(data_len + reply.size());
+                    memcpy(&loopback_data[data_len], reply.data(), reply.size());
+                    data_len += reply.size();
+                    auto ret = std::async(on_read, nullptr, data_len);
+                    return len;
+                }
+            }
             data[2] = 0xff;         // generic reply
+            if (data[1] == 0x03 && len > 12 && data[4] == 0x83) {   // DLC parameter negotiation
+                data[4] = 0x81;                                     // PN response
+                if ((data[10] | (data[11] << 8)) > max_frame_size) {    // accept lower frame size only
+                    data[10] = max_frame_size & 0xFF;
+                    data[11] = max_frame_size >> 8;
+                }
+            }
         }
+        // the control field is covered by FCS, update it (the whole frame is written at once)
+        size_t header_len = (data[3] & 0x01) ? 3 : 4;
+        data[len - 2] = CMuxFcs::calc(data + 1, header_len);
     }
     loopback_data.resize(data_len + len);
     memcpy(&loopback_data[data_len], data, len);
@@ -154,6 +208,7 @@ int LoopbackTerm::inject(uint8_t *data, size_t len, size_t injected_by, size_t d
 
 void LoopbackTerm::batch_read()
 {
+    injecting = true;
     while (!stopping && data_len > 0) {
         Task::Delay(delay_before_inject);
         {
@@ -172,6 +227,7 @@ void LoopbackTerm::batch_read()
 void LoopbackTerm::finish_async()
 {
     stopping = true;
+    std::lock_guard<std::mutex> l(async_lock);
     for (auto &result : async_results) {
         if (result.valid()) {
             result.wait();
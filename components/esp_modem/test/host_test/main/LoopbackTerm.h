@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include "cxx_include/esp_modem_api.hpp"
 #include "cxx_include/esp_modem_terminal.hpp"
 
@@ -43,6 +44,33 @@ public:
         return last_command;
     }
 
+    size_t get_write_count() const
+    {
+        return write_count;
+    }
+
+    std::vector<uint8_t> get_last_write()
+    {
+        std::lock_guard<std::mutex> l(last_write_lock);
+        return last_write;
+    }
+
+    /**
+     * @brief Sets the highest CMUX frame size accepted in DLC parameter negotiation
+     */
+    void set_max_frame_size(size_t size)
+    {
+        max_frame_size = size;
+    }
+
+    /**
+     * @brief Makes the CMUX responder refuse opening the given DLCI
+     */
+    void set_refused_dlci(int dlci)
+    {
+        refused_dlci = dlci;
+    }
+
 private:
     enum class status_t {
         STARTED,
@@ -50,6 +78,11 @@ private:
     };
     void batch_read();
 
+    /**
+     * @brief Simple AT responder, returns an empty string for unknown commands
+     */
+    std::string at_response(const std::string &command);
+
     /**
      * @brief Stops the injection loop and waits for all pending async replies to complete
      *
@@ -67,8 +100,14 @@ private:
     size_t inject_by;
     size_t delay_before_inject;
     size_t delay_after_inject;
+    std::mutex async_lock;                      /*!< Several threads may write while injecting */
     std::vector<std::future<void>> async_results;
     std::atomic<bool> stopping;
     std::string last_command;
+    std::atomic<size_t> write_count{0};
+    std::mutex last_write_lock;
+    std::vector<uint8_t> last_write;
+    size_t max_frame_size{32767};
+    int refused_dlci{-1};
 
 };
@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "cxx_include/esp_modem_cmux.hpp"
+
+using namespace esp_modem;
+
+/**
+ * @brief Bit-by-bit FCS, as originally computed by CMux (reference for correctness and speed)
+ */
+static uint8_t fcs_bitwise(uint8_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x01) {
+                crc = (crc >> 1) ^ 0xe0;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+static std::vector<uint8_t> make_payload(size_t len)
+{
+    std::vector<uint8_t> payload(len);
+    uint32_t seed = 0x12345678;
+    for (auto &b : payload) {
+        seed = seed * 1103515245 + 12345;
+        b = seed >> 24;
+    }
+    return payload;
+}
+
+TEST_CASE("CMUX FCS", "[esp_modem][cmux]")
+{
+    // SABM on DLCI 0
+    const uint8_t sabm[] = { 0x03, 0x3f, 0x01 };
+    CHECK(CMuxFcs::calc(sabm, sizeof(sabm)) == 0x1c);
+
+    // Matches the bitwise reference for any length
+    auto payload = make_payload(1500);
+    for (size_t len = 0; len <= payload.size(); len += 37) {
+        CHECK(CMuxFcs::update(CMuxFcs::INIT, payload.data(), len) == fcs_bitwise(0xFF, payload.data(), len));
+    }
+
+    // Running CRC over data and its FCS gives the good value, also when computed in chunks
+    uint8_t crc = CMuxFcs::update(CMuxFcs::INIT, payload.data(), 700);
+    crc = CMuxFcs::update(crc, payload.data() + 700, 800);
+    uint8_t fcs = 0xFF - crc;
+    CHECK(fcs == CMuxFcs::calc(payload.data(), payload.size()));
+    CHECK(CMuxFcs::update(crc, &fcs, 1) == CMuxFcs::GOOD);
+}
+
+TEST_CASE("CMUX FCS benchmark", "[esp_modem][cmux][.][benchmark]")
+{
+    const uint8_t header[] = { 0x09, 0xef, 0x7c, 0x03 };
+    auto payload = make_payload(1500);
+
+    BENCHMARK("bitwise, UIH header") {
+        return fcs_bitwise(0xFF, header, sizeof(header));
+    };
+    BENCHMARK("table, UIH header") {
+        return CMuxFcs::update(CMuxFcs::INIT, header, sizeof(header));
+    };
+    BENCHMARK("bitwise, 1500 byte UI frame") {
+        return fcs_bitwise(0xFF, payload.data(), payload.size());
+    };
+    BENCHMARK("table, 1500 byte UI frame") {
+        return CMuxFcs::update(CMuxFcs::INIT, payload.data(), payload.size());
+    };
+}
@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <catch2/catch_test_macros.hpp>
+#include "cxx_include/esp_modem_api.hpp"
+#include "esp_modem_config.h"
+
+#ifdef CONFIG_ESP_MODEM_LINUX_FD_REACTOR
+
+using namespace esp_modem;
+
+static int thread_count()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return std::stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+static void close_fd(int fd, struct esp_modem_vfs_resource *resource)
+{
+    close(fd);
+}
+
+/**
+ * @brief Modem simulators for all socket pairs in one thread, answering every command with OK
+ */
+static void simulate_modems(const std::vector<int> &fds, const std::atomic<bool> &running)
+{
+    std::vector<pollfd> pfds;
+    for (auto fd : fds) {
+        pfds.push_back({ fd, POLLIN, 0 });
+    }
+    char buf[64];
+    while (running) {
+        if (poll(pfds.data(), pfds.size(), 10) <= 0) {
+            continue;
+        }
+        for (auto &pfd : pfds) {
+            if ((pfd.revents & POLLIN) && read(pfd.fd, buf, sizeof(buf)) > 0) {
+                const char reply[] = "\r\nOK\r\n";
+                write(pfd.fd, reply, sizeof(reply) - 1);
+            }
+        }
+    }
+}
+
+static command_result expect_ok(uint8_t *data, size_t len)
+{
+    std::string_view response((char *)data, len);
+    return response.find("OK") != std::string_view::npos ? command_result::OK : command_result::TIMEOUT;
+}
+
+TEST_CASE("Many VFS terminals served by the reactor", "[esp_modem][reactor]")
+{
+    static constexpr int modems = 48;
+    int threads_before = thread_count();
+
+    std::vector<int> modem_fds;
+    std::vector<std::shared_ptr<DTE>> dtes;
+    for (int i = 0; i < modems; i++) {
+        int sv[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0);
+        esp_modem_dte_config_t dte_config = {
+            .dte_buffer_size = 512,
+            .task_stack_size = 4096,
+            .task_priority = 5,
+            .vfs_config = { .fd = sv[0], .deleter = close_fd, .resource = nullptr }
+        };
+        auto dte = create_vfs_dte(&dte_config);
+        REQUIRE(dte != nullptr);
+        dtes.push_back(std::move(dte));
+        modem_fds.push_back(sv[1]);
+    }
+
+    // no thread per terminal, just the reactor's pool
+    CHECK(thread_count() - threads_before <= CONFIG_ESP_MODEM_LINUX_FD_REACTOR_THREADS);
+
+    // unsolicited data, which the DTEs don't read while no command is in progress
+    for (auto fd : modem_fds) {
+        const char urc[] = "\r\n+CREG: 1\r\n";
+        write(fd, urc, sizeof(urc) - 1);
+    }
+    usleep(50'000);
+
+    std::atomic<bool> running{true};
+    std::thread simulator(simulate_modems, std::cref(modem_fds), std::cref(running));
+
+    // commands on all the DTEs from several threads at once
+    std::atomic<int> ok{0};
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; t++) {
+        clients.emplace_back([&, t] {
+            for (int round = 0; round < 10; round++) {
+                for (int i = t; i < modems; i += 4) {
+                    if (dtes[i]->command("AT\r", expect_ok, 1000) == command_result::OK) {
+                        ok++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    CHECK(ok == modems * 10);
+
+    running = false;
+    simulator.join();
+    dtes.clear();
+    for (auto fd : modem_fds) {
+        close(fd);
+    }
+}
+
+#endif // CONFIG_ESP_MODEM_LINUX_FD_REACTOR
@@ -4,11 +4,20 @@
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
 #define CATCH_CONFIG_MAIN // This tells the catch header to generate a main
+#include <atomic>
+#include <list>
 #include <memory>
 #include <future>
+#include <mutex>
+#include <thread>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_session.hpp>
 #include "cxx_include/esp_modem_api.hpp"
+#include "cxx_include/esp_modem_command_queue.hpp"
+#include "cxx_include/esp_modem_response_matcher.hpp"
+#include "cxx_include/esp_modem_command_library_utils.hpp"
+#include "cxx17_include/esp_modem_command_library_17.hpp"
+#include "esp_modem_config.h"
 #include "LoopbackTerm.h"
 #include <iostream>
 
@@ -191,6 +200,139 @@ TEST_CASE("DTE send/receive command", "[esp_modem]")
     CHECK(ret == command_result::OK);
 }
 
+TEST_CASE("Asynchronous command queue", "[esp_modem]")
+{
+    auto term = std::make_unique<LoopbackTerm>(true);
+    auto dte =  std::make_shared<DTE>(std::move(term));
+    int rssi = 0, ber = 0, voltage = 0, bcs = 0, bcl = 0, act = 0;
+    std::string operator_name;
+    std::atomic<int> completed{0};
+    std::future<command_result> blocked, cancelled;
+    {
+        CommandQueue queue(dte.get());
+        // independent queries complete together
+        auto telemetry = queue.batch({
+            [&](CommandableIf * t) { return dce_commands::get_signal_quality(t, rssi, ber); },
+            [&](CommandableIf * t) { return dce_commands::get_battery_status(t, voltage, bcs, bcl); },
+            [&](CommandableIf * t) { return dce_commands::get_operator_name(t, operator_name, act); },
+        });
+        for (int i = 0; i < 10; ++i) {
+            queue.submit([](CommandableIf * t) {
+                return dce_commands::sync(t);
+            }, [&](command_result result) {
+                CHECK(result == command_result::OK);
+                completed++;
+            });
+        }
+        auto custom = queue.command("AT\r", [&](uint8_t *data, size_t len) {
+            return command_result::OK;
+        }, 1000);
+        CHECK(telemetry.get() == command_result::OK);
+        CHECK(rssi == 123);
+        CHECK(ber == 456);
+        CHECK(voltage == 123456);
+        CHECK(operator_name == "OperatorName");
+        CHECK(act == 5);
+        // requests are executed in order
+        CHECK(custom.get() == command_result::OK);
+        CHECK(completed == 10);
+
+        blocked = queue.submit([](CommandableIf * t) {
+            Task::Delay(100);
+            return command_result::OK;
+        });
+        cancelled = queue.submit([](CommandableIf * t) {
+            return command_result::OK;
+        });
+        CHECK(queue.pending() >= 1);
+    }
+    // requests which haven't started when the queue is destroyed fail
+    CHECK(cancelled.get() == command_result::FAIL);
+    CHECK(blocked.valid());
+}
+
+
+TEST_CASE("Response matcher", "[esp_modem]")
+{
+    static constexpr ResponseMatcher matcher({"OK", "NO CARRIER"}, {"ERROR"});
+    CHECK(matcher.match("\r\n+CSQ: 123,456\r\n\r\nOK\r\n") == command_result::OK);
+    CHECK(matcher.match("\r\n+CME ERROR: 10\r\n") == command_result::FAIL);
+    CHECK(matcher.match("ERROR\r\nOK\r\n") == command_result::OK);    // pass phrases take precedence
+    CHECK(matcher.match("NO CARRIE") == command_result::TIMEOUT);
+
+    // incremental scanning finds phrases split between fragments
+    ResponseMatcher::cursor cursor = 0;
+    CHECK(matcher.feed("\r\nNO CAR", cursor) == command_result::TIMEOUT);
+    CHECK(matcher.feed("RIER\r\n", cursor) == command_result::OK);
+
+    const std::list<std::string_view> pass({"+CEREG: 1", "+CEREG: 5"});
+    const std::list<std::string_view> fail({"ERROR"});
+    ResponseMatcher from_lists(pass, fail);
+    CHECK(from_lists.match("\r\n+CEREG: 5\r\n") == command_result::OK);
+    CHECK(from_lists.match("\r\n+CEREG: 2\r\n") == command_result::TIMEOUT);
+}
+
+TEST_CASE("DTE matches fragmented replies longer than its buffer", "[esp_modem]")
+{
+    esp_modem_dte_config_t dte_config = {
+        .dte_buffer_size = 16,
+        .task_stack_size = 4096,
+        .task_priority = 5,
+        .vfs_config = {}
+    };
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    auto dte = std::make_unique<DTE>(&dte_config, std::move(term));
+    CHECK(dte->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
+    static constexpr ResponseMatcher matcher({"OK"}, {"ERROR"});
+
+    // the reply is scanned as it arrives, so it doesn't have to fit into the DTE buffer
+    std::string reply = "\r\n+CGMR: " + std::string(200, 'x') + "\r\n\r\nOK\r\n";
+    loopback->inject((uint8_t *)reply.data(), reply.size(), 3, 0, 0);
+    CHECK(dte->command_until("AT+CGMR\r", matcher, 1000) == command_result::OK);
+
+    // phrases split between fragments are found as well
+    std::string error = "\r\n+CME ERROR: 10\r\n";
+    loopback->inject((uint8_t *)error.data(), error.size(), 5, 0, 0);
+    CHECK(dte->command_until("AT+CPIN?\r", matcher, 1000) == command_result::FAIL);
+
+    // no phrase until the end of line
+    std::string partial = "\r\nO";
+    loopback->inject((uint8_t *)partial.data(), partial.size(), 2, 0, 0);
+    CHECK(dte->command_until("AT\r", matcher, 100) == command_result::TIMEOUT);
+    loopback->inject(nullptr, 0, 0, 0, 0);
+}
+
+TEST_CASE("Generic command with long phrases", "[esp_modem]")
+{
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    auto dte = std::make_unique<DTE>(std::move(term));
+    CHECK(dte->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
+
+    // the phrases don't fit into the response matcher, replies are searched for them one by one
+    const std::string long_pass = "+QIURC: \"recv\",0," + std::string(ResponseMatcher::max_nodes, 'p');
+    const std::string long_fail = "+QIURC: \"closed\",0," + std::string(ResponseMatcher::max_nodes, 'f');
+    const std::list<std::string_view> pass({"+QIOPEN: 0,0", long_pass});
+    const std::list<std::string_view> fail({long_fail, "ERROR"});
+
+    std::string reply = "\r\n" + long_pass + "\r\n";
+    loopback->inject((uint8_t *)reply.data(), reply.size(), reply.size(), 0, 0);
+    CHECK(dce_commands::generic_command(dte.get(), "AT+QIRD=0\r", pass, fail, 1000) == command_result::OK);
+
+    reply = "\r\n" + long_fail + "\r\n";
+    loopback->inject((uint8_t *)reply.data(), reply.size(), reply.size(), 0, 0);
+    CHECK(dce_commands::generic_command(dte.get(), "AT+QIRD=0\r", long_pass, long_fail, 1000) == command_result::FAIL);
+
+    // part of a long phrase is not enough
+    reply = "\r\n" + long_pass.substr(0, long_pass.size() - 1) + "\r\n";
+    loopback->inject((uint8_t *)reply.data(), reply.size(), reply.size(), 0, 0);
+    CHECK(dce_commands::generic_command(dte.get(), "AT+QIRD=0\r", pass, fail, 100) == command_result::TIMEOUT);
+    loopback->inject(nullptr, 0, 0, 0, 0);
+
+    // short phrases still use the matcher
+    CHECK(dce_commands::generic_command(dte.get(), "AT\r", "OK", "ERROR", 1000) == command_result::OK);
+}
 
 TEST_CASE("DCE commands", "[esp_modem]")
 {
@@ -260,6 +402,27 @@ TEST_CASE("DCE modes", "[esp_modem]")
     CHECK(dce->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
 }
 
+TEST_CASE("DCE data mode receive statistics", "[esp_modem]")
+{
+    auto term = std::make_unique<LoopbackTerm>();
+    auto dte =  std::make_shared<DTE>(std::move(term));
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("APN");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    CHECK(dce != nullptr);
+
+    CHECK(dce->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
+    CHECK(dce->set_mode(esp_modem::modem_mode::DATA_MODE) == true);
+    // PPP frame looped back by the terminal is passed to the netif
+    uint8_t ppp_frame[] = { 0x7e, 0xff, 0x7d, 0x23, 0xc0, 0x21, 0x7e };
+    CHECK(dte->write(ppp_frame, sizeof(ppp_frame)) == sizeof(ppp_frame));
+    auto stats = dce->get_netif_stats();
+    CHECK(stats.rx_chunks == 1);
+    CHECK(stats.rx_bytes == sizeof(ppp_frame));
+    CHECK(stats.rx_dropped == 0);
+    CHECK(dce->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
+}
+
 TEST_CASE("DCE CMUX test", "[esp_modem]")
 {
     auto term = std::make_unique<LoopbackTerm>();
@@ -282,6 +445,237 @@ TEST_CASE("DCE CMUX test", "[esp_modem]")
     CHECK(ret == command_result::OK);
 }
 
+TEST_CASE("CMUX frame is written at once", "[esp_modem]")
+{
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    auto dte = std::make_shared<DTE>(std::move(term));
+    CHECK(term == nullptr);
+
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("APN");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    CHECK(dce != nullptr);
+
+    CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == true);
+    auto writes = loopback->get_write_count();
+    const auto test_command = "Test\n";
+    auto ret = dce->command(test_command, [&](uint8_t *data, size_t len) {
+        std::string response((char *) data, len);
+        CHECK(response == test_command);
+        return command_result::OK;
+    }, 1000);
+    CHECK(ret == command_result::OK);
+    // header, payload and footer of the frame are passed to the terminal together
+    CHECK(loopback->get_write_count() == writes + 1);
+}
+
+TEST_CASE("CMUX negotiates frame size of additional terminals", "[esp_modem]")
+{
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    loopback->set_max_frame_size(200);
+    auto dte = std::make_shared<DTE>(std::move(term));
+    CHECK(term == nullptr);
+
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("APN");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    CHECK(dce != nullptr);
+
+    CHECK(dte->set_cmux_terminals(std::vector<CMuxTermConfig>(1)) == false);
+    std::vector<CMuxTermConfig> terms(3);
+    terms[2].frame_size = 300;
+    CHECK(dte->set_cmux_terminals(terms) == true);
+    CHECK(dte->get_cmux_terminal(2) == nullptr);
+    CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == true);
+    CHECK(dte->get_cmux_terminal(1) == nullptr);
+    CHECK(dte->get_cmux_terminal(3) == nullptr);
+    auto extra = dte->get_cmux_terminal(2);
+    REQUIRE(extra != nullptr);
+
+    std::mutex received_lock;
+    std::string received;
+    extra->set_read_cb([&](uint8_t *data, size_t len) {
+        std::lock_guard<std::mutex> l(received_lock);
+        received.append((char *)data, len);
+        return false;
+    });
+    // the module accepted 200 bytes out of the proposed 300, so 500 bytes are sent in three frames
+    std::string payload(500, 'x');
+    auto writes = loopback->get_write_count();
+    CHECK(extra->write((uint8_t *)payload.data(), payload.size()) == 500);
+    CHECK(loopback->get_write_count() == writes + 3);
+    for (int i = 0; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> l(received_lock);
+            if (received.size() >= payload.size()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    {
+        std::lock_guard<std::mutex> l(received_lock);
+        CHECK(received == payload);
+    }
+    extra->set_read_cb(nullptr);
+    CHECK(dce->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
+}
+
+TEST_CASE("CMUX setup fails without waiting if the module refuses a DLC", "[esp_modem]")
+{
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    loopback->set_refused_dlci(2);
+    auto dte = std::make_shared<DTE>(std::move(term));
+    CHECK(term == nullptr);
+
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("APN");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    CHECK(dce != nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == false);
+    // DM response completes the handshake, no need to wait for the response timeout
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+    loopback->set_refused_dlci(-1);
+    CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == true);
+}
+
+TEST_CASE("CMUX flow control", "[esp_modem]")
+{
+    using namespace std::chrono_literals;
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    auto dte = std::make_shared<DTE>(std::move(term));
+    CHECK(term == nullptr);
+
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("APN");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    CHECK(dce != nullptr);
+    CHECK(dte->set_cmux_terminals(std::vector<CMuxTermConfig>(3)) == true);
+    CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == true);
+    auto extra = dte->get_cmux_terminal(2);
+    REQUIRE(extra != nullptr);
+
+    uint8_t data[] = "data";
+    // the module's control command is processed once we have answered it
+    auto module_sends = [&](uint8_t *frame, size_t len) {
+        auto writes = loopback->get_write_count();
+        loopback->inject(frame, len, len, 0, 0);
+        loopback->write(nullptr, 0);    // triggers the injection
+        for (int i = 0; i < 100 && loopback->get_write_count() < writes + 2; i++) {
+            std::this_thread::sleep_for(10ms);
+        }
+        return loopback->get_write_count() >= writes + 2;
+    };
+    auto send = [&](int term_id) {
+        return std::async(std::launch::async, [&, term_id] {
+            return term_id < 2 ? dte->send(data, sizeof(data), term_id) : extra->write(data, sizeof(data));
+        });
+    };
+    // the writes are held for up to 5s, if the module doesn't release them
+    auto held = [](std::future<int> &f) {
+        return f.wait_for(100ms) == std::future_status::timeout;
+    };
+    auto released = [&](std::future<int> &f) {
+        return f.wait_for(1000ms) == std::future_status::ready && f.get() == sizeof(data);
+    };
+
+    // the module sends FCoff, all the virtual terminals are held
+    uint8_t fcoff[] = { 0xf9, 0x03, 0xef, 0x05, 0x63, 0x01, 0x00, 0xf9 };
+    fcoff[6] = CMuxFcs::calc(&fcoff[1], 3);
+    REQUIRE(module_sends(&fcoff[0], sizeof(fcoff)));
+    std::vector<std::future<int>> waiters;
+    for (int term_id = 0; term_id < 3; term_id++) {
+        waiters.push_back(send(term_id));
+        waiters.push_back(send(term_id));
+    }
+    for (auto &waiter : waiters) {
+        CHECK(held(waiter));
+    }
+
+    // FCon releases all the waiters
+    uint8_t fcon[] = { 0xf9, 0x03, 0xef, 0x05, 0xa3, 0x01, 0x00, 0xf9 };
+    fcon[6] = CMuxFcs::calc(&fcon[1], 3);
+    REQUIRE(module_sends(&fcon[0], sizeof(fcon)));
+    for (auto &waiter : waiters) {
+        CHECK(released(waiter));
+    }
+
+    // the module holds only the data terminal (DLCI 1) by the flow control bit of MSC
+    uint8_t msc_off[] = { 0xf9, 0x03, 0xef, 0x09, 0xe3, 0x05, 0x07, 0x0f, 0x00, 0xf9 };
+    msc_off[8] = CMuxFcs::calc(&msc_off[1], 3);
+    REQUIRE(module_sends(&msc_off[0], sizeof(msc_off)));
+    waiters.clear();
+    for (int i = 0; i < 3; i++) {
+        waiters.push_back(send(1));
+    }
+    auto command = send(0);             // the command terminal (DLCI 2) is not held
+    CHECK(released(command));
+    for (auto &waiter : waiters) {
+        CHECK(held(waiter));
+    }
+
+    uint8_t msc_on[] = { 0xf9, 0x03, 0xef, 0x09, 0xe3, 0x05, 0x07, 0x0d, 0x00, 0xf9 };
+    msc_on[8] = CMuxFcs::calc(&msc_on[1], 3);
+    REQUIRE(module_sends(&msc_on[0], sizeof(msc_on)));
+    for (auto &waiter : waiters) {
+        CHECK(released(waiter));
+    }
+
+    // pausing the data terminal sends MSC with the flow control bit, once
+    auto writes = loopback->get_write_count();
+    dte->pause_rx(true);
+    dte->pause_rx(true);
+    CHECK(loopback->get_write_count() == writes + 1);
+    dte->pause_rx(false);
+    CHECK(loopback->get_write_count() == writes + 2);
+    loopback->inject(nullptr, 0, 0, 0, 0);
+}
+
+TEST_CASE("CMUX control commands", "[esp_modem]")
+{
+    using namespace std::chrono_literals;
+    auto term = std::make_unique<LoopbackTerm>();
+    auto loopback = term.get();
+    auto dte = std::make_shared<DTE>(std::move(term));
+    CHECK(term == nullptr);
+
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("APN");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    CHECK(dce != nullptr);
+    CHECK(dte->set_cmux_terminals(std::vector<CMuxTermConfig>(3)) == true);
+    CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == true);
+    auto extra = dte->get_cmux_terminal(2);
+    REQUIRE(extra != nullptr);
+
+    // the module sends the Test command, which we do not support, so it is answered with NSC
+    uint8_t test[] = { 0xf9, 0x03, 0xef, 0x07, 0x23, 0x03, 0xaa, 0x00, 0xf9 };
+    test[7] = CMuxFcs::calc(&test[1], 3);
+    loopback->inject(&test[0], sizeof(test), sizeof(test), 0, 100);
+    uint8_t data[] = "data";
+    auto writes = loopback->get_write_count();
+    CHECK(dte->send(data, sizeof(data), 0) == sizeof(data));
+    std::this_thread::sleep_for(200ms);
+    CHECK(loopback->get_write_count() == writes + 2);
+    std::vector<uint8_t> nsc = { 0xf9, 0x03, 0xef, 0x07, 0x11, 0x03, 0x23, 0x00, 0xf9 };
+    nsc[7] = CMuxFcs::calc(&nsc[1], 3);
+    CHECK(loopback->get_last_write() == nsc);
+    loopback->inject(nullptr, 0, 0, 0, 0);
+
+    // the CMUX terminals outlive the CMUX mode, but cannot write anymore
+    CHECK(dce->set_mode(esp_modem::modem_mode::COMMAND_MODE) == true);
+    writes = loopback->get_write_count();
+    CHECK(extra->write(data, sizeof(data)) == -1);
+    CHECK(loopback->get_write_count() == writes);
+}
+
 TEST_CASE("Test CMUX protocol by injecting payloads", "[esp_modem]")
 {
     auto term = std::make_unique<LoopbackTerm>();
@@ -297,7 +691,7 @@ TEST_CASE("Test CMUX protocol by injecting payloads", "[esp_modem]")
     CHECK(dce->set_mode(esp_modem::modem_mode::CMUX_MODE) == true);
     const auto test_command = "Test\n";
     // 1 byte payload size
-    uint8_t test_payload[] = {0xf9, 0x09, 0xff, 0x0b, 0x54, 0x65, 0x73, 0x74, 0x0a, 0xbb, 0xf9 };
+    uint8_t test_payload[] = {0xf9, 0x09, 0xff, 0x0b, 0x54, 0x65, 0x73, 0x74, 0x0a, 0x29, 0xf9 };
     loopback->inject(&test_payload[0], sizeof(test_payload), 1);
     auto ret = dce->command(test_command, [&](uint8_t *data, size_t len) {
         std::string response((char *) data, len);
@@ -311,7 +705,7 @@ TEST_CASE("Test CMUX protocol by injecting payloads", "[esp_modem]")
     long_payload[5]   = 0x7e;   // payload to validate
     long_payload[449] = 0x7e;
     long_payload[450] = '\n';
-    long_payload[451] = 0x53;   // footer
+    long_payload[451] = 0xc6;   // footer
     long_payload[452] = 0xf9;
     for (int i = 0; i < 5; ++i) {
         // inject the whole payload (i=0) and then per 1,2,3,4 bytes (i)
@@ -324,6 +718,24 @@ TEST_CASE("Test CMUX protocol by injecting payloads", "[esp_modem]")
         }, 1000);
         CHECK(ret == command_result::OK);
     }
+
+    // UI frame, its FCS covers the payload as well
+    uint8_t ui_payload[] = {0xf9, 0x09, 0x13, 0x0b, 0x54, 0x65, 0x73, 0x74, 0x0a, 0x8b, 0xf9 };
+    loopback->inject(&ui_payload[0], sizeof(ui_payload), 1);
+    ret = dce->command(test_command, [&](uint8_t *data, size_t len) {
+        std::string response((char *) data, len);
+        CHECK(response == test_command);
+        return command_result::OK;
+    }, 1000);
+    CHECK(ret == command_result::OK);
+
+    // corrupted UI frame payload fails the FCS check and gets dropped
+    ui_payload[5] = 0x45;
+    loopback->inject(&ui_payload[0], sizeof(ui_payload), 1);
+    ret = dce->command(test_command, [&](uint8_t *data, size_t len) {
+        return command_result::OK;
+    }, 500);
+    CHECK(ret == command_result::TIMEOUT);
 }
 
 TEST_CASE("Command and Data mode transitions", "[esp_modem][transitions]")
@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+
+// Benchmarks of the DTE and CMUX paths against the modem simulator, hidden from the default run.
+// Each measurement is appended as one JSON line to the file given by BENCHMARK_RESULTS (stdout if not set).
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <catch2/catch_test_macros.hpp>
+#include "cxx_include/esp_modem_api.hpp"
+#include "esp_modem_config.h"
+#include "vfs_resource/vfs_create.hpp"
+
+using namespace esp_modem;
+using namespace std::chrono;
+
+namespace {
+
+int env_int(const char *name, int default_value)
+{
+    const char *env = std::getenv(name);
+    return env ? std::atoi(env) : default_value;
+}
+
+std::shared_ptr<DTE> create_benchmark_dte()
+{
+    esp_modem_dte_config_t dte_config = {
+        .dte_buffer_size = static_cast<size_t>(env_int("BENCH_DTE_BUFFER_SIZE", 1024)),
+        .task_stack_size = 4096,
+        .task_priority = 5,
+        .vfs_config = {}
+    };
+
+    struct esp_modem_vfs_socket_creator socket_config = {
+        .host_name = "127.0.0.1",
+        .port = env_int("MODEM_SIM_PORT", 10000)
+    };
+
+    if (!vfs_create_socket(&socket_config, &dte_config.vfs_config)) {
+        return nullptr;
+    }
+    return create_vfs_dte(&dte_config);
+}
+
+/**
+ * Appends one result with the simulator link configuration, so results of different runs can be compared
+ */
+void record(const std::string &benchmark, const char *mode, const std::string &fields)
+{
+    char line[512];
+    snprintf(line, sizeof(line),
+             "{\"benchmark\":\"%s\",\"mode\":\"%s\",\"link_rate\":%d,\"batch_size\":%d,\"batch_delay_ms\":%d,%s}\n",
+             benchmark.c_str(), mode, env_int("MODEM_SIM_LINK_RATE", 0), env_int("MODEM_SIM_BATCH_SIZE", 0),
+             env_int("MODEM_SIM_BATCH_DELAY_MS", 1), fields.c_str());
+    const char *path = std::getenv("BENCHMARK_RESULTS");
+    FILE *out = path ? fopen(path, "a") : stdout;
+    REQUIRE(out != nullptr);
+    fputs(line, out);
+    if (out != stdout) {
+        fclose(out);
+    }
+}
+
+const char *mode_name(modem_mode mode)
+{
+    return mode == modem_mode::CMUX_MODE ? "cmux" : mode == modem_mode::DATA_MODE ? "data" : "command";
+}
+
+void at_round_trip(modem_mode mode)
+{
+    auto dte = create_benchmark_dte();
+    REQUIRE(dte != nullptr);
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("internet");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    REQUIRE(dce != nullptr);
+    if (mode == modem_mode::CMUX_MODE) {
+        // commands are sent on the second virtual terminal, while the first one is in data mode
+        REQUIRE(dce->set_mode(modem_mode::CMUX_MODE));
+    }
+
+    const int samples = env_int("BENCH_AT_SAMPLES", 100);
+    std::vector<int64_t> us;
+    us.reserve(samples);
+    for (int i = 0; i < samples; i++) {
+        int rssi, ber;
+        auto start = steady_clock::now();
+        REQUIRE(dce->get_signal_quality(rssi, ber) == command_result::OK);
+        us.push_back(duration_cast<microseconds>(steady_clock::now() - start).count());
+    }
+    std::sort(us.begin(), us.end());
+    int64_t total = 0;
+    for (auto t : us) {
+        total += t;
+    }
+
+    char fields[256];
+    snprintf(fields, sizeof(fields),
+             "\"samples\":%d,\"min_us\":%" PRId64 ",\"median_us\":%" PRId64 ",\"p95_us\":%" PRId64 ",\"max_us\":%" PRId64 ",\"mean_us\":%" PRId64,
+             samples, us.front(), us[us.size() / 2], us[us.size() * 95 / 100], us.back(), total / samples);
+    record("at_round_trip", mode_name(mode), fields);
+}
+
+/**
+ * Sends PPP-like frames which the simulator loops back, keeping at most `window` bytes in flight,
+ * and measures the time until all of them are received by the netif
+ */
+void ppp_bulk(modem_mode mode)
+{
+    auto dte = create_benchmark_dte();
+    REQUIRE(dte != nullptr);
+    esp_modem_dce_config_t dce_config = ESP_MODEM_DCE_DEFAULT_CONFIG("internet");
+    esp_netif_t netif{};
+    auto dce = create_SIM7600_dce(&dce_config, dte, &netif);
+    REQUIRE(dce != nullptr);
+    REQUIRE(dce->set_mode(mode));
+    REQUIRE(netif.transmit != nullptr);
+
+    const size_t total = env_int("BENCH_PPP_BYTES", 64 * 1024);
+    const size_t frame_size = env_int("BENCH_PPP_FRAME_SIZE", 1500);
+    const size_t window = env_int("BENCH_PPP_WINDOW", 8 * 1024);
+    const int timeout_ms = env_int("BENCH_PPP_TIMEOUT_MS", 60000);
+
+    // flags around the payload, which avoids '+' so the simulator never sees an escape sequence
+    std::vector<uint8_t> frame(frame_size);
+    for (size_t i = 0; i < frame_size; i++) {
+        frame[i] = '0' + (i % 64);
+    }
+    frame.front() = frame.back() = 0x7E;
+
+    auto start = steady_clock::now();
+    auto deadline = start + milliseconds(timeout_ms);
+    size_t sent = 0;
+    NetifStats stats = dce->get_netif_stats();
+    while (stats.rx_bytes < total && steady_clock::now() < deadline) {
+        size_t len = std::min(frame_size, total - sent);
+        if (len > 0 && sent + len - stats.rx_bytes <= window) {
+            netif.transmit(netif.ctx, frame.data(), len);
+            sent += len;
+            continue;
+        }
+        usleep(100);
+        stats = dce->get_netif_stats();
+    }
+    double seconds = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+    CHECK(stats.rx_bytes == total);
+    CHECK(stats.rx_dropped == 0);
+
+    char fields[256];
+    snprintf(fields, sizeof(fields),
+             "\"bytes\":%" PRIu32 ",\"seconds\":%.3f,\"kbit_per_s\":%.1f,\"rx_chunks\":%" PRIu32 ",\"mean_chunk\":%.1f",
+             stats.rx_bytes, seconds, stats.rx_bytes * 8 / 1000.0 / seconds,
+             stats.rx_chunks, stats.rx_chunks ? static_cast<double>(stats.rx_bytes) / stats.rx_chunks : 0.0);
+    record("ppp_bulk", mode_name(mode), fields);
+}
+
+} // namespace
+
+TEST_CASE("AT command round-trip latency", "[esp_modem][.][benchmark]")
+{
+    SECTION("command mode") {
+        at_round_trip(modem_mode::COMMAND_MODE);
+    }
+    SECTION("CMUX") {
+        at_round_trip(modem_mode::CMUX_MODE);
+    }
+}
+
+TEST_CASE("PPP bulk throughput", "[esp_modem][.][benchmark]")
+{
+    SECTION("data mode") {
+        ppp_bulk(modem_mode::DATA_MODE);
+    }
+    SECTION("CMUX") {
+        ppp_bulk(modem_mode::CMUX_MODE);
+    }
+}
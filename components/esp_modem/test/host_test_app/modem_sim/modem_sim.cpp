@@ -4,14 +4,18 @@
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <chrono>
 #include <string>
+#include <thread>
 #include <unistd.h>
 #include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <errno.h>
@@ -19,6 +23,30 @@
 static volatile bool running = true;
 static int batch_size = 0;      // 0 = send whole response at once
 static int batch_delay_ms = 1;  // delay between batches (ms)
+static int link_rate = 0;       // emulated link rate (baud, 8N1), 0 = unlimited
+
+// CMUX (3GPP TS 27.010) frame fields
+static const uint8_t SOF_MARKER = 0xF9;
+static const uint8_t FT_SABM = 0x2F;
+static const uint8_t FT_DISC = 0x43;
+static const uint8_t FT_UA = 0x63;
+static const uint8_t FT_UIH = 0xEF;
+static const uint8_t PF = 0x10;
+static const uint8_t CMD_PN = 0x83;
+static const uint8_t CMD_CLD = 0xC3;
+static const uint8_t CMD_MSC = 0xE3;
+static const size_t CMUX_MAX_DLCI = 63;
+
+enum class sim_mode { COMMAND, DATA, CMUX };
+
+struct client_state {
+    int fd;
+    sim_mode mode = sim_mode::COMMAND;
+    std::string pending;                        // received data, not processed yet
+    std::string dlc_pending[CMUX_MAX_DLCI + 1]; // AT commands received on virtual terminals
+    bool dlc_data[CMUX_MAX_DLCI + 1] = {};      // virtual terminals in data mode
+    std::chrono::steady_clock::time_point link_free;
+};
 
 static void signal_handler(int sig)
 {
@@ -63,6 +91,9 @@ static std::string process_at_command(const std::string &command)
     if (command.find("AT+CFUN") != std::string::npos) {
         return "OK\r\n";
     }
+    if (command.find("ATD*99") != std::string::npos) {
+        return "CONNECT\r\n";
+    }
     if (command.find("AT") != std::string::npos) {
         return "OK\r\n";
     }
@@ -78,35 +109,56 @@ static void print_escaped(const char *prefix, const std::string &s)
     printf("\n");
 }
 
-static void send_response(int fd, const std::string &cmd, const std::string &response)
+/**
+ * Writes data to the client in chunks of batch_size (random sizes up to -batch_size if negative),
+ * each delivered after the time it takes to transmit it at link_rate
+ */
+static void send_bytes(client_state &client, const char *data, size_t len)
 {
-    print_escaped("modem_sim: rx ", cmd);
-    if (batch_size > 0) {
-        printf("modem_sim: tx [%zu] in batches of %d, delay %dms\n",
-               response.size(), batch_size, batch_delay_ms);
-    } else {
-        print_escaped("modem_sim: tx ", response);
-    }
-    fflush(stdout);
-
+    using namespace std::chrono;
     size_t total = 0;
-    while (total < response.size()) {
-        size_t chunk = response.size() - total;
+    while (total < len) {
+        size_t chunk = len - total;
         if (batch_size > 0 && chunk > (size_t)batch_size) {
             chunk = batch_size;
+        } else if (batch_size < 0) {
+            chunk = std::min(chunk, (size_t)(1 + rand() % -batch_size));
         }
-        ssize_t sent = write(fd, response.c_str() + total, chunk);
-        if (sent < 0) {
-            perror("modem_sim: write error");
-            return;
+        if (link_rate > 0) {
+            // 10 bits per byte (8N1), the link stays busy until the previous chunk is transmitted
+            auto start = std::max(steady_clock::now(), client.link_free);
+            client.link_free = start + microseconds(chunk * 10 * 1000000 / link_rate);
+            std::this_thread::sleep_until(client.link_free);
         }
-        total += sent;
-        if (batch_size > 0 && total < response.size() && batch_delay_ms > 0) {
+        size_t sent = 0;
+        while (sent < chunk) {
+            ssize_t ret = write(client.fd, data + total + sent, chunk - sent);
+            if (ret < 0) {
+                perror("modem_sim: write error");
+                return;
+            }
+            sent += ret;
+        }
+        total += chunk;
+        if (batch_size != 0 && total < len && batch_delay_ms > 0) {
             usleep(batch_delay_ms * 1000);
         }
     }
 }
 
+static void send_response(client_state &client, const std::string &cmd, const std::string &response)
+{
+    print_escaped("modem_sim: rx ", cmd);
+    if (batch_size != 0) {
+        printf("modem_sim: tx [%zu] in batches of %d, delay %dms\n",
+               response.size(), batch_size, batch_delay_ms);
+    } else {
+        print_escaped("modem_sim: tx ", response);
+    }
+    fflush(stdout);
+    send_bytes(client, response.c_str(), response.size());
+}
+
 static void send_urc_event_response(int fd, const std::string &cmd)
 {
     const std::string urc = "+URCTEST: event\r\n";
@@ -137,10 +189,219 @@ static void send_urc_discard_response(int fd, const std::string &cmd)
     write(fd, ok.c_str(), ok.size());
 }
 
+static uint8_t cmux_fcs(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0xFF;
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x01) ? (crc >> 1) ^ 0xE0 : crc >> 1;
+        }
+    }
+    return 0xFF - crc;
+}
+
+static void cmux_send(client_state &client, size_t dlci, uint8_t type, const std::string &payload)
+{
+    std::string frame = { (char)SOF_MARKER, (char)((dlci << 2) | 0x03), (char)type };
+    if (payload.size() <= 127) {
+        frame.push_back((char)((payload.size() << 1) | 0x01));
+    } else {
+        frame.push_back((char)((payload.size() & 0x7F) << 1));
+        frame.push_back((char)(payload.size() >> 7));
+    }
+    uint8_t fcs = cmux_fcs((const uint8_t *)frame.data() + 1, frame.size() - 1);
+    frame += payload;
+    frame.push_back((char)fcs);
+    frame.push_back((char)SOF_MARKER);
+    send_bytes(client, frame.data(), frame.size());
+}
+
+/**
+ * Answers AT commands received in command mode or on a virtual terminal,
+ * returns the mode the terminal switches to
+ */
+static sim_mode process_command(client_state &client, const std::string &cmd, size_t dlci)
+{
+    if (dlci == 0 && cmd.find("AT+URCTEST0\r") != std::string::npos) {
+        send_urc_event_response(client.fd, cmd);
+        return sim_mode::COMMAND;
+    }
+    if (dlci == 0 && cmd.find("AT+URCTEST1\r") != std::string::npos) {
+        send_urc_discard_response(client.fd, cmd);
+        return sim_mode::COMMAND;
+    }
+    std::string response = process_at_command(cmd);
+    if (dlci == 0) {
+        send_response(client, cmd, response);
+    } else {
+        print_escaped("modem_sim: rx (cmux) ", cmd);
+        fflush(stdout);
+        cmux_send(client, dlci, FT_UIH, response);
+    }
+    if (response.rfind("CONNECT", 0) == 0) {
+        return sim_mode::DATA;
+    }
+    if (dlci == 0 && cmd.find("AT+CMUX=0\r") != std::string::npos) {
+        return sim_mode::CMUX;
+    }
+    return sim_mode::COMMAND;
+}
+
+static void process_control_message(client_state &client, std::string &msg)
+{
+    if (msg.empty()) {
+        return;
+    }
+    uint8_t type = msg[0];
+    if (type == CMD_PN || type == CMD_MSC) {
+        // accept the proposed parameters, respond with the same message
+        msg[0] = (char)(type & ~0x02);
+        cmux_send(client, 0, FT_UIH, msg);
+    } else if (type == CMD_CLD) {
+        cmux_send(client, 0, FT_UIH, std::string("\xC1\x01", 2));
+        printf("modem_sim: CMUX closed\n");
+        fflush(stdout);
+        client.mode = sim_mode::COMMAND;
+        for (size_t i = 0; i <= CMUX_MAX_DLCI; i++) {
+            client.dlc_pending[i].clear();
+            client.dlc_data[i] = false;
+        }
+    }
+}
+
+static void process_cmux_frame(client_state &client, size_t dlci, uint8_t type, std::string &payload)
+{
+    if ((type & ~PF) == FT_SABM || (type & ~PF) == FT_DISC) {
+        cmux_send(client, dlci, FT_UA | PF, "");
+        if ((type & ~PF) == FT_SABM && dlci > 0) {
+            // report the modem status once the DLC is open, like most devices do
+            std::string msc = { (char)CMD_MSC, 0x05, (char)((dlci << 2) | 0x03), 0x0D };
+            cmux_send(client, 0, FT_UIH, msc);
+        }
+        client.dlc_data[dlci] = false;
+        return;
+    }
+    if ((type & ~PF) != FT_UIH) {
+        return;
+    }
+    if (dlci == 0) {
+        process_control_message(client, payload);
+    } else if (client.dlc_data[dlci]) {
+        if (payload == "+++") {
+            client.dlc_data[dlci] = false;
+            cmux_send(client, dlci, FT_UIH, "OK\r\n");
+        } else {
+            // loop the PPP data back
+            cmux_send(client, dlci, FT_UIH, payload);
+        }
+    } else {
+        std::string &pending = client.dlc_pending[dlci];
+        pending += payload;
+        size_t pos;
+        while ((pos = pending.find('\r')) != std::string::npos) {
+            std::string cmd = pending.substr(0, pos + 1);
+            pending.erase(0, pos + 1);
+            if (process_command(client, cmd, dlci) == sim_mode::DATA) {
+                client.dlc_data[dlci] = true;
+            }
+        }
+    }
+}
+
+/**
+ * Processes complete CMUX frames, returns false if more data is needed
+ */
+static bool process_cmux(client_state &client)
+{
+    std::string &rx = client.pending;
+    // skip the flags between frames
+    size_t start = rx.find_first_not_of((char)SOF_MARKER);
+    if (start == std::string::npos) {
+        rx.clear();
+        return false;
+    }
+    rx.erase(0, start);
+    if (rx.size() < 3) {
+        return false;
+    }
+    size_t header_len = (rx[2] & 0x01) ? 3 : 4;
+    if (rx.size() < header_len) {
+        return false;
+    }
+    size_t len = (uint8_t)rx[2] >> 1;
+    if (header_len == 4) {
+        len += (uint8_t)rx[3] << 7;
+    }
+    if (rx.size() < header_len + len + 2) {
+        return false;
+    }
+    if ((uint8_t)rx[header_len + len + 1] != SOF_MARKER ||
+            (uint8_t)rx[header_len + len] != cmux_fcs((const uint8_t *)rx.data(), header_len)) {
+        printf("modem_sim: invalid CMUX frame, skipping\n");
+        fflush(stdout);
+        rx.erase(0, 1);
+        return true;
+    }
+    size_t dlci = (uint8_t)rx[0] >> 2;
+    uint8_t type = rx[1];
+    std::string payload = rx.substr(header_len, len);
+    rx.erase(0, header_len + len + 1);
+    process_cmux_frame(client, dlci, type, payload);
+    return true;
+}
+
+/**
+ * Processes received data according to the current mode, returns false if more data is needed
+ */
+static bool process(client_state &client)
+{
+    std::string &pending = client.pending;
+    switch (client.mode) {
+    case sim_mode::DATA:
+        if (pending == "+++") {
+            client.mode = sim_mode::COMMAND;
+            send_response(client, pending, "NO CARRIER\r\n");
+        } else {
+            // loop the PPP data back
+            send_bytes(client, pending.data(), pending.size());
+        }
+        pending.clear();
+        return false;
+    case sim_mode::CMUX:
+        return process_cmux(client);
+    case sim_mode::COMMAND:
+        break;
+    }
+
+    // Handle "+++" escape sequence (no \r)
+    size_t ppp_pos = pending.find("+++");
+    if (ppp_pos != std::string::npos && pending.find('\r') == std::string::npos) {
+        std::string response = "NO CARRIER\r\n";
+        send_response(client, "+++", response);
+        pending.erase(0, ppp_pos + 3);
+        return false;
+    }
+
+    size_t pos = pending.find('\r');
+    if (pos == std::string::npos) {
+        return false;
+    }
+    std::string cmd = pending.substr(0, pos + 1);
+    pending.erase(0, pos + 1);
+    client.mode = process_command(client, cmd, 0);
+    if (client.mode != sim_mode::COMMAND) {
+        printf("modem_sim: entering %s mode\n", client.mode == sim_mode::DATA ? "data" : "CMUX");
+        fflush(stdout);
+    }
+    return !pending.empty();
+}
+
 static void handle_client(int client_fd)
 {
-    char buf[1024];
-    std::string pending;
+    char buf[4096];
+    client_state client;
+    client.fd = client_fd;
 
     printf("modem_sim: client connected\n");
     fflush(stdout);
@@ -158,10 +419,10 @@ static void handle_client(int client_fd)
         }
         if (ret == 0) {
             // Check for "+++" pattern (no \r terminator)
-            if (pending.find("+++") != std::string::npos) {
+            if (client.mode == sim_mode::COMMAND && client.pending.find("+++") != std::string::npos) {
                 std::string response = "NO CARRIER\r\n";
-                send_response(client_fd, pending, response);
-                pending.clear();
+                send_response(client, client.pending, response);
+                client.pending.clear();
             }
             continue;
         }
@@ -176,44 +437,19 @@ static void handle_client(int client_fd)
             break;
         }
 
-        pending.append(buf, n);
-
-        // Handle "+++" escape sequence (no \r)
-        size_t ppp_pos = pending.find("+++");
-        if (ppp_pos != std::string::npos && pending.find('\r') == std::string::npos) {
-            std::string response = "NO CARRIER\r\n";
-            send_response(client_fd, "+++", response);
-            pending.erase(0, ppp_pos + 3);
-            continue;
-        }
-
-        size_t pos;
-        while ((pos = pending.find('\r')) != std::string::npos) {
-            std::string cmd = pending.substr(0, pos + 1);
-            pending.erase(0, pos + 1);
-
-            if (cmd.find("AT+URCTEST0\r") != std::string::npos) {
-                send_urc_event_response(client_fd, cmd);
-                continue;
-            }
-
-            if (cmd.find("AT+URCTEST1\r") != std::string::npos) {
-                send_urc_discard_response(client_fd, cmd);
-                continue;
-            }
-
-            std::string response = process_at_command(cmd);
-            send_response(client_fd, cmd, response);
+        client.pending.append(buf, n);
+        while (process(client)) {
         }
     }
 }
 
 static void usage(const char *prog)
 {
-    printf("Usage: %s [port] [batch_size] [batch_delay_ms]\n"
+    printf("Usage: %s [port] [batch_size] [batch_delay_ms] [link_rate]\n"
            "  port           TCP listen port (default: 10000)\n"
-           "  batch_size     reply chunk size in bytes, 0=whole (default: 0)\n"
-           "  batch_delay_ms delay between chunks in ms (default: 1)\n", prog);
+           "  batch_size     reply chunk size in bytes, 0=whole, <0=random up to -batch_size (default: 0)\n"
+           "  batch_delay_ms delay between chunks in ms (default: 1)\n"
+           "  link_rate      emulated link rate in baud, 0=unlimited (default: 0)\n", prog);
 }
 
 int main(int argc, char *argv[])
@@ -232,6 +468,11 @@ int main(int argc, char *argv[])
     if (argc > 3) {
         batch_delay_ms = atoi(argv[3]);
     }
+    if (argc > 4) {
+        link_rate = atoi(argv[4]);
+    }
+    // random fragmentation is reproducible between runs
+    srand(1);
 
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
@@ -263,8 +504,8 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    printf("modem_sim: listening on 127.0.0.1:%d (batch_size=%d, batch_delay=%dms)\n",
-           port, batch_size, batch_delay_ms);
+    printf("modem_sim: listening on 127.0.0.1:%d (batch_size=%d, batch_delay=%dms, link_rate=%d)\n",
+           port, batch_size, batch_delay_ms, link_rate);
     fflush(stdout);
 
     while (running) {
@@ -279,6 +520,8 @@ int main(int argc, char *argv[])
             break;
         }
 
+        // send every chunk right away, as a serial line would
+        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
         handle_client(client_fd);
         close(client_fd);
     }
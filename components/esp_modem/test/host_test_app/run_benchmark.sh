@@ -0,0 +1,74 @@
+#!/bin/bash
+#
+# SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# Benchmark harness: runs the benchmarks of the test app against the modem simulator
+# for every combination of link rate and fragmentation, collects results as JSON lines.
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PORT="${MODEM_SIM_PORT:-10000}"
+LINK_RATES="${BENCH_LINK_RATES:-0 921600 115200}"         # baud, 0 = unlimited
+FRAGMENTS="${BENCH_FRAGMENTS:-0:0 64:0 -64:0}"              # batch_size:batch_delay_ms, negative size = random chunks
+SIM_BINARY="${SCRIPT_DIR}/modem_sim/build/modem_sim"
+TEST_BINARY="${SCRIPT_DIR}/build/host_test_app.elf"
+TEST_TIMEOUT="${TEST_TIMEOUT:-300}"
+export BENCHMARK_RESULTS="${BENCHMARK_RESULTS:-${SCRIPT_DIR}/build/benchmark_results.jsonl}"
+
+cleanup() {
+    if [ -n "$SIM_PID" ]; then
+        kill "$SIM_PID" 2>/dev/null
+        kill -9 "$SIM_PID" 2>/dev/null
+        wait "$SIM_PID" 2>/dev/null
+    fi
+    SIM_PID=
+}
+trap cleanup EXIT
+
+# --- Build modem_sim if needed ---
+if [ ! -f "$SIM_BINARY" ]; then
+    echo "Building modem_sim..."
+    cmake -S "${SCRIPT_DIR}/modem_sim" -B "${SCRIPT_DIR}/modem_sim/build"
+    cmake --build "${SCRIPT_DIR}/modem_sim/build"
+fi
+
+# --- Check test binary ---
+if [ ! -f "$TEST_BINARY" ]; then
+    echo "Error: test binary not found at $TEST_BINARY"
+    echo "Build with: idf.py --preview set-target linux && idf.py build"
+    exit 1
+fi
+
+: > "$BENCHMARK_RESULTS"
+RESULT=0
+
+for rate in $LINK_RATES; do
+    for fragment in $FRAGMENTS; do
+        batch_size="${fragment%%:*}"
+        batch_delay="${fragment##*:}"
+        echo "Benchmark: link_rate=$rate, batch_size=$batch_size, batch_delay=${batch_delay}ms"
+
+        "$SIM_BINARY" "$PORT" "$batch_size" "$batch_delay" "$rate" > /dev/null &
+        SIM_PID=$!
+        sleep 0.5
+        if ! kill -0 "$SIM_PID" 2>/dev/null; then
+            echo "Error: modem_sim failed to start"
+            exit 1
+        fi
+
+        MODEM_SIM_PORT="$PORT" MODEM_SIM_LINK_RATE="$rate" MODEM_SIM_BATCH_SIZE="$batch_size" \
+            MODEM_SIM_BATCH_DELAY_MS="$batch_delay" \
+            timeout --signal=KILL "$TEST_TIMEOUT" "$TEST_BINARY" "[benchmark]" > /dev/null
+        TEST_RESULT=$?
+        if [ $TEST_RESULT -ne 0 ]; then
+            echo "Error: benchmark failed (exit code: $TEST_RESULT)"
+            RESULT=$TEST_RESULT
+        fi
+        cleanup
+    done
+done
+
+echo ""
+echo "Results written to $BENCHMARK_RESULTS"
+cat "$BENCHMARK_RESULTS"
+exit $RESULT
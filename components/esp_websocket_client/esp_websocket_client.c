@@ -23,6 +23,15 @@
 #include "esp_system.h"
 #include <errno.h>
 #include <arpa/inet.h>
+#include <sys/random.h>
+
+#if CONFIG_ESP_WS_CLIENT_PERMESSAGE_DEFLATE && WS_TRANSPORT_HEADER_CALLBACK_SUPPORT
+// The server's answer to the extension offer is read by the handshake header callback
+#define WS_PERMESSAGE_DEFLATE_SUPPORT   1
+#include "zlib.h"
+#else
+#define WS_PERMESSAGE_DEFLATE_SUPPORT   0
+#endif
 
 static const char *TAG = "websocket_client";
 
@@ -64,6 +73,15 @@ static const char *TAG = "websocket_client";
 #define WEBSOCKET_KEEP_ALIVE_IDLE       (5)
 #define WEBSOCKET_KEEP_ALIVE_INTERVAL   (5)
 #define WEBSOCKET_KEEP_ALIVE_COUNT      (3)
+#define WEBSOCKET_POLL_TIMEOUT_MS       (1000)
+
+#define WS_FRAME_MASK_BIT               (0x80)
+#define WS_FRAME_RSV1_BIT               (0x40)
+#define WS_FRAME_CONTROL_BIT            (0x08)
+#define WS_FRAME_MASK_LEN               (4)
+#define WS_CONTROL_MAX_PAYLOAD          (125)
+#define WS_FRAME_MAX_HEADER_LEN         (14)
+#define WS_RSV_QUEUE_LEN                (256)
 
 #ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
 #define WEBSOCKET_TX_LOCK_TIMEOUT_MS    (CONFIG_ESP_WS_CLIENT_TX_LOCK_TIMEOUT_MS)
@@ -141,6 +159,9 @@ typedef struct {
     const char                  *cert_common_name;
     esp_err_t (*crt_bundle_attach)(void *conf);
     esp_transport_handle_t      ext_transport;
+    int                         tx_coalesce_ms;
+    esp_websocket_permessage_deflate_config_t permessage_deflate;
+    int                         max_message_len;
 } websocket_config_storage_t;
 
 typedef enum {
@@ -152,6 +173,26 @@ typedef enum {
     WEBSOCKET_STATE_CLOSING,
 } websocket_client_state_t;
 
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+typedef struct {
+    bool                        negotiated;                 /*!< The server accepted the extension in the last handshake */
+    bool                        invalid;                    /*!< The server's extension response can't be accepted */
+    bool                        active;                     /*!< The streams are set up for the current connection */
+    int                         client_window_bits;
+    int                         server_window_bits;
+    bool                        client_no_context_takeover;
+    bool                        server_no_context_takeover;
+    z_stream                    deflater;
+    z_stream                    inflater;
+    uint8_t                     *tx_out;                    /*!< Compressed payload of the frame being sent, buffer_size bytes */
+    uint8_t                     *rx_out;                    /*!< Inflated payload of the frame being received, buffer_size + 1 bytes */
+    int                         rx_out_len;                 /*!< Inflated bytes in rx_out, which haven't been dispatched yet */
+    int                         rx_offset;                  /*!< Inflated bytes of the current frame dispatched so far */
+    bool                        rx_compressed;              /*!< The message being received has RSV1 set in its first frame */
+    esp_transport_handle_t      rsv_layer;                  /*!< Transport under the websocket layer which reports RSV1, the extension is offered only with it */
+} websocket_deflate_t;
+#endif
+
 struct esp_websocket_client {
     esp_event_loop_handle_t     event_handle;
     TaskHandle_t                task_handle;
@@ -178,13 +219,23 @@ struct esp_websocket_client {
     char                        *rx_buffer;
     char                        *tx_buffer;
     int                         buffer_size;
+    esp_transport_handle_t      tx_parent;          /*!< Transport under the websocket layer, coalesced frames are written directly to it */
+    int                         tx_pending_len;     /*!< Length of the coalesced frames in tx_buffer, which haven't been sent yet */
+    uint64_t                    tx_pending_tick_ms; /*!< Time when the oldest coalesced frame was queued */
     bool                        last_fin;
     ws_transport_opcodes_t      last_opcode;
     int                         payload_len;
     int                         payload_offset;
     int                         close_status_code;  /*!< Status code from the last received CLOSE frame (0 = none / client-initiated) */
+    char                        *rx_msg_buffer;     /*!< Slab the received messages are reassembled in, reused for every message */
+    int                         rx_msg_size;        /*!< Size of rx_msg_buffer, a multiple of buffer_size */
+    int                         rx_msg_len;         /*!< Length of the message reassembled so far */
+    ws_transport_opcodes_t      rx_msg_opcode;      /*!< Opcode of the first frame of the message being reassembled */
     esp_transport_keep_alive_t  keep_alive_cfg;
     struct ifreq                *if_name;
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    websocket_deflate_t         *deflate;           /*!< permessage-deflate state, NULL if the extension isn't offered */
+#endif
 };
 
 static uint64_t _tick_get_ms(void)
@@ -192,6 +243,16 @@ static uint64_t _tick_get_ms(void)
     return esp_timer_get_time() / 1000;
 }
 
+/**
+ * @brief Returns the transport which keeps the TCP/TLS errors
+ *
+ * The websocket transport shares its error state with its parent, unless the RSV1 layer sits in between.
+ */
+static esp_transport_handle_t esp_websocket_client_error_transport(esp_websocket_client_handle_t client)
+{
+    return client->tx_parent ? client->tx_parent : client->transport;
+}
+
 static esp_err_t esp_websocket_new_buf(esp_websocket_client_handle_t client, bool is_tx)
 {
 #ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
@@ -227,6 +288,12 @@ static void esp_websocket_free_buf(esp_websocket_client_handle_t client, bool is
             free(client->rx_buffer);
             client->rx_buffer = NULL;
         }
+        // The reassembly slab is only kept while a message is in progress
+        if (client->rx_msg_buffer && client->rx_msg_len == 0) {
+            free(client->rx_msg_buffer);
+            client->rx_msg_buffer = NULL;
+            client->rx_msg_size = 0;
+        }
     }
 #endif
 }
@@ -250,12 +317,12 @@ static esp_err_t esp_websocket_client_dispatch_event(esp_websocket_client_handle
     event_data.close_status_code = client->close_status_code;
 
     if (client->error_handle.error_type == WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT) {
-        event_data.error_handle.esp_tls_last_esp_err = esp_tls_get_and_clear_last_error(esp_transport_get_error_handle(client->transport),
+        event_data.error_handle.esp_tls_last_esp_err = esp_tls_get_and_clear_last_error(esp_transport_get_error_handle(esp_websocket_client_error_transport(client)),
                                                                                         &client->error_handle.esp_tls_stack_err,
                                                                                         &client->error_handle.esp_tls_cert_verify_flags);
         event_data.error_handle.esp_tls_stack_err = client->error_handle.esp_tls_stack_err;
         event_data.error_handle.esp_tls_cert_verify_flags = client->error_handle.esp_tls_cert_verify_flags;
-        event_data.error_handle.esp_transport_sock_errno = esp_transport_get_errno(client->transport);
+        event_data.error_handle.esp_transport_sock_errno = esp_transport_get_errno(esp_websocket_client_error_transport(client));
     }
     event_data.error_handle.error_type = client->error_handle.error_type;
     event_data.error_handle.esp_ws_handshake_status_code = client->error_handle.esp_ws_handshake_status_code;
@@ -490,6 +557,36 @@ static esp_err_t esp_websocket_client_set_config(esp_websocket_client_handle_t c
         cfg->ping_interval_sec = config->ping_interval_sec;
     }
 
+    cfg->tx_coalesce_ms = config->tx_coalesce_ms > 0 ? config->tx_coalesce_ms : 0;
+    cfg->max_message_len = config->max_message_len > 0 ? config->max_message_len : 0;
+
+    if (config->permessage_deflate.enable) {
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+        const esp_websocket_permessage_deflate_config_t *deflate_cfg = &config->permessage_deflate;
+        // zlib can't make raw deflate streams with 256 byte windows, the server may use them
+        if ((deflate_cfg->client_max_window_bits != 0 && (deflate_cfg->client_max_window_bits < 9 || deflate_cfg->client_max_window_bits > 15)) ||
+                (deflate_cfg->server_max_window_bits != 0 && (deflate_cfg->server_max_window_bits < 8 || deflate_cfg->server_max_window_bits > 15)) ||
+                (deflate_cfg->mem_level != 0 && (deflate_cfg->mem_level < 1 || deflate_cfg->mem_level > 9))) {
+            ESP_LOGE(TAG, "Invalid permessage-deflate configuration");
+            return ESP_ERR_INVALID_ARG;
+        }
+        cfg->permessage_deflate = *deflate_cfg;
+        if (cfg->permessage_deflate.client_max_window_bits == 0) {
+            cfg->permessage_deflate.client_max_window_bits = 15;
+        }
+        if (cfg->permessage_deflate.mem_level == 0) {
+            cfg->permessage_deflate.mem_level = 8;
+        }
+        free(client->deflate);
+        client->deflate = calloc(1, sizeof(websocket_deflate_t));
+        ESP_WS_CLIENT_MEM_CHECK(TAG, client->deflate, return ESP_ERR_NO_MEM);
+#elif CONFIG_ESP_WS_CLIENT_PERMESSAGE_DEFLATE
+        ESP_LOGW(TAG, "permessage-deflate needs ESP-IDF v6.0 or newer, the extension won't be offered");
+#else
+        ESP_LOGW(TAG, "permessage-deflate is not enabled (CONFIG_ESP_WS_CLIENT_PERMESSAGE_DEFLATE), the extension won't be offered");
+#endif
+    }
+
     return ESP_OK;
 }
 
@@ -518,6 +615,380 @@ static esp_err_t esp_websocket_client_destroy_config(esp_websocket_client_handle
     return ESP_OK;
 }
 
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+/**
+ * @brief Returns the additional headers of the opening handshake with the permessage-deflate offer, the caller frees it
+ */
+static char *esp_websocket_deflate_offer(esp_websocket_client_handle_t client, const char *headers)
+{
+    const esp_websocket_permessage_deflate_config_t *cfg = &client->config->permessage_deflate;
+    char client_bits[32] = "";
+    char server_bits[32] = "";
+    char *offer = NULL;
+
+    // Not offering client_max_window_bits with the default window, the server can't pick a smaller one then
+    if (cfg->client_max_window_bits < 15) {
+        snprintf(client_bits, sizeof(client_bits), "; client_max_window_bits=%d", cfg->client_max_window_bits);
+    }
+    if (cfg->server_max_window_bits) {
+        snprintf(server_bits, sizeof(server_bits), "; server_max_window_bits=%d", cfg->server_max_window_bits);
+    }
+    if (asprintf(&offer, "%sSec-WebSocket-Extensions: permessage-deflate%s%s%s%s\r\n", headers ? headers : "",
+                 client_bits, server_bits,
+                 cfg->client_no_context_takeover ? "; client_no_context_takeover" : "",
+                 cfg->server_no_context_takeover ? "; server_no_context_takeover" : "") < 0) {
+        return NULL;
+    }
+    return offer;
+}
+
+static char *esp_websocket_deflate_trim(char *str)
+{
+    while (*str == ' ' || *str == '\t') {
+        ++str;
+    }
+    char *end = str + strlen(str);
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t')) {
+        *--end = '\0';
+    }
+    return str;
+}
+
+/**
+ * @brief Reads the extension parameters accepted by the server from the Sec-WebSocket-Extensions response header
+ */
+static void esp_websocket_deflate_parse_response(esp_websocket_client_handle_t client, const char *line, int line_len)
+{
+    static const char header[] = "Sec-WebSocket-Extensions:";
+    const int header_len = sizeof(header) - 1;
+    websocket_deflate_t *ctx = client->deflate;
+    char value[128];
+
+    if (ctx == NULL || line_len < header_len || strncasecmp(line, header, header_len) != 0) {
+        return;
+    }
+    // Only one extension is offered, so a second one (or a second header) is an error
+    if (ctx->negotiated || line_len - header_len >= (int)sizeof(value) || memchr(line, ',', line_len) != NULL) {
+        ctx->invalid = true;
+        return;
+    }
+    memcpy(value, line + header_len, line_len - header_len);
+    value[line_len - header_len] = '\0';
+
+    char *saveptr = NULL;
+    char *param = strtok_r(value, ";", &saveptr);
+    if (param == NULL || strcmp(esp_websocket_deflate_trim(param), "permessage-deflate") != 0) {
+        ctx->invalid = true;
+        return;
+    }
+    ctx->negotiated = true;
+    while ((param = strtok_r(NULL, ";", &saveptr)) != NULL) {
+        char *arg = strchr(param, '=');
+        if (arg) {
+            *arg++ = '\0';
+            arg = esp_websocket_deflate_trim(arg);
+            if (*arg == '"' && strlen(arg) > 1 && arg[strlen(arg) - 1] == '"') {
+                arg[strlen(arg) - 1] = '\0';
+                ++arg;
+            }
+        }
+        param = esp_websocket_deflate_trim(param);
+        int bits = arg ? atoi(arg) : 0;
+        if (strcmp(param, "server_no_context_takeover") == 0 && arg == NULL) {
+            ctx->server_no_context_takeover = true;
+        } else if (strcmp(param, "client_no_context_takeover") == 0 && arg == NULL) {
+            ctx->client_no_context_takeover = true;
+        } else if (strcmp(param, "server_max_window_bits") == 0 && bits >= 8 && bits <= 15) {
+            ctx->server_window_bits = bits;
+        } else if (strcmp(param, "client_max_window_bits") == 0 && bits >= 9 && bits <= ctx->client_window_bits) {
+            ctx->client_window_bits = bits;
+        } else {
+            ESP_LOGE(TAG, "Unsupported permessage-deflate parameter: %s", param);
+            ctx->invalid = true;
+        }
+    }
+}
+
+/**
+ * @brief Forgets the extension parameters of the previous connection before a new handshake
+ */
+static void esp_websocket_deflate_reset_negotiation(esp_websocket_client_handle_t client)
+{
+    websocket_deflate_t *ctx = client->deflate;
+    if (ctx) {
+        ctx->negotiated = false;
+        ctx->invalid = false;
+        ctx->client_window_bits = client->config->permessage_deflate.client_max_window_bits;
+        ctx->server_window_bits = 15;
+        ctx->client_no_context_takeover = client->config->permessage_deflate.client_no_context_takeover;
+        ctx->server_no_context_takeover = false;
+    }
+}
+
+static void esp_websocket_deflate_end(esp_websocket_client_handle_t client)
+{
+    websocket_deflate_t *ctx = client->deflate;
+    if (ctx && ctx->active) {
+        deflateEnd(&ctx->deflater);
+        inflateEnd(&ctx->inflater);
+        free(ctx->tx_out);
+        free(ctx->rx_out);
+        ctx->tx_out = NULL;
+        ctx->rx_out = NULL;
+        ctx->active = false;
+    }
+}
+
+/**
+ * @brief Layer between the websocket transport and its parent, which takes note of RSV1 of the received frames
+ *
+ * The websocket transport doesn't report the RSV bits, so this layer follows the frame headers in the stream
+ * the websocket transport reads and queues RSV1 of every frame. The client takes one entry per frame it reads,
+ * which covers the frames the websocket transport buffered along with the handshake response, too.
+ */
+typedef struct {
+    esp_transport_handle_t      parent;
+    bool                        upgraded;                       /*!< The handshake response has been read, frames follow */
+    uint32_t                    response_tail;                  /*!< Last four bytes of the handshake response read so far */
+    uint8_t                     header[WS_FRAME_MAX_HEADER_LEN];
+    int                         header_len;                     /*!< Bytes of the current frame header read so far */
+    int                         header_size;                    /*!< Size of the current frame header, known from its second byte */
+    uint64_t                    payload_left;                   /*!< Payload bytes of the current frame which haven't been read */
+    uint8_t                     rsv1[WS_RSV_QUEUE_LEN / 8];     /*!< RSV1 of the frames the client hasn't taken yet */
+    int                         rsv1_head;
+    int                         rsv1_count;
+    bool                        recording;                      /*!< Frames are noted until the connection turns out uncompressed */
+} websocket_rsv_layer_t;
+
+static void esp_websocket_rsv_layer_reset(websocket_rsv_layer_t *layer)
+{
+    esp_transport_handle_t parent = layer->parent;
+    memset(layer, 0, sizeof(websocket_rsv_layer_t));
+    layer->parent = parent;
+    layer->header_size = 2;
+    layer->recording = true;
+}
+
+static void esp_websocket_rsv_layer_scan(websocket_rsv_layer_t *layer, const uint8_t *data, int len)
+{
+    int i = 0;
+    while (i < len) {
+        if (!layer->upgraded) {
+            layer->response_tail = (layer->response_tail << 8) | data[i++];
+            layer->upgraded = layer->response_tail == 0x0d0a0d0a;   // "\r\n\r\n" ends the response
+            continue;
+        }
+        if (layer->payload_left > 0) {
+            int skip = (layer->payload_left < (uint64_t)(len - i)) ? (int)layer->payload_left : len - i;
+            layer->payload_left -= skip;
+            i += skip;
+            continue;
+        }
+        uint8_t *header = layer->header;
+        header[layer->header_len++] = data[i++];
+        if (layer->header_len == 2) {
+            int len7 = header[1] & 0x7f;
+            layer->header_size = 2 + (len7 == 126 ? 2 : len7 == 127 ? 8 : 0) + ((header[1] & WS_FRAME_MASK_BIT) ? WS_FRAME_MASK_LEN : 0);
+        }
+        if (layer->header_len < 2 || layer->header_len < layer->header_size) {
+            continue;
+        }
+        uint64_t payload_len = header[1] & 0x7f;
+        if (payload_len >= 126) {
+            int ext_len = payload_len == 126 ? 2 : 8;
+            payload_len = 0;
+            for (int j = 0; j < ext_len; j++) {
+                payload_len = (payload_len << 8) | header[2 + j];
+            }
+        }
+        if (!layer->recording) {
+            // only the frame boundaries are followed
+        } else if (layer->rsv1_count < WS_RSV_QUEUE_LEN) {
+            int pos = (layer->rsv1_head + layer->rsv1_count) % WS_RSV_QUEUE_LEN;
+            if (header[0] & WS_FRAME_RSV1_BIT) {
+                layer->rsv1[pos / 8] |= 1 << (pos % 8);
+            } else {
+                layer->rsv1[pos / 8] &= ~(1 << (pos % 8));
+            }
+            layer->rsv1_count++;
+        } else {
+            ESP_LOGW(TAG, "Too many frames buffered, RSV1 not recorded");
+        }
+        layer->payload_left = payload_len;
+        layer->header_len = 0;
+        layer->header_size = 2;
+    }
+}
+
+/**
+ * @brief Takes RSV1 of the next frame read by the websocket transport
+ */
+static bool esp_websocket_rsv_layer_pop(esp_transport_handle_t t)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    if (layer->rsv1_count == 0) {
+        ESP_LOGW(TAG, "No RSV1 recorded for the received frame");
+        return false;
+    }
+    bool rsv1 = layer->rsv1[layer->rsv1_head / 8] & (1 << (layer->rsv1_head % 8));
+    layer->rsv1_head = (layer->rsv1_head + 1) % WS_RSV_QUEUE_LEN;
+    layer->rsv1_count--;
+    return rsv1;
+}
+
+/**
+ * @brief Stops noting RSV1 for the rest of the connection, as nobody takes it without compression
+ */
+static void esp_websocket_rsv_layer_stop(esp_transport_handle_t t)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    layer->recording = false;
+    layer->rsv1_count = 0;
+}
+
+static int esp_websocket_rsv_layer_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    esp_websocket_rsv_layer_reset(layer);
+    return esp_transport_connect(layer->parent, host, port, timeout_ms);
+}
+
+static int esp_websocket_rsv_layer_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    int rlen = esp_transport_read(layer->parent, buffer, len, timeout_ms);
+    if (rlen > 0) {
+        esp_websocket_rsv_layer_scan(layer, (const uint8_t *)buffer, rlen);
+    }
+    return rlen;
+}
+
+static int esp_websocket_rsv_layer_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    return esp_transport_write(layer->parent, buffer, len, timeout_ms);
+}
+
+static int esp_websocket_rsv_layer_close(esp_transport_handle_t t)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    return esp_transport_close(layer->parent);
+}
+
+static int esp_websocket_rsv_layer_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    return esp_transport_poll_read(layer->parent, timeout_ms);
+}
+
+static int esp_websocket_rsv_layer_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    websocket_rsv_layer_t *layer = esp_transport_get_context_data(t);
+    return esp_transport_poll_write(layer->parent, timeout_ms);
+}
+
+static int esp_websocket_rsv_layer_destroy(esp_transport_handle_t t)
+{
+    // the parent is destroyed with the transport list
+    free(esp_transport_get_context_data(t));
+    return 0;
+}
+
+/**
+ * @brief Creates the RSV1 layer over the given transport and adds it to the transport list, for cleanup
+ */
+static esp_transport_handle_t esp_websocket_rsv_layer_init(esp_websocket_client_handle_t client, esp_transport_handle_t parent)
+{
+    esp_transport_handle_t t = esp_transport_init();
+    websocket_rsv_layer_t *layer = calloc(1, sizeof(websocket_rsv_layer_t));
+    if (t == NULL || layer == NULL) {
+        free(layer);
+        if (t) {
+            esp_transport_destroy(t);
+        }
+        return NULL;
+    }
+    layer->parent = parent;
+    esp_websocket_rsv_layer_reset(layer);
+    esp_transport_set_context_data(t, layer);
+    esp_transport_set_func(t, esp_websocket_rsv_layer_connect, esp_websocket_rsv_layer_read, esp_websocket_rsv_layer_write,
+                           esp_websocket_rsv_layer_close, esp_websocket_rsv_layer_poll_read, esp_websocket_rsv_layer_poll_write,
+                           esp_websocket_rsv_layer_destroy);
+    esp_transport_list_add(client->transport_list, t, "_rsv");
+    client->deflate->rsv_layer = t;
+    return t;
+}
+
+/**
+ * @brief Sets up the compression streams for a new connection, if the server accepted the extension
+ */
+static esp_err_t esp_websocket_deflate_start(esp_websocket_client_handle_t client)
+{
+    websocket_deflate_t *ctx = client->deflate;
+    if (ctx == NULL) {
+        return ESP_OK;
+    }
+#ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
+    // A sender might still be compressing a message for the previous connection
+    xSemaphoreGiveRecursive(client->lock);
+    xSemaphoreTakeRecursive(client->tx_lock, portMAX_DELAY);
+    xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+#endif
+    esp_err_t ret = ESP_OK;
+    esp_websocket_deflate_end(client);
+    if (ctx->invalid) {
+        ESP_LOGE(TAG, "Invalid permessage-deflate response from the server");
+        ret = ESP_FAIL;
+        goto unlock_and_return;
+    }
+    if (!ctx->negotiated) {
+        ESP_LOGD(TAG, "Server declined permessage-deflate");
+        goto unlock_and_return;
+    }
+    memset(&ctx->deflater, 0, sizeof(z_stream));
+    memset(&ctx->inflater, 0, sizeof(z_stream));
+    ctx->tx_out = malloc(client->buffer_size);
+    ctx->rx_out = malloc(client->buffer_size + 1);
+    if (ctx->tx_out == NULL || ctx->rx_out == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+    // Negative window bits make raw deflate streams, without zlib headers
+    if (deflateInit2(&ctx->deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -ctx->client_window_bits,
+                     client->config->permessage_deflate.mem_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+    if (inflateInit2(&ctx->inflater, -ctx->server_window_bits) != Z_OK) {
+        deflateEnd(&ctx->deflater);
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+    ctx->rx_out_len = 0;
+    ctx->rx_offset = 0;
+    ctx->rx_compressed = false;
+    ctx->active = true;
+    ESP_LOGD(TAG, "permessage-deflate negotiated, client window %d bits, server window %d bits",
+             ctx->client_window_bits, ctx->server_window_bits);
+    goto unlock_and_return;
+
+cleanup:
+    ESP_LOGE(TAG, "Failed to set up permessage-deflate streams");
+    free(ctx->tx_out);
+    free(ctx->rx_out);
+    ctx->tx_out = NULL;
+    ctx->rx_out = NULL;
+unlock_and_return:
+    if (ctx->rsv_layer && !ctx->active) {
+        esp_websocket_rsv_layer_stop(ctx->rsv_layer);
+    }
+#ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
+    xSemaphoreGiveRecursive(client->tx_lock);
+#endif
+    return ret;
+}
+#endif // WS_PERMESSAGE_DEFLATE_SUPPORT
+
 static void destroy_and_free_resources(esp_websocket_client_handle_t client)
 {
     if (client->event_handle) {
@@ -533,6 +1004,7 @@ static void destroy_and_free_resources(esp_websocket_client_handle_t client)
         esp_transport_list_destroy(client->transport_list);
         client->transport_list = NULL;
         client->transport = NULL;
+        client->tx_parent = NULL;
     }
     if (client->lock) {
         vSemaphoreDelete(client->lock);
@@ -552,10 +1024,21 @@ static void destroy_and_free_resources(esp_websocket_client_handle_t client)
         free(client->rx_buffer);
         client->rx_buffer = NULL;
     }
+    if (client->rx_msg_buffer) {
+        free(client->rx_msg_buffer);
+        client->rx_msg_buffer = NULL;
+    }
     if (client->errormsg_buffer) {
         free(client->errormsg_buffer);
         client->errormsg_buffer = NULL;
     }
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    if (client->deflate) {
+        esp_websocket_deflate_end(client);
+        free(client->deflate);
+        client->deflate = NULL;
+    }
+#endif
     if (client->status_bits) {
         vEventGroupDelete(client->status_bits);
         client->status_bits = NULL;
@@ -583,6 +1066,9 @@ static esp_err_t stop_wait_task(esp_websocket_client_handle_t client)
 static void websocket_header_hook(void * client, const char * line, int line_len)
 {
     ESP_LOGD(TAG, "%s header:%.*s", __func__, line_len, line);
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    esp_websocket_deflate_parse_response(client, line, line_len);
+#endif
     esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_HEADER_RECEIVED, line, line_len);
 }
 #endif
@@ -591,11 +1077,20 @@ static esp_err_t set_websocket_transport_optional_settings(esp_websocket_client_
 {
     esp_transport_handle_t trans = esp_transport_list_get_transport(client->transport_list, scheme);
     if (trans) {
+        const char *headers = client->config->headers;
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+        char *offer = NULL;
+        if (client->deflate && client->deflate->rsv_layer) {
+            offer = esp_websocket_deflate_offer(client, headers);
+            ESP_WS_CLIENT_MEM_CHECK(TAG, offer, return ESP_ERR_NO_MEM);
+            headers = offer;
+        }
+#endif
         const esp_transport_ws_config_t config = {
             .ws_path = client->config->path,
             .sub_protocol = client->config->subprotocol,
             .user_agent = client->config->user_agent,
-            .headers = client->config->headers,
+            .headers = headers,
 #if WS_TRANSPORT_HEADER_CALLBACK_SUPPORT
             .header_hook = websocket_header_hook,
             .header_user_context = client,
@@ -603,11 +1098,29 @@ static esp_err_t set_websocket_transport_optional_settings(esp_websocket_client_
             .auth = client->config->auth,
             .propagate_control_frames = true
         };
-        return esp_transport_ws_set_config(trans, &config);
+        // the transport keeps its own copy of the headers
+        esp_err_t ret = esp_transport_ws_set_config(trans, &config);
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+        free(offer);
+#endif
+        return ret;
     }
     return ESP_ERR_INVALID_ARG;
 }
 
+/**
+ * @brief Returns the transport to put under the websocket layer, the RSV1 layer over the given one if permessage-deflate is offered
+ */
+static esp_transport_handle_t esp_websocket_client_ws_parent(esp_websocket_client_handle_t client, esp_transport_handle_t parent)
+{
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    if (client->deflate) {
+        return esp_websocket_rsv_layer_init(client, parent);
+    }
+#endif
+    return parent;
+}
+
 static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_handle_t client)
 {
     if (!client->config->scheme) {
@@ -618,6 +1131,12 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
     if (client->transport_list) {
         esp_transport_list_destroy(client->transport_list);
         client->transport_list = NULL;
+        client->tx_parent = NULL;
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+        if (client->deflate) {
+            client->deflate->rsv_layer = NULL;
+        }
+#endif
     }
 
     client->transport_list = esp_transport_list_init();
@@ -635,8 +1154,11 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
             esp_transport_tcp_set_interface_name(tcp, client->if_name);
         }
 
-        esp_transport_handle_t ws = esp_transport_ws_init(tcp);
+        esp_transport_handle_t ws_parent = esp_websocket_client_ws_parent(client, tcp);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, ws_parent, return ESP_ERR_NO_MEM);
+        esp_transport_handle_t ws = esp_transport_ws_init(ws_parent);
         ESP_WS_CLIENT_MEM_CHECK(TAG, ws, return ESP_ERR_NO_MEM);
+        client->tx_parent = tcp;
 
         esp_transport_set_default_port(ws, WEBSOCKET_TCP_DEFAULT_PORT);
         esp_transport_list_add(client->transport_list, ws, WS_OVER_TCP_SCHEME);
@@ -699,8 +1221,11 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
 #endif
         }
 
-        esp_transport_handle_t wss = esp_transport_ws_init(ssl);
+        esp_transport_handle_t wss_parent = esp_websocket_client_ws_parent(client, ssl);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, wss_parent, return ESP_ERR_NO_MEM);
+        esp_transport_handle_t wss = esp_transport_ws_init(wss_parent);
         ESP_WS_CLIENT_MEM_CHECK(TAG, wss, return ESP_ERR_NO_MEM);
+        client->tx_parent = ssl;
 
         esp_transport_set_default_port(wss, WEBSOCKET_SSL_DEFAULT_PORT);
 
@@ -713,17 +1238,212 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
     return ESP_OK;
 }
 
-static int esp_websocket_client_send_with_exact_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len, TickType_t timeout)
+static bool esp_websocket_client_tx_coalescing(esp_websocket_client_handle_t client)
+{
+    // Coalesced frames are written to the transport under the websocket layer, unknown for external transports
+    return client->config->tx_coalesce_ms > 0 && client->tx_parent != NULL;
+}
+
+static int esp_websocket_client_frame_len(int len)
+{
+    int header_len = 2;
+    if (len > 0xFFFF) {
+        header_len += 8;
+    } else if (len > 125) {
+        header_len += 2;
+    }
+    return header_len + WS_FRAME_MASK_LEN + len;
+}
+
+/**
+ * @brief Appends a masked frame to the coalesced frames in tx_buffer, the caller checks that it fits
+ */
+static void esp_websocket_client_append_frame(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len)
+{
+    uint8_t *frame = (uint8_t *)client->tx_buffer + client->tx_pending_len;
+    int header_len = 2;
+
+    frame[0] = opcode & 0xFF;
+    if (len > 0xFFFF) {
+        frame[1] = WS_FRAME_MASK_BIT | 127;
+        memset(&frame[2], 0, 4);
+        frame[6] = (len >> 24) & 0xFF;
+        frame[7] = (len >> 16) & 0xFF;
+        frame[8] = (len >> 8) & 0xFF;
+        frame[9] = len & 0xFF;
+        header_len = 10;
+    } else if (len > 125) {
+        frame[1] = WS_FRAME_MASK_BIT | 126;
+        frame[2] = (len >> 8) & 0xFF;
+        frame[3] = len & 0xFF;
+        header_len = 4;
+    } else {
+        frame[1] = WS_FRAME_MASK_BIT | len;
+    }
+    uint8_t *mask = frame + header_len;
+    getrandom(mask, WS_FRAME_MASK_LEN, 0);
+    uint8_t *payload = mask + WS_FRAME_MASK_LEN;
+    for (int i = 0; i < len; ++i) {
+        payload[i] = data[i] ^ mask[i % WS_FRAME_MASK_LEN];
+    }
+
+    if (client->tx_pending_len == 0) {
+        client->tx_pending_tick_ms = _tick_get_ms();
+    }
+    client->tx_pending_len += header_len + WS_FRAME_MASK_LEN + len;
+}
+
+/**
+ * @brief Sends the coalesced frames in one write
+ *
+ * @return Number of bytes sent (0 if there was nothing to send), or negative value on error
+ */
+static int esp_websocket_client_flush_tx_buffer(esp_websocket_client_handle_t client, int timeout_ms)
+{
+    int len = client->tx_pending_len;
+    if (len == 0) {
+        return 0;
+    }
+    client->tx_pending_len = 0;
+    int wlen = esp_transport_write(client->tx_parent, client->tx_buffer, len, timeout_ms);
+    if (wlen != len) {
+        return wlen < 0 ? wlen : -1;
+    }
+    return len;
+}
+
+/**
+ * @brief Sends one frame, or queues it with the coalesced frames if it's a small data frame
+ *
+ * @return Number of payload bytes sent or queued, or negative value on error
+ */
+static int esp_websocket_client_write_frame(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode,
+                                            const uint8_t *data, int len, bool in_place, int timeout_ms)
+{
+    int frame_len = esp_websocket_client_frame_len(len);
+    int ret;
+
+    if (esp_websocket_client_tx_coalescing(client) && (opcode & WS_FRAME_CONTROL_BIT) == 0 && frame_len <= client->buffer_size) {
+        if (client->tx_pending_len + frame_len > client->buffer_size &&
+                (ret = esp_websocket_client_flush_tx_buffer(client, timeout_ms)) < 0) {
+            return ret;
+        }
+        esp_websocket_client_append_frame(client, opcode, data, len);
+        if (_tick_get_ms() - client->tx_pending_tick_ms >= client->config->tx_coalesce_ms &&
+                (ret = esp_websocket_client_flush_tx_buffer(client, timeout_ms)) < 0) {
+            return ret;
+        }
+        return len;
+    }
+
+    // Frames must not overtake the coalesced ones
+    if ((ret = esp_websocket_client_flush_tx_buffer(client, timeout_ms)) < 0) {
+        return ret;
+    }
+    if (!in_place) {
+        memcpy(client->tx_buffer, data, len);
+        data = (const uint8_t *)client->tx_buffer;
+    }
+    // the payload is masked in place and restored by the transport
+    return esp_transport_ws_send_raw(client->transport, opcode, (char *)data, len, timeout_ms);
+}
+
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+static bool esp_websocket_deflate_active(esp_websocket_client_handle_t client)
+{
+    return client->deflate && client->deflate->active;
+}
+
+/**
+ * @brief Compresses the given parts of a message and sends them in frames of up to buffer_size
+ *
+ * The first frame of a message is marked with RSV1. The final frame is flushed and sent without
+ * the 0x00 0x00 0xff 0xff tail of the flush, as required by RFC 7692.
+ *
+ * @return Number of uncompressed bytes sent, or negative value on error
+ */
+static int esp_websocket_client_send_deflated(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode,
+                                              const esp_websocket_iov_t *iov, int iovcnt, int timeout_ms)
+{
+    websocket_deflate_t *ctx = client->deflate;
+    z_stream *zs = &ctx->deflater;
+    bool fin = opcode & WS_TRANSPORT_OPCODES_FIN;
+    ws_transport_opcodes_t frame_opcode = opcode & ~WS_TRANSPORT_OPCODES_FIN;
+    int out_len = 0, sent = 0, wlen;
+
+    if (frame_opcode != WS_TRANSPORT_OPCODES_CONT) {
+        frame_opcode |= WS_FRAME_RSV1_BIT;
+    }
+    // The extra round flushes the compressor at the end of the message
+    for (int i = 0; i < iovcnt || (fin && i == iovcnt); i++) {
+        bool flush = i == iovcnt;
+        zs->next_in = flush ? NULL : iov[i].data;
+        zs->avail_in = flush ? 0 : iov[i].len;
+        do {
+            zs->next_out = ctx->tx_out + out_len;
+            zs->avail_out = client->buffer_size - out_len;
+            if (deflate(zs, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                ESP_LOGE(TAG, "deflate() failed");
+                return -1;
+            }
+            out_len = client->buffer_size - zs->avail_out;
+            if (zs->avail_out == 0) {
+                // The last four bytes are kept back, they might be the tail of the flush
+                wlen = esp_websocket_client_write_frame(client, frame_opcode, ctx->tx_out, out_len - 4, true, timeout_ms);
+                if (wlen != out_len - 4) {
+                    return wlen < 0 ? wlen : -1;
+                }
+                memmove(ctx->tx_out, ctx->tx_out + out_len - 4, 4);
+                out_len = 4;
+                frame_opcode = WS_TRANSPORT_OPCODES_CONT;
+            }
+        } while (zs->avail_in > 0 || zs->avail_out == 0);
+        sent += flush ? 0 : iov[i].len;
+    }
+    if (fin) {
+        out_len -= 4;
+        frame_opcode |= WS_TRANSPORT_OPCODES_FIN;
+    } else if (out_len == 0 && frame_opcode == WS_TRANSPORT_OPCODES_CONT) {
+        return sent;    // nothing to send yet, the message has been started already
+    }
+    wlen = esp_websocket_client_write_frame(client, frame_opcode, ctx->tx_out, out_len, true, timeout_ms);
+    if (wlen != out_len) {
+        return wlen < 0 ? wlen : -1;
+    }
+    if (fin && ctx->client_no_context_takeover) {
+        deflateReset(zs);
+    }
+    return sent;
+}
+#endif // WS_PERMESSAGE_DEFLATE_SUPPORT
+
+/**
+ * @brief Sends a message made of the given parts
+ *
+ * @param in_place Send the parts directly from the caller's buffers, one frame per part.
+ *                 Otherwise, the parts are copied to tx_buffer and sent in chunks of buffer_size.
+ *
+ * If there are no parts, only the coalesced frames are sent.
+ */
+static int esp_websocket_client_send_frames(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode,
+                                            const esp_websocket_iov_t *iov, int iovcnt, bool in_place, TickType_t timeout)
 {
     int ret = -1;
-    int need_write = len;
-    int wlen = 0, widx = 0;
+    int wlen = 0, sent = 0;
+    int last = iovcnt - 1;
     bool contained_fin = opcode & WS_TRANSPORT_OPCODES_FIN;
+    int timeout_ms = (timeout == portMAX_DELAY) ? -1 : timeout * portTICK_PERIOD_MS;
 
-    if (client == NULL || len < 0 || (data == NULL && len > 0)) {
+    if (client == NULL || iovcnt < 0 || (iov == NULL && iovcnt > 0)) {
         ESP_LOGE(TAG, "Invalid arguments");
         return -1;
     }
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].len < 0 || (iov[i].data == NULL && iov[i].len > 0)) {
+            ESP_LOGE(TAG, "Invalid arguments");
+            return -1;
+        }
+    }
 
     if (!esp_websocket_client_is_connected(client)) {
         ESP_LOGE(TAG, "Websocket client is not connected");
@@ -747,56 +1467,83 @@ static int esp_websocket_client_send_with_exact_opcode(esp_websocket_client_hand
     }
 #endif
 
-    if (esp_websocket_new_buf(client, true) != ESP_OK) {
+    // tx_buffer is in use while it holds coalesced frames
+    if (iovcnt > 0 && (!in_place || esp_websocket_client_tx_coalescing(client)) && client->tx_pending_len == 0 && esp_websocket_new_buf(client, true) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to setup tx buffer");
         goto unlock_and_return;
     }
 
-    while (widx < len || opcode) {  // allow for sending "current_opcode" only message with len==0
-        if (need_write > client->buffer_size) {
-            need_write = client->buffer_size;
-            opcode = opcode & ~WS_TRANSPORT_OPCODES_FIN;
-        } else if (contained_fin) {
-            opcode = opcode | WS_TRANSPORT_OPCODES_FIN;
+    if (iovcnt == 0 && (wlen = esp_websocket_client_flush_tx_buffer(client, timeout_ms)) < 0) {
+        goto send_error;
+    }
+
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    if (iovcnt > 0 && esp_websocket_deflate_active(client) && (opcode & WS_FRAME_CONTROL_BIT) == 0) {
+        if ((wlen = esp_websocket_client_send_deflated(client, opcode, iov, iovcnt, timeout_ms)) < 0) {
+            goto send_error;
+        }
+        sent = wlen;
+        last = -1;  // sent compressed, no plain frames
+    }
+#endif
+    // Empty parts at the end don't make another frame, the FIN bit goes with the last data
+    while (last > 0 && iov[last].len == 0) {
+        --last;
+    }
+    for (int i = 0; i <= last; i++) {
+        int widx = 0;
+        while (widx < iov[i].len || (opcode && i == last)) {  // allow for sending "current_opcode" only message with len==0
+            int need_write = iov[i].len - widx;
+            if (!in_place && need_write > client->buffer_size) {
+                need_write = client->buffer_size;
+            }
+            ws_transport_opcodes_t frame_opcode = opcode & ~WS_TRANSPORT_OPCODES_FIN;
+            if (contained_fin && i == last && widx + need_write == iov[i].len) {
+                frame_opcode |= WS_TRANSPORT_OPCODES_FIN;
+            }
+            // send with ws specific way and specific opcode
+            wlen = esp_websocket_client_write_frame(client, frame_opcode, iov[i].data + widx, need_write, in_place, timeout_ms);
+            if (wlen < 0 || (wlen == 0 && need_write != 0)) {
+                goto send_error;
+            }
+            opcode = 0;
+            widx += wlen;
         }
-        memcpy(client->tx_buffer, data + widx, need_write);
-        // send with ws specific way and specific opcode
-        wlen = esp_transport_ws_send_raw(client->transport, opcode, (char *)client->tx_buffer, need_write,
-                                         (timeout == portMAX_DELAY) ? -1 : timeout * portTICK_PERIOD_MS);
-        if (wlen < 0 || (wlen == 0 && need_write != 0)) {
-            ret = wlen;
-            esp_websocket_free_buf(client, true);
+        sent += widx;
+    }
+    if (client->tx_pending_len == 0) {
+        esp_websocket_free_buf(client, true);
+    }
+    ret = sent;
+    goto unlock_and_return;
+
+send_error:
+    ret = wlen;
+    client->tx_pending_len = 0;
+    esp_websocket_free_buf(client, true);
 
 #ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
-            xSemaphoreGiveRecursive(client->tx_lock);
-            xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+    xSemaphoreGiveRecursive(client->tx_lock);
+    xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
 #endif
-            esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
-            if (error_handle) {
-                const char *error_name = esp_err_to_name(error_handle->last_error);
-                esp_websocket_client_error(client, "esp_transport_write() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
-                                           ret, error_name, error_handle->esp_tls_error_code,
-                                           error_handle->esp_tls_flags, errno);
-            } else {
-                esp_websocket_client_error(client, "esp_transport_write() returned %d, errno=%d", ret, errno);
-            }
-            ESP_LOGD(TAG, "Calling abort_connection due to send error");
+    esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(esp_websocket_client_error_transport(client));
+    if (error_handle) {
+        const char *error_name = esp_err_to_name(error_handle->last_error);
+        esp_websocket_client_error(client, "esp_transport_write() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
+                                   ret, error_name, error_handle->esp_tls_error_code,
+                                   error_handle->esp_tls_flags, errno);
+    } else {
+        esp_websocket_client_error(client, "esp_transport_write() returned %d, errno=%d", ret, errno);
+    }
+    ESP_LOGD(TAG, "Calling abort_connection due to send error");
 #ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
-            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
-            xSemaphoreGiveRecursive(client->lock);
-            return ret;
+    esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
+    xSemaphoreGiveRecursive(client->lock);
+    return ret;
 #else
-            // Already holding client->lock, safe to call
-            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
-            goto unlock_and_return;
+    // Already holding client->lock, safe to call
+    esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
 #endif
-        }
-        opcode = 0;
-        widx += wlen;
-        need_write = len - widx;
-    }
-    esp_websocket_free_buf(client, true);
-    ret = widx;
 
 unlock_and_return:
 #ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
@@ -807,6 +1554,20 @@ unlock_and_return:
     return ret;
 }
 
+static int esp_websocket_client_send_with_exact_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len, TickType_t timeout)
+{
+    // not modified, the data is copied to tx_buffer before sending
+    const esp_websocket_iov_t part = { .data = (uint8_t *)data, .len = len };
+    return esp_websocket_client_send_frames(client, opcode, &part, 1, false, timeout);
+}
+
+static void esp_websocket_client_flush_expired(esp_websocket_client_handle_t client)
+{
+    if (client->tx_pending_len > 0 && _tick_get_ms() - client->tx_pending_tick_ms >= client->config->tx_coalesce_ms) {
+        esp_websocket_client_send_frames(client, WS_TRANSPORT_OPCODES_CONT, NULL, 0, true, pdMS_TO_TICKS(client->config->network_timeout_ms));
+    }
+}
+
 esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t *config)
 {
     esp_websocket_client_handle_t client = heap_caps_calloc(1, sizeof(struct esp_websocket_client), ESP_WS_CLIENT_OBJ_MEMORY);
@@ -1046,6 +1807,16 @@ esp_err_t esp_websocket_client_set_headers(esp_websocket_client_handle_t client,
     }
 
     xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    if (client->deflate && client->deflate->rsv_layer) {
+        // keep offering the extension on reconnection
+        char *offer = esp_websocket_deflate_offer(client, headers);
+        esp_err_t ret = offer ? esp_transport_ws_set_headers(client->transport, offer) : ESP_ERR_NO_MEM;
+        free(offer);
+        xSemaphoreGiveRecursive(client->lock);
+        return ret;
+    }
+#endif
     esp_err_t ret = esp_transport_ws_set_headers(client->transport, headers);
     xSemaphoreGiveRecursive(client->lock);
 
@@ -1097,46 +1868,181 @@ esp_err_t esp_websocket_client_append_header(esp_websocket_client_handle_t clien
     return ESP_OK;
 }
 
-static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
+static bool esp_websocket_client_reassembling(esp_websocket_client_handle_t client)
 {
-    int rlen;
+    return client->config->max_message_len > 0;
+}
+
+/**
+ * @brief Makes room for len more bytes after the message reassembled so far, growing the slab in steps of buffer_size
+ */
+static esp_err_t esp_websocket_client_msg_reserve(esp_websocket_client_handle_t client, int len)
+{
+    int need = client->rx_msg_len + len;
+    if (need <= client->rx_msg_size) {
+        return ESP_OK;
+    }
+    int size = (need + client->buffer_size - 1) / client->buffer_size * client->buffer_size;
+    char *buffer = realloc(client->rx_msg_buffer, size);
+    ESP_WS_CLIENT_MEM_CHECK(TAG, buffer, return ESP_ERR_NO_MEM);
+    client->rx_msg_buffer = buffer;
+    client->rx_msg_size = size;
+    return ESP_OK;
+}
+
+static esp_err_t esp_websocket_client_msg_check(esp_websocket_client_handle_t client, int len)
+{
+    if (len > client->config->max_message_len - client->rx_msg_len) {
+        esp_websocket_client_error(client, "Received message is longer than max_message_len=%d", client->config->max_message_len);
+        client->rx_msg_len = 0;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Dispatches the reassembled message in one event, as if it had been received in a single frame
+ */
+static void esp_websocket_client_msg_deliver(esp_websocket_client_handle_t client)
+{
+    int frame_len = client->payload_len;
+    int frame_offset = client->payload_offset;
+    ws_transport_opcodes_t frame_opcode = client->last_opcode;
+
+    client->payload_len = client->rx_msg_len;
     client->payload_offset = 0;
-    if (esp_websocket_new_buf(client, false) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to setup rx buffer");
+    client->last_opcode = client->rx_msg_opcode;
+    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_msg_buffer, client->rx_msg_len);
+    client->payload_len = frame_len;
+    client->payload_offset = frame_offset;
+    client->last_opcode = frame_opcode;
+    client->rx_msg_len = 0;
+}
+
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+static esp_err_t esp_websocket_client_msg_append(esp_websocket_client_handle_t client, const void *data, int len)
+{
+    if (esp_websocket_client_msg_check(client, len) != ESP_OK ||
+            esp_websocket_client_msg_reserve(client, len) != ESP_OK) {
         return ESP_FAIL;
     }
-    do {
-        rlen = esp_transport_read(client->transport, client->rx_buffer, client->buffer_size, client->config->network_timeout_ms);
-        if (rlen < 0) {
-            esp_websocket_free_buf(client, false);
-            esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
-            if (error_handle) {
-                const char *error_name = esp_err_to_name(error_handle->last_error);
-                esp_websocket_client_error(client, "esp_transport_read() failed with %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
-                                           rlen, error_name, error_handle->esp_tls_error_code,
-                                           error_handle->esp_tls_flags, errno);
-            } else {
-                esp_websocket_client_error(client, "esp_transport_read() failed with %d, errno=%d", rlen, errno);
-            }
+    if (client->last_opcode != WS_TRANSPORT_OPCODES_CONT) {
+        client->rx_msg_opcode = client->last_opcode;
+    }
+    memcpy(client->rx_msg_buffer + client->rx_msg_len, data, len);
+    client->rx_msg_len += len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Dispatches inflated data, the event's payload_offset and payload_len describe the inflated frame
+ *
+ * When reassembling messages, the data is appended to the message instead, which is dispatched once complete.
+ *
+ * @param known_len Inflated bytes of the frame known so far from this offset, more than len unless this is the last event of the frame
+ */
+static esp_err_t esp_websocket_deflate_dispatch(esp_websocket_client_handle_t client, int len, int known_len)
+{
+    websocket_deflate_t *ctx = client->deflate;
+    int frame_len = client->payload_len;
+    int frame_offset = client->payload_offset;
+
+    if (esp_websocket_client_reassembling(client)) {
+        if (esp_websocket_client_msg_append(client, ctx->rx_out, len) != ESP_OK) {
             return ESP_FAIL;
         }
-        client->payload_len = esp_transport_ws_get_read_payload_len(client->transport);
-        client->last_fin = esp_transport_ws_get_fin_flag(client->transport);
-        client->last_opcode = esp_transport_ws_get_read_opcode(client->transport);
+        if (len == known_len && client->last_fin) {
+            esp_websocket_client_msg_deliver(client);
+        }
+        return ESP_OK;
+    }
+    client->payload_offset = ctx->rx_offset;
+    client->payload_len = ctx->rx_offset + known_len;
+    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, (const char *)ctx->rx_out, len);
+    client->payload_len = frame_len;
+    client->payload_offset = frame_offset;
+    ctx->rx_offset += len;
+    return ESP_OK;
+}
 
-        if (rlen == 0 && client->last_opcode == WS_TRANSPORT_OPCODES_NONE) {
-            ESP_LOGV(TAG, "esp_transport_read timeouts");
-            esp_websocket_free_buf(client, false);
-            return ESP_OK;
+/**
+ * @brief Inflates the received part of a frame and dispatches the data in chunks of up to buffer_size
+ */
+static esp_err_t esp_websocket_client_inflate(esp_websocket_client_handle_t client, int len)
+{
+    static const uint8_t flush_tail[] = { 0x00, 0x00, 0xff, 0xff };
+    websocket_deflate_t *ctx = client->deflate;
+    z_stream *zs = &ctx->inflater;
+    bool frame_done = client->payload_offset + len >= client->payload_len;
+    bool add_tail = frame_done && client->last_fin;
+
+    zs->next_in = (Bytef *)client->rx_buffer;
+    zs->avail_in = len;
+    while (true) {
+        zs->next_out = ctx->rx_out + ctx->rx_out_len;
+        zs->avail_out = client->buffer_size + 1 - ctx->rx_out_len;
+        int ret = inflate(zs, Z_SYNC_FLUSH);
+        ctx->rx_out_len = client->buffer_size + 1 - zs->avail_out;
+        if (ret == Z_STREAM_END) {
+            // The server finished the deflate stream, anything that follows starts a new one
+            inflateReset(zs);
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            esp_websocket_client_error(client, "inflate() failed with %d: %s", ret, zs->msg ? zs->msg : "invalid data");
+            return ESP_FAIL;
         }
-        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
+        if (ctx->rx_out_len > client->buffer_size) {
+            // A full buffer, with one byte kept back to know there's more to come
+            if (esp_websocket_deflate_dispatch(client, client->buffer_size, client->buffer_size + 1) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            ctx->rx_out[0] = ctx->rx_out[client->buffer_size];
+            ctx->rx_out_len = 1;
+        } else if (zs->avail_in == 0) {
+            if (!add_tail) {
+                break;
+            }
+            // The sender stripped the tail of the flush which ends every message
+            zs->next_in = (Bytef *)flush_tail;
+            zs->avail_in = sizeof(flush_tail);
+            add_tail = false;
+        }
+    }
+    if (frame_done) {
+        esp_err_t err = esp_websocket_deflate_dispatch(client, ctx->rx_out_len, ctx->rx_out_len);
+        ctx->rx_out_len = 0;
+        ctx->rx_offset = 0;
+        if (client->last_fin && ctx->server_no_context_takeover) {
+            inflateReset(zs);
+        }
+        return err;
+    }
+    return ESP_OK;
+}
+#endif // WS_PERMESSAGE_DEFLATE_SUPPORT
 
-        client->payload_offset += rlen;
-    } while (client->payload_offset < client->payload_len);
+static void esp_websocket_client_read_error(esp_websocket_client_handle_t client, int rlen)
+{
+    esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(esp_websocket_client_error_transport(client));
+    if (error_handle) {
+        const char *error_name = esp_err_to_name(error_handle->last_error);
+        esp_websocket_client_error(client, "esp_transport_read() failed with %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
+                                   rlen, error_name, error_handle->esp_tls_error_code,
+                                   error_handle->esp_tls_flags, errno);
+    } else {
+        esp_websocket_client_error(client, "esp_transport_read() failed with %d, errno=%d", rlen, errno);
+    }
+}
 
-    // if a PING message received -> send out the PONG, this will not work for PING messages with payload longer than buffer len
+/**
+ * @brief Reacts to a received control frame
+ *
+ * @param payload Whole payload of the frame (payload_len bytes)
+ */
+static esp_err_t esp_websocket_client_handle_control(esp_websocket_client_handle_t client, const char *payload)
+{
+    // if a PING message received -> send out the PONG
     if (client->last_opcode == WS_TRANSPORT_OPCODES_PING) {
-        const char *data = (client->payload_len == 0) ? NULL : client->rx_buffer;
+        const char *data = (client->payload_len == 0) ? NULL : payload;
         ESP_LOGD(TAG, "Sending PONG with payload len=%d", client->payload_len);
 #ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
         xSemaphoreGiveRecursive(client->lock);
@@ -1145,7 +2051,6 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
         if (xSemaphoreTakeRecursive(client->tx_lock, WEBSOCKET_TX_LOCK_TIMEOUT_MS) != pdPASS) {
             ESP_LOGE(TAG, "Could not lock ws-client within %d timeout for PONG", WEBSOCKET_TX_LOCK_TIMEOUT_MS);
             xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);  // Re-acquire client->lock before returning
-            esp_websocket_free_buf(client, false);
             return ESP_FAIL;
         }
 
@@ -1158,7 +2063,6 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
                 client->state == WEBSOCKET_STATE_WAIT_TIMEOUT || client->transport == NULL) {
             ESP_LOGW(TAG, "Transport closed while preparing PONG, skipping send");
             xSemaphoreGiveRecursive(client->tx_lock);
-            esp_websocket_free_buf(client, false);
             return ESP_OK;  // Caller expects client->lock to be held, which it is
         }
 
@@ -1176,16 +2080,180 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
         client->close_status_code = 0;
         if (client->payload_len >= 2) {
             uint16_t code_net;
-            memcpy(&code_net, client->rx_buffer, sizeof(code_net));
+            memcpy(&code_net, payload, sizeof(code_net));
             client->close_status_code = (int)ntohs(code_net);
         }
         ESP_LOGD(TAG, "Received close frame, status code: %d", client->close_status_code);
         client->state = WEBSOCKET_STATE_CLOSING;
     }
-    esp_websocket_free_buf(client, false);
     return ESP_OK;
 }
 
+/**
+ * @brief Receives one frame, reassembling data frames into whole messages (see `max_message_len`)
+ *
+ * The frame header and the start of the payload are read into the spare room of the slab and the rest
+ * of the payload right behind it, so a frame takes one or two transport reads regardless of its length.
+ * Control frames are read past the message being reassembled, without disturbing it.
+ */
+static esp_err_t esp_websocket_client_recv_message(esp_websocket_client_handle_t client)
+{
+    esp_err_t ret = ESP_FAIL;
+    int spare = client->buffer_size > WS_CONTROL_MAX_PAYLOAD ? client->buffer_size : WS_CONTROL_MAX_PAYLOAD;
+    int rlen;
+
+    client->payload_offset = 0;
+    if (esp_websocket_client_msg_reserve(client, spare) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to setup rx buffer");
+        return ESP_FAIL;
+    }
+    spare = client->rx_msg_size - client->rx_msg_len;
+    rlen = esp_transport_read(client->transport, client->rx_msg_buffer + client->rx_msg_len, spare, client->config->network_timeout_ms);
+    if (rlen < 0) {
+        esp_websocket_client_read_error(client, rlen);
+        goto free_and_return;
+    }
+    client->payload_len = esp_transport_ws_get_read_payload_len(client->transport);
+    client->last_fin = esp_transport_ws_get_fin_flag(client->transport);
+    client->last_opcode = esp_transport_ws_get_read_opcode(client->transport);
+
+    if (rlen == 0 && client->last_opcode == WS_TRANSPORT_OPCODES_NONE) {
+        ESP_LOGV(TAG, "esp_transport_read timeouts");
+        ret = ESP_OK;
+        goto free_and_return;
+    }
+    bool control = client->last_opcode & WS_FRAME_CONTROL_BIT;
+    if (control && client->payload_len > spare) {
+        esp_websocket_client_error(client, "Control frame with %d bytes of payload", client->payload_len);
+        goto free_and_return;
+    }
+    if (!control) {
+        if (esp_websocket_client_msg_check(client, client->payload_len) != ESP_OK ||
+                esp_websocket_client_msg_reserve(client, client->payload_len) != ESP_OK) {
+            goto free_and_return;
+        }
+        if (client->last_opcode != WS_TRANSPORT_OPCODES_CONT) {
+            client->rx_msg_opcode = client->last_opcode;
+        }
+    }
+    char *payload = client->rx_msg_buffer + client->rx_msg_len;
+    for (int offset = rlen; offset < client->payload_len; offset += rlen) {
+        rlen = esp_transport_read(client->transport, payload + offset, client->payload_len - offset, client->config->network_timeout_ms);
+        if (rlen < 0) {
+            esp_websocket_client_read_error(client, rlen);
+            goto free_and_return;
+        }
+    }
+
+    if (control) {
+        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, payload, client->payload_len);
+        ret = esp_websocket_client_handle_control(client, payload);
+        goto free_and_return;
+    }
+    client->rx_msg_len += client->payload_len;
+    if (client->last_fin) {
+        esp_websocket_client_msg_deliver(client);
+    }
+    ret = ESP_OK;
+
+free_and_return:
+    esp_websocket_free_buf(client, false);
+    return ret;
+}
+
+static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
+{
+    int rlen;
+    char *control_payload = client->rx_buffer;
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    // Compressed messages are read in chunks and reassembled from the inflated data
+    if (esp_websocket_client_reassembling(client) && !esp_websocket_deflate_active(client)) {
+#else
+    if (esp_websocket_client_reassembling(client)) {
+#endif
+        return esp_websocket_client_recv_message(client);
+    }
+    client->payload_offset = 0;
+    if (esp_websocket_new_buf(client, false) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to setup rx buffer");
+        return ESP_FAIL;
+    }
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+    bool frame_start = true;
+#endif
+    do {
+        rlen = esp_transport_read(client->transport, client->rx_buffer, client->buffer_size, client->config->network_timeout_ms);
+        if (rlen < 0) {
+            esp_websocket_free_buf(client, false);
+            esp_websocket_client_read_error(client, rlen);
+            return ESP_FAIL;
+        }
+        client->payload_len = esp_transport_ws_get_read_payload_len(client->transport);
+        client->last_fin = esp_transport_ws_get_fin_flag(client->transport);
+        client->last_opcode = esp_transport_ws_get_read_opcode(client->transport);
+
+        if (rlen == 0 && client->last_opcode == WS_TRANSPORT_OPCODES_NONE) {
+            ESP_LOGV(TAG, "esp_transport_read timeouts");
+            esp_websocket_free_buf(client, false);
+            return ESP_OK;
+        }
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+        if (frame_start && esp_websocket_deflate_active(client)) {
+            bool rsv1 = esp_websocket_rsv_layer_pop(client->deflate->rsv_layer);
+            // RSV1 of the first frame marks the whole message as compressed
+            if ((client->last_opcode & WS_FRAME_CONTROL_BIT) == 0 && client->last_opcode != WS_TRANSPORT_OPCODES_CONT) {
+                client->deflate->rx_compressed = rsv1;
+            }
+        }
+        frame_start = false;
+        if (esp_websocket_deflate_active(client) && (client->last_opcode & WS_FRAME_CONTROL_BIT) == 0) {
+            if (client->deflate->rx_compressed) {
+                if (esp_websocket_client_inflate(client, rlen) != ESP_OK) {
+                    esp_websocket_free_buf(client, false);
+                    return ESP_FAIL;
+                }
+                client->payload_offset += rlen;
+                continue;
+            }
+            // The server may leave messages uncompressed, these are reassembled here, too
+            if (esp_websocket_client_reassembling(client)) {
+                if (esp_websocket_client_msg_append(client, client->rx_buffer, rlen) != ESP_OK) {
+                    esp_websocket_free_buf(client, false);
+                    return ESP_FAIL;
+                }
+                client->payload_offset += rlen;
+                if (client->payload_offset >= client->payload_len && client->last_fin) {
+                    esp_websocket_client_msg_deliver(client);
+                }
+                continue;
+            }
+        }
+        // Collect control frames past the message being reassembled, so PINGs of any length can be answered
+        if (esp_websocket_client_reassembling(client) && (client->last_opcode & WS_FRAME_CONTROL_BIT)) {
+            if (client->payload_len > WS_CONTROL_MAX_PAYLOAD) {
+                esp_websocket_client_error(client, "Control frame with %d bytes of payload", client->payload_len);
+                esp_websocket_free_buf(client, false);
+                return ESP_FAIL;
+            }
+            if (esp_websocket_client_msg_reserve(client, WS_CONTROL_MAX_PAYLOAD) != ESP_OK) {
+                esp_websocket_free_buf(client, false);
+                return ESP_FAIL;
+            }
+            control_payload = client->rx_msg_buffer + client->rx_msg_len;
+            memcpy(control_payload + client->payload_offset, client->rx_buffer, rlen);
+        }
+#endif
+        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
+
+        client->payload_offset += rlen;
+    } while (client->payload_offset < client->payload_len);
+
+    // this will not work for PING messages with payload longer than buffer len, unless reassembling messages
+    esp_err_t ret = esp_websocket_client_handle_control(client, control_payload);
+    esp_websocket_free_buf(client, false);
+    return ret;
+}
+
 static int esp_websocket_client_send_close(esp_websocket_client_handle_t client, int code, const char *additional_data, int total_len, TickType_t timeout);
 
 static void esp_websocket_client_task(void *pv)
@@ -1225,12 +2293,15 @@ static void esp_websocket_client_task(void *pv)
                 break;
             }
             esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_BEFORE_CONNECT, NULL, 0);
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+            esp_websocket_deflate_reset_negotiation(client);
+#endif
             int result = esp_transport_connect(client->transport,
                                                client->config->host,
                                                client->config->port,
                                                client->config->network_timeout_ms);
             if (result < 0) {
-                esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
+                esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(esp_websocket_client_error_transport(client));
                 client->error_handle.esp_ws_handshake_status_code  = esp_transport_ws_get_upgrade_request_status(client->transport);
                 if (error_handle) {
                     const char *error_name = esp_err_to_name(error_handle->last_error);
@@ -1269,15 +2340,24 @@ static void esp_websocket_client_task(void *pv)
             }
 #endif
             ESP_LOGD(TAG, "Transport connected to %s://%s:%d", client->config->scheme, client->config->host, client->config->port);
+#if WS_PERMESSAGE_DEFLATE_SUPPORT
+            if (esp_websocket_deflate_start(client) != ESP_OK) {
+                esp_websocket_client_error(client, "Failed to set up permessage-deflate");
+                esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_HANDSHAKE);
+                break;
+            }
+#endif
 
             client->state = WEBSOCKET_STATE_CONNECTED;
             client->wait_for_pong_resp = false;
+            client->tx_pending_len = 0;
             client->error_handle.error_type = WEBSOCKET_ERROR_TYPE_NONE;
             client->payload_len = 0;
             client->payload_offset = 0;
             client->last_fin = false;
             client->last_opcode = WS_TRANSPORT_OPCODES_NONE;
             client->close_status_code = 0;
+            client->rx_msg_len = 0;
 
             // Clear CLOSE_FRAME_SENT_BIT to allow PINGs to be sent after reconnect
             xEventGroupClearBits(client->status_bits, CLOSE_FRAME_SENT_BIT);
@@ -1380,6 +2460,11 @@ static void esp_websocket_client_task(void *pv)
                     break;
                 }
 #endif
+                // No data frame may follow the close frame, so send the coalesced ones first
+                if (client->tx_pending_len > 0) {
+                    esp_websocket_client_flush_tx_buffer(client, client->config->network_timeout_ms);
+                    esp_websocket_free_buf(client, true);
+                }
                 esp_transport_ws_send_raw(client->transport, WS_TRANSPORT_OPCODES_CLOSE | WS_TRANSPORT_OPCODES_FIN, NULL, 0, client->config->network_timeout_ms);
 #ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
                 xSemaphoreGiveRecursive(client->tx_lock);
@@ -1393,10 +2478,18 @@ static void esp_websocket_client_task(void *pv)
         }
         xSemaphoreGiveRecursive(client->lock);
         if (WEBSOCKET_STATE_CONNECTED == client->state) {
-            read_select = esp_transport_poll_read(client->transport, 1000); //Poll every 1000ms
+            int poll_timeout_ms = WEBSOCKET_POLL_TIMEOUT_MS;
+            if (esp_websocket_client_tx_coalescing(client)) {
+                // Send the frames which have been held long enough, wake up in time for the next ones
+                esp_websocket_client_flush_expired(client);
+                if (client->config->tx_coalesce_ms < poll_timeout_ms) {
+                    poll_timeout_ms = client->config->tx_coalesce_ms;
+                }
+            }
+            read_select = esp_transport_poll_read(client->transport, poll_timeout_ms);
             if (read_select < 0) {
                 xSemaphoreTakeRecursive(client->lock, lock_timeout);
-                esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
+                esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(esp_websocket_client_error_transport(client));
                 if (error_handle) {
                     const char *error_name = esp_err_to_name(error_handle->last_error);
                     esp_websocket_client_error(client, "esp_transport_poll_read() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
@@ -1661,6 +2754,29 @@ int esp_websocket_client_send_with_opcode(esp_websocket_client_handle_t client,
     return esp_websocket_client_send_with_exact_opcode(client, opcode | WS_TRANSPORT_OPCODES_FIN, data, len, timeout);
 }
 
+int esp_websocket_client_send_with_opcode_nocopy(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, uint8_t *data, int len, TickType_t timeout)
+{
+    const esp_websocket_iov_t part = { .data = data, .len = len };
+    return esp_websocket_client_send_frames(client, opcode | WS_TRANSPORT_OPCODES_FIN, &part, 1, true, timeout);
+}
+
+int esp_websocket_client_send_iov(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const esp_websocket_iov_t *iov, int iovcnt, TickType_t timeout)
+{
+    if (iovcnt <= 0) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return -1;
+    }
+    return esp_websocket_client_send_frames(client, opcode | WS_TRANSPORT_OPCODES_FIN, iov, iovcnt, true, timeout);
+}
+
+esp_err_t esp_websocket_client_flush(esp_websocket_client_handle_t client, TickType_t timeout)
+{
+    if (client == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_websocket_client_send_frames(client, WS_TRANSPORT_OPCODES_CONT, NULL, 0, true, timeout) < 0 ? ESP_FAIL : ESP_OK;
+}
+
 bool esp_websocket_client_is_connected(esp_websocket_client_handle_t client)
 {
     if (client == NULL) {
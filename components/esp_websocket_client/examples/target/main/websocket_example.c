@@ -14,6 +14,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 #include "esp_wifi.h"
 #include "esp_system.h"
 #include "nvs_flash.h"
@@ -186,6 +187,7 @@ static void websocket_app_start(void)
 #if CONFIG_WS_OVER_TLS_SKIP_COMMON_NAME_CHECK
     websocket_cfg.skip_cert_common_name_check = true;
 #endif
+    websocket_cfg.tx_coalesce_ms = CONFIG_WS_TX_COALESCE_MS;
 
     ESP_LOGI(TAG, "Connecting to %s...", websocket_cfg.uri);
 
@@ -232,6 +234,31 @@ static void websocket_app_start(void)
     memset(long_data, 'a', size);
     esp_websocket_client_send_text(client, long_data, size, portMAX_DELAY);
     free(long_data);
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+
+    // Sending from writable buffers, which are masked in place instead of being copied to the ws buffer
+    ESP_LOGI(TAG, "Sending zero-copy messages");
+    char nocopy_data[] = "nocopy message";
+    esp_websocket_client_send_with_opcode_nocopy(client, WS_TRANSPORT_OPCODES_TEXT, (uint8_t *)nocopy_data, strlen(nocopy_data), portMAX_DELAY);
+    if (strcmp(nocopy_data, "nocopy message") != 0) {
+        ESP_LOGE(TAG, "Zero-copy buffer not restored");
+    }
+    char head[] = "gathered ", body[] = "from ", tail[] = "three parts";
+    const esp_websocket_iov_t parts[] = {
+        { .data = (uint8_t *)head, .len = strlen(head) },
+        { .data = (uint8_t *)body, .len = strlen(body) },
+        { .data = (uint8_t *)tail, .len = strlen(tail) },
+    };
+    esp_websocket_client_send_iov(client, WS_TRANSPORT_OPCODES_TEXT, parts, 3, portMAX_DELAY);
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+
+    // Sending small messages in a burst, coalesced into one write if tx_coalesce_ms is set
+    ESP_LOGI(TAG, "Sending a burst of small messages");
+    for (i = 0; i < 5; i++) {
+        int len = sprintf(data, "burst %d", i);
+        esp_websocket_client_send_text(client, data, len, portMAX_DELAY);
+    }
+    esp_websocket_client_flush(client, portMAX_DELAY);
 
     xSemaphoreTake(shutdown_sema, portMAX_DELAY);
     esp_websocket_client_close(client, portMAX_DELAY);
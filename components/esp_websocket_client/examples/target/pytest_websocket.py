@@ -106,6 +106,20 @@ def test_examples_protocol_websocket(dut):
         dut.expect('Received=' + 32 * 'a' + 32 * 'b')
         print('\nFragmented data received\n')
 
+    # Test for zero-copy sends:
+    # Verifies the frames masked in the caller's buffer, and a message gathered from several buffers, one frame per part.
+    def test_nocopy_msgs(dut):
+        dut.expect('Received=nocopy message')
+        dut.expect('Received=gathered from three parts')
+        print('\nZero-copy messages received\n')
+
+    # Test for a burst of small messages:
+    # Checks that the messages are echoed in order, whether they were sent one by one or coalesced into one write.
+    def test_burst_msgs(dut):
+        for i in range(0, 5):
+            dut.expect('Received=burst {}'.format(i))
+        print('\nBurst of messages received\n')
+
     # Extract the hexdump portion of the log line
     def parse_hexdump(line):
         match = re.search(r'\(.*\) Received binary data: ([0-9A-Fa-f ]+)', line)
@@ -171,6 +185,8 @@ def test_examples_protocol_websocket(dut):
             test_fragmented_binary_msg(dut)
             test_recv_fragmented_msg1(dut)
             test_recv_fragmented_msg2(dut)
+            test_nocopy_msgs(dut)
+            test_burst_msgs(dut)
             test_close(dut)
     else:
         print('DUT connecting to {}'.format(uri))
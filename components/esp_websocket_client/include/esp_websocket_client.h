@@ -103,6 +103,18 @@ typedef enum {
     WEBSOCKET_TRANSPORT_OVER_SSL,       /*!< Transport over ssl */
 } esp_websocket_transport_t;
 
+/**
+ * @brief Websocket permessage-deflate extension (RFC 7692) configuration
+ */
+typedef struct {
+    bool                        enable;                     /*!< Offer the extension in the opening handshake, requires CONFIG_ESP_WS_CLIENT_PERMESSAGE_DEFLATE and ESP-IDF v6.0 or newer. Not supported with `ext_transport` */
+    int                         client_max_window_bits;     /*!< Window size of the client's compressor as a power of two, 9..15 (0 = 15). The compressor needs about 2^(bits+2) + 2^(mem_level+9) bytes */
+    int                         server_max_window_bits;     /*!< Ask the server to compress with at most this window size, 8..15 (0 = don't ask). The decompressor needs 2^bits bytes plus about 7 KB */
+    bool                        client_no_context_takeover; /*!< Compress every message on its own, which costs compression ratio but keeps no history between messages */
+    bool                        server_no_context_takeover; /*!< Ask the server to compress every message on its own */
+    int                         mem_level;                  /*!< zlib memory level of the compressor, 1..9 (0 = 8) */
+} esp_websocket_permessage_deflate_config_t;
+
 /**
  * @brief Websocket client setup configuration
  */
@@ -160,8 +172,24 @@ typedef struct {
     size_t                      ping_interval_sec;          /*!< Websocket ping interval, defaults to 10 seconds if not set */
     struct ifreq                *if_name;                   /*!< The name of interface for data to go through. Use the default interface without setting */
     esp_transport_handle_t      ext_transport;              /*!< External WebSocket tcp_transport handle to the client; or if null, the client will create its own transport handle. */
+    int                         tx_coalesce_ms;             /*!< Hold small text/binary/continuation frames for up to this time to send them together in one write (i.e. one TLS record), 0 (default) sends every frame immediately.
+                                                                 Held frames are sent once they don't fit into `buffer_size`, before any larger or control frame, on esp_websocket_client_flush(), or after this time.
+                                                                 The websocket task wakes up at this interval while connected. Not supported with `ext_transport`. */
+    esp_websocket_permessage_deflate_config_t permessage_deflate; /*!< Compression of text and binary messages, if accepted by the server */
+    int                         max_message_len;            /*!< Deliver every text/binary message of up to this length in a single WEBSOCKET_EVENT_DATA, reassembled from its frames,
+                                                                 0 (default) dispatches each received frame in parts of up to `buffer_size`.
+                                                                 The message is kept in a buffer reused for the next one, a longer message fails the connection.
+                                                                 Control frames are still dispatched on their own, also in between the frames of a message. */
 } esp_websocket_client_config_t;
 
+/**
+ * @brief Part of a message sent by esp_websocket_client_send_iov()
+ */
+typedef struct {
+    uint8_t                     *data;                      /*!< Payload of the part, masked in place while being sent */
+    int                         len;                        /*!< Length of the part */
+} esp_websocket_iov_t;
+
 /**
  * @brief      Start a Websocket session
  *             This function must be the first function to call,
@@ -385,6 +413,65 @@ int esp_websocket_client_send_fin(esp_websocket_client_handle_t client, TickType
  */
 int esp_websocket_client_send_with_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len, TickType_t timeout);
 
+/**
+ * @brief      Write opcode data to the WebSocket connection directly from the caller's buffer
+ *
+ * Unlike esp_websocket_client_send_with_opcode(), the data is not copied to the client's buffer
+ * and it's sent in a single frame regardless of `buffer_size`.
+ *
+ * @param[in]  client  The client
+ * @param[in]  opcode  The opcode
+ * @param[in]  data    The data, must be writable
+ * @param[in]  len     The length
+ * @param[in]  timeout Write data timeout in RTOS ticks
+ *
+ *  Notes:
+ *  - The data is masked in place while being sent and restored before returning, so it must not be
+ *    placed in flash, nor accessed from other tasks during this call
+ *  - This API sets the FIN bit on the frame
+ *
+ * @return
+ *     - Number of data was sent
+ *     - (-1) if any errors
+ */
+int esp_websocket_client_send_with_opcode_nocopy(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, uint8_t *data, int len, TickType_t timeout);
+
+/**
+ * @brief      Write a message gathered from several buffers to the WebSocket connection without copying them
+ *
+ * Each non-empty part is sent directly from the caller's buffer as one frame of a fragmented message,
+ * the first frame with the given opcode, the others as continuation frames.
+ *
+ * @param[in]  client  The client
+ * @param[in]  opcode  The opcode
+ * @param[in]  iov     The parts of the message, must be writable
+ * @param[in]  iovcnt  Number of parts
+ * @param[in]  timeout Write data timeout in RTOS ticks
+ *
+ *  Notes:
+ *  - The parts are masked in place while being sent and restored before returning, the same way as in
+ *    esp_websocket_client_send_with_opcode_nocopy()
+ *  - This API sets the FIN bit on the last frame
+ *
+ * @return
+ *     - Number of data was sent
+ *     - (-1) if any errors
+ */
+int esp_websocket_client_send_iov(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const esp_websocket_iov_t *iov, int iovcnt, TickType_t timeout);
+
+/**
+ * @brief      Send the frames held by the client to be coalesced (see `tx_coalesce_ms`)
+ *
+ * @param[in]  client  The client
+ * @param[in]  timeout Write data timeout in RTOS ticks
+ *
+ * @return
+ *     - ESP_OK on success (also if there was nothing to send)
+ *     - ESP_FAIL if the client is not connected or the frames couldn't be sent
+ *     - ESP_ERR_INVALID_ARG if the client is NULL
+ */
+esp_err_t esp_websocket_client_flush(esp_websocket_client_handle_t client, TickType_t timeout);
+
 /**
  * @brief      Close the WebSocket connection in a clean way
  *
@@ -528,6 +528,9 @@ static esp_err_t run_test_case(int case_num)
         .disable_auto_reconnect = true, // Autobahn cases expect a clean stop on protocol errors
         .task_prio = 10,                // High prio → low latency
         .task_stack = 8144,
+#if CONFIG_ESP_WS_CLIENT_PERMESSAGE_DEFLATE
+        .permessage_deflate = { .enable = true },   // Sections 12 and 13
+#endif
     };
 
     esp_websocket_client_handle_t client = esp_websocket_client_init(&cfg);
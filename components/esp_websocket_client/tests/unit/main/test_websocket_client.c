@@ -12,8 +12,15 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <esp_websocket_client.h>
 #include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_tls_crypto.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -70,14 +77,355 @@ TEST(websocket, websocket_set_invalid_url)
     esp_websocket_client_destroy(client);
 }
 
+TEST(websocket, websocket_send_nocopy_not_connected)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        .uri = "ws://echo.websocket.org",
+        .tx_coalesce_ms = 10,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    uint8_t data[] = "data";
+    esp_websocket_iov_t parts[] = {
+        { .data = data, .len = 2 },
+        { .data = data + 2, .len = 2 },
+    };
+    TEST_ASSERT_EQUAL(-1, esp_websocket_client_send_with_opcode_nocopy(client, WS_TRANSPORT_OPCODES_BINARY, data, 4, 0));
+    TEST_ASSERT_EQUAL(-1, esp_websocket_client_send_iov(client, WS_TRANSPORT_OPCODES_BINARY, parts, 2, 0));
+    TEST_ASSERT_EQUAL(-1, esp_websocket_client_send_iov(client, WS_TRANSPORT_OPCODES_BINARY, parts, 0, 0));
+    TEST_ASSERT_EQUAL(ESP_FAIL, esp_websocket_client_flush(client, 0));
+    esp_websocket_client_destroy(client);
+}
+
 TEST_GROUP_RUNNER(websocket)
 {
     RUN_TEST_CASE(websocket, websocket_init_deinit)
     RUN_TEST_CASE(websocket, websocket_init_invalid_url)
     RUN_TEST_CASE(websocket, websocket_set_invalid_url)
+    RUN_TEST_CASE(websocket, websocket_send_nocopy_not_connected)
+}
+
+/*
+ * Message reassembly (max_message_len) against a scripted server on the loopback interface,
+ * which answers the opening handshake, sends the given frames and collects the client's PONG
+ */
+#define TEST_SERVER_PORT        8090
+#define TEST_BUFFER_SIZE        64
+#define TEST_MAX_MESSAGE_LEN    256
+#define TEST_TIMEOUT_MS         5000
+
+#define TEST_MESSAGE_BIT        BIT0
+#define TEST_PING_BIT           BIT1
+#define TEST_ERROR_BIT          BIT2
+#define TEST_DISCONNECTED_BIT   BIT3
+#define TEST_SERVER_READY_BIT   BIT4
+#define TEST_SERVER_DONE_BIT    BIT5
+
+typedef struct {
+    EventGroupHandle_t  events;
+    const uint8_t       *frames;            /*!< Frames the server sends after the handshake */
+    int                 frames_len;
+    uint8_t             pong[125];          /*!< Payload of the PONG the server received */
+    int                 pong_len;
+    int                 messages;           /*!< Text/binary data events received by the client */
+    uint8_t             message[TEST_MAX_MESSAGE_LEN];
+    int                 message_len;
+    int                 message_opcode;
+    bool                message_whole;      /*!< The event had fin set and described the whole message */
+    int                 ping_len;
+} test_recv_t;
+
+static int test_server_read_exact(int sock, uint8_t *buffer, int len)
+{
+    for (int offset = 0; offset < len;) {
+        int rlen = recv(sock, buffer + offset, len - offset, 0);
+        if (rlen <= 0) {
+            return -1;
+        }
+        offset += rlen;
+    }
+    return len;
+}
+
+static bool test_server_handshake(int sock)
+{
+    static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    char request[512];
+    int len = 0;
+    while (len < sizeof(request) - 1) {
+        int rlen = recv(sock, request + len, sizeof(request) - 1 - len, 0);
+        if (rlen <= 0) {
+            return false;
+        }
+        len += rlen;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n")) {
+            break;
+        }
+    }
+    char *key = strstr(request, "Sec-WebSocket-Key:");
+    if (key == NULL) {
+        return false;
+    }
+    key += strlen("Sec-WebSocket-Key:");
+    key += strspn(key, " ");
+    char accept_src[64 + sizeof(guid)];
+    int key_len = strcspn(key, "\r\n");
+    if (key_len > 64) {
+        return false;
+    }
+    memcpy(accept_src, key, key_len);
+    memcpy(accept_src + key_len, guid, sizeof(guid));
+    unsigned char sha1[20];
+    unsigned char accept[32];
+    size_t accept_len = 0;
+    esp_crypto_sha1((const unsigned char *)accept_src, key_len + sizeof(guid) - 1, sha1);
+    esp_crypto_base64_encode(accept, sizeof(accept), &accept_len, sha1, sizeof(sha1));
+    char response[160];
+    len = snprintf(response, sizeof(response), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                   "Connection: Upgrade\r\nSec-WebSocket-Accept: %.*s\r\n\r\n", (int)accept_len, accept);
+    return send(sock, response, len, 0) == len;
+}
+
+/**
+ * @brief Reads the client's frames until it closes the connection, keeping the payload of its PONG
+ */
+static void test_server_read_client(int sock, test_recv_t *test)
+{
+    uint8_t header[2];
+    uint8_t mask[4];
+    uint8_t payload[TEST_MAX_MESSAGE_LEN];
+    while (test_server_read_exact(sock, header, sizeof(header)) > 0) {
+        int len = header[1] & 0x7f;
+        if (len == 126) {
+            uint8_t ext[2];
+            if (test_server_read_exact(sock, ext, sizeof(ext)) < 0) {
+                return;
+            }
+            len = (ext[0] << 8) | ext[1];
+        }
+        if (len > sizeof(payload) || test_server_read_exact(sock, mask, sizeof(mask)) < 0 ||
+                test_server_read_exact(sock, payload, len) < 0) {
+            return;
+        }
+        for (int i = 0; i < len; i++) {
+            payload[i] ^= mask[i % 4];
+        }
+        if ((header[0] & 0x0f) == WS_TRANSPORT_OPCODES_PONG && len <= sizeof(test->pong)) {
+            memcpy(test->pong, payload, len);
+            test->pong_len = len;
+        }
+    }
+}
+
+static void test_server_task(void *args)
+{
+    test_recv_t *test = args;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(TEST_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int opt = 1;
+    struct timeval timeout = { .tv_sec = TEST_TIMEOUT_MS / 1000 };
+    // reset the connection when closing, so that nothing lingers in TIME_WAIT
+    struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    int sock = -1;
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_sock, 1) != 0) {
+        goto done;
+    }
+    xEventGroupSetBits(test->events, TEST_SERVER_READY_BIT);
+    sock = accept(listen_sock, NULL, NULL);
+    if (sock < 0) {
+        goto done;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    if (test_server_handshake(sock) && send(sock, test->frames, test->frames_len, 0) == test->frames_len) {
+        test_server_read_client(sock, test);
+    }
+done:
+    if (sock >= 0) {
+        close(sock);
+    }
+    close(listen_sock);
+    xEventGroupSetBits(test->events, TEST_SERVER_DONE_BIT);
+    vTaskDelete(NULL);
+}
+
+static void test_recv_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    test_recv_t *test = handler_args;
+    esp_websocket_event_data_t *data = event_data;
+    switch (event_id) {
+    case WEBSOCKET_EVENT_DATA:
+        if (data->op_code == WS_TRANSPORT_OPCODES_PING) {
+            test->ping_len = data->data_len;
+            xEventGroupSetBits(test->events, TEST_PING_BIT);
+        } else if (data->op_code == WS_TRANSPORT_OPCODES_TEXT || data->op_code == WS_TRANSPORT_OPCODES_BINARY ||
+                   data->op_code == WS_TRANSPORT_OPCODES_CONT) {
+            test->messages++;
+            test->message_opcode = data->op_code;
+            test->message_whole = data->fin && data->payload_offset == 0 && data->payload_len == data->data_len;
+            test->message_len = data->data_len <= sizeof(test->message) ? data->data_len : 0;
+            memcpy(test->message, data->data_ptr, test->message_len);
+            xEventGroupSetBits(test->events, TEST_MESSAGE_BIT);
+        }
+        break;
+    case WEBSOCKET_EVENT_ERROR:
+        xEventGroupSetBits(test->events, TEST_ERROR_BIT);
+        break;
+    case WEBSOCKET_EVENT_DISCONNECTED:
+        xEventGroupSetBits(test->events, TEST_DISCONNECTED_BIT);
+        break;
+    }
+}
+
+/**
+ * @brief Appends a server frame (unmasked) to the script
+ */
+static int test_add_frame(uint8_t *script, int len, uint8_t opcode, const uint8_t *payload, int payload_len)
+{
+    script[len++] = opcode;
+    if (payload_len < 126) {
+        script[len++] = payload_len;
+    } else {
+        script[len++] = 126;
+        script[len++] = payload_len >> 8;
+        script[len++] = payload_len & 0xff;
+    }
+    memcpy(script + len, payload, payload_len);
+    return len + payload_len;
+}
+
+/**
+ * @brief Runs the client against the server sending the given frames, until all the expected event bits are set
+ */
+static EventBits_t test_recv_run(test_recv_t *test, EventBits_t expected)
+{
+    test->events = xEventGroupCreate();
+    TEST_ASSERT_NOT_NULL(test->events);
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(test_server_task, "ws_test_server", 4096, test, 5, NULL));
+    EventBits_t bits = xEventGroupWaitBits(test->events, TEST_SERVER_READY_BIT | TEST_SERVER_DONE_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(TEST_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL(TEST_SERVER_READY_BIT, bits);
+
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = "127.0.0.1",
+        .port = TEST_SERVER_PORT,
+        .buffer_size = TEST_BUFFER_SIZE,
+        .max_message_len = TEST_MAX_MESSAGE_LEN,
+        .disable_auto_reconnect = true,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_NULL(client);
+    TEST_ESP_OK(esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_recv_event_handler, test));
+    TEST_ESP_OK(esp_websocket_client_start(client));
+    bits = xEventGroupWaitBits(test->events, expected, pdFALSE, pdTRUE, pdMS_TO_TICKS(TEST_TIMEOUT_MS));
+    esp_websocket_client_destroy(client);
+    // the server finishes once the client is gone
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(test->events, TEST_SERVER_DONE_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(TEST_TIMEOUT_MS)) & TEST_SERVER_DONE_BIT);
+    vEventGroupDelete(test->events);
+    // let the idle task free the server task
+    vTaskDelay(pdMS_TO_TICKS(100));
+    return bits;
+}
+
+TEST_GROUP(websocket_recv);
+
+TEST_SETUP(websocket_recv)
+{
+    // lwIP is started once, for all the tests
+    TEST_ESP_OK(esp_netif_init());
+    test_utils_record_free_mem();
+    TEST_ESP_OK(test_utils_set_leak_level(0, ESP_LEAK_TYPE_CRITICAL, ESP_COMP_LEAK_GENERAL));
+}
+
+TEST_TEAR_DOWN(websocket_recv)
+{
+    // sockets leave some lazily allocated lwIP state behind
+    test_utils_finish_and_evaluate_leaks(32, 64);
+}
+
+TEST(websocket_recv, websocket_recv_fragmented_message_with_ping)
+{
+    static test_recv_t test;
+    static uint8_t script[512];
+    uint8_t first[100];
+    uint8_t last[100];
+    const uint8_t ping[] = "ping between the fragments";
+    memset(&test, 0, sizeof(test));
+    memset(first, 'a', sizeof(first));
+    memset(last, 'b', sizeof(last));
+    int len = test_add_frame(script, 0, WS_TRANSPORT_OPCODES_TEXT, first, sizeof(first));
+    len = test_add_frame(script, len, WS_TRANSPORT_OPCODES_PING | WS_TRANSPORT_OPCODES_FIN, ping, sizeof(ping));
+    len = test_add_frame(script, len, WS_TRANSPORT_OPCODES_CONT | WS_TRANSPORT_OPCODES_FIN, last, sizeof(last));
+    test.frames = script;
+    test.frames_len = len;
+
+    EventBits_t bits = test_recv_run(&test, TEST_MESSAGE_BIT | TEST_PING_BIT);
+    TEST_ASSERT_EQUAL(TEST_MESSAGE_BIT | TEST_PING_BIT, bits & (TEST_MESSAGE_BIT | TEST_PING_BIT));
+    TEST_ASSERT_EQUAL(1, test.messages);
+    TEST_ASSERT_EQUAL(WS_TRANSPORT_OPCODES_TEXT, test.message_opcode);
+    TEST_ASSERT_TRUE(test.message_whole);
+    TEST_ASSERT_EQUAL(sizeof(first) + sizeof(last), test.message_len);
+    TEST_ASSERT_EQUAL_MEMORY(first, test.message, sizeof(first));
+    TEST_ASSERT_EQUAL_MEMORY(last, test.message + sizeof(first), sizeof(last));
+    TEST_ASSERT_EQUAL(sizeof(ping), test.ping_len);
+    TEST_ASSERT_EQUAL(sizeof(ping), test.pong_len);
+    TEST_ASSERT_EQUAL_MEMORY(ping, test.pong, sizeof(ping));
+}
+
+TEST(websocket_recv, websocket_recv_message_too_long)
+{
+    static test_recv_t test;
+    static uint8_t script[512];
+    uint8_t payload[TEST_MAX_MESSAGE_LEN + 1];
+    memset(&test, 0, sizeof(test));
+    memset(payload, 'x', sizeof(payload));
+    test.frames = script;
+    test.frames_len = test_add_frame(script, 0, WS_TRANSPORT_OPCODES_BINARY | WS_TRANSPORT_OPCODES_FIN, payload, sizeof(payload));
+
+    EventBits_t bits = test_recv_run(&test, TEST_ERROR_BIT | TEST_DISCONNECTED_BIT);
+    TEST_ASSERT_EQUAL(TEST_ERROR_BIT | TEST_DISCONNECTED_BIT, bits & (TEST_ERROR_BIT | TEST_DISCONNECTED_BIT));
+    TEST_ASSERT_EQUAL(0, test.messages);
+}
+
+TEST(websocket_recv, websocket_recv_ping_longer_than_buffer)
+{
+    static test_recv_t test;
+    static uint8_t script[512];
+    uint8_t ping[125];
+    memset(&test, 0, sizeof(test));
+    for (int i = 0; i < sizeof(ping); i++) {
+        ping[i] = i;
+    }
+    TEST_ASSERT_GREATER_THAN(TEST_BUFFER_SIZE, sizeof(ping));
+    test.frames = script;
+    test.frames_len = test_add_frame(script, 0, WS_TRANSPORT_OPCODES_PING | WS_TRANSPORT_OPCODES_FIN, ping, sizeof(ping));
+
+    EventBits_t bits = test_recv_run(&test, TEST_PING_BIT);
+    TEST_ASSERT_EQUAL(TEST_PING_BIT, bits & (TEST_PING_BIT | TEST_ERROR_BIT));
+    TEST_ASSERT_EQUAL(sizeof(ping), test.ping_len);
+    TEST_ASSERT_EQUAL(sizeof(ping), test.pong_len);
+    TEST_ASSERT_EQUAL_MEMORY(ping, test.pong, sizeof(ping));
+}
+
+TEST_GROUP_RUNNER(websocket_recv)
+{
+    RUN_TEST_CASE(websocket_recv, websocket_recv_fragmented_message_with_ping)
+    RUN_TEST_CASE(websocket_recv, websocket_recv_message_too_long)
+    RUN_TEST_CASE(websocket_recv, websocket_recv_ping_longer_than_buffer)
+}
+
+static void run_all_tests(void)
+{
+    RUN_TEST_GROUP(websocket);
+    RUN_TEST_GROUP(websocket_recv);
 }
 
 void app_main(void)
 {
-    UNITY_MAIN(websocket);
+    UNITY_MAIN_FUNC(run_all_tests);
 }
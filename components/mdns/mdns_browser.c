@@ -14,6 +14,10 @@
 #include "mdns_responder.h"
 #include "mdns_netif.h"
 #include "mdns_service.h"
+#include "mdns_receive.h"
+#ifdef CONFIG_MDNS_RECORD_CACHE
+#include "mdns_cache.h"
+#endif
 #include "esp_log.h"
 
 static const char *TAG = "mdns_browser";
@@ -178,11 +182,106 @@ static mdns_browse_t *browse_init(const char *service, const char *proto, mdns_b
     return browse;
 }
 
+#ifdef CONFIG_MDNS_RECORD_CACHE
+/**
+ * @brief  Add cached A/AAAA records of the host to the browse results
+ */
+static void browse_add_cached_ips(mdns_browse_t *browse, const char *hostname, mdns_if_t tcpip_if,
+                                  mdns_ip_protocol_t ip_protocol, mdns_browse_sync_t *sync)
+{
+    static const uint16_t types[] = {
+#ifdef CONFIG_LWIP_IPV4
+        MDNS_TYPE_A,
+#endif
+#ifdef CONFIG_LWIP_IPV6
+        MDNS_TYPE_AAAA,
+#endif
+    };
+    mdns_cache_record_t owner = {
+        .tcpip_if = tcpip_if,
+        .ip_protocol = ip_protocol,
+        .hostname = hostname,
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        const mdns_cache_record_t *record = NULL;
+        owner.type = types[i];
+        while ((record = mdns_priv_cache_find(&owner, record)) != NULL) {
+            esp_ip_addr_t addr = record->addr;
+            mdns_priv_browse_result_add_ip(browse, hostname, &addr, tcpip_if, ip_protocol,
+                                           mdns_priv_cache_remaining_ttl(record), sync);
+        }
+    }
+}
+
+/**
+ * @brief  Report the instances already known from the record cache to a new browse
+ */
+static void browse_add_cached(mdns_browse_t *browse)
+{
+    mdns_browse_sync_t *sync = mdns_priv_browse_ensure_sync(browse, NULL);
+    if (!sync) {
+        return;
+    }
+    for (uint8_t interface_idx = 0; interface_idx < MDNS_MAX_INTERFACES; interface_idx++) {
+        for (uint8_t protocol_idx = 0; protocol_idx < MDNS_IP_PROTOCOL_MAX; protocol_idx++) {
+            mdns_if_t tcpip_if = (mdns_if_t) interface_idx;
+            mdns_ip_protocol_t ip_protocol = (mdns_ip_protocol_t) protocol_idx;
+            mdns_cache_record_t owner = {
+                .type = MDNS_TYPE_PTR,
+                .tcpip_if = tcpip_if,
+                .ip_protocol = ip_protocol,
+                .service = browse->service,
+                .proto = browse->proto,
+            };
+            const mdns_cache_record_t *ptr = NULL;
+            while ((ptr = mdns_priv_cache_find(&owner, ptr)) != NULL) {
+                mdns_priv_browse_result_add_ptr(browse, ptr->instance, browse->service, browse->proto, tcpip_if,
+                                                ip_protocol, mdns_priv_cache_remaining_ttl(ptr), sync);
+
+                mdns_cache_record_t instance = owner;
+                instance.type = MDNS_TYPE_SRV;
+                instance.instance = ptr->instance;
+                const mdns_cache_record_t *srv = mdns_priv_cache_find(&instance, NULL);
+                if (srv) {
+                    mdns_priv_browse_result_add_srv(browse, srv->hostname, ptr->instance, browse->service, browse->proto,
+                                                    srv->port, tcpip_if, ip_protocol,
+                                                    mdns_priv_cache_remaining_ttl(srv), sync);
+                }
+                instance.type = MDNS_TYPE_TXT;
+                const mdns_cache_record_t *txt_record = mdns_priv_cache_find(&instance, NULL);
+                if (txt_record) {
+                    mdns_txt_item_t *txt = NULL;
+                    uint8_t *txt_value_len = NULL;
+                    size_t txt_count = 0;
+                    mdns_priv_result_txt_create(txt_record->txt, txt_record->txt_len, &txt, &txt_value_len, &txt_count);
+                    if (txt_count) {
+                        mdns_priv_browse_result_add_txt(browse, ptr->instance, browse->service, browse->proto,
+                                                        txt, txt_value_len, txt_count, tcpip_if, ip_protocol,
+                                                        mdns_priv_cache_remaining_ttl(txt_record), sync);
+                    }
+                }
+                if (srv) {
+                    browse_add_cached_ips(browse, srv->hostname, tcpip_if, ip_protocol, sync);
+                }
+            }
+        }
+    }
+    if (!sync->sync_result) {
+        mdns_mem_free(sync);
+    } else if (mdns_priv_browse_sync(sync) != ESP_OK) {
+        mdns_priv_browse_sync_free(sync);
+    }
+}
+#endif /* CONFIG_MDNS_RECORD_CACHE */
+
 /**
  * @brief  Send initial PTR queries for a registered browse.
  */
 static void browse_start(mdns_browse_t *browse)
 {
+#ifdef CONFIG_MDNS_RECORD_CACHE
+    browse_add_cached(browse);
+#endif
     for (uint8_t interface_idx = 0; interface_idx < MDNS_MAX_INTERFACES; interface_idx++) {
         for (uint8_t protocol_idx = 0; protocol_idx < MDNS_IP_PROTOCOL_MAX; protocol_idx++) {
             browse_send(browse, (mdns_if_t) interface_idx, (mdns_ip_protocol_t) protocol_idx);
@@ -0,0 +1,266 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "sdkconfig.h"
+#include "mdns_private.h"
+#include "mdns_cache.h"
+#include "mdns_mem_caps.h"
+#include "mdns_utils.h"
+#include "esp_log.h"
+
+/*
+ * Records learned from responses of other hosts, shared by the querier and the browser.
+ * Only accessed from the mDNS service task, so no locking is needed.
+ * Expired records are dropped lazily when the cache is modified.
+ */
+
+#define CACHE_GOODBYE_MS    1000
+#define CACHE_FLUSH_MS      1000
+#define CACHE_MAX_TTL       (24 * 60 * 60)  // keeps expiry times within the tick counter range
+
+static const char *TAG = "mdns_cache";
+static mdns_cache_record_t *s_cache;
+static size_t s_cache_len;
+
+static inline uint32_t now_ms(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static bool is_expired(const mdns_cache_record_t *record, uint32_t now)
+{
+    return (int32_t)(record->expires - now) <= 0;
+}
+
+static bool str_equal(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    return !strcasecmp(a, b);
+}
+
+static bool same_owner(const mdns_cache_record_t *a, const mdns_cache_record_t *b)
+{
+    if (a->type != b->type || a->tcpip_if != b->tcpip_if || a->ip_protocol != b->ip_protocol) {
+        return false;
+    }
+    switch (a->type) {
+    case MDNS_TYPE_PTR:
+        return str_equal(a->service, b->service) && str_equal(a->proto, b->proto);
+    case MDNS_TYPE_SRV:
+    case MDNS_TYPE_TXT:
+        return str_equal(a->instance, b->instance) && str_equal(a->service, b->service) && str_equal(a->proto, b->proto);
+    default:
+        return str_equal(a->hostname, b->hostname);
+    }
+}
+
+static bool same_rdata(const mdns_cache_record_t *a, const mdns_cache_record_t *b)
+{
+    switch (a->type) {
+    case MDNS_TYPE_PTR:
+        return str_equal(a->instance, b->instance);
+    case MDNS_TYPE_SRV:
+        return a->port == b->port && str_equal(a->hostname, b->hostname);
+    case MDNS_TYPE_TXT:
+        return a->txt_len == b->txt_len && (a->txt_len == 0 || !memcmp(a->txt, b->txt, a->txt_len));
+#ifdef CONFIG_LWIP_IPV4
+    case MDNS_TYPE_A:
+        return a->addr.u_addr.ip4.addr == b->addr.u_addr.ip4.addr;
+#endif
+#ifdef CONFIG_LWIP_IPV6
+    case MDNS_TYPE_AAAA:
+        return !memcmp(a->addr.u_addr.ip6.addr, b->addr.u_addr.ip6.addr, MDNS_UTILS_SIZEOF_IP6_ADDR);
+#endif
+    default:
+        return false;
+    }
+}
+
+static void record_free(mdns_cache_record_t *record)
+{
+    mdns_mem_free((char *)record->instance);
+    mdns_mem_free((char *)record->service);
+    mdns_mem_free((char *)record->proto);
+    mdns_mem_free((char *)record->hostname);
+    mdns_mem_free((uint8_t *)record->txt);
+    mdns_mem_free(record);
+}
+
+static bool strdup_opt(const char **dst, const char *src)
+{
+    *dst = NULL;
+    if (src == NULL) {
+        return true;
+    }
+    *dst = mdns_mem_strdup(src);
+    return *dst != NULL;
+}
+
+static mdns_cache_record_t *record_copy(const mdns_cache_record_t *src)
+{
+    mdns_cache_record_t *record = (mdns_cache_record_t *)mdns_mem_calloc(1, sizeof(mdns_cache_record_t));
+    if (!record) {
+        HOOK_MALLOC_FAILED;
+        return NULL;
+    }
+    record->type = src->type;
+    record->tcpip_if = src->tcpip_if;
+    record->ip_protocol = src->ip_protocol;
+    record->port = src->port;
+    record->addr = src->addr;
+    if (!strdup_opt(&record->instance, src->instance) || !strdup_opt(&record->service, src->service)
+            || !strdup_opt(&record->proto, src->proto) || !strdup_opt(&record->hostname, src->hostname)) {
+        HOOK_MALLOC_FAILED;
+        record_free(record);
+        return NULL;
+    }
+    if (src->txt_len) {
+        uint8_t *txt = (uint8_t *)mdns_mem_malloc(src->txt_len);
+        if (!txt) {
+            HOOK_MALLOC_FAILED;
+            record_free(record);
+            return NULL;
+        }
+        memcpy(txt, src->txt, src->txt_len);
+        record->txt = txt;
+        record->txt_len = src->txt_len;
+    }
+    return record;
+}
+
+/**
+ * @brief  Drop expired records
+ */
+static void purge_expired(uint32_t now)
+{
+    mdns_cache_record_t **it = &s_cache;
+    while (*it) {
+        mdns_cache_record_t *record = *it;
+        if (is_expired(record, now)) {
+            *it = record->next;
+            record_free(record);
+            s_cache_len--;
+        } else {
+            it = &record->next;
+        }
+    }
+}
+
+/**
+ * @brief  Drop the record closest to expiry to make room for a new one
+ */
+static void evict_one(void)
+{
+    mdns_cache_record_t **victim = NULL;
+    for (mdns_cache_record_t **it = &s_cache; *it; it = &(*it)->next) {
+        if (!victim || (int32_t)((*it)->expires - (*victim)->expires) < 0) {
+            victim = it;
+        }
+    }
+    if (victim) {
+        mdns_cache_record_t *record = *victim;
+        *victim = record->next;
+        record_free(record);
+        s_cache_len--;
+    }
+}
+
+void mdns_priv_cache_add(const mdns_cache_record_t *record, bool flush)
+{
+    uint32_t now = now_ms();
+    uint32_t ttl = record->ttl > CACHE_MAX_TTL ? CACHE_MAX_TTL : record->ttl;
+    mdns_cache_record_t *found = NULL;
+
+    purge_expired(now);
+    for (mdns_cache_record_t *it = s_cache; it; it = it->next) {
+        if (!same_owner(it, record)) {
+            continue;
+        }
+        if (same_rdata(it, record)) {
+            found = it;
+        } else if (flush && ttl && (int32_t)(now - (it->expires - it->ttl * 1000)) > CACHE_FLUSH_MS) {
+            // the owner announced a new unique record set, older records go away in one second
+            it->expires = now + CACHE_FLUSH_MS;
+        }
+    }
+
+    if (ttl == 0) {
+        if (found) {
+            found->ttl = 0;
+            found->expires = now + CACHE_GOODBYE_MS;
+        }
+        return;
+    }
+
+    if (!found) {
+        if (s_cache_len >= CONFIG_MDNS_RECORD_CACHE_SIZE) {
+            evict_one();
+        }
+        found = record_copy(record);
+        if (!found) {
+            return;
+        }
+        found->next = s_cache;
+        s_cache = found;
+        s_cache_len++;
+        ESP_LOGD(TAG, "Cached record type %d (%d entries)", record->type, (int)s_cache_len);
+    }
+    found->ttl = ttl;
+    found->expires = now + ttl * 1000;
+}
+
+const mdns_cache_record_t *mdns_priv_cache_find(const mdns_cache_record_t *owner, const mdns_cache_record_t *prev)
+{
+    uint32_t now = now_ms();
+    const mdns_cache_record_t *it = prev ? prev->next : s_cache;
+    for (; it; it = it->next) {
+        if (it->ttl && !is_expired(it, now) && same_owner(it, owner)) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+uint32_t mdns_priv_cache_remaining_ttl(const mdns_cache_record_t *record)
+{
+    uint32_t now = now_ms();
+    if (is_expired(record, now)) {
+        return 0;
+    }
+    return (record->expires - now) / 1000;
+}
+
+bool mdns_priv_cache_is_known_answer(const mdns_cache_record_t *record)
+{
+    return record->ttl && mdns_priv_cache_remaining_ttl(record) > record->ttl / 2;
+}
+
+void mdns_priv_cache_remove_if(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    mdns_cache_record_t **it = &s_cache;
+    while (*it) {
+        mdns_cache_record_t *record = *it;
+        if (record->tcpip_if == tcpip_if && record->ip_protocol == ip_protocol) {
+            *it = record->next;
+            record_free(record);
+            s_cache_len--;
+        } else {
+            it = &record->next;
+        }
+    }
+}
+
+void mdns_priv_cache_free(void)
+{
+    while (s_cache) {
+        mdns_cache_record_t *record = s_cache;
+        s_cache = s_cache->next;
+        record_free(record);
+    }
+    s_cache_len = 0;
+}
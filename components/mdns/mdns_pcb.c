@@ -14,6 +14,9 @@
 #include "esp_log.h"
 #include "esp_random.h"
 #include "mdns_responder.h"
+#ifdef CONFIG_MDNS_RECORD_CACHE
+#include "mdns_cache.h"
+#endif
 
 #define PCB_STATE_IS_PROBING(s) (s->state > PCB_OFF && s->state < PCB_ANNOUNCE_1)
 #define PCB_STATE_IS_ANNOUNCING(s) (s->state > PCB_PROBE_3 && s->state < PCB_RUNNING)
@@ -156,6 +159,9 @@ void mdns_priv_pcb_disable(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 
     if (mdns_priv_if_ready(tcpip_if, ip_protocol)) {
         mdns_priv_clear_tx_queue_if(tcpip_if, ip_protocol);
+#ifdef CONFIG_MDNS_RECORD_CACHE
+        mdns_priv_cache_remove_if(tcpip_if, ip_protocol);
+#endif
         deinit_pcb(tcpip_if, ip_protocol);
         mdns_if_t other_if = mdns_priv_netif_get_other_interface(tcpip_if);
         if (other_if != MDNS_MAX_INTERFACES && s_pcbs[other_if][ip_protocol].state == PCB_DUP) {
@@ -15,6 +15,10 @@
 #include "mdns_netif.h"
 #include "mdns_responder.h"
 #include "mdns_service.h"
+#include "mdns_receive.h"
+#ifdef CONFIG_MDNS_RECORD_CACHE
+#include "mdns_cache.h"
+#endif
 
 static const char *TAG = "mdns_querier";
 static mdns_search_once_t *s_search_once;
@@ -93,13 +97,154 @@ static void search_finish(mdns_search_once_t *search)
     xSemaphoreGive(search->done_semaphore);
 }
 
+#ifdef CONFIG_MDNS_RECORD_CACHE
+/**
+ * @brief  Add cached A/AAAA records of the host to the search results
+ */
+static void search_add_cached_ips(mdns_search_once_t *search, const char *hostname, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    static const uint16_t types[] = {
+#ifdef CONFIG_LWIP_IPV4
+        MDNS_TYPE_A,
+#endif
+#ifdef CONFIG_LWIP_IPV6
+        MDNS_TYPE_AAAA,
+#endif
+    };
+    mdns_cache_record_t owner = {
+        .tcpip_if = tcpip_if,
+        .ip_protocol = ip_protocol,
+        .hostname = hostname,
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        const mdns_cache_record_t *record = NULL;
+        owner.type = types[i];
+        while ((record = mdns_priv_cache_find(&owner, record)) != NULL) {
+            esp_ip_addr_t addr = record->addr;
+            mdns_priv_query_result_add_ip(search, hostname, &addr, tcpip_if, ip_protocol,
+                                          mdns_priv_cache_remaining_ttl(record));
+        }
+    }
+}
+
+/**
+ * @brief  Complete a PTR search result with cached SRV, TXT and address records of the instance
+ */
+static void search_complete_cached_instance(mdns_search_once_t *search, mdns_result_t *r, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
+{
+    mdns_cache_record_t owner = {
+        .type = MDNS_TYPE_SRV,
+        .tcpip_if = tcpip_if,
+        .ip_protocol = ip_protocol,
+        .instance = r->instance_name,
+        .service = search->service,
+        .proto = search->proto,
+    };
+    const mdns_cache_record_t *record = mdns_priv_cache_find(&owner, NULL);
+    if (record && !r->hostname) {
+        r->hostname = mdns_mem_strdup(record->hostname);
+        r->port = record->port;
+        mdns_priv_query_update_result_ttl(r, mdns_priv_cache_remaining_ttl(record));
+    }
+    owner.type = MDNS_TYPE_TXT;
+    record = mdns_priv_cache_find(&owner, NULL);
+    if (record && !r->txt) {
+        mdns_txt_item_t *txt = NULL;
+        uint8_t *txt_value_len = NULL;
+        size_t txt_count = 0;
+        mdns_priv_result_txt_create(record->txt, record->txt_len, &txt, &txt_value_len, &txt_count);
+        if (txt_count) {
+            r->txt = txt;
+            r->txt_value_len = txt_value_len;
+            r->txt_count = txt_count;
+            mdns_priv_query_update_result_ttl(r, mdns_priv_cache_remaining_ttl(record));
+        }
+    }
+    if (r->hostname) {
+        search_add_cached_ips(search, r->hostname, tcpip_if, ip_protocol);
+    }
+}
+
+/**
+ * @brief  Fill search results from the record cache
+ */
+static void search_add_cached(mdns_search_once_t *search)
+{
+    for (uint8_t i = 0; i < MDNS_MAX_INTERFACES; i++) {
+        for (uint8_t j = 0; j < MDNS_IP_PROTOCOL_MAX; j++) {
+            mdns_if_t tcpip_if = (mdns_if_t) i;
+            mdns_ip_protocol_t ip_protocol = (mdns_ip_protocol_t) j;
+            mdns_cache_record_t owner = {
+                .type = search->type,
+                .tcpip_if = tcpip_if,
+                .ip_protocol = ip_protocol,
+                .instance = search->instance,
+                .service = search->service,
+                .proto = search->proto,
+                .hostname = search->instance,
+            };
+            const mdns_cache_record_t *record = NULL;
+
+            switch (search->type) {
+            case MDNS_TYPE_PTR:
+                while ((record = mdns_priv_cache_find(&owner, record)) != NULL) {
+                    mdns_result_t *r = mdns_priv_query_result_add_ptr(search, record->instance, search->service, search->proto,
+                                                                      tcpip_if, ip_protocol, mdns_priv_cache_remaining_ttl(record));
+                    if (r) {
+                        search_complete_cached_instance(search, r, tcpip_if, ip_protocol);
+                    }
+                }
+                break;
+            case MDNS_TYPE_SRV:
+                while ((record = mdns_priv_cache_find(&owner, record)) != NULL) {
+                    mdns_priv_query_result_add_srv(search, record->hostname, record->port, tcpip_if, ip_protocol,
+                                                   mdns_priv_cache_remaining_ttl(record));
+                    search_add_cached_ips(search, record->hostname, tcpip_if, ip_protocol);
+                }
+                break;
+            case MDNS_TYPE_TXT:
+                record = mdns_priv_cache_find(&owner, NULL);
+                if (record) {
+                    mdns_txt_item_t *txt = NULL;
+                    uint8_t *txt_value_len = NULL;
+                    size_t txt_count = 0;
+                    mdns_priv_result_txt_create(record->txt, record->txt_len, &txt, &txt_value_len, &txt_count);
+                    if (txt_count) {
+                        mdns_priv_query_result_add_txt(search, txt, txt_value_len, txt_count, tcpip_if, ip_protocol,
+                                                       mdns_priv_cache_remaining_ttl(record));
+                    }
+                }
+                break;
+            case MDNS_TYPE_A:
+            case MDNS_TYPE_AAAA:
+                if (search->instance) {
+                    search_add_cached_ips(search, search->instance, tcpip_if, ip_protocol);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+#endif /* CONFIG_MDNS_RECORD_CACHE */
+
 /**
  * @brief  Add new search to the search chain
+ *
+ * Fresh records from the cache are added to the results first; a search that
+ * is already satisfied by them finishes without sending any query.
  */
 void search_add(mdns_search_once_t *search)
 {
     search->next = s_search_once;
     s_search_once = search;
+#ifdef CONFIG_MDNS_RECORD_CACHE
+    search_add_cached(search);
+    if (search->max_results && search->num_results >= search->max_results) {
+        search_finish(search);
+    }
+#endif
 }
 
 /**
@@ -327,7 +472,6 @@ mdns_search_once_t *mdns_priv_query_find(mdns_name_t *name, uint16_t type, mdns_
  */
 static mdns_tx_packet_t *create_search_packet(mdns_search_once_t *search, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_result_t *r = NULL;
     mdns_tx_packet_t *packet = mdns_priv_alloc_packet(tcpip_if, ip_protocol);
     if (!packet) {
         return NULL;
@@ -396,8 +540,43 @@ static mdns_tx_packet_t *create_search_packet(mdns_search_once_t *search, mdns_i
 
     queueToEnd(mdns_out_question_t, packet->questions, q);
 
+#ifdef CONFIG_MDNS_RECORD_CACHE
+    if (search->type == MDNS_TYPE_PTR && !q->own_dynamic_memory) {
+        // known answers from the record cache, with their remaining TTL (RFC 6762 section 7.1)
+        mdns_cache_record_t owner = {
+            .type = MDNS_TYPE_PTR,
+            .tcpip_if = tcpip_if,
+            .ip_protocol = ip_protocol,
+            .service = search->service,
+            .proto = search->proto,
+        };
+        const mdns_cache_record_t *record = NULL;
+        while ((record = mdns_priv_cache_find(&owner, record)) != NULL) {
+            if (!mdns_priv_cache_is_known_answer(record)) {
+                continue;
+            }
+            mdns_out_answer_t *a = (mdns_out_answer_t *)mdns_mem_malloc(sizeof(mdns_out_answer_t));
+            if (!a) {
+                HOOK_MALLOC_FAILED;
+                mdns_priv_free_tx_packet(packet);
+                return NULL;
+            }
+            a->type = MDNS_TYPE_PTR;
+            a->service = NULL;
+            a->host = NULL;
+            a->custom_instance = record->instance;
+            a->custom_service = search->service;
+            a->custom_proto = search->proto;
+            a->ttl = mdns_priv_cache_remaining_ttl(record);
+            a->bye = false;
+            a->flush = false;
+            a->next = NULL;
+            queueToEnd(mdns_out_answer_t, packet->answers, a);
+        }
+    }
+#else
     if (search->type == MDNS_TYPE_PTR) {
-        r = search->result;
+        mdns_result_t *r = search->result;
         while (r) {
             //full record on the same interface is available
             if (r->esp_netif != mdns_priv_get_esp_netif(tcpip_if) || r->ip_protocol != ip_protocol || r->instance_name == NULL || r->hostname == NULL || r->addr == NULL) {
@@ -415,6 +594,7 @@ static mdns_tx_packet_t *create_search_packet(mdns_search_once_t *search, mdns_i
             a->custom_instance = r->instance_name;
             a->custom_service = search->service;
             a->custom_proto = search->proto;
+            a->ttl = 0;
             a->bye = false;
             a->flush = false;
             a->next = NULL;
@@ -422,6 +602,7 @@ static mdns_tx_packet_t *create_search_packet(mdns_search_once_t *search, mdns_i
             r = r->next;
         }
     }
+#endif /* CONFIG_MDNS_RECORD_CACHE */
 
     return packet;
 }
@@ -21,6 +21,10 @@
 #include "mdns_querier.h"
 #include "mdns_pcb.h"
 #include "mdns_responder.h"
+#include "mdns_receive.h"
+#ifdef CONFIG_MDNS_RECORD_CACHE
+#include "mdns_cache.h"
+#endif
 
 static const char *TAG = "mdns_receive";
 
@@ -223,8 +227,8 @@ static int get_txt_item_len(const uint8_t *data, size_t len)
 /**
  * @brief  Create TXT result array from parsed TXT data
  */
-static void result_txt_create(const uint8_t *data, size_t len, mdns_txt_item_t **out_txt, uint8_t **out_value_len,
-                              size_t *out_count)
+void mdns_priv_result_txt_create(const uint8_t *data, size_t len, mdns_txt_item_t **out_txt, uint8_t **out_value_len,
+                                 size_t *out_count)
 {
     *out_txt = NULL;
     *out_count = 0;
@@ -585,6 +589,82 @@ static void remove_parsed_question(mdns_parsed_packet_t *parsed_packet, uint16_t
     }
 }
 
+#ifdef CONFIG_MDNS_RECORD_CACHE
+/**
+ * @brief  Store a record from a response of another host in the record cache
+ *
+ * @param  name     Parsed owner name of the record
+ */
+static void cache_record(const uint8_t *data, mdns_name_t *name, uint16_t type, uint32_t ttl, bool flush,
+                         const uint8_t *data_ptr, uint16_t data_len, mdns_rx_packet_t *packet)
+{
+    static mdns_name_t target;
+    size_t rdata_bound = (size_t)(data_ptr + data_len - data);
+    mdns_cache_record_t record = {
+        .type = type,
+        .tcpip_if = packet->tcpip_if,
+        .ip_protocol = packet->ip_protocol,
+        .ttl = ttl,
+    };
+
+    if (name->sub || name->invalid) {
+        return;
+    }
+    if (type == MDNS_TYPE_PTR) {
+        // only plain service types, e.g. _http._tcp.local
+        if (name->host[0] || !name->service[0] || !name->proto[0]
+                || !mdns_utils_parse_fqdn(data, data_ptr, &target, rdata_bound) || !target.host[0]) {
+            return;
+        }
+        record.service = name->service;
+        record.proto = name->proto;
+        record.instance = target.host;
+    } else if (type == MDNS_TYPE_SRV || type == MDNS_TYPE_TXT) {
+        if (!name->host[0] || !name->service[0] || !name->proto[0]) {
+            return;
+        }
+        record.instance = name->host;
+        record.service = name->service;
+        record.proto = name->proto;
+        if (type == MDNS_TYPE_SRV) {
+            if (data_len <= MDNS_SRV_FQDN_OFFSET
+                    || !mdns_utils_parse_fqdn(data, data_ptr + MDNS_SRV_FQDN_OFFSET, &target, rdata_bound)) {
+                return;
+            }
+            record.hostname = target.host;
+            record.port = mdns_utils_read_u16(data_ptr, MDNS_SRV_PORT_OFFSET);
+        } else {
+            record.txt = data_ptr;
+            record.txt_len = data_len;
+        }
+    }
+#ifdef CONFIG_LWIP_IPV4
+    else if (type == MDNS_TYPE_A) {
+        if (data_len < 4 || !name->host[0]) {
+            return;
+        }
+        record.hostname = name->host;
+        record.addr.type = ESP_IPADDR_TYPE_V4;
+        memcpy(&record.addr.u_addr.ip4.addr, data_ptr, 4);
+    }
+#endif
+#ifdef CONFIG_LWIP_IPV6
+    else if (type == MDNS_TYPE_AAAA) {
+        if (data_len < MDNS_ANSWER_AAAA_SIZE || !name->host[0]) {
+            return;
+        }
+        record.hostname = name->host;
+        record.addr.type = ESP_IPADDR_TYPE_V6;
+        memcpy(record.addr.u_addr.ip6.addr, data_ptr, MDNS_ANSWER_AAAA_SIZE);
+    }
+#endif
+    else {
+        return;
+    }
+    mdns_priv_cache_add(&record, flush);
+}
+#endif /* CONFIG_MDNS_RECORD_CACHE */
+
 /**
  * @brief  main packet parser
  *
@@ -786,6 +866,9 @@ static void mdns_parse_packet(mdns_rx_packet_t *packet)
             uint32_t ttl = mdns_utils_read_u32(content, MDNS_TTL_OFFSET);
             uint16_t data_len = mdns_utils_read_u16(content, MDNS_LEN_OFFSET);
             const uint8_t *data_ptr = content + MDNS_DATA_OFFSET;
+#ifdef CONFIG_MDNS_RECORD_CACHE
+            bool cache_flush = !!(mdns_class & 0x8000);
+#endif
             mdns_class &= 0x7FFF;
 
             content = data_ptr + data_len;
@@ -822,6 +905,9 @@ static void mdns_parse_packet(mdns_rx_packet_t *packet)
                     //skip this record
                     continue;
                 }
+#ifdef CONFIG_MDNS_RECORD_CACHE
+                cache_record(data, name, type, ttl, cache_flush, data_ptr, data_len, packet);
+#endif
                 search_result = mdns_priv_query_find(name, type, packet->tcpip_if, packet->ip_protocol);
 #ifdef CONFIG_MDNS_ENABLE_BROWSE
                 browse_result = mdns_priv_browse_find(name, type, packet->tcpip_if, packet->ip_protocol);
@@ -1061,7 +1147,7 @@ static void mdns_parse_packet(mdns_rx_packet_t *packet)
                 if (browse_result && !mdns_utils_str_null_or_empty(browse_result_instance)
                         && !mdns_utils_str_null_or_empty(browse_result_service)
                         && !mdns_utils_str_null_or_empty(browse_result_proto)) {
-                    result_txt_create(data_ptr, data_len, &txt, &txt_value_len, &txt_count);
+                    mdns_priv_result_txt_create(data_ptr, data_len, &txt, &txt_value_len, &txt_count);
                     mdns_priv_browse_result_add_txt(browse_result, browse_result_instance, browse_result_service,
                                                     browse_result_proto,
                                                     txt, txt_value_len, txt_count, packet->tcpip_if,
@@ -1089,7 +1175,7 @@ static void mdns_parse_packet(mdns_rx_packet_t *packet)
                             }
                         }
                         if (!result->txt) {
-                            result_txt_create(data_ptr, data_len, &txt, &txt_value_len, &txt_count);
+                            mdns_priv_result_txt_create(data_ptr, data_len, &txt, &txt_value_len, &txt_count);
                             if (txt_count) {
                                 result->txt = txt;
                                 result->txt_count = txt_count;
@@ -1097,7 +1183,7 @@ static void mdns_parse_packet(mdns_rx_packet_t *packet)
                             }
                         }
                     } else {
-                        result_txt_create(data_ptr, data_len, &txt, &txt_value_len, &txt_count);
+                        mdns_priv_result_txt_create(data_ptr, data_len, &txt, &txt_value_len, &txt_count);
                         if (txt_count) {
                             mdns_priv_query_result_add_txt(search_result, txt, txt_value_len, txt_count,
                                                            packet->tcpip_if, packet->ip_protocol, ttl);
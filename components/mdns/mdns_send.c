@@ -230,6 +230,7 @@ bool mdns_priv_create_answer(mdns_out_answer_t **destination, uint16_t type, mdn
     a->service = service;
     a->host = host;
     a->custom_service = NULL;
+    a->ttl = 0;
     a->bye = bye;
     a->flush = flush;
     a->next = NULL;
@@ -786,10 +787,11 @@ static uint16_t append_question(uint8_t *packet, uint16_t *index, mdns_out_quest
  * @param  index        offset in the packet
  * @param  server       the server that is hosting the service
  * @param  service      the service to add record for
+ * @param  ttl          record TTL, 0 for the default
  *
  * @return length of added data: 0 on error or length on success
  */
-static uint16_t append_ptr_record(uint8_t *packet, uint16_t *index, const char *instance, const char *service, const char *proto, bool flush, bool bye)
+static uint16_t append_ptr_record(uint8_t *packet, uint16_t *index, const char *instance, const char *service, const char *proto, uint32_t ttl, bool flush, bool bye)
 {
     const char *str[4];
     uint16_t record_length = 0;
@@ -810,7 +812,7 @@ static uint16_t append_ptr_record(uint8_t *packet, uint16_t *index, const char *
     }
     record_length += part_length;
 
-    part_length = append_type(packet, index, MDNS_ANSWER_PTR, false, bye ? 0 : MDNS_ANSWER_PTR_TTL);
+    part_length = append_type(packet, index, MDNS_ANSWER_PTR, false, bye ? 0 : (ttl ? ttl : MDNS_ANSWER_PTR_TTL));
     if (!part_length) {
         return 0;
     }
@@ -884,7 +886,7 @@ static uint8_t append_service_ptr_answers(uint8_t *packet, uint16_t *index, mdns
     uint8_t appended_answers = 0;
 
     if (append_ptr_record(packet, index, mdns_utils_get_service_instance_name(service), service->service,
-                          service->proto, flush, bye) <= 0) {
+                          service->proto, 0, flush, bye) <= 0) {
         return appended_answers;
     }
     appended_answers++;
@@ -1250,7 +1252,7 @@ static uint8_t append_answer(uint8_t *packet, uint16_t *index, mdns_out_answer_t
         } else {
             return append_ptr_record(packet, index,
                                      answer->custom_instance, answer->custom_service, answer->custom_proto,
-                                     answer->flush, answer->bye) > 0;
+                                     answer->ttl, answer->flush, answer->bye) > 0;
         }
     } else if (answer->type == MDNS_TYPE_SRV) {
         return append_srv_record(packet, index, answer->service, answer->flush, answer->bye) > 0;
@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include "mdns_private.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Record learned from a response of another host
+ *
+ * The owner name depends on the type:
+ *  - PTR:    service.proto -> instance
+ *  - SRV:    instance.service.proto -> hostname:port
+ *  - TXT:    instance.service.proto -> txt
+ *  - A/AAAA: hostname -> addr
+ */
+typedef struct mdns_cache_record_s {
+    struct mdns_cache_record_s *next;
+    uint16_t type;
+    mdns_if_t tcpip_if;
+    mdns_ip_protocol_t ip_protocol;
+    const char *instance;
+    const char *service;
+    const char *proto;
+    const char *hostname;
+    uint16_t port;
+    esp_ip_addr_t addr;
+    const uint8_t *txt;     // raw TXT RDATA
+    uint16_t txt_len;
+    uint32_t ttl;           // TTL as received (seconds)
+    uint32_t expires;       // expiry time (ms, tick based)
+} mdns_cache_record_t;
+
+/**
+ * @brief Add or refresh a record in the cache
+ *
+ * @param record Record to store; strings and TXT data are copied
+ * @param flush  Cache-flush bit of the record (RFC 6762 section 10.2)
+ *
+ * @note A TTL of zero (goodbye) makes the record expire in one second,
+ *       it is not returned by mdns_priv_cache_find() in the meantime.
+ *       Called from the packet parser (mdns_receive.c)
+ */
+void mdns_priv_cache_add(const mdns_cache_record_t *record, bool flush);
+
+/**
+ * @brief Find the next fresh record with the same owner as @p owner
+ *
+ * @param owner Record template: type, interface, protocol and owner name are compared
+ * @param prev  Previously returned record, NULL to start from the beginning
+ *
+ * @return matching record or NULL; valid until the cache is modified
+ */
+const mdns_cache_record_t *mdns_priv_cache_find(const mdns_cache_record_t *owner, const mdns_cache_record_t *prev);
+
+/**
+ * @brief Remaining TTL of the record in seconds
+ */
+uint32_t mdns_priv_cache_remaining_ttl(const mdns_cache_record_t *record);
+
+/**
+ * @brief Check if the record can be listed as a known answer
+ *
+ * @return true if more than half of the original TTL remains (RFC 6762 section 7.1)
+ */
+bool mdns_priv_cache_is_known_answer(const mdns_cache_record_t *record);
+
+/**
+ * @brief Remove all records learned on the interface
+ * @note Called when the interface is disabled
+ */
+void mdns_priv_cache_remove_if(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
+
+/**
+ * @brief Free all cached records
+ * @note Called from mdns_free()
+ */
+void mdns_priv_cache_free(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -300,6 +300,7 @@ typedef struct mdns_out_answer_s {
     const char *custom_instance;
     const char *custom_service;
     const char *custom_proto;
+    uint32_t ttl;   // TTL of a custom PTR answer, 0 for the default
 } mdns_out_answer_t;
 
 typedef struct mdns_tx_packet_s {
@@ -19,6 +19,15 @@ extern "C" {
 */
 void mdns_priv_receive_action(mdns_action_t *action, mdns_action_subtype_t type);
 
+/**
+ * @brief Create TXT result array from TXT record data
+ *
+ * @note Called from the packet parser and when filling results from the record cache;
+ *       on success the caller owns the returned arrays
+ */
+void mdns_priv_result_txt_create(const uint8_t *data, size_t len, mdns_txt_item_t **out_txt, uint8_t **out_value_len,
+                                 size_t *out_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,9 +47,16 @@ uint32_t esp_random(void)
     return 0;
 }
 
+static TickType_t s_tick_count;
+
+void set_tick_count(uint32_t ticks)
+{
+    s_tick_count = ticks;
+}
+
 TickType_t xTaskGetTickCount(void)
 {
-    return 0;
+    return s_tick_count;
 }
 
 int esp_netif_get_all_ip6(esp_netif_t *esp_netif, esp_ip6_addr_t if_ip6[])
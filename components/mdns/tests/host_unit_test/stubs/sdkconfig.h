@@ -768,6 +768,8 @@
 #define CONFIG_MDNS_TIMER_PERIOD_MS 100
 #define CONFIG_MDNS_ENABLE_CONSOLE_CLI 1
 #define CONFIG_MDNS_ENABLE_BROWSE 1
+#define CONFIG_MDNS_RECORD_CACHE 1
+#define CONFIG_MDNS_RECORD_CACHE_SIZE 64
 #define CONFIG_MDNS_MULTIPLE_INSTANCE 1
 
 /* List of deprecated options */
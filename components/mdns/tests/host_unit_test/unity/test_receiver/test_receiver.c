@@ -4,12 +4,16 @@
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
 
+#include <stdlib.h>
 #include "unity.h"
 #include "create_test_packet.h"
 #include "unity_main.h"
 #include "mock_mdns_pcb.h"
 #include "mock_mdns_send.h"
 #include "mdns_private.h"
+#include "mdns_cache.h"
+#include "mdns_querier.h"
+#include "mdns_mem_caps.h"
 
 static void test_mdns_hostname_queries(void)
 {
@@ -82,6 +86,166 @@ static void test_mdns_reject_short_packet(void)
     }
 }
 
+static void send_printer_ptr(uint32_t ttl)
+{
+    uint8_t ptr_data[200];
+    size_t ptr_data_len = encode_dns_name(ptr_data, "office._printer._tcp.local");
+    mdns_test_answer_t answers[] = {
+        { "_printer._tcp.local", MDNS_TYPE_PTR, 1, ttl, ptr_data_len, ptr_data }
+    };
+    size_t packet_len;
+    uint8_t *packet = create_mdns_test_packet(NULL, 0, answers, 1, NULL, 0, &packet_len);
+    TEST_ASSERT_NOT_NULL(packet);
+    send_packet(true, false, packet, packet_len);
+    free(packet);
+}
+
+/*
+ * Records from responses of other hosts are kept in the record cache
+ * and a goodbye (TTL=0) removes them from lookups.
+ */
+static void test_mdns_response_is_cached(void)
+{
+    mdns_cache_record_t owner = {
+        .type = MDNS_TYPE_PTR,
+        .tcpip_if = 0,
+        .ip_protocol = MDNS_IP_PROTOCOL_V4,
+        .service = "_printer",
+        .proto = "_tcp",
+    };
+
+    send_printer_ptr(120);
+    const mdns_cache_record_t *record = mdns_priv_cache_find(&owner, NULL);
+    TEST_ASSERT_NOT_NULL(record);
+    TEST_ASSERT_EQUAL_STRING("office", record->instance);
+    TEST_ASSERT_TRUE(mdns_priv_cache_is_known_answer(record));
+
+    send_printer_ptr(0);
+    TEST_ASSERT_NULL(mdns_priv_cache_find(&owner, NULL));
+    mdns_priv_cache_free();
+}
+
+static void send_printer_a(uint32_t ip, bool flush)
+{
+    uint8_t a_data[4] = { ip >> 24, ip >> 16, ip >> 8, ip };
+    mdns_test_answer_t answers[] = {
+        { "printer.local", MDNS_TYPE_A, flush ? 0x8001 : 1, 120, sizeof(a_data), a_data }
+    };
+    size_t packet_len;
+    uint8_t *packet = create_mdns_test_packet(NULL, 0, answers, 1, NULL, 0, &packet_len);
+    TEST_ASSERT_NOT_NULL(packet);
+    send_packet(true, false, packet, packet_len);
+    free(packet);
+}
+
+static size_t count_printer_a(void)
+{
+    mdns_cache_record_t owner = {
+        .type = MDNS_TYPE_A,
+        .tcpip_if = 0,
+        .ip_protocol = MDNS_IP_PROTOCOL_V4,
+        .hostname = "printer",
+    };
+    size_t count = 0;
+    const mdns_cache_record_t *record = NULL;
+    while ((record = mdns_priv_cache_find(&owner, record)) != NULL) {
+        count++;
+    }
+    return count;
+}
+
+/*
+ * A record with the cache-flush bit retires the other records of the same owner
+ * received more than one second ago (RFC 6762, section 10.2), shared records stay.
+ */
+static void test_mdns_cache_flush_bit(void)
+{
+    set_tick_count(0);
+    send_printer_a(0xC0A8010A, false);
+    set_tick_count(2000);
+    send_printer_a(0xC0A8010B, false);
+    TEST_ASSERT_EQUAL(2, count_printer_a());
+
+    set_tick_count(4000);
+    send_printer_a(0xC0A8010C, true);
+    TEST_ASSERT_EQUAL(3, count_printer_a());
+    set_tick_count(5001);
+    TEST_ASSERT_EQUAL(1, count_printer_a());
+
+    set_tick_count(0);
+    mdns_priv_cache_free();
+}
+
+static size_t s_known_answers_len;
+
+static mdns_tx_packet_t *mdns_priv_alloc_packet_Callback(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol, int cmock_num_calls)
+{
+    mdns_tx_packet_t *packet = calloc(1, sizeof(mdns_tx_packet_t));
+    TEST_ASSERT_NOT_NULL(packet);
+    packet->tcpip_if = tcpip_if;
+    packet->ip_protocol = ip_protocol;
+    return packet;
+}
+
+static void mdns_priv_dispatch_tx_packet_Callback(mdns_tx_packet_t *packet, int cmock_num_calls)
+{
+    s_known_answers_len = 0;
+    for (mdns_out_answer_t *a = packet->answers; a; a = a->next) {
+        s_known_answers_len++;
+        TEST_ASSERT_EQUAL(MDNS_TYPE_PTR, a->type);
+        TEST_ASSERT_EQUAL_STRING("office", a->custom_instance);
+        TEST_ASSERT_EQUAL_STRING("_printer", a->custom_service);
+        TEST_ASSERT_EQUAL_STRING("_tcp", a->custom_proto);
+        TEST_ASSERT_EQUAL(120 - 10, a->ttl);
+    }
+}
+
+static void mdns_priv_free_tx_packet_Callback(mdns_tx_packet_t *packet, int cmock_num_calls)
+{
+    while (packet->questions) {
+        mdns_out_question_t *q = packet->questions;
+        packet->questions = q->next;
+        mdns_mem_free(q);
+    }
+    while (packet->answers) {
+        mdns_out_answer_t *a = packet->answers;
+        packet->answers = a->next;
+        mdns_mem_free(a);
+    }
+    free(packet);
+}
+
+/*
+ * PTR queries list cached instances as known answers with their remaining TTL,
+ * but only while more than half of the TTL is left (RFC 6762, section 7.1).
+ */
+static void test_mdns_query_known_answers(void)
+{
+    mdns_search_once_t search = {
+        .type = MDNS_TYPE_PTR,
+        .service = "_printer",
+        .proto = "_tcp",
+    };
+    mdsn_priv_pcb_is_inited_IgnoreAndReturn(true);
+    mdns_priv_alloc_packet_Stub(mdns_priv_alloc_packet_Callback);
+    mdns_priv_dispatch_tx_packet_Stub(mdns_priv_dispatch_tx_packet_Callback);
+    mdns_priv_free_tx_packet_Stub(mdns_priv_free_tx_packet_Callback);
+
+    set_tick_count(0);
+    send_printer_ptr(120);
+    set_tick_count(10 * 1000);
+    mdns_priv_query_send(&search, 0, MDNS_IP_PROTOCOL_V4);
+    TEST_ASSERT_EQUAL(1, s_known_answers_len);
+
+    // less than half of the TTL left, the answer has to be refreshed
+    set_tick_count(61 * 1000);
+    mdns_priv_query_send(&search, 0, MDNS_IP_PROTOCOL_V4);
+    TEST_ASSERT_EQUAL(0, s_known_answers_len);
+
+    set_tick_count(0);
+    mdns_priv_cache_free();
+}
+
 static void mdns_priv_create_answer_from_parsed_packet_Callback(mdns_parsed_packet_t* parsed_packet, int cmock_num_calls)
 {
     printf("callback\n");
@@ -112,5 +276,11 @@ void run_unity_tests(void)
 
     RUN_TEST(test_mdns_reject_short_packet);
 
+    RUN_TEST(test_mdns_response_is_cached);
+
+    RUN_TEST(test_mdns_cache_flush_bit);
+
+    RUN_TEST(test_mdns_query_known_answers);
+
     UNITY_END();
 }
@@ -8,3 +8,6 @@
 
 void send_packet(bool ip4, bool mdns_port, uint8_t*data, size_t len);
 void send_test_packet_multiple(uint8_t* packet, size_t packet_len);
+
+// Moves the time returned by the xTaskGetTickCount() stub
+void set_tick_count(uint32_t ticks);